@@ -57,6 +57,7 @@ int main(int argc, char **argv) {
 	bool syntax_only;
 	string input_file;
 	string output_file;
+	string bounds_file;
 
 	po::options_description visible_options("OPTIONS");
 	visible_options.add_options()
@@ -66,7 +67,9 @@ int main(int argc, char **argv) {
 	    ("symbols-print", po::bool_switch(&symbols_print), "prints all symbols and their memory location")
 	    ("syntax-only", po::bool_switch(&syntax_only), "performs a syntax check only and does not produce any output")
 	    ("include-path,I", po::value<vector<string> >(), "Add the directory to the list of directories to be search for includes.")
-	    ("output-file,o", po::value<string>(&output_file), "Write output to the specified file.  Use - for stdout.");
+	    ("output-file,o", po::value<string>(&output_file), "Write output to the specified file.  Use - for stdout.")
+	    ("bounds", po::value<string>(&bounds_file), "Write the loop bounds given with .BOUND to the specified file, "
+	    		"for dcpu-wcet.");
 
 	po::options_description hidden_options("Hidden options");
 	hidden_options.add_options()
@@ -148,6 +151,12 @@ int main(int argc, char **argv) {
 				fout.close();
 				remove(output_file.c_str());
 			}
+		} else if (bounds_file.length() != 0 && mode == compiler_mode::NORMAL) {
+			ofstream bounds(bounds_file, ios_base::out | ios_base::trunc);
+			_compiler.write_bounds(bounds);
+			if (!bounds) {
+				throw runtime_error(str(boost::format("Failed to write %s: %s") % bounds_file % strerror(errno)));
+			}
 		}
 	} catch (std::exception &e) {
 		cerr << e.what() << endl;
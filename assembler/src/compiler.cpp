@@ -437,6 +437,18 @@ namespace dcpu { namespace assembler {
 		}
 	}
 
+	void compiler::write_bounds(std::ostream &out) {
+		uint32_t pc = 0;
+		for (auto &stmt : statements) {
+			auto bound = boost::get<bound_directive>(&stmt);
+			if (bound) {
+				out << boost::format("%#06x %d") % pc % bound->count << endl;
+			}
+
+			pc += output_size(stmt, pc);
+		}
+	}
+
 	void compiler::print_ast(std::ostream &out) {
 		for (auto &stmt : statements) {
 			out << stmt << endl;
@@ -190,6 +190,12 @@ namespace dcpu { namespace assembler {
 		compiler(log &logger, symbol_table& table, statement_list &statement);
 
 		void compile(std::ostream &out, compiler_mode mode=compiler_mode::NORMAL, endianness format=endianness::BIG);
+
+		/**
+		 * Writes the address and count of each .BOUND directive, one per line,
+		 * for the cycle estimator.  Only valid after a successful compile.
+		 */
+		void write_bounds(std::ostream &out);
 	};
 
 	compile_result compile(log &logger, const argument &arg);
@@ -186,7 +186,7 @@ namespace dcpu { namespace assembler {
 		}
 
 		bool operator()(const unary_operation &expr) const {
-			return apply_visitor(*this, expr.operand);
+			return expr._operator != unary_operator::INDIRECT && apply_visitor(*this, expr.operand);
 		}
 
 		bool operator()(const invalid_expression&) const {
@@ -226,7 +226,7 @@ namespace dcpu { namespace assembler {
 		}
 
 		bool operator()(const unary_operation &expr) const {
-			return apply_visitor(*this, expr.operand);
+			return expr._operator != unary_operator::INDIRECT && apply_visitor(*this, expr.operand);
 		}
 
 		bool operator()(const invalid_expression&) const {
@@ -418,6 +418,8 @@ namespace dcpu { namespace assembler {
 		case unary_operator::BITWISE_NOT:
 			value = ~value;
 			break;
+		case unary_operator::INDIRECT:
+			throw invalid_argument("memory contents are not known at assembly time");
 		}
 
 		return evaluated_expression(operand.location, value);
@@ -481,6 +483,8 @@ namespace dcpu { namespace assembler {
 			return stream << "!";
 		case unary_operator::BITWISE_NOT:
 			return stream << "~";
+		case unary_operator::INDIRECT:
+			return stream << "[]";
 		default:
 			return stream << "<Unknown unary_operator " << static_cast<int>(op) << ">";
 		}
@@ -530,6 +534,10 @@ namespace dcpu { namespace assembler {
 	}
 
 	ostream& operator<< (ostream& stream, const unary_operation &expr) {
+		if (expr._operator == unary_operator::INDIRECT) {
+			return stream << "[" << expr.operand << "]";
+		}
+
 		return stream << expr._operator << "(" << expr.operand << ")";
 	}
 
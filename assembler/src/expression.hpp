@@ -48,7 +48,8 @@ namespace dcpu { namespace assembler {
 		PLUS,
 		MINUS,
 		NOT,
-		BITWISE_NOT
+		BITWISE_NOT,
+		INDIRECT
 	};
 
 	/*************************************************************************
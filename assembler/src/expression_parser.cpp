@@ -76,8 +76,8 @@ namespace dcpu { namespace assembler {
 		return parse_binary_operation(current_token, &expression_parser::parse_bitwise_shift, {
 			operator_definition(binary_operator::GTE, bind(&token::is_operator, _1, operator_type::GTE)),
 			operator_definition(binary_operator::LTE, bind(&token::is_operator, _1, operator_type::LTE)),
-			operator_definition(binary_operator::GT,  bind(&token::is_character, _1, '<')),
-			operator_definition(binary_operator::LT,  bind(&token::is_character, _1, '>'))
+			operator_definition(binary_operator::LT,  bind(&token::is_character, _1, '<')),
+			operator_definition(binary_operator::GT,  bind(&token::is_character, _1, '>'))
 		});
 	}
 
@@ -130,6 +130,10 @@ namespace dcpu { namespace assembler {
 	bool expression_parser::is_expression_valid(const operator_definition& definition, const location_ptr& location,
 			expression &left, expression &right) {
 
+		if (is_runtime_operands_allowed()) {
+			return true;
+		}
+
 		bool left_invalid = (definition.left_literal || !is_register_in_expressions_allowed())
 				&& !evaluates_to_literal(left);
 		bool right_invalid = (definition.right_literal || !is_register_in_expressions_allowed())
@@ -159,7 +163,7 @@ namespace dcpu { namespace assembler {
 		}
 
 		expression operand = parse_unary(next_token());
-		if (!evaluates_to_literal(operand)) {
+		if (!is_runtime_operands_allowed() && !evaluates_to_literal(operand)) {
 			logger.error(current_token.location, boost::format("non-constant operand for unary operator '%s'")
 					% _operator);
 			return invalid_expression(current_token.location);
@@ -179,6 +183,10 @@ namespace dcpu { namespace assembler {
 			return parse_literal(current_token);
 		} else if (current_token.is_character('$')) {
 			return current_position_operand(current_token.location);
+		} else if (current_token.is_character('[') && is_indirection_allowed()) {
+			return parse_indirection(next_token());
+		} else if (current_token.is_stack_operation() && is_indirection_allowed()) {
+			return parse_stack_operation(current_token);
 		} else {
 			--current;
 			logger.error(current_token.location, boost::format("expected a primary-expression before '%s'")
@@ -199,6 +207,30 @@ namespace dcpu { namespace assembler {
 		return expr;
 	}
 
+	expression expression_parser::parse_indirection(const token& current_token) {
+		expression expr = parse(current_token);
+
+		auto& next_tkn = next_token();
+		if (!next_tkn.is_character(']')) {
+			--current;
+			logger.unexpected_token(next_tkn, ']');
+		}
+
+		return unary_operation(current_token.location, unary_operator::INDIRECT, expr);
+	}
+
+	expression expression_parser::parse_stack_operation(const token& current_token) {
+		if (!current_token.is_stack_operation(stack_operation::PEEK)) {
+			logger.error(current_token.location, boost::format("'%s' modifies SP and is not allowed here")
+					% current_token.content);
+
+			return invalid_expression(current_token.location);
+		}
+
+		return unary_operation(current_token.location, unary_operator::INDIRECT,
+				register_operand(current_token.location, registers::SP));
+	}
+
 	expression expression_parser::parse_register(const token& current_token) {
 		auto _register = current_token.get_register();
 
@@ -208,12 +240,12 @@ namespace dcpu { namespace assembler {
 			return invalid_expression(current_token.location);
 		}
 
-		if (first_register) {
+		if (first_register && !is_multiple_registers_allowed()) {
 			logger.error(current_token.location, boost::format("multiple registers in expression; "
 					"first register '%s' at %s") % (*first_register)._register % (*first_register).location);
 
 			return invalid_expression(current_token.location);
-		} else {
+		} else if (!first_register) {
 			first_register = register_location(current_token.location, _register);
 		}
 
@@ -276,6 +308,18 @@ namespace dcpu { namespace assembler {
 		return allowed_flags & CURRENT_POSITION;
 	}
 
+	bool expression_parser::is_multiple_registers_allowed() {
+		return allowed_flags & MULTIPLE_REGISTERS;
+	}
+
+	bool expression_parser::is_runtime_operands_allowed() {
+		return allowed_flags & RUNTIME_OPERANDS;
+	}
+
+	bool expression_parser::is_indirection_allowed() {
+		return allowed_flags & INDIRECTION;
+	}
+
 	token& expression_parser::next_token() {
 		return next(current, end);
 	}
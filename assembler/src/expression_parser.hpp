@@ -45,6 +45,8 @@ namespace dcpu { namespace assembler {
 				const std::vector<operator_definition>&);
 		expression parse_primary(const token&);
 		expression parse_grouping(const token&);
+		expression parse_indirection(const token&);
+		expression parse_stack_operation(const token&);
 		expression parse_register(const token&);
 		expression parse_symbol(const token&);
 		expression parse_literal(const token&);
@@ -66,6 +68,9 @@ namespace dcpu { namespace assembler {
 		bool is_register_in_expressions_allowed();
 		bool is_symbols_allowed();
 		bool is_current_position_allowed();
+		bool is_multiple_registers_allowed();
+		bool is_runtime_operands_allowed();
+		bool is_indirection_allowed();
 	public:
 		expression_parser(token_iterator&, token_iterator, log&, uint32_t allowed_flags);
 
@@ -86,6 +91,9 @@ namespace dcpu { namespace assembler {
 			REGISTER_EXPRESSIONS=1 << 11,
 			SYMBOL=1 << 12,
 			CURRENT_POSITION=1 << 13,
+			MULTIPLE_REGISTERS=1 << 14,
+			RUNTIME_OPERANDS=1 << 15,
+			INDIRECTION=1 << 16,
 
 			SCALAR = 0,
 			CONSTANT = SYMBOL | CURRENT_POSITION,
@@ -93,6 +101,10 @@ namespace dcpu { namespace assembler {
 					   REGISTER_J | REGISTER_SP | REGISTER_EXPRESSIONS | CONSTANT,
 			DIRECT = REGISTER_A | REGISTER_B | REGISTER_C | REGISTER_X | REGISTER_Y | REGISTER_Z | REGISTER_I |
 					 REGISTER_J | REGISTER_SP | REGISTER_PC | REGISTER_EX | CONSTANT,
+			// evaluated against a running DCPU rather than at assembly time, e.g. debugger conditions
+			RUNTIME = REGISTER_A | REGISTER_B | REGISTER_C | REGISTER_X | REGISTER_Y | REGISTER_Z | REGISTER_I |
+					  REGISTER_J | REGISTER_SP | REGISTER_PC | REGISTER_EX | REGISTER_EXPRESSIONS |
+					  MULTIPLE_REGISTERS | RUNTIME_OPERANDS | INDIRECTION,
 
 		};
 	};
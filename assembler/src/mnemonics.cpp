@@ -124,6 +124,8 @@ namespace dcpu { namespace assembler {
 			return directives::DB;
 		} else if (iequals(mnemonic, ".fill")) {
 			return directives::FILL;
+		} else if (iequals(mnemonic, ".bound")) {
+			return directives::BOUND;
 		}
 
 		return boost::none;
@@ -285,6 +287,8 @@ namespace dcpu { namespace assembler {
 			return stream << ".EQU";
 		case directives::ORG:
 			return stream << ".ORG";
+		case directives::BOUND:
+			return stream << ".BOUND";
 		default:
 			return stream << "<Unknown directive " << static_cast<int>(directive) << ">";
 		}
@@ -62,7 +62,8 @@ namespace dcpu { namespace assembler {
 		DB,
 		EQU,
 		ORG,
-		FILL
+		FILL,
+		BOUND
 	};
 
 	enum class stack_operation : std::uint8_t {
@@ -1,6 +1,7 @@
 #include <boost/format.hpp>
 #include <boost/optional.hpp>
 #include <boost/variant.hpp>
+#include <boost/algorithm/string.hpp>
 
 #include <climits>
 #include <functional>
@@ -139,6 +140,9 @@ namespace dcpu { namespace assembler {
 		case directives::ALIGN:
 			result = statement(parse_align(current_token));
 			break;
+		case directives::BOUND:
+			result = statement(parse_bound(current_token));
+			break;
 		default:
 			logger.warning(current_token.location, boost::format("directive '%s' is not yet supported")
 					% directive);
@@ -278,12 +282,31 @@ namespace dcpu { namespace assembler {
 		return align_directive(current_token.location, value);
 	}
 
+	bound_directive parser::parse_bound(const token &current_token) {
+		auto expr = parse_expression(next_token(), expression_parser::SCALAR);
+		if (!evaluated(expr)) {
+			// the only way this can happen is if we failed to parse the expression
+			return bound_directive(current_token.location, 1);
+		}
+
+		int32_t value = evaluated_value(expr);
+		if (value <= 0) {
+			logger.error(current_token.location, "loop bound must be greater than zero");
+		}
+
+		return bound_directive(current_token.location, value);
+	}
+
 	optional_argument parser::parse_argument(const token& current_token, argument_position position) {
 		if (current_token.is_character(',') || current_token.is_terminator()) {
 			logger.unexpected_token(current_token, "an instruction argument");
 			return boost::none;
 		}
 
+		if (is_long_prefix(current_token)) {
+			return parse_long_argument(current_token, position);
+		}
+
 		if (current_token.is_character('[')) {
 			return parse_indirect_argument(next_token(), position);
 		} else if (current_token.is_stack_operation()) {
@@ -294,6 +317,51 @@ namespace dcpu { namespace assembler {
 				parse_expression(current_token, expression_parser::DIRECT), false, false));
 	}
 
+	/*
+	 * LONG is only a prefix when the start of an operand follows it, so it can still be used as a symbol
+	 * name, as in "SET A, long + 1".
+	 */
+	bool parser::is_long_prefix(const token& current_token) {
+		if (!current_token.is_symbol() || current_token.get_symbol_type() != symbol_type::NORMAL
+				|| !boost::algorithm::iequals(current_token.content, "long")) {
+			return false;
+		}
+
+		auto &next_tkn = next_token();
+		move_back();
+
+		return next_tkn.is_character('[') || next_tkn.is_character('(') || next_tkn.is_integer()
+				|| next_tkn.is_symbol() || next_tkn.is_register() || next_tkn.is_stack_operation();
+	}
+
+	/*
+	 * LONG <argument> keeps a literal or register offset in the next word even when it would fit in the
+	 * instruction, so that existing binaries can be reassembled exactly.
+	 */
+	optional_argument parser::parse_long_argument(const token& current_token, argument_position position) {
+		auto arg = parse_argument(next_token(), position);
+		if (!arg) {
+			return arg;
+		}
+
+		auto expr_arg = boost::get<expression_argument>(&*arg);
+		if (!expr_arg) {
+			logger.error(current_token.location, "LONG can not be applied to PUSH, POP or PEEK");
+			return arg;
+		}
+
+		if (expr_arg->indirect && evaluated(expr_arg->expr)) {
+			// [A] has no offset to keep, so it becomes [A + 0]
+			auto &evaled_expr = boost::get<evaluated_expression>(expr_arg->expr);
+			if (!evaled_expr.value) {
+				evaled_expr.value = 0;
+			}
+		}
+
+		expr_arg->force_next_word = true;
+		return arg;
+	}
+
 	optional_argument parser::parse_indirect_argument(const token& current_token, argument_position position) {
 		argument arg(expression_argument(current_token.location, position,
 				parse_expression(current_token, expression_parser::INDIRECT), true, false));
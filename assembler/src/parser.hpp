@@ -26,7 +26,10 @@ namespace dcpu { namespace assembler {
 		equ_directive parse_equ(const token&);
 		fill_directive parse_fill(const token&);
 		align_directive parse_align(const token&);
+		bound_directive parse_bound(const token&);
 		optional_argument parse_argument(const token&, argument_position);
+		bool is_long_prefix(const token&);
+		optional_argument parse_long_argument(const token&, argument_position);
 		optional_argument parse_indirect_argument(const token&, argument_position);
 		optional_argument parse_stack_argument(const token&, argument_position);
 		expression parse_expression(const token&, uint32_t flags);
@@ -137,6 +137,18 @@ namespace dcpu { namespace assembler {
 		return alignment == other.alignment;
 	}
 
+	/*************************************************************************
+	 *
+	 * bound_directive
+	 *
+	 *************************************************************************/
+	bound_directive::bound_directive(const location_ptr &location, uint32_t count)
+		: locatable(location), count(count) {}
+
+	bool bound_directive::operator==(const bound_directive &other) const {
+		return count == other.count;
+	}
+
 	/*************************************************************************
 	 *
 	 * calculate_size_expression
@@ -328,4 +340,8 @@ namespace dcpu { namespace assembler {
 	ostream& operator<< (ostream& stream, const align_directive &align) {
 		return stream << ".ALIGN " << align.alignment;
 	}
+
+	ostream& operator<< (ostream& stream, const bound_directive &bound) {
+		return stream << ".BOUND " << bound.count;
+	}
 }}
@@ -104,6 +104,14 @@ namespace dcpu { namespace assembler {
 		bool operator==(const align_directive&) const;
 	};
 
+	// the most times the loop starting at the next instruction runs each time it is entered
+	struct bound_directive : public locatable {
+		uint32_t count;
+
+		bound_directive(const location_ptr &location, uint32_t count);
+		bool operator==(const bound_directive&) const;
+	};
+
 	typedef boost::variant<
 			instruction,
 			label,
@@ -111,7 +119,8 @@ namespace dcpu { namespace assembler {
 			org_directive,
 			fill_directive,
 			equ_directive,
-			align_directive> statement;
+			align_directive,
+			bound_directive> statement;
 	typedef std::list<statement> statement_list;
 
 	class calculate_size_expression : public boost::static_visitor<std::uint16_t> {
@@ -152,4 +161,5 @@ namespace dcpu { namespace assembler {
 	std::ostream& operator<< (std::ostream& stream, const fill_directive &fill);
 	std::ostream& operator<< (std::ostream& stream, const equ_directive &reserve);
 	std::ostream& operator<< (std::ostream& stream, const align_directive &reserve);
+	std::ostream& operator<< (std::ostream& stream, const bound_directive &bound);
 }}
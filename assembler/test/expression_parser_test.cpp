@@ -2,6 +2,7 @@
 #include <list>
 #include <gtest/gtest.h>
 #include <boost/variant.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include <expression_parser.hpp>
 #include <lexer.hpp>
@@ -347,3 +348,38 @@ TEST(ExpressionParser, CurrentPosition) {
 		literal_operand(_location, 3))
 	));
 }
+
+TEST(ExpressionParser, RuntimeOperands) {
+	location_ptr _location = make_shared<location>("<Test>", 1, 1);
+
+	expression expr = run_expression_parser("[SP+2] == 0x8000 && A > B", expression_parser::RUNTIME);
+	EXPECT_EQ(expr, expression(binary_operation(_location, binary_operator::AND,
+		binary_operation(_location, binary_operator::EQ,
+			unary_operation(_location, unary_operator::INDIRECT,
+				binary_operation(_location, binary_operator::PLUS,
+					register_operand(_location, registers::SP),
+					literal_operand(_location, 2))),
+			literal_operand(_location, 0x8000)),
+		binary_operation(_location, binary_operator::GT,
+			register_operand(_location, registers::A),
+			register_operand(_location, registers::B)))
+	));
+	EXPECT_EQ("(([(SP + 2)] == 32768) && (A > B))", boost::lexical_cast<string>(expr));
+
+	expr = run_expression_parser("[SP] * 2", expression_parser::RUNTIME);
+	EXPECT_EQ("([SP] * 2)", boost::lexical_cast<string>(expr));
+
+	expr = run_expression_parser("-A", expression_parser::RUNTIME);
+	EXPECT_EQ("-(A)", boost::lexical_cast<string>(expr));
+}
+
+TEST(ExpressionParser, RuntimeOperandsNotAllowed) {
+	dcpu::assembler::log logger;
+	lexer lex("A * B", "<Test>", logger);
+	lex.parse();
+
+	auto begin = lex.tokens.begin();
+	expression_parser parser(begin, lex.tokens.end(), lex.logger, expression_parser::DIRECT);
+	parser.parse(next(begin, lex.tokens.end()));
+	EXPECT_TRUE(logger.has_errors());
+}
@@ -144,8 +144,8 @@ TEST(Lexer, Register) {
 }
 
 TEST(Lexer, Directive) {
-	shared_ptr<lexer> lex = run_lexer(".DW .DAT DAT .DB .DP .INCLUDE .INCBIN .FILL .ALIGN .EQU .ORG");
-	ASSERT_EQ(12, lex->tokens.size());
+	shared_ptr<lexer> lex = run_lexer(".DW .DAT DAT .DB .DP .INCLUDE .INCBIN .FILL .ALIGN .EQU .ORG .BOUND");
+	ASSERT_EQ(13, lex->tokens.size());
 	EXPECT_FALSE(lex->logger.has_errors());
 	EXPECT_FALSE(lex->logger.has_warnings());
 
@@ -161,6 +161,7 @@ TEST(Lexer, Directive) {
 	EXPECT_TRUE(it++->is_directive(directives::ALIGN));
 	EXPECT_TRUE(it++->is_directive(directives::EQU));
 	EXPECT_TRUE(it++->is_directive(directives::ORG));
+	EXPECT_TRUE(it++->is_directive(directives::BOUND));
 
 	EXPECT_TRUE(it->is_eoi());
 }
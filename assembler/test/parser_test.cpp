@@ -1,10 +1,12 @@
 #include <iostream>
+#include <sstream>
 #include <list>
 #include <memory>
 #include <gtest/gtest.h>
 #include <boost/variant.hpp>
 
 #include <parser.hpp>
+#include <compiler.hpp>
 
 using namespace std;
 using namespace dcpu::assembler;
@@ -200,6 +202,34 @@ TEST(Parser, AlignDirective) {
 	EXPECT_EQ(*it++, statement(align_directive(_location, 8)));
 }
 
+TEST(Parser, BoundDirective) {
+	location_ptr _location = make_shared<location>("<Test>", 1, 1);
+	statement_list statements;
+
+	ASSERT_NO_FATAL_FAILURE(run_parser(".bound 10\n.BOUND 4*2", 2, statements));
+
+	auto it = statements.begin();
+	EXPECT_EQ(*it++, statement(bound_directive(_location, 10)));
+	EXPECT_EQ(*it++, statement(bound_directive(_location, 8)));
+}
+
+TEST(Parser, BoundAddresses) {
+	statement_list statements;
+	ASSERT_NO_FATAL_FAILURE(run_parser("SET A, 0x1000\n.bound 16\n:loop ADD A, 1\nIFN A, 16\nSET PC, loop\n"
+			".BOUND 3\nSUB A, 1", 8, statements));
+
+	dcpu::assembler::log logger;
+	symbol_table table;
+	compiler _compiler(logger, table, statements);
+	ostringstream out;
+	_compiler.compile(out);
+	ASSERT_FALSE(logger.has_errors());
+
+	ostringstream bounds;
+	_compiler.write_bounds(bounds);
+	EXPECT_EQ("0x0002 16\n0x0005 3\n", bounds.str());
+}
+
 TEST(Parser, Register) {
 	location_ptr _location = make_shared<location>("<Test>", 1, 1);
 	statement_list statements;
@@ -399,3 +429,33 @@ TEST(Parser, StackArguments) {
 				true, false))
 	)));
 }
+
+TEST(Parser, LongArguments) {
+	location_ptr _location = make_shared<location>("<Test>", 1, 1);
+	statement_list statements;
+
+	ASSERT_NO_FATAL_FAILURE(run_parser("set LONG [A], LONG 5\nset B, LONG PICK 0\nset A, long + 1", 3, statements));
+	auto it = statements.begin();
+	EXPECT_EQ(*it++, statement(instruction(_location, opcodes::SET,
+		argument(expression_argument(_location, argument_position::A, evaluated_expression(_location, 5), false, true)),
+		argument(expression_argument(_location, argument_position::B, evaluated_expression(_location, registers::A, 0),
+				true, true))
+	)));
+
+	EXPECT_EQ(*it++, statement(instruction(_location, opcodes::SET,
+		argument(expression_argument(_location, argument_position::A, evaluated_expression(_location, registers::SP, 0),
+				true, true)),
+		argument(expression_argument(_location, argument_position::B, evaluated_expression(_location, registers::B),
+				false, false))
+	)));
+
+	// without an operand after it, long is an ordinary symbol
+	EXPECT_EQ(*it++, statement(instruction(_location, opcodes::SET,
+		argument(expression_argument(_location, argument_position::A,
+				binary_operation(_location, binary_operator::PLUS, symbol_operand(_location, "long"),
+						literal_operand(_location, 1)),
+				false, false)),
+		argument(expression_argument(_location, argument_position::B, evaluated_expression(_location, registers::A),
+				false, false))
+	)));
+}
@@ -0,0 +1,216 @@
+#include <algorithm>
+
+#include "analysis.hpp"
+
+using namespace std;
+
+namespace dcpu { namespace disassembler {
+	using emulator::DecodedInstruction;
+
+	static const uint8_t SET = 0x01;
+	static const uint8_t ADD = 0x02;
+	static const uint8_t SUB = 0x03;
+	static const uint8_t JSR = 0x01;
+	static const uint8_t HCF = 0x07;
+	static const uint8_t IAS = 0x0a;
+	static const uint8_t RFI = 0x0b;
+
+	static const uint8_t ARG_PC = 0x1c;
+	static const uint8_t ARG_INDIRECT_NEXT = 0x1e;
+
+	/*************************************************************************
+	 *
+	 * Analysis
+	 *
+	 *************************************************************************/
+
+	Analysis::Analysis(const Image &image) : image(image), limit(min<size_t>(image.size(), MAX_WORDS)),
+			memory(MAX_WORDS, 0), types(limit, DATA), visits(limit, 0), labels(limit, false), work(), codeWords(0),
+			coverageConflicts(0) {
+
+		image.read(0, memory.data(), limit);
+	}
+
+	void Analysis::addEntry(uint16_t address) {
+		addLabel(address);
+		push(address, false);
+	}
+
+	void Analysis::addCoverage(const emulator::ExecutionCoverage &coverage) {
+		DecodedInstruction instruction;
+
+		for (size_t address = 0; address < limit; address++) {
+			if (!coverage.isMarked(address)) {
+				continue;
+			}
+
+			if (!decode(address, instruction) || !claim(address, instruction)) {
+				coverageConflicts++;
+				continue;
+			}
+
+			push(address, false);
+		}
+	}
+
+	void Analysis::push(uint32_t address, bool skippable) {
+		if (address < limit) {
+			work.push_back(Path { static_cast<uint16_t>(address), skippable });
+		}
+	}
+
+	void Analysis::addLabel(uint32_t address) {
+		if (address < limit) {
+			labels[address] = true;
+		}
+	}
+
+	bool Analysis::decode(uint16_t address, DecodedInstruction &instruction) const {
+		instruction = emulator::decodeInstruction(memory.data(), address);
+		// instructions that would run past the end of the image are data
+		return instruction.isValid() && address + instruction.length <= limit;
+	}
+
+	bool Analysis::fits(uint16_t address, const DecodedInstruction &instruction) const {
+		if (types[address] == CODE) {
+			return true;
+		}
+
+		for (uint8_t i = 0; i < instruction.length; i++) {
+			if (types[address + i] != DATA) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Analysis::claim(uint16_t address, const DecodedInstruction &instruction) {
+		if (!fits(address, instruction)) {
+			return false;
+		}
+		if (types[address] == CODE) {
+			return true;
+		}
+
+		types[address] = CODE;
+		for (uint8_t i = 1; i < instruction.length; i++) {
+			types[address + i] = OPERAND;
+		}
+		codeWords += instruction.length;
+		return true;
+	}
+
+	void Analysis::run() {
+		DecodedInstruction instruction;
+
+		// entries are followed in the order they were added
+		reverse(work.begin(), work.end());
+
+		while (!work.empty()) {
+			Path path = work.back();
+			work.pop_back();
+
+			uint8_t visit = path.skippable ? VISITED_SKIPPABLE : VISITED;
+			if (visits[path.address] & visit) {
+				continue;
+			}
+			visits[path.address] |= visit;
+
+			if (!decode(path.address, instruction) || !claim(path.address, instruction)) {
+				continue;
+			}
+
+			follow(path.address, instruction, path.skippable);
+		}
+	}
+
+	void Analysis::follow(uint16_t address, const DecodedInstruction &instruction, bool skippable) {
+		uint32_t next = address + instruction.length;
+
+		if (skippable) {
+			// skipping an IFx skips the instruction after it as well
+			push(next, instruction.conditional);
+		}
+
+		if (instruction.a == ARG_INDIRECT_NEXT) {
+			addLabel(instruction.nextA);
+		}
+
+		if (instruction.opcode) {
+			uint8_t opcode = instruction.opcode;
+
+			if (instruction.b == ARG_INDIRECT_NEXT) {
+				addLabel(instruction.nextB);
+			}
+
+			if (instruction.conditional) {
+				push(next, true);
+				return;
+			}
+
+			if (instruction.b != ARG_PC) {
+				push(next, false);
+				return;
+			}
+
+			uint16_t value;
+			bool known = instruction.literalA(value);
+			if (opcode == SET && known) {
+				addLabel(value);
+				push(value, false);
+			} else if ((opcode == ADD || opcode == SUB) && known) {
+				uint16_t target = opcode == ADD ? next + value : next - value;
+				addLabel(target);
+				push(target, false);
+			} else if (opcode == SET && instruction.a >= 0x10 && instruction.a <= 0x17) {
+				readJumpTable(instruction.nextA);
+			}
+
+			// SET PC, POP returns, and any other write to PC goes somewhere we can not tell
+			return;
+		}
+
+		uint8_t opcode = instruction.b;
+		switch (opcode) {
+		case JSR:
+		case IAS: {
+			uint16_t value;
+			// IAS 0 turns interrupts off
+			if (instruction.literalA(value) && !(opcode == IAS && value == 0)) {
+				addLabel(value);
+				push(value, false);
+			}
+			push(next, false);
+			break;
+		}
+		case HCF:
+		case RFI:
+			break;
+		default:
+			push(next, false);
+			break;
+		}
+	}
+
+	void Analysis::readJumpTable(uint16_t base) {
+		DecodedInstruction instruction;
+
+		for (uint32_t address = base; address < limit && address - base < MAX_JUMP_TABLE; address++) {
+			uint16_t target = image[address];
+			if (types[address] != DATA || target >= limit || !decode(target, instruction)) {
+				break;
+			}
+
+			// small numbers and text after a table point back into it or at code already found
+			if ((target <= address && target + instruction.length > base) || !fits(target, instruction)) {
+				break;
+			}
+
+			types[address] = JUMP_TABLE;
+			addLabel(target);
+			push(target, false);
+		}
+
+		addLabel(base);
+	}
+}}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "image.hpp"
+#include "coverage.hpp"
+#include "cfg.hpp"
+
+namespace dcpu { namespace disassembler {
+	/*************************************************************************
+	 *
+	 * Analysis
+	 *
+	 * Separates code from data by following control flow from the entry
+	 * points: fall through, IFx skips (including chained IFx), SET PC, ADD /
+	 * SUB PC, JSR, IAS handlers and jump tables of the form
+	 * SET PC, [reg + table].  Everything that is not reached is data.  A
+	 * jump table ends at the first entry that is not an instruction that
+	 * fits, or that points into the table or into words already claimed.
+	 *
+	 * Execution coverage from the emulator settles computed jumps: the words
+	 * instructions started at during a run are claimed as code before the
+	 * static analysis runs, and followed from like entry points.
+	 *
+	 * Only the first 0x10000 words can hold code.  An instruction that would
+	 * overlap one found earlier is not decoded, so the code always splits
+	 * into whole instructions.  Instructions are decoded as the emulator's
+	 * control flow graph decodes them.
+	 *
+	 *************************************************************************/
+	class Analysis {
+	public:
+		enum WordType : uint8_t {
+			DATA = 0,
+			CODE = 1,
+			OPERAND = 2,
+			JUMP_TABLE = 3
+		};
+
+		enum { MAX_WORDS = 0x10000, MAX_JUMP_TABLE = 256 };
+	private:
+		enum Visit : uint8_t {
+			VISITED = 1 << 0,
+			VISITED_SKIPPABLE = 1 << 1
+		};
+
+		struct Path {
+			uint16_t address;
+			// when set, an IFx before the instruction can skip it
+			bool skippable;
+		};
+
+		const Image &image;
+		size_t limit;
+		// the image padded to all of memory, as decoding reads it
+		std::vector<uint16_t> memory;
+		std::vector<uint8_t> types;
+		std::vector<uint8_t> visits;
+		std::vector<bool> labels;
+		std::vector<Path> work;
+		size_t codeWords;
+		size_t coverageConflicts;
+
+		void push(uint32_t address, bool skippable);
+		void addLabel(uint32_t address);
+		bool fits(uint16_t address, const emulator::DecodedInstruction &instruction) const;
+		bool claim(uint16_t address, const emulator::DecodedInstruction &instruction);
+		void follow(uint16_t address, const emulator::DecodedInstruction &instruction, bool skippable);
+		void readJumpTable(uint16_t base);
+		bool decode(uint16_t address, emulator::DecodedInstruction &instruction) const;
+	public:
+		Analysis(const Image &image);
+
+		/**
+		 * Adds an address execution can start from.
+		 */
+		void addEntry(uint16_t address);
+
+		/**
+		 * Claims every instruction start in the coverage as code.
+		 */
+		void addCoverage(const emulator::ExecutionCoverage &coverage);
+
+		/**
+		 * Follows control flow from every entry point added so far.
+		 */
+		void run();
+
+		WordType getType(size_t address) const {
+			return address < limit ? static_cast<WordType>(types[address]) : DATA;
+		}
+
+		/**
+		 * True when the address is referenced and starts an instruction or is
+		 * data, so that a label can be placed on it.
+		 */
+		bool hasLabel(uint32_t address) const {
+			return address < limit && labels[address] && types[address] != OPERAND;
+		}
+
+		size_t getCodeWords() const {
+			return codeWords;
+		}
+
+		/**
+		 * The number of covered instruction starts that could not be decoded
+		 * from the image or overlap another covered instruction, as left by
+		 * self-modifying code.
+		 */
+		size_t getCoverageConflicts() const {
+			return coverageConflicts;
+		}
+	};
+}}
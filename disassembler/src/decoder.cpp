@@ -0,0 +1,63 @@
+#include "decoder.hpp"
+
+namespace dcpu { namespace disassembler {
+	/*************************************************************************
+	 *
+	 * Decoder
+	 *
+	 *************************************************************************/
+
+	const char *const Decoder::BASIC_MNEMONICS[32] = {
+		nullptr, "SET", "ADD", "SUB", "MUL", "MLI", "DIV", "DVI",
+		"MOD", "MDI", "AND", "BOR", "XOR", "SHR", "ASR", "SHL",
+		"IFB", "IFC", "IFE", "IFN", "IFG", "IFA", "IFL", "IFU",
+		nullptr, nullptr, "ADX", "SBX", nullptr, nullptr, "STI", "STD"
+	};
+
+	const char *const Decoder::SPECIAL_MNEMONICS[32] = {
+		nullptr, "JSR", nullptr, nullptr, nullptr, nullptr, nullptr, "HCF",
+		"INT", "IAG", "IAS", "RFI", "IAQ", nullptr, nullptr, nullptr,
+		"HWN", "HWQ", "HWI", nullptr, nullptr, nullptr, nullptr, nullptr,
+		nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr
+	};
+
+	const uint8_t Decoder::NEXT_WORD[64] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 1, 0, 0, 0, 1, 1,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+	};
+
+	void Decoder::decode(const uint16_t *words, size_t available, Instruction &instruction) {
+		uint16_t word = words[0];
+		uint8_t opcode = word & 0x1f;
+
+		instruction.a = (word >> 10) & 0x3f;
+		instruction.special = opcode == 0;
+
+		if (instruction.special) {
+			instruction.b = 0;
+			instruction.mnemonic = SPECIAL_MNEMONICS[(word >> 5) & 0x1f];
+			instruction.length = 1 + NEXT_WORD[instruction.a];
+		} else {
+			instruction.b = (word >> 5) & 0x1f;
+			instruction.mnemonic = BASIC_MNEMONICS[opcode];
+			instruction.length = 1 + NEXT_WORD[instruction.a] + NEXT_WORD[instruction.b];
+		}
+
+		if (instruction.length > available) {
+			instruction.mnemonic = nullptr;
+		}
+
+		if (!instruction.mnemonic) {
+			instruction.length = 1;
+			instruction.nextA = instruction.nextB = 0;
+			return;
+		}
+
+		// a is read before b
+		uint8_t next = 1;
+		instruction.nextA = NEXT_WORD[instruction.a] ? words[next++] : 0;
+		instruction.nextB = !instruction.special && NEXT_WORD[instruction.b] ? words[next] : 0;
+	}
+}}
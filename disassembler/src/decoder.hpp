@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace dcpu { namespace disassembler {
+	/*************************************************************************
+	 *
+	 * Instruction
+	 *
+	 * A decoded instruction.  Special instructions only use a.  The next
+	 * words are stored with the argument that consumes them.
+	 *
+	 *************************************************************************/
+	struct Instruction {
+		// nullptr when the first word does not hold a valid instruction
+		const char *mnemonic;
+		uint8_t a;
+		uint8_t b;
+		uint16_t nextA;
+		uint16_t nextB;
+		uint8_t length;
+		bool special;
+
+		bool isValid() const {
+			return mnemonic != nullptr;
+		}
+	};
+
+	/*************************************************************************
+	 *
+	 * Decoder
+	 *
+	 * Decodes straight from lookup tables indexed by the opcode and argument
+	 * fields, without allocating.
+	 *
+	 *************************************************************************/
+	class Decoder {
+	public:
+		enum { MAX_LENGTH = 3 };
+
+		static const char *const BASIC_MNEMONICS[32];
+		static const char *const SPECIAL_MNEMONICS[32];
+		// 1 for the argument codes that consume a next word
+		static const uint8_t NEXT_WORD[64];
+
+		/**
+		 * Decodes the instruction at the start of words, of which available
+		 * are valid.  Instructions that would run past the end are invalid.
+		 */
+		static void decode(const uint16_t *words, size_t available, Instruction &instruction);
+	};
+}}
@@ -0,0 +1,212 @@
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <exception>
+#include <stdexcept>
+
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+
+#include "image.hpp"
+#include "decoder.hpp"
+#include "analysis.hpp"
+#include "formatter.hpp"
+#include "cfg.hpp"
+
+using namespace std;
+using namespace dcpu::disassembler;
+using dcpu::emulator::ControlFlowGraph;
+
+namespace po = boost::program_options;
+
+void usage(const char *program_name, const po::options_description &visible_options) {
+	cout << "Usage: " << program_name << " [OPTIONS] <input-file>" << endl;
+	cout << visible_options << endl;
+}
+
+void disassemble_linear(const Image &image, Formatter &formatter) {
+	uint16_t words[Decoder::MAX_LENGTH];
+	Instruction instruction;
+
+	for (size_t address = 0; address < image.size(); address += instruction.length) {
+		size_t available = image.read(address, words, Decoder::MAX_LENGTH);
+		Decoder::decode(words, available, instruction);
+		formatter.instruction(address, instruction, words);
+	}
+}
+
+void disassemble_code(const Image &image, const Analysis &analysis, Formatter &formatter) {
+	uint16_t words[Formatter::MAX_DATA];
+	Instruction instruction;
+
+	size_t address = 0;
+	while (address < image.size()) {
+		formatter.label(address);
+
+		if (analysis.getType(address) == Analysis::CODE) {
+			size_t available = image.read(address, words, Decoder::MAX_LENGTH);
+			Decoder::decode(words, available, instruction);
+			formatter.instruction(address, instruction, words);
+			address += instruction.length;
+			continue;
+		}
+
+		// data runs up to the next label or instruction
+		size_t count = 0;
+		do {
+			words[count] = image[address + count];
+			count++;
+		} while (count < Formatter::MAX_DATA && address + count < image.size()
+				&& analysis.getType(address + count) != Analysis::CODE && !analysis.hasLabel(address + count));
+
+		formatter.data(address, words, count);
+		address += count;
+	}
+}
+
+void write_cfg(const Image &image, const vector<uint16_t> &entries, const string &format, ostream &out) {
+	vector<uint16_t> memory(ControlFlowGraph::TOTAL_WORDS, 0);
+	image.read(0, memory.data(), memory.size());
+
+	ControlFlowGraph cfg(memory.data(), entries);
+	if (format == "dot") {
+		cfg.writeDot(out);
+	} else {
+		cfg.writeJson(out);
+	}
+}
+
+uint16_t parse_address(const string &value) {
+	size_t end;
+	unsigned long address = stoul(value, &end, 0);
+	if (end != value.length() || address > 0xffff) {
+		throw invalid_argument(str(boost::format("invalid entry point '%s'") % value));
+	}
+
+	return address;
+}
+
+int main(int argc, char **argv) {
+	string input_file;
+	string output_file;
+	string cfg_format;
+
+	// -h selects hexadecimal, so help has no short form
+	po::options_description visible_options("OPTIONS");
+	visible_options.add_options()
+		("help", "Displays this information")
+		("decimal,d", "Output all literals in decimal.")
+		("hex,h", "Output all literals in hexadecimal.  This is the default.")
+		("octal,c", "Output all literals in octal.")
+		("entry,e", po::value<vector<string>>(), "Follow control flow from this address as well as from 0.")
+		("coverage", po::value<vector<string>>(), "Treat the words instructions started at in a coverage file "
+				"written by dcpu-run --coverage as code.  May be given more than once.")
+		("linear,l", "Decode every word as code from the start to the end, without following control flow.")
+		("cfg", po::value<string>(&cfg_format), "Write the basic blocks reachable from the entry points and their "
+				"edges as a graph in 'dot' or 'json' format instead of the disassembly.")
+		("output,o", po::value<string>(&output_file), "Write output to the specified file instead of stdout.");
+
+	po::options_description hidden_options("Hidden options");
+	hidden_options.add_options()
+		("input-file", po::value<string>(&input_file), "the input file");
+
+	po::options_description cmdline_options;
+	cmdline_options.add(visible_options).add(hidden_options);
+
+	po::positional_options_description positional_args;
+	positional_args.add("input-file", -1);
+
+	try {
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).
+		          options(cmdline_options).positional(positional_args).run(), vm);
+		po::notify(vm);
+
+		if (vm.count("help")) {
+			usage(argv[0], visible_options);
+			return 0;
+		}
+
+		if (input_file.length() == 0) {
+			cerr << "Missing required input-file argument" << endl << endl;
+			usage(argv[0], visible_options);
+			return 1;
+		}
+
+		if (vm.count("decimal") + vm.count("hex") + vm.count("octal") > 1) {
+			throw invalid_argument("only one of --decimal, --hex and --octal may be given");
+		}
+
+		Radix radix = Radix::HEX;
+		if (vm.count("decimal")) {
+			radix = Radix::DECIMAL;
+		} else if (vm.count("octal")) {
+			radix = Radix::OCTAL;
+		}
+
+		if (cfg_format.length() && cfg_format != "dot" && cfg_format != "json") {
+			throw invalid_argument(str(boost::format("unknown graph format '%s'") % cfg_format));
+		}
+
+		vector<uint16_t> entries = { 0 };
+		if (vm.count("entry")) {
+			for (auto &entry : vm["entry"].as<vector<string>>()) {
+				entries.push_back(parse_address(entry));
+			}
+		}
+
+		Image image(input_file);
+
+		ofstream fout;
+		if (output_file.length() != 0 && output_file != "-") {
+			fout.open(output_file, ios_base::out | ios_base::trunc);
+			if (!fout) {
+				throw runtime_error(str(boost::format("Failed to open file %s for write: %s")
+						% output_file % strerror(errno)));
+			}
+		}
+
+		ostream &out = fout.is_open() ? fout : cout;
+		if (cfg_format.length()) {
+			write_cfg(image, entries, cfg_format, out);
+		} else if (vm.count("linear")) {
+			Formatter formatter(out, radix);
+			disassemble_linear(image, formatter);
+		} else {
+			Analysis analysis(image);
+			if (vm.count("coverage")) {
+				dcpu::emulator::ExecutionCoverage coverage;
+				for (auto &filename : vm["coverage"].as<vector<string>>()) {
+					coverage.load(filename);
+				}
+
+				analysis.addCoverage(coverage);
+				if (analysis.getCoverageConflicts()) {
+					cerr << boost::format("Warning: %d covered instruction starts overlap other instructions or do "
+							"not decode in the image, and were left as data") % analysis.getCoverageConflicts() << endl;
+				}
+			}
+
+			for (auto entry : entries) {
+				analysis.addEntry(entry);
+			}
+			analysis.run();
+
+			Formatter formatter(out, radix, &analysis);
+			disassemble_code(image, analysis, formatter);
+		}
+
+		out.flush();
+		if (!out) {
+			throw runtime_error(str(boost::format("Failed to write the output: %s") % strerror(errno)));
+		}
+	} catch (std::exception &e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
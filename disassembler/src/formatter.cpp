@@ -0,0 +1,226 @@
+#include "formatter.hpp"
+
+using namespace std;
+
+namespace dcpu { namespace disassembler {
+	static const char *const REGISTER_NAMES[8] = { "A", "B", "C", "X", "Y", "Z", "I", "J" };
+	static const char HEX_DIGITS[] = "0123456789abcdef";
+
+	static const uint8_t ARG_PC = 0x1c;
+
+	// true when argument a of the instruction is a jump, call or handler address
+	static bool isTransfer(const Instruction &instruction, uint16_t word) {
+		if (instruction.special) {
+			uint8_t opcode = (word >> 5) & 0x1f;
+			return opcode == 0x01 || opcode == 0x0a; // JSR, IAS
+		}
+
+		return instruction.b == ARG_PC && (word & 0x1f) == 0x01; // SET
+	}
+
+	/*************************************************************************
+	 *
+	 * Formatter
+	 *
+	 *************************************************************************/
+
+	Formatter::Formatter(ostream &out, Radix radix, const Analysis *analysis) : out(out), radix(radix),
+			analysis(analysis), used(0) {}
+
+	Formatter::~Formatter() {
+		flush();
+	}
+
+	void Formatter::flush() {
+		out.write(buffer, used);
+		used = 0;
+	}
+
+	void Formatter::put(const char *text) {
+		while (*text) {
+			buffer[used++] = *text++;
+		}
+	}
+
+	void Formatter::putHex(uint32_t value, int digits) {
+		for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4) {
+			put(HEX_DIGITS[(value >> shift) & 0xf]);
+		}
+	}
+
+	void Formatter::putLiteral(uint16_t value) {
+		char digits[8];
+		int count = 0;
+
+		switch (radix) {
+		case Radix::HEX:
+			put("0x");
+			putHex(value, 4);
+			return;
+		case Radix::OCTAL:
+			put("0o");
+			do {
+				digits[count++] = '0' + (value & 7);
+				value >>= 3;
+			} while (value);
+			break;
+		case Radix::DECIMAL:
+			do {
+				digits[count++] = '0' + value % 10;
+				value /= 10;
+			} while (value);
+			break;
+		}
+
+		while (count > 0) {
+			put(digits[--count]);
+		}
+	}
+
+	void Formatter::putLabel(uint32_t address) {
+		put(analysis->getType(address) == Analysis::CODE ? "L_" : "D_");
+		putHex(address, 4);
+	}
+
+	void Formatter::putAddress(uint16_t value, bool useLabel) {
+		if (useLabel && analysis && analysis->hasLabel(value)) {
+			putLabel(value);
+		} else {
+			putLiteral(value);
+		}
+	}
+
+	void Formatter::putRegister(uint8_t code) {
+		put(REGISTER_NAMES[code & 7]);
+	}
+
+	void Formatter::putArgument(uint8_t code, uint16_t next, bool isA, bool transfer) {
+		if (code < 0x08) {
+			putRegister(code);
+		} else if (code < 0x10) {
+			put('[');
+			putRegister(code);
+			put(']');
+		} else if (code < 0x18) {
+			// the assembler drops an offset of 0
+			if (next == 0) {
+				put("LONG ");
+			}
+			put('[');
+			putRegister(code);
+			put(" + ");
+			putAddress(next, transfer);
+			put(']');
+		} else if (code == 0x20) {
+			put("-1");
+		} else if (code > 0x20) {
+			putAddress(code - 0x21, transfer);
+		} else {
+			switch (code) {
+			case 0x18:
+				put(isA ? "POP" : "PUSH");
+				break;
+			case 0x19:
+				put("PEEK");
+				break;
+			case 0x1a:
+				// PICK 0 would become PEEK
+				if (next == 0) {
+					put("LONG ");
+				}
+				put("PICK ");
+				putLiteral(next);
+				break;
+			case 0x1b:
+				put("SP");
+				break;
+			case ARG_PC:
+				put("PC");
+				break;
+			case 0x1d:
+				put("EX");
+				break;
+			case 0x1e:
+				put('[');
+				putAddress(next, true);
+				put(']');
+				break;
+			case 0x1f:
+				// the assembler puts -1 to 30 in argument a into the instruction itself
+				if (isA && next <= 30) {
+					put("LONG ");
+				}
+				putAddress(next, transfer);
+				break;
+			}
+		}
+	}
+
+	void Formatter::putComment(size_t start, size_t address, const uint16_t *words, size_t count) {
+		do {
+			put(' ');
+		} while (used - start < COMMENT_COLUMN);
+
+		put("; ");
+		putHex(address, address > 0xffff ? 8 : 4);
+		put(':');
+		for (size_t i = 0; i < count; i++) {
+			put(' ');
+			putHex(words[i], 4);
+		}
+		put('\n');
+	}
+
+	void Formatter::label(size_t address) {
+		if (!analysis || !analysis->hasLabel(address)) {
+			return;
+		}
+
+		if (used > BUFFER_SIZE - MAX_LINE) {
+			flush();
+		}
+
+		putLabel(address);
+		put(":\n");
+	}
+
+	void Formatter::instruction(size_t address, const Instruction &instruction, const uint16_t *words) {
+		if (used > BUFFER_SIZE - MAX_LINE) {
+			flush();
+		}
+
+		size_t start = used;
+		if (!instruction.isValid()) {
+			put("DAT ");
+			putLiteral(words[0]);
+		} else {
+			put(instruction.mnemonic);
+			put(' ');
+
+			if (!instruction.special) {
+				putArgument(instruction.b, instruction.nextB, false, false);
+				put(", ");
+			}
+			putArgument(instruction.a, instruction.nextA, true, isTransfer(instruction, words[0]));
+		}
+
+		putComment(start, address, words, instruction.length);
+	}
+
+	void Formatter::data(size_t address, const uint16_t *words, size_t count) {
+		if (used > BUFFER_SIZE - MAX_LINE) {
+			flush();
+		}
+
+		size_t start = used;
+		put("DAT ");
+		for (size_t i = 0; i < count; i++) {
+			if (i > 0) {
+				put(", ");
+			}
+			putLiteral(words[i]);
+		}
+
+		putComment(start, address, words, count);
+	}
+}}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+
+#include "decoder.hpp"
+#include "analysis.hpp"
+
+namespace dcpu { namespace disassembler {
+	enum class Radix {
+		DECIMAL,
+		HEX,
+		OCTAL
+	};
+
+	/*************************************************************************
+	 *
+	 * Formatter
+	 *
+	 * Writes instructions in assembler syntax into a fixed buffer that is
+	 * handed to the stream in large blocks.  Each line ends with a comment
+	 * holding the address and the words of the instruction.
+	 *
+	 * The output assembles back to the same words: encodings the assembler
+	 * would shorten are marked LONG.  With an analysis, jump and call
+	 * targets and [address] operands refer to labels where it has them.
+	 *
+	 *************************************************************************/
+	class Formatter {
+		Formatter(Formatter const&) = delete;
+		Formatter& operator =(Formatter const&) = delete;
+
+		enum { BUFFER_SIZE = 64 * 1024, MAX_LINE = 256, COMMENT_COLUMN = 32 };
+
+		std::ostream &out;
+		Radix radix;
+		const Analysis *analysis;
+		char buffer[BUFFER_SIZE];
+		size_t used;
+
+		void put(char c) {
+			buffer[used++] = c;
+		}
+
+		void put(const char *text);
+		void putHex(uint32_t value, int digits);
+		void putLiteral(uint16_t value);
+		void putLabel(uint32_t address);
+		void putAddress(uint16_t value, bool useLabel);
+		void putRegister(uint8_t code);
+		void putArgument(uint8_t code, uint16_t next, bool isA, bool transfer);
+		void putComment(size_t start, size_t address, const uint16_t *words, size_t count);
+	public:
+		Formatter(std::ostream &out, Radix radix=Radix::HEX, const Analysis *analysis=nullptr);
+		~Formatter();
+
+		/**
+		 * Writes the label line for address, when the analysis has one.
+		 */
+		void label(size_t address);
+
+		/**
+		 * Writes one line for the instruction at address, whose words are
+		 * shown in the trailing comment.
+		 */
+		void instruction(size_t address, const Instruction &instruction, const uint16_t *words);
+
+		/**
+		 * Writes count words, at most MAX_DATA, as one DAT line.
+		 */
+		void data(size_t address, const uint16_t *words, size_t count);
+
+		enum { MAX_DATA = 8 };
+
+		/**
+		 * Hands the buffered text to the stream.
+		 */
+		void flush();
+	};
+}}
@@ -0,0 +1,78 @@
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/format.hpp>
+
+#include "image.hpp"
+
+using namespace std;
+using boost::format;
+using boost::str;
+
+namespace dcpu { namespace disassembler {
+	/*************************************************************************
+	 *
+	 * Image
+	 *
+	 *************************************************************************/
+
+	Image::Image(const string &filename) : fd(-1), mappingSize(0), bytes(nullptr) {
+		fd = open(filename.c_str(), O_RDONLY);
+		if (fd == -1) {
+			throw runtime_error(str(format("Failed to open the file %s: %s") % filename % strerror(errno)));
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) != 0) {
+			close(fd);
+			throw runtime_error(str(format("Failed to stat the file %s: %s") % filename % strerror(errno)));
+		}
+
+		mappingSize = info.st_size;
+		if (mappingSize % 2 != 0) {
+			close(fd);
+			throw runtime_error(str(format("%s does not hold a whole number of words") % filename));
+		}
+
+		// mmap refuses empty mappings
+		if (mappingSize == 0) {
+			return;
+		}
+
+		void *mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping == MAP_FAILED) {
+			close(fd);
+			throw runtime_error(str(format("Failed to map the file %s: %s") % filename % strerror(errno)));
+		}
+
+		madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+		bytes = static_cast<const uint8_t*>(mapping);
+	}
+
+	Image::~Image() {
+		if (bytes) {
+			munmap(const_cast<uint8_t*>(bytes), mappingSize);
+		}
+
+		if (fd != -1) {
+			close(fd);
+		}
+	}
+
+	size_t Image::read(size_t index, uint16_t *words, size_t count) const {
+		size_t available = index < size() ? size() - index : 0;
+		if (count > available) {
+			count = available;
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			words[i] = (*this)[index + i];
+		}
+
+		return count;
+	}
+}}
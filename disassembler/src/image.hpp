@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace dcpu { namespace disassembler {
+	/*************************************************************************
+	 *
+	 * Image
+	 *
+	 * A program image mapped read-only into memory.  Words are stored big
+	 * endian, the way the assembler writes them and the emulator loads them.
+	 *
+	 *************************************************************************/
+	class Image {
+		Image(Image const&) = delete;
+		Image& operator =(Image const&) = delete;
+
+		int fd;
+		size_t mappingSize;
+		const uint8_t *bytes;
+	public:
+		Image(const std::string &filename);
+		~Image();
+
+		size_t size() const {
+			return mappingSize / 2;
+		}
+
+		uint16_t operator[](size_t index) const {
+			return bytes[index * 2] << 8 | bytes[index * 2 + 1];
+		}
+
+		/**
+		 * Copies up to count words starting at index into words and returns
+		 * how many were available.
+		 */
+		size_t read(size_t index, uint16_t *words, size_t count) const;
+	};
+}}
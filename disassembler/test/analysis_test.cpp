@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <vector>
+#include <unistd.h>
+
+#include <image.hpp>
+#include <analysis.hpp>
+
+using namespace std;
+using namespace dcpu::disassembler;
+
+class AnalysisTest : public ::testing::Test {
+public:
+	void SetUp() {
+		char path[] = "/tmp/dcpu-image-XXXXXX";
+		int fd = mkstemp(path);
+		close(fd);
+		filename = path;
+	}
+
+	void TearDown() {
+		remove(filename.c_str());
+	}
+protected:
+	string filename;
+
+	void write(const vector<uint16_t> &words) {
+		FILE *file = fopen(filename.c_str(), "wb");
+		for (auto word : words) {
+			fputc(word >> 8, file);
+			fputc(word & 0xff, file);
+		}
+		fclose(file);
+	}
+};
+
+TEST_F(AnalysisTest, FollowsControlFlow) {
+	// 0000: JSR 0x0008
+	// 0002: IFE A, 0
+	// 0003: SET PC, 0x000a
+	// 0004: HCF 0
+	// 0005: DAT 0xffff, 0x0018, 0x0000
+	// 0008: SET A, 1
+	// 0009: SET PC, POP
+	// 000a: IAS 0x000c
+	// 000b: RFI 0
+	// 000c: RFI 0
+	write({ 0x7c20, 0x0008, 0x8412, 0xaf81, 0x84e0, 0xffff, 0x0018, 0x0000, 0x8801, 0x6381,
+			0xb540, 0x8560, 0x8560 });
+
+	Image image(filename);
+	Analysis analysis(image);
+	analysis.addEntry(0);
+	analysis.run();
+
+	EXPECT_EQ(Analysis::CODE, analysis.getType(0x0000));
+	EXPECT_EQ(Analysis::OPERAND, analysis.getType(0x0001));
+	for (uint16_t address : { 0x2, 0x3, 0x4, 0x8, 0x9, 0xa, 0xb, 0xc }) {
+		EXPECT_EQ(Analysis::CODE, analysis.getType(address)) << "at " << address;
+	}
+	for (uint16_t address : { 0x5, 0x6, 0x7 }) {
+		EXPECT_EQ(Analysis::DATA, analysis.getType(address)) << "at " << address;
+	}
+
+	EXPECT_TRUE(analysis.hasLabel(0x0008));
+	EXPECT_TRUE(analysis.hasLabel(0x000a));
+	EXPECT_TRUE(analysis.hasLabel(0x000c));
+	EXPECT_FALSE(analysis.hasLabel(0x0004));
+	EXPECT_EQ(10, analysis.getCodeWords());
+}
+
+TEST_F(AnalysisTest, JumpTable) {
+	// 0000: SET PC, [A + 0x0002]
+	// 0002: DAT 0x0005, 0x0006, 0xf000
+	// 0005: HCF 0
+	// 0006: RFI 0
+	write({ 0x4381, 0x0002, 0x0005, 0x0006, 0xf000, 0x84e0, 0x8560 });
+
+	Image image(filename);
+	Analysis analysis(image);
+	analysis.addEntry(0);
+	analysis.run();
+
+	EXPECT_EQ(Analysis::JUMP_TABLE, analysis.getType(0x0002));
+	EXPECT_EQ(Analysis::JUMP_TABLE, analysis.getType(0x0003));
+	EXPECT_EQ(Analysis::DATA, analysis.getType(0x0004));
+	EXPECT_EQ(Analysis::CODE, analysis.getType(0x0005));
+	EXPECT_EQ(Analysis::CODE, analysis.getType(0x0006));
+	EXPECT_TRUE(analysis.hasLabel(0x0002));
+}
+
+TEST_F(AnalysisTest, JumpTableStopsAtData) {
+	// 0000: SET PC, [A + 0x0002]
+	// 0002: DAT 0x0005
+	// 0003: DAT 0x0003, 0x0002  (points into the table)
+	// 0005: HCF 0
+	write({ 0x4381, 0x0002, 0x0005, 0x0003, 0x0002, 0x84e0 });
+
+	Image image(filename);
+	Analysis analysis(image);
+	analysis.addEntry(0);
+	analysis.run();
+
+	EXPECT_EQ(Analysis::JUMP_TABLE, analysis.getType(0x0002));
+	EXPECT_EQ(Analysis::DATA, analysis.getType(0x0003));
+	EXPECT_EQ(Analysis::DATA, analysis.getType(0x0004));
+	EXPECT_EQ(Analysis::CODE, analysis.getType(0x0005));
+	EXPECT_FALSE(analysis.hasLabel(0x0003));
+
+	// 0002: DAT 0x0006
+	// 0003: DAT 0x0001, 0x0000  (points at the operand of the jump)
+	// 0006: HCF 0
+	write({ 0x4381, 0x0002, 0x0006, 0x0001, 0x0000, 0x0000, 0x84e0 });
+
+	Image other(filename);
+	Analysis otherAnalysis(other);
+	otherAnalysis.addEntry(0);
+	otherAnalysis.run();
+
+	EXPECT_EQ(Analysis::JUMP_TABLE, otherAnalysis.getType(0x0002));
+	EXPECT_EQ(Analysis::DATA, otherAnalysis.getType(0x0003));
+	EXPECT_EQ(Analysis::OPERAND, otherAnalysis.getType(0x0001));
+	EXPECT_EQ(Analysis::CODE, otherAnalysis.getType(0x0006));
+}
+
+TEST_F(AnalysisTest, ChainedSkips) {
+	// 0000: IFE A, 0
+	// 0001: IFE B, 0
+	// 0002: SET PC, 0x0002
+	// 0003: HCF 0
+	write({ 0x8412, 0x8432, 0x8f81, 0x84e0 });
+
+	Image image(filename);
+	Analysis analysis(image);
+	analysis.addEntry(0);
+	analysis.run();
+
+	EXPECT_EQ(Analysis::CODE, analysis.getType(0x0003));
+}
+
+TEST_F(AnalysisTest, OverlappingTargetsStayData) {
+	// 0000: SET PC, 0x0003
+	// 0002: DAT 0x7c01
+	// 0003: HCF 0
+	// 0004: SET PC, 0x0003 is never reached
+	write({ 0x7f81, 0x0003, 0x7c01, 0x84e0 });
+
+	Image image(filename);
+	Analysis analysis(image);
+	analysis.addEntry(0);
+	analysis.addEntry(2);
+	analysis.run();
+
+	// SET A, 0x84e0 at 0002 would swallow the HCF
+	EXPECT_EQ(Analysis::CODE, analysis.getType(0x0003));
+	EXPECT_EQ(Analysis::DATA, analysis.getType(0x0002));
+}
+
+TEST_F(AnalysisTest, CoverageResolvesComputedJumps) {
+	// 0000: SET PC, A          (A was 3 in the run)
+	// 0001: DAT 0x7c01
+	// 0002: DAT 0x0000
+	// 0003: SET B, 1
+	// 0004: HCF 0
+	write({ 0x0381, 0x7c01, 0x0000, 0x8821, 0x84e0 });
+
+	Image image(filename);
+	dcpu::emulator::ExecutionCoverage coverage;
+	coverage.mark(0);
+	coverage.mark(3);
+
+	Analysis analysis(image);
+	analysis.addCoverage(coverage);
+	analysis.addEntry(0);
+	analysis.run();
+
+	EXPECT_EQ(Analysis::CODE, analysis.getType(0x0003));
+	EXPECT_EQ(Analysis::CODE, analysis.getType(0x0004));
+	EXPECT_EQ(Analysis::DATA, analysis.getType(0x0001));
+	EXPECT_EQ(0, analysis.getCoverageConflicts());
+}
+
+TEST_F(AnalysisTest, CoverageConflicts) {
+	// 0000: SET A, 0x8821 and 0001: SET B, 1 both ran, as after self-modifying code
+	write({ 0x7c01, 0x8821, 0x84e0 });
+
+	Image image(filename);
+	dcpu::emulator::ExecutionCoverage coverage;
+	coverage.mark(0);
+	coverage.mark(1);
+
+	Analysis analysis(image);
+	analysis.addCoverage(coverage);
+	analysis.run();
+
+	EXPECT_EQ(Analysis::CODE, analysis.getType(0x0000));
+	EXPECT_EQ(Analysis::OPERAND, analysis.getType(0x0001));
+	EXPECT_EQ(1, analysis.getCoverageConflicts());
+}
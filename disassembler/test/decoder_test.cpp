@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include <cstring>
+
+#include <decoder.hpp>
+
+using namespace dcpu::disassembler;
+
+TEST(DecoderTest, BasicWithoutNextWords) {
+	uint16_t words[] = { 0x0021 }; // SET B, A
+	Instruction instruction;
+	Decoder::decode(words, 1, instruction);
+
+	ASSERT_TRUE(instruction.isValid());
+	EXPECT_STREQ("SET", instruction.mnemonic);
+	EXPECT_FALSE(instruction.special);
+	EXPECT_EQ(0x01, instruction.b);
+	EXPECT_EQ(0x00, instruction.a);
+	EXPECT_EQ(1, instruction.length);
+}
+
+TEST(DecoderTest, NextWordsFollowAThenB) {
+	uint16_t words[] = { 0x7fc2, 0x1234, 0x1000 }; // ADD [0x1000], 0x1234
+	Instruction instruction;
+	Decoder::decode(words, 3, instruction);
+
+	ASSERT_TRUE(instruction.isValid());
+	EXPECT_STREQ("ADD", instruction.mnemonic);
+	EXPECT_EQ(0x1e, instruction.b);
+	EXPECT_EQ(0x1f, instruction.a);
+	EXPECT_EQ(0x1234, instruction.nextA);
+	EXPECT_EQ(0x1000, instruction.nextB);
+	EXPECT_EQ(3, instruction.length);
+}
+
+TEST(DecoderTest, Special) {
+	uint16_t words[] = { 0x7c20, 0x0010 }; // JSR 0x0010
+	Instruction instruction;
+	Decoder::decode(words, 2, instruction);
+
+	ASSERT_TRUE(instruction.isValid());
+	EXPECT_STREQ("JSR", instruction.mnemonic);
+	EXPECT_TRUE(instruction.special);
+	EXPECT_EQ(0x1f, instruction.a);
+	EXPECT_EQ(0x0010, instruction.nextA);
+	EXPECT_EQ(2, instruction.length);
+}
+
+TEST(DecoderTest, InvalidOpcodes) {
+	Instruction instruction;
+
+	uint16_t basic[] = { 0x0018 };
+	Decoder::decode(basic, 1, instruction);
+	EXPECT_FALSE(instruction.isValid());
+	EXPECT_EQ(1, instruction.length);
+
+	uint16_t special[] = { 0x0040 };
+	Decoder::decode(special, 1, instruction);
+	EXPECT_FALSE(instruction.isValid());
+	EXPECT_EQ(1, instruction.length);
+}
+
+TEST(DecoderTest, Truncated) {
+	uint16_t words[] = { 0x7c01 }; // SET A, with its next word missing
+	Instruction instruction;
+	Decoder::decode(words, 1, instruction);
+
+	EXPECT_FALSE(instruction.isValid());
+	EXPECT_EQ(1, instruction.length);
+}
+
+TEST(DecoderTest, NextWordTable) {
+	for (int code = 0; code < 64; code++) {
+		bool expected = (code >= 0x10 && code <= 0x17) || code == 0x1a || code == 0x1e || code == 0x1f;
+		EXPECT_EQ(expected, Decoder::NEXT_WORD[code] == 1) << "argument code " << code;
+	}
+}
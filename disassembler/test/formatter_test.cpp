@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <algorithm>
+
+#include <decoder.hpp>
+#include <formatter.hpp>
+
+using namespace std;
+using namespace dcpu::disassembler;
+
+static string format(const uint16_t *words, size_t count, Radix radix=Radix::HEX, size_t address=0) {
+	ostringstream out;
+	Instruction instruction;
+	Decoder::decode(words, count, instruction);
+	{
+		Formatter formatter(out, radix);
+		formatter.instruction(address, instruction, words);
+	}
+
+	// drop the comment
+	string line = out.str();
+	return line.substr(0, line.find_last_not_of(' ', line.find(';') - 1) + 1);
+}
+
+TEST(FormatterTest, Registers) {
+	uint16_t words[] = { 0x0021 };
+	EXPECT_EQ("SET B, A", format(words, 1));
+}
+
+TEST(FormatterTest, MemoryArguments) {
+	uint16_t indirect[] = { 0x2102 }; // ADD [A], [A]
+	EXPECT_EQ("ADD [A], [A]", format(indirect, 1));
+
+	uint16_t offset[] = { 0x4661, 0x0010, 0x0020 }; // SET [X + 0x20], [B + 0x10]
+	EXPECT_EQ("SET [X + 0x0020], [B + 0x0010]", format(offset, 3));
+
+	uint16_t next[] = { 0x63c1, 0x1000 };
+	EXPECT_EQ("SET [0x1000], POP", format(next, 2));
+}
+
+TEST(FormatterTest, StackArguments) {
+	uint16_t push[] = { 0x0301 };
+	EXPECT_EQ("SET PUSH, A", format(push, 1));
+
+	uint16_t peek[] = { 0x6421 };
+	EXPECT_EQ("SET B, PEEK", format(peek, 1));
+
+	uint16_t pick[] = { 0x6801, 0x0003 };
+	EXPECT_EQ("SET A, PICK 0x0003", format(pick, 2));
+
+	uint16_t specials[] = { 0x7761 }; // SET SP, EX
+	EXPECT_EQ("SET SP, EX", format(specials, 1));
+}
+
+TEST(FormatterTest, ShortLiterals) {
+	uint16_t minusOne[] = { 0x8381 };
+	EXPECT_EQ("SET PC, -1", format(minusOne, 1));
+
+	uint16_t thirty[] = { 0xfc01 };
+	EXPECT_EQ("SET A, 0x001e", format(thirty, 1));
+}
+
+TEST(FormatterTest, LongEncodings) {
+	uint16_t literal[] = { 0x7c01, 0x001e };
+	EXPECT_EQ("SET A, LONG 0x001e", format(literal, 2));
+
+	uint16_t large[] = { 0x7c01, 0x001f };
+	EXPECT_EQ("SET A, 0x001f", format(large, 2));
+
+	uint16_t minusOne[] = { 0x7c01, 0xffff };
+	EXPECT_EQ("SET A, 0xffff", format(minusOne, 2));
+
+	// argument b always takes a next word
+	uint16_t b[] = { 0x03e1, 0x0005 };
+	EXPECT_EQ("SET 0x0005, A", format(b, 2));
+
+	uint16_t offset[] = { 0x4001, 0x0000 };
+	EXPECT_EQ("SET A, LONG [A + 0x0000]", format(offset, 2));
+
+	uint16_t pick[] = { 0x6801, 0x0000 };
+	EXPECT_EQ("SET A, LONG PICK 0x0000", format(pick, 2));
+}
+
+TEST(FormatterTest, Radix) {
+	uint16_t words[] = { 0x7c01, 0x01ff };
+	EXPECT_EQ("SET A, 511", format(words, 2, Radix::DECIMAL));
+	EXPECT_EQ("SET A, 0o777", format(words, 2, Radix::OCTAL));
+	EXPECT_EQ("SET A, 0x01ff", format(words, 2, Radix::HEX));
+
+	uint16_t zero[] = { 0x8401 };
+	EXPECT_EQ("SET A, 0", format(zero, 1, Radix::DECIMAL));
+	EXPECT_EQ("SET A, 0o0", format(zero, 1, Radix::OCTAL));
+}
+
+TEST(FormatterTest, InvalidAsData) {
+	uint16_t words[] = { 0x0018 };
+	EXPECT_EQ("DAT 0x0018", format(words, 1));
+}
+
+TEST(FormatterTest, Comment) {
+	ostringstream out;
+	uint16_t words[] = { 0x7c01, 0x1234 };
+	Instruction instruction;
+	Decoder::decode(words, 2, instruction);
+	{
+		Formatter formatter(out, Radix::HEX);
+		formatter.instruction(0x0100, instruction, words);
+		formatter.instruction(0x12345, instruction, words);
+	}
+
+	EXPECT_EQ("SET A, 0x1234                   ; 0100: 7c01 1234\n"
+			"SET A, 0x1234                   ; 00012345: 7c01 1234\n", out.str());
+}
+
+TEST(FormatterTest, LargeOutputIsFlushed) {
+	ostringstream out;
+	uint16_t words[] = { 0x7fc2, 0x1234, 0x1000 };
+	Instruction instruction;
+	Decoder::decode(words, 3, instruction);
+	{
+		Formatter formatter(out);
+		for (int i = 0; i < 10000; i++) {
+			formatter.instruction(i * 3, instruction, words);
+		}
+	}
+
+	string text = out.str();
+	EXPECT_EQ(10000, count(text.begin(), text.end(), '\n'));
+	EXPECT_EQ(0, text.find("ADD [0x1000], 0x1234"));
+}
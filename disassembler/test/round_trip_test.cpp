@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+#include <boost/variant.hpp>
+
+#include <parser.hpp>
+#include <compiler.hpp>
+
+#include <image.hpp>
+#include <decoder.hpp>
+#include <analysis.hpp>
+#include <formatter.hpp>
+
+using namespace std;
+using namespace dcpu::disassembler;
+
+// Disassembles images and checks that the assembler turns the output back into the same words.
+class RoundTripTest : public ::testing::Test {
+public:
+	void SetUp() {
+		char path[] = "/tmp/dcpu-image-XXXXXX";
+		int fd = mkstemp(path);
+		close(fd);
+		filename = path;
+	}
+
+	void TearDown() {
+		remove(filename.c_str());
+	}
+protected:
+	string filename;
+
+	void write(const vector<uint16_t> &words) {
+		FILE *file = fopen(filename.c_str(), "wb");
+		for (auto word : words) {
+			fputc(word >> 8, file);
+			fputc(word & 0xff, file);
+		}
+		fclose(file);
+	}
+
+	string disassemble(Radix radix, bool linear) {
+		Image image(filename);
+		Analysis analysis(image);
+		analysis.addEntry(0);
+		analysis.run();
+
+		ostringstream out;
+		Formatter formatter(out, radix, linear ? nullptr : &analysis);
+		uint16_t words[Formatter::MAX_DATA];
+		Instruction instruction;
+
+		for (size_t address = 0; address < image.size(); address += instruction.length) {
+			formatter.label(address);
+			size_t available = image.read(address, words, Decoder::MAX_LENGTH);
+			if (linear || analysis.getType(address) == Analysis::CODE) {
+				Decoder::decode(words, available, instruction);
+				formatter.instruction(address, instruction, words);
+			} else {
+				instruction.length = 1;
+				formatter.data(address, words, 1);
+			}
+		}
+
+		formatter.flush();
+		return out.str();
+	}
+
+	vector<uint16_t> assemble(const string &source) {
+		dcpu::assembler::log logger;
+		dcpu::assembler::lexer lex(source, "<Test>", logger);
+		lex.parse();
+
+		dcpu::assembler::statement_list statements;
+		dcpu::assembler::parser parser(lex, statements);
+		parser.parse();
+
+		dcpu::assembler::symbol_table table;
+		dcpu::assembler::compiler compiler(logger, table, statements);
+		ostringstream out;
+		compiler.compile(out, dcpu::assembler::compiler_mode::NORMAL);
+		EXPECT_FALSE(logger.has_errors());
+
+		string bytes = out.str();
+		vector<uint16_t> words;
+		for (size_t i = 0; i + 1 < bytes.size(); i += 2) {
+			words.push_back(static_cast<uint8_t>(bytes[i]) << 8 | static_cast<uint8_t>(bytes[i + 1]));
+		}
+		return words;
+	}
+
+	void check(const vector<uint16_t> &words) {
+		write(words);
+
+		for (bool linear : { true, false }) {
+			for (Radix radix : { Radix::HEX, Radix::DECIMAL, Radix::OCTAL }) {
+				string source = disassemble(radix, linear);
+				ASSERT_EQ(words, assemble(source)) << source;
+			}
+		}
+	}
+};
+
+TEST_F(RoundTripTest, EncodingsTheAssemblerWouldShorten) {
+	check({
+		0x7c01, 0x0005,         // SET A, LONG 5
+		0x7c01, 0xffff,         // SET A, 0xffff
+		0x8001,                 // SET A, -1
+		0x4001, 0x0000,         // SET A, LONG [A + 0]
+		0x6a21, 0x0000, 0x0000, // SET LONG [B + 0], LONG PICK 0
+		0x7f81, 0x000b,         // SET PC, LONG L_000b
+		0x84e0                  // HCF 0
+	});
+}
+
+TEST_F(RoundTripTest, LabelsAndData) {
+	// JSR L_0005 / SET [D_0007], A / HCF 0 / SET A, [D_0007] / SET PC, POP / DAT 0x1234
+	check({ 0x9820, 0x03c1, 0x0007, 0x84e0, 0x84e0, 0x7801, 0x0007, 0x1234 });
+}
+
+TEST_F(RoundTripTest, RandomWords) {
+	srand(1);
+	vector<uint16_t> words;
+	for (int i = 0; i < 4000; i++) {
+		words.push_back(rand() & 0xffff);
+	}
+
+	check(words);
+}
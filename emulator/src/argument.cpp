@@ -58,6 +58,23 @@ namespace dcpu { namespace emulator {
 		this->value = value;
 	}
 
+    /*************************************************************************
+     *
+     * MemoryArgument
+     *
+     *************************************************************************/
+    MemoryArgument::MemoryArgument(Dcpu &cpu, uint16_t address) : memory(cpu.memory), address(address) {
+
+    }
+
+    uint16_t MemoryArgument::get() const {
+        return memory.read(address);
+    }
+
+    void MemoryArgument::set(uint16_t value) {
+        memory.write(address, value);
+    }
+
     /*************************************************************************
      *
      * ReadOnlyArgument
@@ -90,6 +107,10 @@ namespace dcpu { namespace emulator {
         return ::str(format("%s") % _register);
     }
 
+    registers RegisterArgument::getRegister() const {
+        return _register;
+    }
+
     bool RegisterArgument::matches(uint8_t code, bool isA) {
         return (code >= START && code <= END) || code == PC || code == EX || code == SP;
     }
@@ -118,7 +139,7 @@ namespace dcpu { namespace emulator {
      *************************************************************************/
     
     RegisterIndirectArgument::RegisterIndirectArgument(Dcpu &cpu, registers _register) 
-            : WritableArgument(cpu.registers.indirect(_register)), _register(_register) {
+            : MemoryArgument(cpu, cpu.registers.indirectAddress(_register)), _register(_register) {
     }
 
     string RegisterIndirectArgument::str() const {
@@ -142,7 +163,7 @@ namespace dcpu { namespace emulator {
      *************************************************************************/
 
     RegisterIndirectOffsetArgument::RegisterIndirectOffsetArgument(Dcpu &cpu, registers _register,
-            uint16_t offset) : WritableArgument(cpu.registers.indirect(_register,  offset)), _register(_register),
+            uint16_t offset) : MemoryArgument(cpu, cpu.registers.indirectAddress(_register, offset)), _register(_register),
             offset(offset) {
     }
 
@@ -170,7 +191,7 @@ namespace dcpu { namespace emulator {
      *
      *************************************************************************/
     
-    StackPushArgument::StackPushArgument(Dcpu &cpu) : WritableArgument(cpu.stack.push()) {
+    StackPushArgument::StackPushArgument(Dcpu &cpu) : MemoryArgument(cpu, cpu.stack.pushAddress()) {
 
     }
 
@@ -191,7 +212,7 @@ namespace dcpu { namespace emulator {
      * StackPopArgument
      *
      *************************************************************************/
-    StackPopArgument::StackPopArgument(Dcpu &cpu) : WritableArgument(cpu.stack.pop()) {
+    StackPopArgument::StackPopArgument(Dcpu &cpu) : MemoryArgument(cpu, cpu.stack.popAddress()) {
 
     }
 
@@ -212,7 +233,7 @@ namespace dcpu { namespace emulator {
      * StackPeekArgument
      *
      *************************************************************************/
-    StackPeekArgument::StackPeekArgument(Dcpu &cpu) : WritableArgument(cpu.stack.peek()) {
+    StackPeekArgument::StackPeekArgument(Dcpu &cpu) : MemoryArgument(cpu, cpu.stack.peekAddress()) {
 
     }
 
@@ -234,7 +255,7 @@ namespace dcpu { namespace emulator {
      *
      *************************************************************************/
     StackPickArgument::StackPickArgument(Dcpu &cpu, uint16_t offset) 
-        : WritableArgument(cpu.stack.pick(offset)), offset(offset)  {
+        : MemoryArgument(cpu, cpu.stack.pickAddress(offset)), offset(offset)  {
 
     }
 
@@ -256,7 +277,7 @@ namespace dcpu { namespace emulator {
      *
      *************************************************************************/
     IndirectNextWordArgument::IndirectNextWordArgument(Dcpu &cpu, uint16_t nextWord) 
-            : WritableArgument(cpu.memory[nextWord]), nextWord(nextWord) {
+            : MemoryArgument(cpu, nextWord), nextWord(nextWord) {
     }
 
     uint16_t IndirectNextWordArgument::getCycles() const {
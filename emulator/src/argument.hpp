@@ -38,6 +38,16 @@ namespace dcpu { namespace emulator {
         virtual void set(uint16_t);
     };
 
+    class MemoryArgument : public Argument {
+    protected:
+        DcpuMemory &memory;
+        uint16_t address;
+        MemoryArgument(Dcpu &cpu, uint16_t address);
+    public:
+        virtual uint16_t get() const;
+        virtual void set(uint16_t);
+    };
+
     class RegisterArgument : public WritableArgument {
         enum {START = 0, END=0x7, SP=0x1b, PC=0x1c, EX=0x1d};
 
@@ -45,12 +55,14 @@ namespace dcpu { namespace emulator {
     public:
         RegisterArgument(Dcpu &cpu, registers _register);
         virtual std::string str() const;
+
+        registers getRegister() const;
     
         static bool matches(uint8_t code, bool isA);
         static ArgumentPtr create(Dcpu &cpu, uint8_t code, bool isA);
     };
 
-    class RegisterIndirectArgument : public WritableArgument {
+    class RegisterIndirectArgument : public MemoryArgument {
         enum { START=0x8, END=0xf };
 
         registers _register;
@@ -62,7 +74,7 @@ namespace dcpu { namespace emulator {
         static ArgumentPtr create(Dcpu &cpu, uint8_t code, bool isA);
     };
 
-    class RegisterIndirectOffsetArgument : public WritableArgument {
+    class RegisterIndirectOffsetArgument : public MemoryArgument {
         enum { START = 0x10, END=0x17 };
 
         registers _register;
@@ -77,7 +89,7 @@ namespace dcpu { namespace emulator {
         static ArgumentPtr create(Dcpu &cpu, uint8_t code, bool isA);
     };
 
-    class StackPushArgument : public WritableArgument {
+    class StackPushArgument : public MemoryArgument {
         enum { VALUE = 0x18 };
         
     public:
@@ -88,7 +100,7 @@ namespace dcpu { namespace emulator {
         static ArgumentPtr create(Dcpu &cpu, uint8_t code, bool isA);
     };
 
-    class StackPopArgument : public WritableArgument {
+    class StackPopArgument : public MemoryArgument {
         enum { VALUE = 0x18 };
         
     public:
@@ -99,7 +111,7 @@ namespace dcpu { namespace emulator {
         static ArgumentPtr create(Dcpu &cpu, uint8_t code, bool isA);
     };
 
-    class StackPeekArgument : public WritableArgument {
+    class StackPeekArgument : public MemoryArgument {
         enum { VALUE = 0x19 };
     
     public:    
@@ -110,7 +122,7 @@ namespace dcpu { namespace emulator {
         static ArgumentPtr create(Dcpu &cpu, uint8_t code, bool isA);
     };
 
-    class StackPickArgument : public WritableArgument {
+    class StackPickArgument : public MemoryArgument {
         enum { VALUE = 0x1a };
         
         uint16_t offset;
@@ -122,7 +134,7 @@ namespace dcpu { namespace emulator {
         static ArgumentPtr create(Dcpu &cpu, uint8_t code, bool isA);
     };
 
-    class IndirectNextWordArgument : public WritableArgument {
+    class IndirectNextWordArgument : public MemoryArgument {
         enum { VALUE = 0x1e };
 
         uint16_t nextWord;
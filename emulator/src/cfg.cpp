@@ -0,0 +1,394 @@
+#include <boost/format.hpp>
+
+#include "cfg.hpp"
+#include "opcodes.hpp"
+
+using namespace std;
+using boost::format;
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * Decoding
+	 *
+	 *************************************************************************/
+
+	struct OpcodeCost {
+		uint8_t cycles;
+		bool conditional;
+	};
+
+	// indexed by opcode, taken from the opcode declarations.  Zero cycles marks an invalid opcode.
+	struct CostTable {
+		OpcodeCost basic[32];
+		OpcodeCost special[32];
+
+		CostTable() : basic(), special() {
+#define BASIC_COST(name) basic[name ## Opcode::OPCODE] = { name ## Opcode::CYCLES, name ## Opcode::CONDITIONAL }
+#define SPECIAL_COST(name) special[name ## Opcode::OPCODE] = { name ## Opcode::CYCLES, false }
+			BASIC_COST(set); BASIC_COST(add); BASIC_COST(sub); BASIC_COST(mul); BASIC_COST(mli);
+			BASIC_COST(div); BASIC_COST(dvi); BASIC_COST(mod); BASIC_COST(mdi); BASIC_COST(and);
+			BASIC_COST(bor); BASIC_COST(xor); BASIC_COST(shr); BASIC_COST(asr); BASIC_COST(shl);
+			BASIC_COST(ifb); BASIC_COST(ifc); BASIC_COST(ife); BASIC_COST(ifn); BASIC_COST(ifg);
+			BASIC_COST(ifa); BASIC_COST(ifl); BASIC_COST(ifu); BASIC_COST(adx); BASIC_COST(sbx);
+			BASIC_COST(sti); BASIC_COST(std);
+
+			SPECIAL_COST(jsr); SPECIAL_COST(hcf); SPECIAL_COST(int); SPECIAL_COST(iag); SPECIAL_COST(ias);
+			SPECIAL_COST(rfi); SPECIAL_COST(iaq); SPECIAL_COST(hwn); SPECIAL_COST(hwq); SPECIAL_COST(hwi);
+#undef BASIC_COST
+#undef SPECIAL_COST
+		}
+	};
+
+	static const CostTable COSTS;
+
+	enum { PC_CODE = 0x1c, POP_CODE = 0x18, NEXT_WORD_LITERAL = 0x1f, SHORT_LITERAL = 0x20 };
+
+	static bool usesNextWord(uint8_t code) {
+		return (code >= 0x10 && code <= 0x17) || code == 0x1a || code == 0x1e || code == 0x1f;
+	}
+
+	// as Argument::getCycles charges them, which leaves PICK free
+	static uint8_t argumentCycles(uint8_t code) {
+		return (code >= 0x10 && code <= 0x17) || code == 0x1e || code == 0x1f;
+	}
+
+	bool DecodedInstruction::literalA(uint16_t &value) const {
+		if (a == NEXT_WORD_LITERAL) {
+			value = nextA;
+		} else if (a >= SHORT_LITERAL) {
+			value = a - SHORT_LITERAL - 1;
+		} else {
+			return false;
+		}
+
+		return true;
+	}
+
+	DecodedInstruction decodeInstruction(const uint16_t *memory, uint16_t address) {
+		DecodedInstruction decoded = DecodedInstruction();
+		uint16_t word = memory[address];
+		uint16_t next = address + 1;
+
+		decoded.opcode = word & 0x1f;
+		decoded.b = (word >> 5) & 0x1f;
+		decoded.a = word >> 10;
+
+		// a's next word comes first
+		if (usesNextWord(decoded.a)) {
+			decoded.nextA = memory[next++];
+		}
+		if (decoded.opcode && usesNextWord(decoded.b)) {
+			decoded.nextB = memory[next++];
+		}
+		decoded.length = static_cast<uint16_t>(next - address);
+
+		const OpcodeCost &cost = decoded.opcode ? COSTS.basic[decoded.opcode] : COSTS.special[decoded.b];
+		if (cost.cycles) {
+			decoded.cycles = cost.cycles + argumentCycles(decoded.a) + (decoded.opcode ? argumentCycles(decoded.b) : 0);
+		} else {
+			decoded.length = 1;
+		}
+		decoded.conditional = cost.conditional;
+
+		return decoded;
+	}
+
+	uint8_t instructionLength(uint16_t instruction) {
+		uint8_t a = instruction >> 10;
+		uint8_t b = (instruction >> 5) & 0x1f;
+		return 1 + usesNextWord(a) + ((instruction & 0x1f) && usesNextWord(b));
+	}
+
+	// how an instruction leaves the straight line, and where to when that is known
+	static ControlFlowGraph::Block::Exit classify(const DecodedInstruction &decoded, uint16_t next, uint16_t &target,
+			bool &known) {
+
+		typedef ControlFlowGraph::Block Block;
+		uint16_t value;
+		known = decoded.literalA(value);
+
+		if (!decoded.cycles) {
+			return Block::INVALID;
+		}
+
+		if (decoded.opcode == 0) {
+			if (decoded.b == jsrOpcode::OPCODE) {
+				target = known ? value : 0;
+				return Block::CALL;
+			} else if (decoded.b == hcfOpcode::OPCODE) {
+				return Block::HALT;
+			} else if (decoded.b == rfiOpcode::OPCODE) {
+				return Block::RETURN;
+			} else if ((decoded.b == iagOpcode::OPCODE || decoded.b == hwnOpcode::OPCODE) && decoded.a == PC_CODE) {
+				return Block::INDIRECT;
+			}
+
+			return Block::FALLTHROUGH;
+		}
+
+		if (decoded.opcode >= ifbOpcode::OPCODE && decoded.opcode <= ifuOpcode::OPCODE) {
+			return Block::CONDITIONAL;
+		}
+
+		if (decoded.b != PC_CODE) {
+			return Block::FALLTHROUGH;
+		}
+
+		if (decoded.opcode == setOpcode::OPCODE && decoded.a == POP_CODE) {
+			return Block::RETURN;
+		} else if (known && decoded.opcode == setOpcode::OPCODE) {
+			target = value;
+			return Block::JUMP;
+		} else if (known && decoded.opcode == addOpcode::OPCODE) {
+			target = next + value;
+			return Block::JUMP;
+		} else if (known && decoded.opcode == subOpcode::OPCODE) {
+			target = next - value;
+			return Block::JUMP;
+		}
+
+		return Block::INDIRECT;
+	}
+
+	// where a failed IFx continues, past the chain of conditionals that follows it
+	static uint16_t skipTarget(const uint16_t *memory, uint16_t next, uint8_t &skipped) {
+		DecodedInstruction decoded;
+		skipped = 0;
+
+		do {
+			decoded = decodeInstruction(memory, next);
+			next += decoded.length;
+			skipped++;
+		} while (decoded.conditional && skipped < 0xff);
+
+		return next;
+	}
+
+	/*************************************************************************
+	 *
+	 * ControlFlowGraph
+	 *
+	 *************************************************************************/
+
+	const char *ControlFlowGraph::EDGE_NAMES[] = { "fallthrough", "skip", "jump", "call" };
+	const char *ControlFlowGraph::EXIT_NAMES[] = { "fallthrough", "conditional", "jump", "call", "return",
+			"indirect", "halt", "invalid" };
+
+	ControlFlowGraph::ControlFlowGraph(const uint16_t *memory, const vector<uint16_t> &entries)
+			: flags(TOTAL_WORDS), blocks(), blockIndex(TOTAL_WORDS, NO_BLOCK) {
+
+		vector<uint16_t> pending;
+		for (auto entry : entries) {
+			flags[entry] |= LEADER | ENTRY;
+			pending.push_back(entry);
+		}
+		discover(memory, pending);
+
+		for (uint32_t address = 0; address < TOTAL_WORDS; address++) {
+			if (flags[address] & LEADER) {
+				buildBlock(memory, address);
+			}
+		}
+
+		// where blocks overlap, the one starting closest before a word owns it
+		for (uint32_t index = 0; index < blocks.size(); index++) {
+			for (uint32_t offset = 0; offset < blocks[index].words && offset < TOTAL_WORDS; offset++) {
+				blockIndex[static_cast<uint16_t>(blocks[index].start + offset)] = index;
+			}
+		}
+	}
+
+	void ControlFlowGraph::discover(const uint16_t *memory, vector<uint16_t> &pending) {
+		auto branch = [&](uint16_t target) {
+			flags[target] |= LEADER;
+			pending.push_back(target);
+		};
+
+		while (!pending.empty()) {
+			uint16_t address = pending.back();
+			pending.pop_back();
+
+			if (flags[address] & INSTRUCTION) {
+				continue;
+			}
+			flags[address] |= INSTRUCTION;
+
+			DecodedInstruction decoded = decodeInstruction(memory, address);
+			uint16_t next = address + decoded.length;
+			uint16_t target;
+			bool known;
+			uint8_t skipped;
+
+			switch (classify(decoded, next, target, known)) {
+			case Block::FALLTHROUGH:
+				// IAS 0 turns interrupts off
+				if (decoded.isSpecial(iasOpcode::OPCODE) && decoded.literalA(target) && target != 0) {
+					flags[target] |= ENTRY | HANDLER;
+					branch(target);
+				}
+				pending.push_back(next);
+				break;
+			case Block::CONDITIONAL:
+				branch(next);
+				branch(skipTarget(memory, next, skipped));
+				break;
+			case Block::CALL:
+				if (known) {
+					branch(target);
+				}
+				branch(next);
+				break;
+			case Block::JUMP:
+				branch(target);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	void ControlFlowGraph::buildBlock(const uint16_t *memory, uint16_t start) {
+		Block block;
+		block.start = start;
+		block.words = 0;
+		block.instructions = 0;
+		block.cycles = 0;
+
+		uint16_t address = start;
+		uint16_t next;
+		uint16_t target;
+		bool known;
+
+		for (;;) {
+			DecodedInstruction decoded = decodeInstruction(memory, address);
+			next = address + decoded.length;
+			block.exit = classify(decoded, next, target, known);
+			block.words += decoded.length;
+			block.instructions++;
+			block.cycles += decoded.cycles;
+
+			if (block.exit != Block::FALLTHROUGH || (flags[next] & LEADER) || block.words >= TOTAL_WORDS) {
+				break;
+			}
+			address = next;
+		}
+
+		uint8_t skipped;
+		switch (block.exit) {
+		case Block::FALLTHROUGH:
+			block.successors.push_back(Edge { next, Edge::FALLTHROUGH, 0 });
+			break;
+		case Block::CONDITIONAL:
+			block.successors.push_back(Edge { next, Edge::FALLTHROUGH, 0 });
+			target = skipTarget(memory, next, skipped);
+			block.successors.push_back(Edge { target, Edge::SKIP, skipped });
+			break;
+		case Block::CALL:
+			if (known) {
+				block.successors.push_back(Edge { target, Edge::CALL, 0 });
+			}
+			block.successors.push_back(Edge { next, Edge::FALLTHROUGH, 0 });
+			break;
+		case Block::JUMP:
+			block.successors.push_back(Edge { target, Edge::JUMP, 0 });
+			break;
+		default:
+			break;
+		}
+
+		blocks.push_back(move(block));
+	}
+
+	const vector<ControlFlowGraph::Block> &ControlFlowGraph::getBlocks() const {
+		return blocks;
+	}
+
+	const ControlFlowGraph::Block *ControlFlowGraph::findBlock(uint16_t address) const {
+		uint32_t index = blockIndex[address];
+		return index == NO_BLOCK ? nullptr : &blocks[index];
+	}
+
+	bool ControlFlowGraph::isEntry(uint16_t address) const {
+		return flags[address] & ENTRY;
+	}
+
+	bool ControlFlowGraph::isHandler(uint16_t address) const {
+		return flags[address] & HANDLER;
+	}
+
+	bool ControlFlowGraph::isInstruction(uint16_t address) const {
+		return flags[address] & INSTRUCTION;
+	}
+
+	uint16_t ControlFlowGraph::instructionCycles(const uint16_t *memory, uint16_t address) {
+		return decodeInstruction(memory, address).cycles;
+	}
+
+	void ControlFlowGraph::writeDot(ostream &out) const {
+		out << "digraph cfg {\n";
+		out << "\tnode [shape=box, fontname=\"monospace\"];\n";
+
+		for (auto &block : blocks) {
+			out << format("\tb%04x [label=\"%04x-%04x\\n%d instructions, %d cycles\\n%s\"%s];\n") % block.start
+					% block.start % static_cast<uint16_t>(block.start + block.words - 1) % block.instructions
+					% block.cycles % EXIT_NAMES[block.exit] % (isEntry(block.start) ? ", peripheries=2" : "");
+		}
+
+		for (auto &block : blocks) {
+			for (auto &edge : block.successors) {
+				out << format("\tb%04x -> b%04x") % block.start % edge.target;
+				switch (edge.kind) {
+				case Edge::SKIP:
+					out << format(" [style=dashed, label=\"skip %d\"]") % (int)edge.skipped;
+					break;
+				case Edge::JUMP:
+					out << " [style=bold]";
+					break;
+				case Edge::CALL:
+					out << " [style=dotted, label=\"call\"]";
+					break;
+				default:
+					break;
+				}
+				out << ";\n";
+			}
+		}
+
+		out << "}\n";
+	}
+
+	void ControlFlowGraph::writeJson(ostream &out) const {
+		out << "{\n\t\"entries\": [";
+		const char *separator = "";
+		for (uint32_t address = 0; address < TOTAL_WORDS; address++) {
+			if (isEntry(address)) {
+				out << separator << address;
+				separator = ", ";
+			}
+		}
+		out << "],\n\t\"blocks\": [";
+
+		separator = "\n";
+		for (auto &block : blocks) {
+			out << separator << format("\t\t{\"start\": %d, \"words\": %d, \"instructions\": %d, \"cycles\": %d, "
+					"\"exit\": \"%s\", \"successors\": [") % block.start % block.words % block.instructions
+					% block.cycles % EXIT_NAMES[block.exit];
+
+			for (size_t i = 0; i < block.successors.size(); i++) {
+				const Edge &edge = block.successors[i];
+				out << format("%s{\"target\": %d, \"kind\": \"%s\"") % (i ? ", " : "") % edge.target
+						% EDGE_NAMES[edge.kind];
+				if (edge.kind == Edge::SKIP) {
+					out << format(", \"skipped\": %d") % (int)edge.skipped;
+				}
+				out << "}";
+			}
+
+			out << "]}";
+			separator = ",\n";
+		}
+
+		out << "\n\t]\n}\n";
+	}
+}}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <ostream>
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * DecodedInstruction
+	 *
+	 * An instruction as the emulator runs it, with the cycles it takes when
+	 * it is not skipped.  The tracer, debugger, cycle estimator and
+	 * disassembler all find instruction boundaries through
+	 * decodeInstruction() or instructionLength(), so they agree with each
+	 * other and with the graph.
+	 *
+	 *************************************************************************/
+	struct DecodedInstruction {
+		// zero for special opcodes, whose opcode is in b
+		uint8_t opcode;
+		uint8_t a;
+		uint8_t b;
+		uint16_t nextA;
+		uint16_t nextB;
+		uint16_t length;
+		// zero when the word does not decode
+		uint16_t cycles;
+		bool conditional;
+
+		bool isValid() const {
+			return cycles != 0;
+		}
+
+		bool isSpecial(uint8_t special) const {
+			return opcode == 0 && b == special;
+		}
+
+		/**
+		 * Sets value to a when a is a literal.
+		 */
+		bool literalA(uint16_t &value) const;
+	};
+
+	/**
+	 * Decodes the instruction at the address of a 64K word memory, whose
+	 * next words wrap around its end.  An instruction that does not decode
+	 * is one word long.
+	 */
+	DecodedInstruction decodeInstruction(const uint16_t *memory, uint16_t address);
+
+	/**
+	 * The words of the instruction that starts with the word, counting the
+	 * next words its operands take even when the opcode is invalid.
+	 */
+	uint8_t instructionLength(uint16_t instruction);
+
+	/*************************************************************************
+	 *
+	 * ControlFlowGraph
+	 *
+	 * Splits the code reachable from a set of entry points in a 64K word
+	 * memory image into basic blocks.  A block ends at an IFx, a jump, a
+	 * call, anything else that writes PC, and before every instruction that
+	 * something branches to.  Interrupt handlers set with IAS <literal> are
+	 * followed as entry points.
+	 *
+	 * Cycle costs come from the opcode declarations and the operand costs
+	 * the emulator charges, so a block costs what running it takes when no
+	 * instruction in it is skipped.  Only the image is read, so that tools
+	 * can build graphs without a cpu.
+	 *
+	 *************************************************************************/
+	class ControlFlowGraph {
+	public:
+		enum { TOTAL_WORDS = 65536 };
+
+		struct Edge {
+			enum Kind : uint8_t { FALLTHROUGH, SKIP, JUMP, CALL };
+
+			uint16_t target;
+			Kind kind;
+			// the instructions passed over by a skip, which cost a cycle each
+			uint8_t skipped;
+		};
+
+		struct Block {
+			enum Exit : uint8_t { FALLTHROUGH, CONDITIONAL, JUMP, CALL, RETURN, INDIRECT, HALT, INVALID };
+
+			uint16_t start;
+			// the block may wrap around the end of memory
+			uint32_t words;
+			uint32_t instructions;
+			uint32_t cycles;
+			Exit exit;
+			std::vector<Edge> successors;
+
+			bool contains(uint16_t address) const {
+				return static_cast<uint16_t>(address - start) < words;
+			}
+		};
+
+		static const char *EDGE_NAMES[];
+		static const char *EXIT_NAMES[];
+	private:
+		enum Flags : uint8_t { INSTRUCTION = 1 << 0, LEADER = 1 << 1, ENTRY = 1 << 2, HANDLER = 1 << 3 };
+		enum : uint32_t { NO_BLOCK = 0xffffffff };
+
+		std::vector<uint8_t> flags;
+		std::vector<Block> blocks;
+		std::vector<uint32_t> blockIndex;
+
+		void discover(const uint16_t *memory, std::vector<uint16_t> &pending);
+		void buildBlock(const uint16_t *memory, uint16_t start);
+	public:
+		/**
+		 * Builds the graph from the entry points.  The memory must hold
+		 * TOTAL_WORDS words and is not kept.
+		 */
+		ControlFlowGraph(const uint16_t *memory, const std::vector<uint16_t> &entries);
+
+		/**
+		 * The blocks ordered by start address.
+		 */
+		const std::vector<Block> &getBlocks() const;
+
+		/**
+		 * The block containing the address, or nullptr.  Blocks overlap
+		 * where code jumps into the middle of an instruction, and then the
+		 * one starting closest before the address is returned.
+		 */
+		const Block *findBlock(uint16_t address) const;
+
+		bool isEntry(uint16_t address) const;
+		bool isHandler(uint16_t address) const;
+		bool isInstruction(uint16_t address) const;
+
+		/**
+		 * The cycles an instruction takes when it runs, or 0 when the word
+		 * does not decode.
+		 */
+		static uint16_t instructionCycles(const uint16_t *memory, uint16_t address);
+
+		void writeDot(std::ostream &out) const;
+		void writeJson(std::ostream &out) const;
+	};
+}}
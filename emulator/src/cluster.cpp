@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <thread>
+
+#include "cluster.hpp"
+#include "hardware.hpp"
+
+using namespace std;
+
+namespace dcpu { namespace emulator {
+	SharedDevice::SharedDevice(DcpuCluster &cluster, uint32_t manufacturerId, uint32_t hardwareId, uint16_t version)
+		: cluster(cluster), manufacturerId(manufacturerId), hardwareId(hardwareId), version(version) {
+
+	}
+
+	SharedDevice::~SharedDevice() {
+
+	}
+
+	void SharedDevice::tick() {
+
+	}
+
+	uint32_t SharedDevice::getHardwareId() {
+		return hardwareId;
+	}
+
+	uint32_t SharedDevice::getManufacturerId() {
+		return manufacturerId;
+	}
+
+	uint16_t SharedDevice::getVersion() {
+		return version;
+	}
+
+	/*************************************************************************
+	 *
+	 * SharedDevicePort
+	 *
+	 * Stands in for a shared device in the hardware manager of one core.
+	 *
+	 *************************************************************************/
+	class SharedDevicePort : public HardwareDevice {
+		DcpuCluster &cluster;
+		size_t core;
+		shared_ptr<SharedDevice> device;
+	public:
+		SharedDevicePort(DcpuCluster &cluster, size_t core, shared_ptr<SharedDevice> device)
+			: HardwareDevice(cluster.getCore(core), device->getManufacturerId(), device->getHardwareId(),
+					device->getVersion()), cluster(cluster), core(core), device(device) {}
+
+		virtual void tick() {}
+
+		virtual uint16_t interrupt() {
+			cluster.waitForTurn(core);
+			return device->interrupt(core);
+		}
+
+		virtual uint64_t getNextEvent() {
+			return NO_EVENT;
+		}
+	};
+
+	DcpuCluster::DcpuCluster(size_t coreCount, uint64_t quantum) : cores(), devices(),
+			progress(new atomic<uint64_t>[coreCount]), quantum(max<uint64_t>(quantum, 1)), cycles(0), mutex(),
+			started(), finished(), generation(0), quantumEnd(0), running(0), stopping(false), error() {
+
+		for (size_t i = 0; i < coreCount; i++) {
+			cores.push_back(unique_ptr<Dcpu>(new Dcpu()));
+			progress[i].store(0);
+		}
+	}
+
+	DcpuCluster::~DcpuCluster() {
+
+	}
+
+	size_t DcpuCluster::getCoreCount() {
+		return cores.size();
+	}
+
+	Dcpu &DcpuCluster::getCore(size_t core) {
+		return *cores[core];
+	}
+
+	uint64_t DcpuCluster::getCycles() {
+		return cycles;
+	}
+
+	void DcpuCluster::addSharedDevice(shared_ptr<SharedDevice> device) {
+		devices.push_back(device);
+		for (size_t i = 0; i < cores.size(); i++) {
+			cores[i]->hardwareManager.registerDevice(make_shared<SharedDevicePort>(*this, i, device));
+		}
+	}
+
+	void DcpuCluster::waitForTurn(size_t core) {
+		// instructions take at least a cycle, so a core that has reached the
+		// cycle of this HWI with a lower index has finished any HWI it started at it
+		uint64_t start = progress[core].load(memory_order_relaxed);
+		for (size_t other = 0; other < cores.size(); other++) {
+			if (other == core) {
+				continue;
+			}
+
+			uint64_t reached;
+			while ((reached = progress[other].load(memory_order_acquire)) < start
+					|| (reached == start && other < core)) {
+				this_thread::yield();
+			}
+		}
+	}
+
+	void DcpuCluster::runCore(size_t core, uint64_t seen) {
+		Dcpu &cpu = *cores[core];
+
+		while (true) {
+			uint64_t end;
+			{
+				unique_lock<std::mutex> lock(mutex);
+				started.wait(lock, [this, seen] { return generation != seen; });
+				seen = generation;
+				if (stopping) {
+					return;
+				}
+				end = quantumEnd;
+			}
+
+			try {
+				while (!cpu.isOnFire() && cpu.getCycles() < end) {
+					cpu.tick();
+					cpu.hardwareManager.tickAll();
+					progress[core].store(cpu.getCycles(), memory_order_release);
+				}
+			} catch (...) {
+				lock_guard<std::mutex> lock(mutex);
+				if (!error) {
+					error = current_exception();
+				}
+				cpu.catchFire();
+			}
+
+			if (cpu.isOnFire()) {
+				progress[core].store(FINISHED, memory_order_release);
+			}
+
+			lock_guard<std::mutex> lock(mutex);
+			if (--running == 0) {
+				finished.notify_one();
+			}
+		}
+	}
+
+	void DcpuCluster::run(uint64_t maxCycles) {
+		vector<thread> threads;
+		for (size_t i = 0; i < cores.size(); i++) {
+			threads.push_back(thread(&DcpuCluster::runCore, this, i, generation));
+		}
+
+		while (!error && (maxCycles == 0 || cycles < maxCycles)) {
+			bool active = false;
+			for (size_t i = 0; i < cores.size(); i++) {
+				active |= !cores[i]->isOnFire();
+				progress[i].store(cores[i]->isOnFire() ? FINISHED : cores[i]->getCycles(), memory_order_relaxed);
+			}
+
+			if (!active) {
+				break;
+			}
+
+			{
+				unique_lock<std::mutex> lock(mutex);
+				quantumEnd = maxCycles ? min(cycles + quantum, maxCycles) : cycles + quantum;
+				running = cores.size();
+				generation++;
+				started.notify_all();
+				finished.wait(lock, [this] { return running == 0; });
+			}
+
+			cycles = quantumEnd;
+			for (auto &device : devices) {
+				device->tick();
+			}
+		}
+
+		{
+			lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			generation++;
+			started.notify_all();
+		}
+
+		for (auto &thread : threads) {
+			thread.join();
+		}
+		stopping = false;
+
+		if (error) {
+			exception_ptr thrown = error;
+			error = nullptr;
+			rethrow_exception(thrown);
+		}
+	}
+}}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "dcpu.hpp"
+
+namespace dcpu { namespace emulator {
+	class DcpuCluster;
+
+	/*************************************************************************
+	 *
+	 * SharedDevice
+	 *
+	 * A device on the bus that every core of a cluster shares.  Each core
+	 * sees it at the same index of its hardware manager.  interrupt() runs
+	 * on the thread of the core that sent the HWI, one core at a time, and
+	 * may only change that core.  tick() runs once at the end of each
+	 * quantum, while every core is stopped, and may change any of them.
+	 *
+	 *************************************************************************/
+	class SharedDevice {
+	protected:
+		DcpuCluster &cluster;
+		uint32_t manufacturerId;
+		uint32_t hardwareId;
+		uint16_t version;
+	public:
+		SharedDevice(DcpuCluster &cluster, uint32_t manufacturerId, uint32_t hardwareId, uint16_t version);
+		virtual ~SharedDevice();
+
+		virtual uint16_t interrupt(size_t core)=0;
+		virtual void tick();
+
+		uint32_t getHardwareId();
+		uint32_t getManufacturerId();
+		uint16_t getVersion();
+	};
+
+	/*************************************************************************
+	 *
+	 * DcpuCluster
+	 *
+	 * Several cores, each with its own memory and devices, that run on their
+	 * own host threads and share the devices added to the cluster.  Cores
+	 * run in quanta of a fixed number of cycles and wait for each other at
+	 * the end of each.  Within a quantum, a core that sends an HWI to a
+	 * shared device waits until every other core has run past the cycle the
+	 * HWI started at, with ties going to the lower core, so shared devices
+	 * see the same order of calls on every run whatever the host threads
+	 * do.
+	 *
+	 *************************************************************************/
+	class DcpuCluster {
+		friend class SharedDevicePort;
+
+		DcpuCluster(DcpuCluster const&) = delete;
+		DcpuCluster& operator =(DcpuCluster const&) = delete;
+
+		enum : uint64_t { FINISHED = UINT64_MAX };
+
+		std::vector<std::unique_ptr<Dcpu>> cores;
+		std::vector<std::shared_ptr<SharedDevice>> devices;
+		// the cycle each core has run to, or FINISHED once it is on fire
+		std::unique_ptr<std::atomic<uint64_t>[]> progress;
+		uint64_t quantum;
+		uint64_t cycles;
+
+		std::mutex mutex;
+		std::condition_variable started;
+		std::condition_variable finished;
+		uint64_t generation;
+		uint64_t quantumEnd;
+		size_t running;
+		bool stopping;
+		std::exception_ptr error;
+
+		void runCore(size_t core, uint64_t seen);
+		void waitForTurn(size_t core);
+	public:
+		enum : uint64_t { DEFAULT_QUANTUM = 1000 };
+
+		DcpuCluster(size_t coreCount, uint64_t quantum=DEFAULT_QUANTUM);
+		~DcpuCluster();
+
+		size_t getCoreCount();
+		Dcpu &getCore(size_t core);
+
+		/**
+		 * The cycle the last quantum ended at.  Cores may have run a few
+		 * cycles past it to finish their last instruction.
+		 */
+		uint64_t getCycles();
+
+		/**
+		 * Registers the device with every core.
+		 */
+		void addSharedDevice(std::shared_ptr<SharedDevice> device);
+
+		/**
+		 * Runs the cores until all of them are on fire or the cycle count
+		 * reaches maxCycles.  Zero runs without a limit.  Rethrows the first
+		 * error a core threw, after stopping the others.
+		 */
+		void run(uint64_t maxCycles=0);
+	};
+}}
@@ -0,0 +1,326 @@
+#include <sstream>
+#include <stdexcept>
+#include <boost/format.hpp>
+#include <boost/variant.hpp>
+
+#include "condition.hpp"
+#include "../../assembler/src/lexer.hpp"
+#include "../../assembler/src/expression_parser.hpp"
+
+using namespace std;
+using boost::format;
+using boost::str;
+
+namespace asm_ = dcpu::assembler;
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * ConditionCompiler
+	 *
+	 *************************************************************************/
+	class ConditionCompiler : public boost::static_visitor<void> {
+		Dcpu &cpu;
+		vector<Condition::Instruction> &program;
+		int depth;
+
+		void emit(Condition::Op op, int32_t value=0) {
+			Condition::Instruction instruction;
+			instruction.op = op;
+			instruction.value = value;
+			program.push_back(instruction);
+		}
+
+		void push() {
+			if (++depth > Condition::MAX_STACK) {
+				throw invalid_argument("the condition is nested too deeply");
+			}
+		}
+
+		static Condition::Op binaryOp(asm_::binary_operator _operator) {
+			switch (_operator) {
+			case asm_::binary_operator::PLUS:
+				return Condition::Op::ADD;
+			case asm_::binary_operator::MINUS:
+				return Condition::Op::SUBTRACT;
+			case asm_::binary_operator::MULTIPLY:
+				return Condition::Op::MULTIPLY;
+			case asm_::binary_operator::DIVIDE:
+				return Condition::Op::DIVIDE;
+			case asm_::binary_operator::MODULO:
+				return Condition::Op::MODULO;
+			case asm_::binary_operator::SHIFT_LEFT:
+				return Condition::Op::SHIFT_LEFT;
+			case asm_::binary_operator::SHIFT_RIGHT:
+				return Condition::Op::SHIFT_RIGHT;
+			case asm_::binary_operator::BITWISE_AND:
+				return Condition::Op::BITWISE_AND;
+			case asm_::binary_operator::BITWISE_OR:
+				return Condition::Op::BITWISE_OR;
+			case asm_::binary_operator::BITWISE_XOR:
+				return Condition::Op::BITWISE_XOR;
+			case asm_::binary_operator::EQ:
+				return Condition::Op::EQ;
+			case asm_::binary_operator::NEQ:
+				return Condition::Op::NEQ;
+			case asm_::binary_operator::LT:
+				return Condition::Op::LT;
+			case asm_::binary_operator::LTE:
+				return Condition::Op::LTE;
+			case asm_::binary_operator::GT:
+				return Condition::Op::GT;
+			case asm_::binary_operator::GTE:
+				return Condition::Op::GTE;
+			default:
+				throw invalid_argument(str(format("unsupported operator '%s'") % _operator));
+			}
+		}
+	public:
+		ConditionCompiler(Dcpu &cpu, vector<Condition::Instruction> &program) : cpu(cpu), program(program),
+				depth(0) {}
+
+		void operator()(const asm_::literal_operand &expr) {
+			emit(Condition::Op::LITERAL, expr.value);
+			push();
+		}
+
+		void operator()(const asm_::register_operand &expr) {
+			// both enums list A, B, C, X, Y, Z, I, J, SP, PC, EX in the same order
+			Condition::Instruction instruction;
+			instruction.op = Condition::Op::REGISTER;
+			instruction.reg = &cpu.registers[static_cast<registers>(expr._register)];
+			program.push_back(instruction);
+			push();
+		}
+
+		void operator()(const asm_::unary_operation &expr) {
+			boost::apply_visitor(*this, expr.operand);
+
+			switch (expr._operator) {
+			case asm_::unary_operator::PLUS:
+				break;
+			case asm_::unary_operator::MINUS:
+				emit(Condition::Op::NEGATE);
+				break;
+			case asm_::unary_operator::NOT:
+				emit(Condition::Op::NOT);
+				break;
+			case asm_::unary_operator::BITWISE_NOT:
+				emit(Condition::Op::BITWISE_NOT);
+				break;
+			case asm_::unary_operator::INDIRECT:
+				emit(Condition::Op::LOAD);
+				break;
+			}
+		}
+
+		void operator()(const asm_::binary_operation &expr) {
+			boost::apply_visitor(*this, expr.left);
+
+			if (expr._operator == asm_::binary_operator::AND || expr._operator == asm_::binary_operator::OR) {
+				size_t jump = program.size();
+				emit(expr._operator == asm_::binary_operator::AND ? Condition::Op::JUMP_IF_FALSE
+						: Condition::Op::JUMP_IF_TRUE);
+				--depth;
+
+				boost::apply_visitor(*this, expr.right);
+				emit(Condition::Op::TO_BOOL);
+				program[jump].value = program.size();
+				return;
+			}
+
+			boost::apply_visitor(*this, expr.right);
+			emit(binaryOp(expr._operator));
+			--depth;
+		}
+
+		void operator()(const asm_::symbol_operand &expr) {
+			throw invalid_argument(str(format("symbols are not available in conditions: '%s'") % expr.name));
+		}
+
+		void operator()(const asm_::current_position_operand &) {
+			throw invalid_argument("'$' is not available in conditions");
+		}
+
+		void operator()(const asm_::evaluated_expression &) {
+			throw invalid_argument("unexpected evaluated expression");
+		}
+
+		void operator()(const asm_::invalid_expression &) {
+			throw invalid_argument("invalid expression");
+		}
+	};
+
+	/*************************************************************************
+	 *
+	 * Condition
+	 *
+	 *************************************************************************/
+
+	Condition::Condition(const DcpuMemory *memory, const string &source) : memory(memory), source(source),
+			program() {
+
+	}
+
+	Condition Condition::compile(const string &source, Dcpu &cpu) {
+		ostringstream messages;
+		asm_::log logger(messages);
+
+		asm_::lexer lex(source, "<condition>", logger);
+		lex.parse();
+
+		auto current = lex.tokens.begin();
+		asm_::expression_parser parser(current, lex.tokens.end(), logger, asm_::expression_parser::RUNTIME);
+		asm_::expression expr = parser.parse(asm_::next(current, lex.tokens.end()));
+
+		auto &trailing = asm_::next(current, lex.tokens.end());
+		if (!trailing.is_eoi()) {
+			logger.unexpected_token(trailing, "end of condition");
+		}
+
+		if (logger.has_errors()) {
+			string message = messages.str();
+			throw invalid_argument(message.substr(0, message.find_last_not_of('\n') + 1));
+		}
+
+		Condition condition(&cpu.memory, source);
+		ConditionCompiler compiler(cpu, condition.program);
+		boost::apply_visitor(compiler, expr);
+		condition.program.shrink_to_fit();
+
+		return condition;
+	}
+
+	// the two's complement value, without the implementation defined conversion
+	static int32_t toSigned(uint32_t value) {
+		return value <= INT32_MAX ? static_cast<int32_t>(value) : -static_cast<int32_t>(~value) - 1;
+	}
+
+	bool Condition::evaluate() const {
+		// arithmetic wraps in unsigned 32 bits, and only division, >> and ordering read the values as signed
+		uint32_t stack[MAX_STACK];
+		int top = -1;
+
+		const Instruction *instructions = program.data();
+		size_t length = program.size();
+
+		for (size_t i = 0; i < length; i++) {
+			const Instruction &instruction = instructions[i];
+			uint32_t right;
+
+			switch (instruction.op) {
+			case Op::LITERAL:
+				stack[++top] = instruction.value;
+				continue;
+			case Op::REGISTER:
+				stack[++top] = *instruction.reg;
+				continue;
+			case Op::LOAD:
+				stack[top] = (*memory)[static_cast<uint16_t>(stack[top])];
+				continue;
+			case Op::NEGATE:
+				stack[top] = 0u - stack[top];
+				continue;
+			case Op::NOT:
+				stack[top] = !stack[top];
+				continue;
+			case Op::BITWISE_NOT:
+				stack[top] = ~stack[top];
+				continue;
+			case Op::TO_BOOL:
+				stack[top] = stack[top] != 0;
+				continue;
+			case Op::JUMP_IF_FALSE:
+				if (!stack[top]) {
+					i = instruction.value - 1;
+				} else {
+					--top;
+				}
+				continue;
+			case Op::JUMP_IF_TRUE:
+				if (stack[top]) {
+					stack[top] = 1;
+					i = instruction.value - 1;
+				} else {
+					--top;
+				}
+				continue;
+			default:
+				break;
+			}
+
+			right = stack[top--];
+			uint32_t &left = stack[top];
+
+			switch (instruction.op) {
+			case Op::ADD:
+				left += right;
+				break;
+			case Op::SUBTRACT:
+				left -= right;
+				break;
+			case Op::MULTIPLY:
+				left *= right;
+				break;
+			case Op::DIVIDE:
+				// INT32_MIN / -1 wraps to INT32_MIN, which is 0 - left
+				if (right == 0) {
+					left = 0;
+				} else if (toSigned(right) == -1) {
+					left = 0u - left;
+				} else {
+					left = toSigned(left) / toSigned(right);
+				}
+				break;
+			case Op::MODULO:
+				left = right == 0 || toSigned(right) == -1 ? 0 : toSigned(left) % toSigned(right);
+				break;
+			case Op::SHIFT_LEFT:
+				left = right >= 32 ? 0 : left << right;
+				break;
+			case Op::SHIFT_RIGHT:
+				left = right >= 32 ? 0 : toSigned(left) >> right;
+				break;
+			case Op::BITWISE_AND:
+				left &= right;
+				break;
+			case Op::BITWISE_OR:
+				left |= right;
+				break;
+			case Op::BITWISE_XOR:
+				left ^= right;
+				break;
+			case Op::EQ:
+				left = left == right;
+				break;
+			case Op::NEQ:
+				left = left != right;
+				break;
+			case Op::LT:
+				left = toSigned(left) < toSigned(right);
+				break;
+			case Op::LTE:
+				left = toSigned(left) <= toSigned(right);
+				break;
+			case Op::GT:
+				left = toSigned(left) > toSigned(right);
+				break;
+			case Op::GTE:
+				left = toSigned(left) >= toSigned(right);
+				break;
+			default:
+				break;
+			}
+		}
+
+		return stack[0] != 0;
+	}
+
+	const string &Condition::getSource() const {
+		return source;
+	}
+
+	size_t Condition::size() const {
+		return program.size();
+	}
+}}
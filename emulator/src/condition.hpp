@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dcpu.hpp"
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * Condition
+	 *
+	 * A debugger condition written in the assembler's expression syntax, for
+	 * example [SP+2] == 0x8000 && A > B.  The expression is parsed once and
+	 * compiled into a postfix program whose register operands point straight
+	 * at the registers of one Dcpu, so evaluating it never touches the
+	 * expression tree.  Registers and memory read as unsigned 16-bit values
+	 * and arithmetic is done in 32 bits, as in the assembler.
+	 *
+	 *************************************************************************/
+	class Condition {
+	public:
+		enum class Op : uint8_t {
+			LITERAL, REGISTER, LOAD,
+			NEGATE, NOT, BITWISE_NOT,
+			ADD, SUBTRACT, MULTIPLY, DIVIDE, MODULO, SHIFT_LEFT, SHIFT_RIGHT,
+			BITWISE_AND, BITWISE_OR, BITWISE_XOR,
+			EQ, NEQ, LT, LTE, GT, GTE,
+			// short circuit && and ||; the operand stays on the stack when the jump is taken
+			JUMP_IF_FALSE, JUMP_IF_TRUE, TO_BOOL
+		};
+
+		struct Instruction {
+			Op op;
+			union {
+				int32_t value;
+				const uint16_t *reg;
+			};
+		};
+
+		enum { MAX_STACK = 32 };
+	private:
+		const DcpuMemory *memory;
+		std::string source;
+		std::vector<Instruction> program;
+
+		Condition(const DcpuMemory *memory, const std::string &source);
+	public:
+		/**
+		 * Throws invalid_argument with the parser's messages when the source is
+		 * not a valid condition.
+		 */
+		static Condition compile(const std::string &source, Dcpu &cpu);
+
+		bool evaluate() const;
+		const std::string &getSource() const;
+		size_t size() const;
+	};
+}}
@@ -0,0 +1,169 @@
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <chrono>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "console.hpp"
+
+using namespace std;
+
+namespace dcpu { namespace emulator {
+	ConsoleRing::ConsoleRing(size_t capacity) : buffer(max<size_t>(capacity, 1)), indexes() {
+
+	}
+
+	size_t ConsoleRing::write(const char *data, size_t length) {
+		uint64_t position = indexes.getHead();
+		length = min(length, getFree());
+
+		// in at most two pieces, around the end of the buffer
+		size_t start = position % buffer.size();
+		size_t first = min(length, buffer.size() - start);
+		memcpy(&buffer[start], data, first);
+		memcpy(&buffer[0], data + first, length - first);
+
+		indexes.publish(length);
+		return length;
+	}
+
+	size_t ConsoleRing::getFree() const {
+		return indexes.getFree(buffer.size());
+	}
+
+	size_t ConsoleRing::read(char *data, size_t length) {
+		uint64_t position = indexes.getTail();
+		length = min(length, getUsed());
+
+		size_t start = position % buffer.size();
+		size_t first = min(length, buffer.size() - start);
+		memcpy(data, &buffer[start], first);
+		memcpy(data + first, &buffer[0], length - first);
+
+		indexes.consume(length);
+		return length;
+	}
+
+	size_t ConsoleRing::getUsed() const {
+		return indexes.getUsed();
+	}
+
+	size_t ConsoleRing::getCapacity() const {
+		return buffer.size();
+	}
+
+	SerialConsole::SerialConsole(Dcpu &cpu, int outputFd, int inputFd, size_t capacity)
+			: HardwareDevice(cpu, MANUFACTURER_ID, HARDWARE_ID, VERSION), outputFd(outputFd), inputFd(inputFd),
+			outgoing(capacity), incoming(capacity), interruptMessage(0), signalled(false), words(0x10000),
+			characters(0x10000), stopping(false), thread() {
+
+		thread = std::thread(&SerialConsole::pump, this);
+	}
+
+	SerialConsole::~SerialConsole() {
+		finish();
+	}
+
+	void SerialConsole::finish() {
+		if (thread.joinable()) {
+			stopping.store(true, memory_order_release);
+			thread.join();
+		}
+	}
+
+	void SerialConsole::pump() {
+		vector<char> chunk(max(outgoing.getCapacity(), incoming.getCapacity()));
+		bool reading = inputFd >= 0;
+
+		while (!stopping.load(memory_order_acquire)) {
+			flush(chunk);
+
+			size_t room = incoming.getFree();
+			pollfd waiting = { inputFd, POLLIN, 0 };
+			if (!reading || !room) {
+				this_thread::sleep_for(chrono::milliseconds(FLUSH_INTERVAL_MS));
+			} else if (poll(&waiting, 1, FLUSH_INTERVAL_MS) > 0) {
+				ssize_t count = ::read(inputFd, chunk.data(), room);
+				if (count > 0) {
+					incoming.write(chunk.data(), count);
+				} else if (count == 0 || (errno != EINTR && errno != EAGAIN)) {
+					reading = false;
+				}
+			}
+		}
+
+		flush(chunk);
+	}
+
+	void SerialConsole::flush(vector<char> &chunk) {
+		size_t length;
+		while ((length = outgoing.read(chunk.data(), chunk.size())) > 0) {
+			size_t written = 0;
+			while (written < length) {
+				ssize_t count = ::write(outputFd, chunk.data() + written, length - written);
+				if (count > 0) {
+					written += count;
+				} else if (errno != EINTR) {
+					// nothing to report it to from here, so the output is lost
+					break;
+				}
+			}
+		}
+	}
+
+	void SerialConsole::tick() {
+		if (interruptMessage && !signalled && incoming.getUsed()) {
+			signalled = true;
+			cpu.interrupts.send(interruptMessage);
+		}
+	}
+
+	uint16_t SerialConsole::interrupt() {
+		switch (cpu.registers.a) {
+		case WRITE: {
+			uint16_t length = min<size_t>(cpu.registers.c, outgoing.getFree());
+			cpu.memory.readBlock(cpu.registers.b, words.data(), length);
+			for (uint16_t i = 0; i < length; i++) {
+				characters[i] = static_cast<char>(words[i]);
+			}
+
+			cpu.registers.c = outgoing.write(characters.data(), length);
+			return cpu.registers.c / CHARACTERS_PER_CYCLE;
+		}
+		case READ: {
+			uint16_t length = incoming.read(characters.data(), cpu.registers.c);
+			for (uint16_t i = 0; i < length; i++) {
+				words[i] = static_cast<uint8_t>(characters[i]);
+			}
+			cpu.memory.writeBlock(cpu.registers.b, words.data(), length);
+			if (!incoming.getUsed()) {
+				signalled = false;
+			}
+
+			cpu.registers.c = length;
+			return length / CHARACTERS_PER_CYCLE;
+		}
+		case SET_INTERRUPT:
+			interruptMessage = cpu.registers.b;
+			break;
+		case STATUS:
+			cpu.registers.b = min<size_t>(outgoing.getFree(), 0xffff);
+			cpu.registers.c = min<size_t>(incoming.getUsed(), 0xffff);
+			break;
+		}
+
+		return 0;
+	}
+
+	uint64_t SerialConsole::getNextEvent() {
+		// input may arrive, or output drain, at any cycle
+		return inputFd >= 0 || outgoing.getFree() < outgoing.getCapacity() ? ANY_CYCLE : NO_EVENT;
+	}
+
+	void SerialConsole::reset() {
+		interruptMessage = 0;
+		signalled = false;
+	}
+}}
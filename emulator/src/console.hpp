@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+#include "dcpu.hpp"
+#include "hardware.hpp"
+#include "ring.hpp"
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * ConsoleRing
+	 *
+	 * A fixed ring of characters with one writer and one reader, copied in
+	 * and out a block at a time.
+	 *
+	 *************************************************************************/
+	class ConsoleRing {
+		ConsoleRing(ConsoleRing const&) = delete;
+		ConsoleRing& operator =(ConsoleRing const&) = delete;
+
+		std::vector<char> buffer;
+		RingIndexes indexes;
+	public:
+		ConsoleRing(size_t capacity);
+
+		/**
+		 * Called by the writer only.  Returns the characters that fit,
+		 * which may be fewer than given.
+		 */
+		size_t write(const char *data, size_t length);
+		size_t getFree() const;
+
+		/**
+		 * Called by the reader only.  Returns the characters copied out.
+		 */
+		size_t read(char *data, size_t length);
+		size_t getUsed() const;
+
+		size_t getCapacity() const;
+	};
+
+	/*************************************************************************
+	 *
+	 * SerialConsole
+	 *
+	 * A character console whose host side never blocks the cpu.  Characters
+	 * the program writes go into a ring that a host thread writes out every
+	 * few milliseconds in as few calls as it can, and characters the host
+	 * thread reads from the input go into a second ring for the program to
+	 * read.  When the output ring is full a write takes what fits, so the
+	 * program sees the back-pressure rather than waiting for the host.
+	 *
+	 * When input arrives depends on the host, so runs with input do not
+	 * repeat exactly.
+	 *
+	 * Interrupts, with A holding the command:
+	 *   0 WRITE          writes the low byte of each of C words from B, and
+	 *                    sets C to the characters taken, fewer when the
+	 *                    output is full
+	 *   1 READ           copies at most C characters received to B, one a
+	 *                    word, and sets C to the characters copied
+	 *   2 SET_INTERRUPT  sends an interrupt with message B when input
+	 *                    arrives after a READ left none waiting.  0 turns it
+	 *                    off
+	 *   3 STATUS         sets B to the room left in the output and C to the
+	 *                    characters waiting to be read
+	 *
+	 * WRITE and READ take a cycle for every eight characters copied.
+	 *
+	 *************************************************************************/
+	class SerialConsole : public HardwareDevice {
+		enum { HARDWARE_ID = 0x5345524c, MANUFACTURER_ID = 0x44435055, VERSION = 1, CHARACTERS_PER_CYCLE = 8,
+			FLUSH_INTERVAL_MS = 10 };
+
+		int outputFd;
+		int inputFd;
+		ConsoleRing outgoing;
+		ConsoleRing incoming;
+		uint16_t interruptMessage;
+		// whether the input waiting has been signalled already
+		bool signalled;
+		std::vector<uint16_t> words;
+		std::vector<char> characters;
+
+		std::atomic<bool> stopping;
+		std::thread thread;
+
+		void pump();
+		void flush(std::vector<char> &chunk);
+	public:
+		enum Command { WRITE, READ, SET_INTERRUPT, STATUS };
+		enum : size_t { DEFAULT_CAPACITY = 65536 };
+
+		/**
+		 * Writes to and reads from the file descriptors, which stay open
+		 * and belong to the caller.  An input of -1 means no input.
+		 */
+		SerialConsole(Dcpu &cpu, int outputFd, int inputFd=-1, size_t capacity=DEFAULT_CAPACITY);
+		~SerialConsole();
+
+		virtual void tick();
+		virtual uint16_t interrupt();
+		virtual uint64_t getNextEvent();
+		virtual void reset();
+
+		/**
+		 * Stops the host thread once it has written out everything the
+		 * program wrote.  The destructor does it when this has not.
+		 */
+		void finish();
+	};
+}}
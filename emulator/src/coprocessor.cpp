@@ -0,0 +1,121 @@
+#include <cstring>
+
+#include "coprocessor.hpp"
+
+using namespace std;
+
+namespace dcpu { namespace emulator {
+	static const uint16_t ELEMENT_CYCLES[] = { 1, 1, 2, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4 };
+
+	static uint32_t getValue(const vector<uint16_t> &words, uint32_t index) {
+		return words[index * 2] | (static_cast<uint32_t>(words[index * 2 + 1]) << 16);
+	}
+
+	static void setValue(vector<uint16_t> &words, uint32_t index, uint32_t value) {
+		words[index * 2] = value & 0xffff;
+		words[index * 2 + 1] = value >> 16;
+	}
+
+	static float toFloat(uint32_t value) {
+		float result;
+		memcpy(&result, &value, sizeof(result));
+		return result;
+	}
+
+	static uint32_t fromFloat(float value) {
+		uint32_t result;
+		memcpy(&result, &value, sizeof(result));
+		return result;
+	}
+
+	static uint32_t apply(uint16_t operation, uint32_t a, uint32_t b) {
+		int32_t signedA = static_cast<int32_t>(a);
+		int32_t signedB = static_cast<int32_t>(b);
+
+		switch (operation) {
+		case MathCoprocessor::ADD:
+			return a + b;
+		case MathCoprocessor::SUB:
+			return a - b;
+		case MathCoprocessor::MUL:
+			return a * b;
+		case MathCoprocessor::DIV:
+			return b ? a / b : 0;
+		case MathCoprocessor::DVI:
+			// INT32_MIN / -1 overflows on the host
+			return b && !(signedA == INT32_MIN && signedB == -1) ? static_cast<uint32_t>(signedA / signedB) : 0;
+		case MathCoprocessor::MOD:
+			return b ? a % b : 0;
+		case MathCoprocessor::MULX:
+			return static_cast<uint32_t>((static_cast<int64_t>(signedA) * signedB) >> 16);
+		case MathCoprocessor::DIVX:
+			return b ? static_cast<uint32_t>(static_cast<int64_t>(signedA) * 0x10000 / signedB) : 0;
+		case MathCoprocessor::FADD:
+			return fromFloat(toFloat(a) + toFloat(b));
+		case MathCoprocessor::FSUB:
+			return fromFloat(toFloat(a) - toFloat(b));
+		case MathCoprocessor::FMUL:
+			return fromFloat(toFloat(a) * toFloat(b));
+		case MathCoprocessor::FDIV:
+			return fromFloat(toFloat(a) / toFloat(b));
+		}
+
+		return 0;
+	}
+
+	MathCoprocessor::MathCoprocessor(Dcpu &cpu) : HardwareDevice(cpu, MANUFACTURER_ID, HARDWARE_ID, VERSION),
+			first(), second(), results() {
+
+	}
+
+	void MathCoprocessor::tick() {
+
+	}
+
+	uint16_t MathCoprocessor::interrupt() {
+		if (cpu.registers.a != 0) {
+			return 0;
+		}
+
+		uint16_t descriptor[5];
+		cpu.memory.readBlock(cpu.registers.b, descriptor, 5);
+		uint16_t operation = descriptor[0];
+		uint32_t count = descriptor[1];
+
+		if (operation > FDIV || count > MAX_ELEMENTS) {
+			cpu.registers.a = 1;
+			return 0;
+		}
+
+		first.resize(count * 2);
+		second.resize(count * 2);
+		cpu.memory.readBlock(descriptor[2], first.data(), count * 2);
+		cpu.memory.readBlock(descriptor[3], second.data(), count * 2);
+
+		if (operation == DOTX) {
+			// each product fits, but their sum can pass 64 bits, so it wraps unsigned; the bits kept come out the
+			// same as from the exact sum
+			uint64_t sum = 0;
+			for (uint32_t i = 0; i < count; i++) {
+				sum += static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(getValue(first, i)))
+						* static_cast<int32_t>(getValue(second, i)));
+			}
+
+			results.resize(2);
+			setValue(results, 0, static_cast<uint32_t>(sum >> 16));
+		} else {
+			results.resize(count * 2);
+			for (uint32_t i = 0; i < count; i++) {
+				setValue(results, i, apply(operation, getValue(first, i), getValue(second, i)));
+			}
+		}
+
+		cpu.memory.writeBlock(descriptor[4], results.data(), results.size());
+		cpu.registers.a = 0;
+		return SETUP_CYCLES + count * ELEMENT_CYCLES[operation];
+	}
+
+	uint64_t MathCoprocessor::getNextEvent() {
+		return NO_EVENT;
+	}
+}}
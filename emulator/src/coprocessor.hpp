@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "dcpu.hpp"
+#include "hardware.hpp"
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * MathCoprocessor
+	 *
+	 * Runs an operation over vectors of 32 bit values in memory, each stored
+	 * as two words with the low word first.  An HWI with A set to 0 runs the
+	 * operation described by the five words at B:
+	 *
+	 *   B+0  the operation
+	 *   B+1  the number of elements
+	 *   B+2  the address of the first operands
+	 *   B+3  the address of the second operands
+	 *   B+4  the address the results go to
+	 *
+	 * Every operand is read before any result is written, so the results
+	 * may overwrite the operands.  Integer operations wrap, division by zero
+	 * gives 0 as DIV does, and fixed point values are signed 16.16.  DOTX
+	 * wraps too: its result is the exact sum of the products, taken modulo
+	 * 2^32 as a 16.16 value.
+	 *
+	 * Operations, with the cycles each element takes:
+	 *    0 ADD    a + b           1      6 MULX   a * b, fixed    2
+	 *    1 SUB    a - b           1      7 DIVX   a / b, fixed    4
+	 *    2 MUL    a * b           2      8 DOTX   sum of a * b    2
+	 *    3 DIV    a / b           4               as one fixed
+	 *    4 DVI    a / b, signed   4               point result
+	 *    5 MOD    a % b           4      9-12 FADD, FSUB, FMUL, FDIV
+	 *                                             on IEEE floats  4
+	 *
+	 * The HWI takes 2 cycles more than that on top of its own, and sets A to
+	 * 0.  An unknown operation or more than 8192 elements sets A to 1 and
+	 * takes no time.
+	 *
+	 *************************************************************************/
+	class MathCoprocessor : public HardwareDevice {
+		enum { HARDWARE_ID = 0x4d415448, MANUFACTURER_ID = 0x44435055, VERSION = 1, SETUP_CYCLES = 2,
+			MAX_ELEMENTS = 8192 };
+
+		std::vector<uint16_t> first;
+		std::vector<uint16_t> second;
+		std::vector<uint16_t> results;
+	public:
+		enum Operation { ADD, SUB, MUL, DIV, DVI, MOD, MULX, DIVX, DOTX, FADD, FSUB, FMUL, FDIV };
+
+		MathCoprocessor(Dcpu &cpu);
+
+		virtual void tick();
+		virtual uint16_t interrupt();
+		virtual uint64_t getNextEvent();
+	};
+}}
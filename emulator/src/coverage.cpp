@@ -0,0 +1,77 @@
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <stdexcept>
+#include <boost/format.hpp>
+
+#include "coverage.hpp"
+
+using namespace std;
+using boost::format;
+using boost::str;
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * ExecutionCoverage
+	 *
+	 *************************************************************************/
+
+	const char ExecutionCoverage::MAGIC[8] = { 'D', 'C', 'P', 'U', 'C', 'O', 'V', '\0' };
+
+	ExecutionCoverage::ExecutionCoverage() {
+		memset(bits, 0, sizeof(bits));
+	}
+
+	size_t ExecutionCoverage::count() const {
+		size_t total = 0;
+		for (auto byte : bits) {
+			total += __builtin_popcount(byte);
+		}
+
+		return total;
+	}
+
+	void ExecutionCoverage::load(const string &filename) {
+		ifstream in(filename, ios_base::in | ios_base::binary);
+		if (!in) {
+			throw runtime_error(str(format("Failed to open the file %s: %s") % filename % strerror(errno)));
+		}
+
+		char magic[sizeof(MAGIC)];
+		uint8_t version[4];
+		uint8_t loaded[sizeof(bits)];
+		in.read(magic, sizeof(magic));
+		in.read(reinterpret_cast<char*>(version), sizeof(version));
+		in.read(reinterpret_cast<char*>(loaded), sizeof(loaded));
+
+		if (!in || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+			throw runtime_error(str(format("%s is not a coverage file") % filename));
+		}
+
+		uint32_t fileVersion = version[0] | version[1] << 8 | version[2] << 16 | version[3] << 24;
+		if (fileVersion != VERSION) {
+			throw runtime_error(str(format("%s has unsupported coverage version %d") % filename % fileVersion));
+		}
+
+		for (size_t i = 0; i < sizeof(bits); i++) {
+			bits[i] |= loaded[i];
+		}
+	}
+
+	void ExecutionCoverage::save(const string &filename) const {
+		ofstream out(filename, ios_base::out | ios_base::binary | ios_base::trunc);
+		if (!out) {
+			throw runtime_error(str(format("Failed to open file %s for write: %s") % filename % strerror(errno)));
+		}
+
+		uint8_t version[4] = { VERSION & 0xff, (VERSION >> 8) & 0xff, (VERSION >> 16) & 0xff, VERSION >> 24 };
+		out.write(MAGIC, sizeof(MAGIC));
+		out.write(reinterpret_cast<const char*>(version), sizeof(version));
+		out.write(reinterpret_cast<const char*>(bits), sizeof(bits));
+
+		if (!out.flush()) {
+			throw runtime_error(str(format("Failed to write to %s: %s") % filename % strerror(errno)));
+		}
+	}
+}}
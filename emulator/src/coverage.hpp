@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * ExecutionCoverage
+	 *
+	 * One bit per memory word, set when an instruction starts at the word,
+	 * whether it ran or was skipped.  The file holds an 8 byte magic, a 32-bit
+	 * little endian version and the bitmap, where bit n % 8 of byte n / 8
+	 * stands for word n.  Nothing here depends on the rest of the emulator, so
+	 * that the disassembler can read coverage files.
+	 *
+	 *************************************************************************/
+	class ExecutionCoverage {
+	public:
+		enum { VERSION = 1, TOTAL_WORDS = 65536 };
+
+		static const char MAGIC[8];
+	private:
+		uint8_t bits[TOTAL_WORDS / 8];
+	public:
+		ExecutionCoverage();
+
+		void mark(uint16_t address) {
+			bits[address >> 3] |= 1 << (address & 7);
+		}
+
+		bool isMarked(uint16_t address) const {
+			return bits[address >> 3] & (1 << (address & 7));
+		}
+
+		/**
+		 * The number of words marked.
+		 */
+		size_t count() const;
+
+		/**
+		 * Adds the words marked in another coverage file, so that several
+		 * runs can be merged.
+		 */
+		void load(const std::string &filename);
+		void save(const std::string &filename) const;
+	};
+}}
@@ -2,11 +2,19 @@
 #include <stdexcept>
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
 #include <boost/format.hpp>
 
 #include "dcpu.hpp"
 #include "hardware.hpp"
 #include "opcodes.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "timeline.hpp"
+#include "replay.hpp"
+#include "coverage.hpp"
+#include "host_profile.hpp"
+#include "idle.hpp"
 
 using namespace std;
 using boost::format;
@@ -20,16 +28,17 @@ namespace dcpu { namespace emulator {
      *************************************************************************/
 
 	Dcpu::Dcpu() : skipNext(false), onFire(false), cycles(0), stack(*this), registers(*this),
-			interrupts(*this), hardwareManager(*this) {
-		memset(memory, 0, TOTAL_MEMORY * sizeof(uint16_t));
+			interrupts(*this), hardwareManager(*this), profiler(nullptr),
+			tracer(nullptr), timeline(nullptr), coverage(nullptr), hostProfiler(nullptr),
+			idle(nullptr) {
 	}
 
-	uint16_t Dcpu::getCycles() {
+	uint64_t Dcpu::getCycles() {
 		return cycles;
 	}
 
 	uint16_t Dcpu::getNextWord() {
-		return memory[registers.pc++];
+		return memory.fetch(registers.pc++);
 	}
 
 	bool Dcpu::isSkipNext() {
@@ -49,51 +58,79 @@ namespace dcpu { namespace emulator {
 	}
 
 	void Dcpu::tick() {
-		auto instruction = Opcode::parse(*this, getNextWord());
+		if (tracer) {
+			tracer->beginInstruction();
+		}
+
+		if (coverage) {
+			coverage->mark(registers.pc);
+		}
 
-		if (skipNext) {
+		uint64_t hostStart = hostProfiler ? HostProfiler::now() : 0;
+		uint16_t address = registers.pc;
+		bool skipped = skipNext;
+		uint16_t word = getNextWord();
+		auto instruction = Opcode::parse(*this, word);
+
+		if (skipped) {
 			if (!instruction->isConditional()) {
 				skipNext = false;
 			}
 
 			cycles += 1;
+			stats.instructionSkipped();
 		} else {
+			interrupts.executing = true;
 			cycles += instruction->execute();
+			interrupts.instructionExecuted();
+			stats.instructionRetired(word);
+		}
+		stats.setCycles(cycles);
+
+		if (hostProfiler) {
+			hostProfiler->instructionExecuted(word, skipped, hostStart);
+		}
+
+		if (idle) {
+			idle->instructionExecuted(address, word, skipped);
+		}
+
+		if (tracer) {
+			tracer->endInstruction();
+		}
+
+		if (timeline) {
+			timeline->instructionExecuted();
 		}
 	}
 
 	void Dcpu::clear() {
 		cycles = 0;
+		stats.reset();
 		onFire = false;
 		skipNext = false;
 		registers.clear();
-		memset(memory, 0, TOTAL_MEMORY * sizeof(uint16_t));
+		memory.clear();
 	}
 
-	void Dcpu::load(const char *filename) {
-	    clear();
-
-	    ifstream file(filename);
-	    if (!file) {
-	        throw runtime_error(str(format("Failed to open the file %s: %s") % filename % strerror(errno)));
-	    }
-
-	    size_t index = 0;
-	    while (file && index <= TOTAL_MEMORY) {
-	        uint8_t b1 = file.get();
-	        if (file.eof()) {
-	        	break;
-	        }
+	void Dcpu::reset() {
+		cycles = 0;
+		stats.reset();
+		onFire = false;
+		skipNext = false;
+		registers.clear();
+		interrupts.clear();
+		memory.restore();
+		hardwareManager.resetDevices();
+	}
 
-	        uint8_t b2 = file.get();
-	        if (!file.good()) {
-	            throw runtime_error(str(format("Failed to read the next word from the file %s: %s") % filename 
-	                	% strerror(errno)));
-	        }
+	void Dcpu::load(const char *filename) {
+		load(MemoryImage::load(filename));
+	}
 
-	        memory[index++] = (b1 << 8) | b2;
-	    }
-	    file.close();
+	void Dcpu::load(shared_ptr<const MemoryImage> image) {
+		clear();
+		memory.map(image);
 	}
 
 	void Dcpu::dump(ostream& out) const {
@@ -140,6 +177,278 @@ namespace dcpu { namespace emulator {
 
 	/*************************************************************************
      *
+     * MemoryImage
+     *
+     *************************************************************************/
+
+	MemoryImage::MemoryImage(const uint16_t *words, size_t count) {
+		count = min<size_t>(count, TOTAL_WORDS);
+		if (count) {
+			memcpy(this->words, words, count * sizeof(uint16_t));
+		}
+		memset(this->words + count, 0, (TOTAL_WORDS - count) * sizeof(uint16_t));
+	}
+
+	shared_ptr<const MemoryImage> MemoryImage::load(const string &filename) {
+		ifstream file(filename);
+		if (!file) {
+			throw runtime_error(str(format("Failed to open the file %s: %s") % filename % strerror(errno)));
+		}
+
+		vector<uint16_t> words;
+		while (file && words.size() < TOTAL_WORDS) {
+			uint8_t b1 = file.get();
+			if (file.eof()) {
+				break;
+			}
+
+			uint8_t b2 = file.get();
+			if (!file.good()) {
+				throw runtime_error(str(format("Failed to read the next word from the file %s: %s") % filename
+						% strerror(errno)));
+			}
+
+			words.push_back((b1 << 8) | b2);
+		}
+
+		return make_shared<MemoryImage>(words.data(), words.size());
+	}
+
+	shared_ptr<const MemoryImage> MemoryImage::empty() {
+		static shared_ptr<const MemoryImage> zeros = make_shared<MemoryImage>();
+		return zeros;
+	}
+
+	/*************************************************************************
+     *
+     * DcpuMemory
+     *
+     *************************************************************************/
+
+	DcpuMemory::DcpuMemory() : privatePages(), image(), writeCount(0), lastWriteAddress(0), journal(nullptr),
+			devices(), mappedPageCount(0), watcher(nullptr) {
+#ifdef DCPU_MEMORY_STATS
+		stats = nullptr;
+#endif
+		memset(pageFlags, 0, sizeof(pageFlags));
+		clear();
+	}
+
+	// page flags survive clear() so that watchpoints stay set when a new program is loaded
+	void DcpuMemory::clear() {
+		map(MemoryImage::empty());
+	}
+
+	void DcpuMemory::map(shared_ptr<const MemoryImage> image) {
+		// writes never reach a page while it is flagged shared
+		uint16_t *words = const_cast<uint16_t*>(image->getWords());
+		for (uint32_t page = 0; page < TOTAL_PAGES; page++) {
+			pages[page] = words + (page << PAGE_SHIFT);
+			privatePages[page].reset();
+			pageFlags[page] |= PAGE_SHARED;
+		}
+
+		this->image = move(image);
+	}
+
+	void DcpuMemory::attach(uint16_t *words) {
+		for (uint32_t page = 0; page < TOTAL_PAGES; page++) {
+			pages[page] = words + (page << PAGE_SHIFT);
+			privatePages[page].reset();
+			pageFlags[page] &= ~PAGE_SHARED;
+		}
+
+		image.reset();
+	}
+
+	void DcpuMemory::restore() {
+		if (!image) {
+			return;
+		}
+
+		const uint16_t *words = image->getWords();
+		for (uint32_t page = 0; page < TOTAL_PAGES; page++) {
+			if (!(pageFlags[page] & PAGE_SHARED)) {
+				pages[page] = const_cast<uint16_t*>(words + (page << PAGE_SHIFT));
+				pageFlags[page] |= PAGE_SHARED;
+			}
+		}
+	}
+
+	void DcpuMemory::unshare(uint16_t page) {
+		if (!privatePages[page]) {
+			privatePages[page].reset(new uint16_t[PAGE_SIZE]);
+		}
+		memcpy(privatePages[page].get(), pages[page], PAGE_SIZE * sizeof(uint16_t));
+		pages[page] = privatePages[page].get();
+		pageFlags[page] &= ~PAGE_SHARED;
+	}
+
+	uint32_t DcpuMemory::getPrivatePageCount() const {
+		uint32_t count = 0;
+		for (auto flags : pageFlags) {
+			count += !(flags & PAGE_SHARED);
+		}
+
+		return count;
+	}
+
+	void DcpuMemory::flaggedWrite(uint16_t address, uint16_t value) {
+		uint16_t page = address >> PAGE_SHIFT;
+		uint8_t &flags = pageFlags[page];
+		if (flags & PAGE_SHARED) {
+			unshare(page);
+		}
+		flags &= ~PAGE_CLEAN;
+
+		if ((flags & PAGE_JOURNALED) && journal) {
+			journal->push_back(make_pair(address, value));
+		}
+
+		if ((flags & PAGE_WATCHED) && watcher) {
+			watcher->watchedWrite(address, peek(address), value);
+		}
+
+		if (flags & PAGE_MAPPED) {
+			devices[page]->mappedWrite(address, peek(address), value);
+		}
+	}
+
+	uint16_t DcpuMemory::mappedRead(uint16_t address) {
+		return devices[address >> PAGE_SHIFT]->mappedRead(address, peek(address));
+	}
+
+	void DcpuMemory::mapDevice(uint16_t page, uint32_t count, MemoryMappedDevice *device) {
+		if (!devices) {
+			devices.reset(new MemoryMappedDevice*[TOTAL_PAGES]());
+		}
+
+		for (uint32_t i = page; i < min<uint32_t>(page + count, TOTAL_PAGES); i++) {
+			mappedPageCount += !devices[i];
+			devices[i] = device;
+			pageFlags[i] |= PAGE_MAPPED;
+		}
+	}
+
+	void DcpuMemory::unmapDevice(uint16_t page, uint32_t count) {
+		if (!devices) {
+			return;
+		}
+
+		for (uint32_t i = page; i < min<uint32_t>(page + count, TOTAL_PAGES); i++) {
+			mappedPageCount -= devices[i] != nullptr;
+			devices[i] = nullptr;
+			pageFlags[i] &= ~PAGE_MAPPED;
+		}
+
+		// back to reads that test nothing but the table
+		if (!mappedPageCount) {
+			devices.reset();
+		}
+	}
+
+	void DcpuMemory::markClean() {
+		for (auto &flags : pageFlags) {
+			flags |= PAGE_CLEAN;
+		}
+	}
+
+	void DcpuMemory::setJournal(Journal *journal) {
+		this->journal = journal;
+
+		for (auto &flags : pageFlags) {
+			if (journal) {
+				flags |= PAGE_JOURNALED;
+			} else {
+				flags &= ~PAGE_JOURNALED;
+			}
+		}
+	}
+
+	void DcpuMemory::setPageFlags(uint16_t page, uint8_t flags) {
+		pageFlags[page] |= flags & ~HIDDEN_FLAGS;
+	}
+
+	void DcpuMemory::clearPageFlags(uint16_t page, uint8_t flags) {
+		pageFlags[page] &= ~(flags & ~HIDDEN_FLAGS);
+	}
+
+	void DcpuMemory::readBlock(uint16_t address, uint16_t *words, uint32_t count) {
+		while (count) {
+			uint16_t offset = address & (PAGE_SIZE - 1);
+			uint32_t chunk = min<uint32_t>(count, PAGE_SIZE - offset);
+			bool tracked = getMappedDevice(address >> PAGE_SHIFT) != nullptr;
+#ifdef DCPU_MEMORY_STATS
+			tracked |= stats != nullptr;
+#endif
+
+			if (tracked) {
+				for (uint32_t i = 0; i < chunk; i++) {
+					words[i] = read(address + i);
+				}
+			} else {
+				memcpy(words, pages[address >> PAGE_SHIFT] + offset, chunk * sizeof(uint16_t));
+			}
+
+			address += chunk;
+			words += chunk;
+			count -= chunk;
+		}
+	}
+
+	void DcpuMemory::writeBlock(uint16_t address, const uint16_t *words, uint32_t count) {
+		while (count) {
+			uint16_t page = address >> PAGE_SHIFT;
+			uint16_t offset = address & (PAGE_SIZE - 1);
+			uint32_t chunk = min<uint32_t>(count, PAGE_SIZE - offset);
+			bool tracked = pageFlags[page];
+#ifdef DCPU_MEMORY_STATS
+			tracked |= stats != nullptr;
+#endif
+
+			if (tracked) {
+				for (uint32_t i = 0; i < chunk; i++) {
+					write(address + i, words[i]);
+				}
+			} else {
+				memcpy(pages[page] + offset, words, chunk * sizeof(uint16_t));
+				writeCount += chunk;
+				lastWriteAddress = address + chunk - 1;
+			}
+
+			address += chunk;
+			words += chunk;
+			count -= chunk;
+		}
+	}
+
+	void DcpuMemory::fillBlock(uint16_t address, uint16_t value, uint32_t count) {
+		while (count) {
+			uint16_t page = address >> PAGE_SHIFT;
+			uint16_t offset = address & (PAGE_SIZE - 1);
+			uint32_t chunk = min<uint32_t>(count, PAGE_SIZE - offset);
+			bool tracked = pageFlags[page];
+#ifdef DCPU_MEMORY_STATS
+			tracked |= stats != nullptr;
+#endif
+
+			if (tracked) {
+				for (uint32_t i = 0; i < chunk; i++) {
+					write(address + i, value);
+				}
+			} else {
+				fill_n(pages[page] + offset, chunk, value);
+				writeCount += chunk;
+				lastWriteAddress = address + chunk - 1;
+			}
+
+			address += chunk;
+			count -= chunk;
+		}
+	}
+
+	/*************************************************************************
+     *
      * DcpuRegisters
      *
      *************************************************************************/
@@ -152,8 +461,8 @@ namespace dcpu { namespace emulator {
 		a = b = c = x = y = z = i = j = sp = pc = ex = ia = 0;
 	}
 
-	uint16_t &DcpuRegisters::indirect(registers reg, uint16_t offset) {
-		return cpu.memory[get(reg) + offset];
+	uint16_t DcpuRegisters::indirectAddress(registers reg, uint16_t offset) {
+		return get(reg) + offset;
 	}
 
 	uint16_t &DcpuRegisters::operator[] (registers reg) {
@@ -200,23 +509,35 @@ namespace dcpu { namespace emulator {
 	}
 
 	void DcpuStack::push(uint16_t value) {
-		cpu.memory[--cpu.registers.sp] = value;
+		cpu.memory.write(pushAddress(), value);
+	}
+
+	uint16_t DcpuStack::pop() {
+		return cpu.memory.read(popAddress());
 	}
 
-	uint16_t &DcpuStack::push() {
-		return cpu.memory[--cpu.registers.sp];
+	uint16_t DcpuStack::peek() {
+		return cpu.memory.read(peekAddress());
 	}
 
-	uint16_t &DcpuStack::pop() {
-		return cpu.memory[cpu.registers.sp++];
+	uint16_t DcpuStack::pick(uint16_t offset) {
+		return cpu.memory.read(pickAddress(offset));
 	}
 
-	uint16_t &DcpuStack::peek() {
-		return cpu.memory[cpu.registers.sp];
+	uint16_t DcpuStack::pushAddress() {
+		return --cpu.registers.sp;
 	}
 
-	uint16_t &DcpuStack::pick(uint16_t offset) {
-		return cpu.memory[cpu.registers.sp + offset];
+	uint16_t DcpuStack::popAddress() {
+		return cpu.registers.sp++;
+	}
+
+	uint16_t DcpuStack::peekAddress() {
+		return cpu.registers.sp;
+	}
+
+	uint16_t DcpuStack::pickAddress(uint16_t offset) {
+		return cpu.registers.sp + offset;
 	}
 
 	/*************************************************************************
@@ -225,22 +546,54 @@ namespace dcpu { namespace emulator {
      *
      *************************************************************************/
 
-	DcpuInterrupts::DcpuInterrupts(Dcpu &cpu) : cpu(cpu), queueEnabled(false), queue() {
+	DcpuInterrupts::DcpuInterrupts(Dcpu &cpu) : cpu(cpu), queueEnabled(false), queue(), executing(false),
+			enteredHandlers() {
 
 	}
 
 	void DcpuInterrupts::trigger(uint16_t message) {
 		// TODO: use mutex
 		if (cpu.registers.ia == 0) {
+			cpu.stats.interruptDropped();
 			return;
 		}
 
+		cpu.stats.interruptDelivered();
 		enableQueue();
 		cpu.stack.push(cpu.registers.pc);
 		cpu.stack.push(cpu.registers.a);
 
 		cpu.registers.pc = cpu.registers.ia;
 		cpu.registers.a = message;
+
+		if (!cpu.profiler) {
+			return;
+		}
+
+		if (executing) {
+			enteredHandlers.push_back(cpu.registers.ia);
+		} else {
+			cpu.profiler->enterInterrupt(cpu.registers.ia, cpu.getCycles());
+		}
+	}
+
+	void DcpuInterrupts::instructionExecuted() {
+		executing = false;
+		if (enteredHandlers.empty()) {
+			return;
+		}
+
+		if (cpu.profiler) {
+			for (uint16_t handler : enteredHandlers) {
+				cpu.profiler->enterInterrupt(handler, cpu.getCycles());
+			}
+		}
+		enteredHandlers.clear();
+	}
+
+	void DcpuInterrupts::clear() {
+		queueEnabled = false;
+		queue = std::queue<uint16_t>();
 	}
 
 	void DcpuInterrupts::disableQueue() {
@@ -256,16 +609,27 @@ namespace dcpu { namespace emulator {
 	}
 
 	void DcpuInterrupts::send(uint16_t message) {
+		if (cpu.timeline) {
+			cpu.timeline->interruptSent(message);
+		}
+
+		if (cpu.hardwareManager.input) {
+			cpu.hardwareManager.input->interruptSent(message);
+		}
+
 		if (cpu.registers.ia == 0) {
+			cpu.stats.interruptDropped();
 			return;
 		}
 
 		if (queueEnabled) {
 			if (queue.size() >= QUEUE_MAX_SIZE) {
+				cpu.stats.interruptDropped();
 				cpu.catchFire();
 				return;
 			}
 
+			cpu.stats.interruptQueued();
 			queue.push(message);
 		} else {
 			trigger(message);
@@ -289,7 +653,7 @@ namespace dcpu { namespace emulator {
      *
      *************************************************************************/
 
-	DcpuHardwareManager::DcpuHardwareManager(Dcpu &cpu) : cpu(cpu), hardware() {
+	DcpuHardwareManager::DcpuHardwareManager(Dcpu &cpu) : cpu(cpu), hardware(), input(nullptr) {
 
 	}
 
@@ -312,6 +676,14 @@ namespace dcpu { namespace emulator {
 	}
 	
 	uint16_t DcpuHardwareManager::interrupt(uint16_t index) {
+		if (input) {
+			return input->hardwareInterrupt(index);
+		}
+
+		return interruptDevice(index);
+	}
+
+	uint16_t DcpuHardwareManager::interruptDevice(uint16_t index) {
 		if (index >= hardware.size()) {
 			return 0;
 		}
@@ -330,6 +702,34 @@ namespace dcpu { namespace emulator {
 
     
 	void DcpuHardwareManager::tickAll() {
+		if (input) {
+			input->tickHardware();
+			return;
+		}
+
+		tickDevices();
+	}
+
+	uint64_t DcpuHardwareManager::getNextEvent() {
+		if (input) {
+			return HardwareDevice::ANY_CYCLE;
+		}
+
+		uint64_t next = HardwareDevice::NO_EVENT;
+		for (auto &device : hardware) {
+			next = min(next, device->getNextEvent());
+		}
+
+		return next;
+	}
+
+	void DcpuHardwareManager::resetDevices() {
+		for (auto &device : hardware) {
+			device->reset();
+		}
+	}
+
+	void DcpuHardwareManager::tickDevices() {
 		for(auto &device : hardware) {
 			device->tick();
 		}
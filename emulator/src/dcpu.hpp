@@ -8,6 +8,9 @@
 #include <stdexcept>
 #include <atomic>
 
+#include "memory.hpp"
+#include "stats.hpp"
+
 namespace dcpu { namespace emulator {
 	enum class registers : uint8_t {
 		A, B, C, X, Y, Z, I, J, SP, PC, EX, IA
@@ -15,6 +18,13 @@ namespace dcpu { namespace emulator {
 
 	class Dcpu;
 	class HardwareDevice;
+	class CallProfiler;
+	class InstructionTracer;
+	class Timeline;
+	class ExternalInput;
+	class ExecutionCoverage;
+	class HostProfiler;
+	class IdleDetector;
 
 	class DcpuStack {
 		Dcpu &cpu;
@@ -22,10 +32,14 @@ namespace dcpu { namespace emulator {
 		DcpuStack(Dcpu &cpu);
 
 		void push(uint16_t value);
-		uint16_t &push();
-		uint16_t &pop();
-		uint16_t &peek();
-		uint16_t &pick(uint16_t offset);
+		uint16_t pop();
+		uint16_t peek();
+		uint16_t pick(uint16_t offset);
+
+		uint16_t pushAddress();
+		uint16_t popAddress();
+		uint16_t peekAddress();
+		uint16_t pickAddress(uint16_t offset);
 	};
 
 	class DcpuRegisters {
@@ -37,24 +51,41 @@ namespace dcpu { namespace emulator {
 		DcpuRegisters(Dcpu &cpu);
 
 		uint16_t &operator[] (registers reg);
-		uint16_t &indirect(registers reg, uint16_t offset=0);
+		uint16_t indirectAddress(registers reg, uint16_t offset=0);
 		void clear();
 	};
 
 	class DcpuInterrupts {
+		friend class Dcpu;
+		friend class Timeline;
+		friend class InputRecorder;
+		friend class InputReplayer;
+		friend class IdleDetector;
+		friend class StateSegment;
+
 		enum { QUEUE_MAX_SIZE = 256 };
 
 		Dcpu &cpu;
 		bool queueEnabled;
 		std::queue<uint16_t> queue;
 
+		// the profiler hears of handlers entered during an instruction once its cycles are counted
+		bool executing;
+		std::vector<uint16_t> enteredHandlers;
+
 		void trigger(uint16_t message);
+		void instructionExecuted();
 	public:
 		DcpuInterrupts(Dcpu &cpu);
 
 		void disableQueue();
 		void enableQueue();
 
+		/**
+		 * Drops queued interrupts and disables the queue.
+		 */
+		void clear();
+
 		bool isQueueEnabled();
 
 		void send(uint16_t message);
@@ -71,6 +102,9 @@ namespace dcpu { namespace emulator {
 		Dcpu &cpu;
 		std::vector<std::shared_ptr<HardwareDevice>> hardware;
 	public:
+		// when set, device input goes through it so that it can be recorded or replayed
+		ExternalInput *input;
+
 		DcpuHardwareManager(Dcpu &cpu);
 
 		uint16_t getCount();
@@ -78,10 +112,32 @@ namespace dcpu { namespace emulator {
 		uint16_t interrupt(uint16_t index);
         void tickAll();
 
+		/**
+		 * Call the devices directly, bypassing input.
+		 */
+		uint16_t interruptDevice(uint16_t index);
+		void tickDevices();
+
 		void registerDevice(std::shared_ptr<HardwareDevice> device);
+
+		/**
+		 * Returns every device to its power on state, through
+		 * HardwareDevice::reset.
+		 */
+		void resetDevices();
+
+		/**
+		 * The earliest next event of the devices, as HardwareDevice gives
+		 * them.  ANY_CYCLE while device input is recorded or replayed.
+		 */
+		uint64_t getNextEvent();
 	};
 
 	class Dcpu {
+		friend class Timeline;
+		friend class IdleDetector;
+		friend class StateSegment;
+
 		bool skipNext;
 		bool onFire;
 		uint64_t cycles;
@@ -90,15 +146,22 @@ namespace dcpu { namespace emulator {
 	public:
 		enum { TOTAL_MEMORY=65536, FREQUENCY=100000 };
 
-		uint16_t memory[TOTAL_MEMORY];
+		DcpuMemory memory;
 		DcpuStack stack;
 		DcpuRegisters registers;
 		DcpuInterrupts interrupts;
 		DcpuHardwareManager hardwareManager;
+		ExecutionStats stats;
+		CallProfiler *profiler;
+		InstructionTracer *tracer;
+		Timeline *timeline;
+		ExecutionCoverage *coverage;
+		HostProfiler *hostProfiler;
+		IdleDetector *idle;
 
 		Dcpu();
 
-		uint16_t getCycles();
+		uint64_t getCycles();
 		uint16_t getNextWord();
 		bool isOnFire();
 		bool isSkipNext();
@@ -108,6 +171,19 @@ namespace dcpu { namespace emulator {
 
 		void tick();
 		void load(const char *filename);
+
+		/**
+		 * Clears the cpu and maps the image, whose pages are shared until
+		 * written.  Loading the same image again resets an instance cheaply.
+		 */
+		void load(std::shared_ptr<const MemoryImage> image);
+
+		/**
+		 * Returns to the state just after the image was loaded: registers,
+		 * cycles, stats, interrupts, the pages written and the devices.  The
+		 * hooks are left as they are.
+		 */
+		void reset();
 		void dump(std::ostream& out) const;
 		void clear();
 	};
@@ -0,0 +1,134 @@
+#include <iostream>
+#include <string>
+#include <ctime>
+#include <stdexcept>
+
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+
+#include "dcpu.hpp"
+#include "shared_state.hpp"
+
+using namespace std;
+using namespace dcpu::emulator;
+
+namespace po = boost::program_options;
+
+const char *status_name(uint32_t status) {
+	switch (status) {
+	case MachineState::EMPTY:
+		return "empty";
+	case MachineState::RUNNING:
+		return "running";
+	case MachineState::STOPPED:
+		return "stopped";
+	case MachineState::ON_FIRE:
+		return "on fire";
+	default:
+		return "unknown";
+	}
+}
+
+double heartbeat_age(uint64_t heartbeat) {
+	timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return (static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec - heartbeat) / 1e9;
+}
+
+void print_text(ostream &out, const StateSegment::Snapshot &snapshot) {
+	bool alive = StateSegment::isAlive(snapshot.pid);
+	out << boost::format("status:    %s") % status_name(snapshot.status);
+	if (snapshot.status == MachineState::RUNNING && !alive) {
+		out << " (worker is gone)";
+	}
+	out << "\n";
+	out << boost::format("pid:       %d%s\n") % snapshot.pid % (alive ? "" : " (not running)");
+	out << boost::format("heartbeat: %.3fs ago\n") % heartbeat_age(snapshot.heartbeat);
+	out << boost::format("cycles:    %d\n") % snapshot.cycles;
+	out << boost::format("queue:     %d interrupts, %s\n") % snapshot.queueSize
+			% (snapshot.queueEnabled ? "queueing" : "delivering");
+
+	for (int i = 0; i < MachineState::REGISTER_COUNT; i++) {
+		out << static_cast<registers>(i) << boost::format("=%04x%s") % snapshot.registers[i]
+				% (i % 6 == 5 ? "\n" : " ");
+	}
+}
+
+void print_json(ostream &out, const StateSegment::Snapshot &snapshot) {
+	out << "{";
+	out << boost::format("\"status\": \"%s\", ") % status_name(snapshot.status);
+	out << boost::format("\"pid\": %d, \"alive\": %s, ") % snapshot.pid % (StateSegment::isAlive(snapshot.pid) ? "true" : "false");
+	out << boost::format("\"heartbeat_age\": %.3f, ") % heartbeat_age(snapshot.heartbeat);
+	out << boost::format("\"cycles\": %d, ") % snapshot.cycles;
+	out << boost::format("\"queue_size\": %d, \"queue_enabled\": %s, ") % snapshot.queueSize
+			% (snapshot.queueEnabled ? "true" : "false");
+	out << "\"registers\": {";
+	for (int i = 0; i < MachineState::REGISTER_COUNT; i++) {
+		out << (i ? ", " : "") << "\"" << static_cast<registers>(i) << "\": " << snapshot.registers[i];
+	}
+	out << "}}" << endl;
+}
+
+void usage(const char *program_name, const po::options_description &visible_options) {
+	cout << "Usage: " << program_name << " [OPTIONS] <state-file>" << endl;
+	cout << visible_options << endl;
+}
+
+int main(int argc, char **argv) {
+	bool json;
+	string input_file;
+	string checkpoint_file;
+
+	po::options_description visible_options("OPTIONS");
+	visible_options.add_options()
+		("help,h", "Displays this information")
+		("json", po::bool_switch(&json), "Print the state as JSON")
+		("checkpoint", po::value<string>(&checkpoint_file),
+				"Copy the state to a new file, which dcpu-run --state can resume from");
+
+	po::options_description hidden_options("Hidden options");
+	hidden_options.add_options()
+		("input-file", po::value<string>(&input_file), "the state file");
+
+	po::options_description cmdline_options;
+	cmdline_options.add(visible_options).add(hidden_options);
+
+	po::positional_options_description positional_args;
+	positional_args.add("input-file", -1);
+
+	try {
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).
+				options(cmdline_options).positional(positional_args).run(), vm);
+		po::notify(vm);
+
+		if (vm.count("help")) {
+			usage(argv[0], visible_options);
+			return 0;
+		}
+
+		if (input_file.length() == 0) {
+			cerr << "Missing required state-file argument" << endl << endl;
+			usage(argv[0], visible_options);
+			return 1;
+		}
+
+		unique_ptr<StateSegment> segment = StateSegment::open(input_file, false);
+		StateSegment::Snapshot snapshot = segment->read();
+
+		if (json) {
+			print_json(cout, snapshot);
+		} else {
+			print_text(cout, snapshot);
+		}
+
+		if (checkpoint_file.length()) {
+			segment->checkpoint(checkpoint_file);
+		}
+	} catch (exception &e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,188 @@
+#include <iostream>
+#include <string>
+#include <stdexcept>
+
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+
+#include "dcpu.hpp"
+#include "opcodes.hpp"
+#include "trace.hpp"
+
+using namespace std;
+using namespace dcpu::emulator;
+
+namespace po = boost::program_options;
+
+struct address_range {
+	uint32_t start;
+	uint32_t end;
+
+	address_range() : start(0), end(0xffff) {}
+
+	bool contains(uint16_t address) const {
+		return address >= start && address <= end;
+	}
+};
+
+address_range parse_range(const string &value) {
+	address_range range;
+	string::size_type separator = value.find(':');
+
+	range.start = stoul(value.substr(0, separator), nullptr, 0);
+	range.end = separator == string::npos ? range.start : stoul(value.substr(separator + 1), nullptr, 0);
+
+	if (range.start > 0xffff || range.end > 0xffff || range.start > range.end) {
+		throw invalid_argument(str(boost::format("invalid address range '%s'") % value));
+	}
+
+	return range;
+}
+
+string disassemble(Dcpu &scratch, const TraceRecord &record) {
+	for (int i = 0; i < record.wordCount; i++) {
+		scratch.memory[(uint16_t)(record.pc + i)] = record.words[i];
+	}
+	scratch.registers.pc = record.pc + 1;
+
+	try {
+		return Opcode::parse(scratch, record.words[0])->str();
+	} catch (invalid_argument &e) {
+		return str(boost::format("<invalid %04x>") % record.words[0]);
+	}
+}
+
+void print_record(ostream &out, Dcpu &scratch, const TraceRecord &record, uint64_t cycle) {
+	out << boost::format("%12d  %04x: ") % cycle % record.pc;
+	for (int i = 0; i < 3; i++) {
+		if (i < record.wordCount) {
+			out << boost::format("%04x ") % record.words[i];
+		} else {
+			out << "     ";
+		}
+	}
+
+	out << boost::format(" %c %-24s") % (record.flags & TraceRecord::SKIPPED ? '-' : ' ')
+			% disassemble(scratch, record);
+
+	if (record.changedRegister != TraceRecord::NO_REGISTER) {
+		out << static_cast<registers>(record.changedRegister) << boost::format("=%04x") % record.registerValue;
+		if (record.changedRegisters & ~(1 << record.changedRegister)) {
+			out << "+";
+		}
+		out << " ";
+	}
+
+	if (record.flags & TraceRecord::MEMORY_WRITE) {
+		out << boost::format("[%04x]=%04x") % record.writeAddress % record.writeValue;
+		if (record.flags & TraceRecord::MULTIPLE_WRITES) {
+			out << "+";
+		}
+	}
+
+	out << "\n";
+}
+
+void usage(const char *program_name, const po::options_description &visible_options) {
+	cout << "Usage: " << program_name << " [OPTIONS] <trace-file>" << endl;
+	cout << visible_options << endl;
+}
+
+int main(int argc, char **argv) {
+	uint64_t last;
+	string input_file;
+	string pc_filter;
+	string write_filter;
+	string register_filter;
+
+	po::options_description visible_options("OPTIONS");
+	visible_options.add_options()
+		("help,h", "Displays this information")
+		("last,n", po::value<uint64_t>(&last)->default_value(0),
+				"Only decode the last N records.  Zero decodes every record in the buffer.")
+		("pc", po::value<string>(&pc_filter), "Only show instructions at the address or start:end range")
+		("writes", po::value<string>(&write_filter), "Only show instructions that wrote to the address or range")
+		("register", po::value<string>(&register_filter), "Only show instructions that changed the register");
+
+	po::options_description hidden_options("Hidden options");
+	hidden_options.add_options()
+		("input-file", po::value<string>(&input_file), "the trace file");
+
+	po::options_description cmdline_options;
+	cmdline_options.add(visible_options).add(hidden_options);
+
+	po::positional_options_description positional_args;
+	positional_args.add("input-file", -1);
+
+	try {
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).
+				options(cmdline_options).positional(positional_args).run(), vm);
+		po::notify(vm);
+
+		if (vm.count("help")) {
+			usage(argv[0], visible_options);
+			return 0;
+		}
+
+		if (input_file.length() == 0) {
+			cerr << "Missing required trace-file argument" << endl << endl;
+			usage(argv[0], visible_options);
+			return 1;
+		}
+
+		address_range pc_range = pc_filter.length() ? parse_range(pc_filter) : address_range();
+		address_range write_range = write_filter.length() ? parse_range(write_filter) : address_range();
+
+		int register_mask = 0;
+		if (register_filter.length()) {
+			for (int i = 0; i < 12; i++) {
+				if (str(boost::format("%s") % static_cast<registers>(i)) == register_filter) {
+					register_mask = 1 << i;
+				}
+			}
+
+			if (!register_mask) {
+				throw invalid_argument(str(boost::format("unknown register '%s'") % register_filter));
+			}
+		}
+
+		TraceBuffer buffer(input_file);
+
+		uint64_t size = buffer.size();
+		uint64_t cycle = buffer.getEndCycles();
+		for (uint64_t i = 0; i < size; i++) {
+			cycle -= buffer[i].cycleDelta;
+		}
+
+		Dcpu scratch;
+		uint64_t first = last && last < size ? size - last : 0;
+		for (uint64_t i = 0; i < size; i++) {
+			const TraceRecord &record = buffer[i];
+			uint64_t start = cycle;
+			cycle += record.cycleDelta;
+
+			if (i < first || !pc_range.contains(record.pc)) {
+				continue;
+			}
+
+			if (write_filter.length() && (!(record.flags & TraceRecord::MEMORY_WRITE)
+					|| !write_range.contains(record.writeAddress))) {
+				continue;
+			}
+
+			if (register_mask && !(record.changedRegisters & register_mask)) {
+				continue;
+			}
+
+			print_record(cout, scratch, record, start);
+		}
+
+		cerr << boost::format("%d of %d records retained") % size % buffer.getWritten() << endl;
+	} catch (exception &e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
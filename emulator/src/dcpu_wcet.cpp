@@ -0,0 +1,128 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+
+#include "dcpu.hpp"
+#include "cfg.hpp"
+#include "wcet.hpp"
+
+using namespace std;
+using namespace dcpu::emulator;
+
+namespace po = boost::program_options;
+
+uint16_t parse_address(const string &value) {
+	size_t end;
+	unsigned long address = stoul(value, &end, 0);
+	if (end != value.length() || address > 0xffff) {
+		throw invalid_argument(str(boost::format("invalid entry point '%s'") % value));
+	}
+
+	return address;
+}
+
+void usage(const char *program_name, const po::options_description &visible_options) {
+	cout << "Usage: " << program_name << " [OPTIONS] <program>" << endl;
+	cout << visible_options << endl;
+}
+
+int main(int argc, char **argv) {
+	string input_file;
+	uint16_t hwi_cycles;
+	uint64_t budget;
+
+	po::options_description visible_options("OPTIONS");
+	visible_options.add_options()
+		("help,h", "Displays this information")
+		("entry,e", po::value<vector<string>>(), "Estimate the routine at this address as well as the one at 0.")
+		("bounds,b", po::value<vector<string>>(), "Read loop bounds from a file written by the assembler's --bounds.")
+		("hwi-cycles", po::value<uint16_t>(&hwi_cycles)->default_value(0),
+				"The most extra cycles a device takes to handle an HWI.")
+		("budget", po::value<uint64_t>(&budget)->default_value(0),
+				"Fail when an interrupt handler can take more cycles than this.  Zero checks nothing.");
+
+	po::options_description hidden_options("Hidden options");
+	hidden_options.add_options()
+		("input-file", po::value<string>(&input_file), "the program");
+
+	po::options_description cmdline_options;
+	cmdline_options.add(visible_options).add(hidden_options);
+
+	po::positional_options_description positional_args;
+	positional_args.add("input-file", -1);
+
+	try {
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).
+				options(cmdline_options).positional(positional_args).run(), vm);
+		po::notify(vm);
+
+		if (vm.count("help")) {
+			usage(argv[0], visible_options);
+			return 0;
+		}
+
+		if (input_file.length() == 0) {
+			cerr << "Missing required program argument" << endl << endl;
+			usage(argv[0], visible_options);
+			return 1;
+		}
+
+		vector<uint16_t> entries = { 0 };
+		if (vm.count("entry")) {
+			for (auto &entry : vm["entry"].as<vector<string>>()) {
+				entries.push_back(parse_address(entry));
+			}
+		}
+
+		CycleEstimator::LoopBounds bounds;
+		if (vm.count("bounds")) {
+			for (auto &filename : vm["bounds"].as<vector<string>>()) {
+				for (auto &bound : CycleEstimator::loadBounds(filename)) {
+					bounds[bound.first] = bound.second;
+				}
+			}
+		}
+
+		shared_ptr<const MemoryImage> image = MemoryImage::load(input_file);
+		const uint16_t *memory = image->getWords();
+
+		ControlFlowGraph cfg(memory, entries);
+		CycleEstimator estimator(memory, cfg, bounds, hwi_cycles);
+
+		bool failed = false;
+		cout << boost::format("%-8s %-8s %10s %10s") % "Routine" % "Kind" % "Best" % "Worst" << endl;
+		for (auto routine : estimator.getRoutines()) {
+			CycleEstimator::Estimate estimate = estimator.estimate(routine);
+			bool handler = cfg.isHandler(routine);
+
+			cout << boost::format("0x%04x   %-8s %10d ") % routine
+					% (handler ? "handler" : cfg.isEntry(routine) ? "entry" : "routine") % estimate.best;
+			if (estimate.bounded) {
+				cout << boost::format("%10d") % estimate.worst;
+			} else {
+				cout << boost::format("%10s  %s") % "unbounded" % estimate.reason;
+			}
+
+			if (handler && budget && (!estimate.bounded || estimate.worst > budget)) {
+				cout << "  over budget";
+				failed = true;
+			}
+			cout << endl;
+		}
+
+		if (failed) {
+			cerr << boost::format("Interrupt handlers can take more than %d cycles") % budget << endl;
+			return 1;
+		}
+	} catch (exception &e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
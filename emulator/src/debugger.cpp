@@ -0,0 +1,623 @@
+#include <sstream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cctype>
+#include <boost/format.hpp>
+
+#include "debugger.hpp"
+#include "opcodes.hpp"
+#include "cfg.hpp"
+
+using namespace std;
+using boost::format;
+using boost::str;
+
+namespace dcpu { namespace emulator {
+	static bool isJsr(uint16_t instruction) {
+		return (instruction & 0x1f) == 0 && ((instruction >> 5) & 0x1f) == 0x01;
+	}
+
+	/*************************************************************************
+	 *
+	 * Debugger
+	 *
+	 *************************************************************************/
+
+	Debugger::Debugger(Dcpu &cpu) : cpu(cpu), breakpoints(), watchpoints(), armed(false), interruptRequested(false),
+			pending(false), steppingOver(false), stepOverAddress(0), stepOverStack(0), runningToCycle(false), targetCycles(0),
+			resuming(false), resumeAddress(0), watchHit(false), watchAddress(0), watchOldValue(0), watchValue(0) {
+		cpu.memory.watcher = this;
+	}
+
+	Debugger::~Debugger() {
+		for (int page = 0; page < DcpuMemory::TOTAL_PAGES; page++) {
+			cpu.memory.clearPageFlags(page, DcpuMemory::PAGE_WATCHED);
+		}
+
+		if (cpu.memory.watcher == this) {
+			cpu.memory.watcher = nullptr;
+		}
+	}
+
+	void Debugger::addBreakpoint(uint16_t address) {
+		breakpointConditions.erase(address);
+		breakpoints.set(address);
+		updateArmed();
+	}
+
+	void Debugger::addBreakpoint(uint16_t address, const Condition &condition) {
+		breakpointConditions.erase(address);
+		breakpointConditions.insert(make_pair(address, condition));
+		breakpoints.set(address);
+		updateArmed();
+	}
+
+	void Debugger::removeBreakpoint(uint16_t address) {
+		breakpointConditions.erase(address);
+		breakpoints.reset(address);
+		updateArmed();
+	}
+
+	bool Debugger::hasBreakpoint(uint16_t address) const {
+		return breakpoints.test(address);
+	}
+
+	void Debugger::addWatchpoint(uint16_t address) {
+		watchpointConditions.erase(address);
+		watchpoints.set(address);
+		updateWatchedPage(address);
+		updateArmed();
+	}
+
+	void Debugger::addWatchpoint(uint16_t address, const Condition &condition) {
+		watchpointConditions.erase(address);
+		watchpointConditions.insert(make_pair(address, condition));
+		watchpoints.set(address);
+		updateWatchedPage(address);
+		updateArmed();
+	}
+
+	void Debugger::removeWatchpoint(uint16_t address) {
+		watchpointConditions.erase(address);
+		watchpoints.reset(address);
+		updateWatchedPage(address);
+		updateArmed();
+	}
+
+	bool Debugger::hasWatchpoint(uint16_t address) const {
+		return watchpoints.test(address);
+	}
+
+	void Debugger::updateWatchedPage(uint16_t address) {
+		uint16_t page = address >> DcpuMemory::PAGE_SHIFT;
+		uint32_t start = page << DcpuMemory::PAGE_SHIFT;
+
+		for (uint32_t i = start; i < start + DcpuMemory::PAGE_SIZE; i++) {
+			if (watchpoints.test(i)) {
+				cpu.memory.setPageFlags(page, DcpuMemory::PAGE_WATCHED);
+				return;
+			}
+		}
+
+		cpu.memory.clearPageFlags(page, DcpuMemory::PAGE_WATCHED);
+	}
+
+	bool Debugger::conditionHolds(const unordered_map<uint16_t, Condition> &conditions, uint16_t address) {
+		auto condition = conditions.find(address);
+		return condition == conditions.end() || condition->second.evaluate();
+	}
+
+	void Debugger::updateArmed() {
+		updatePending();
+		armed = pending || breakpoints.any() || watchpoints.any();
+	}
+
+	void Debugger::updatePending() {
+		pending = steppingOver || runningToCycle || resuming || watchHit || interruptRequested;
+	}
+
+	void Debugger::clearTargets() {
+		steppingOver = false;
+		runningToCycle = false;
+		updateArmed();
+	}
+
+	void Debugger::tickHardware() {
+		if (cpu.timeline) {
+			cpu.timeline->tickHardware();
+		} else {
+			cpu.hardwareManager.tickAll();
+		}
+	}
+
+	Timeline &Debugger::getTimeline() {
+		if (!cpu.timeline) {
+			throw logic_error("reverse execution is not enabled");
+		}
+
+		return *cpu.timeline;
+	}
+
+	void Debugger::prepareResume() {
+		resuming = true;
+		resumeAddress = cpu.registers.pc;
+		updatePending();
+	}
+
+	void Debugger::requestStop() {
+		interruptRequested = true;
+		pending = true;
+		armed = true;
+	}
+
+	StopReason Debugger::checkPendingStop() {
+		bool resumed = resuming;
+		resuming = false;
+
+		bool watched = watchHit && conditionHolds(watchpointConditions, watchAddress);
+		watchHit = false;
+
+		StopReason reason = StopReason::NONE;
+		if (interruptRequested.exchange(false)) {
+			reason = StopReason::INTERRUPTED;
+		} else if (watched) {
+			reason = StopReason::WATCHPOINT;
+		} else if (breakpoints.test(cpu.registers.pc) && !(resumed && cpu.registers.pc == resumeAddress)
+				&& conditionHolds(breakpointConditions, cpu.registers.pc)) {
+			reason = StopReason::BREAKPOINT;
+		} else if (steppingOver && cpu.registers.pc == stepOverAddress && cpu.registers.sp == stepOverStack) {
+			reason = StopReason::STEP;
+		} else if (runningToCycle && cpu.getCycles() >= targetCycles) {
+			reason = StopReason::CYCLE_REACHED;
+		}
+
+		if (reason != StopReason::NONE) {
+			clearTargets();
+		} else {
+			updatePending();
+		}
+
+		return reason;
+	}
+
+	void Debugger::stopAtCycle(uint64_t cycles) {
+		runningToCycle = true;
+		targetCycles = cycles;
+		updateArmed();
+	}
+
+	bool Debugger::stopAfterCall() {
+		uint16_t pc = cpu.registers.pc;
+		uint16_t instruction = cpu.memory.peek(pc);
+		if (cpu.isSkipNext() || !isJsr(instruction)) {
+			return false;
+		}
+
+		steppingOver = true;
+		stepOverAddress = pc + instructionLength(instruction);
+		stepOverStack = cpu.registers.sp;
+		updateArmed();
+		return true;
+	}
+
+	StopReason Debugger::step() {
+		if (cpu.isOnFire()) {
+			return StopReason::ON_FIRE;
+		}
+
+		cpu.tick();
+		tickHardware();
+
+		if (watchHit) {
+			watchHit = false;
+			updatePending();
+			if (conditionHolds(watchpointConditions, watchAddress)) {
+				return StopReason::WATCHPOINT;
+			}
+		}
+
+		return StopReason::STEP;
+	}
+
+	StopReason Debugger::stepOver() {
+		if (stopAfterCall()) {
+			return run();
+		}
+
+		return step();
+	}
+
+	StopReason Debugger::runToCycle(uint64_t cycles) {
+		if (cycles < cpu.getCycles()) {
+			Timeline &timeline = getTimeline();
+			timeline.seek(max(cycles, timeline.getEarliestCycles()));
+
+			watchHit = false;
+			clearTargets();
+			return cycles < timeline.getEarliestCycles() ? StopReason::HISTORY_START : StopReason::CYCLE_REACHED;
+		}
+
+		stopAtCycle(cycles);
+		return run();
+	}
+
+	StopReason Debugger::run() {
+		prepareResume();
+		return execute();
+	}
+
+	StopReason Debugger::stepBack() {
+		Timeline &timeline = getTimeline();
+		uint64_t now = cpu.getCycles();
+		if (now <= timeline.getEarliestCycles()) {
+			return StopReason::HISTORY_START;
+		}
+
+		// find the boundary of the previous instruction, then go back to it
+		timeline.restore(timeline.snapshotBefore(now));
+		uint64_t previous = cpu.getCycles();
+		while (cpu.getCycles() < now && !cpu.isOnFire()) {
+			previous = cpu.getCycles();
+			cpu.tick();
+			timeline.tickHardware();
+		}
+
+		timeline.seek(previous);
+		watchHit = false;
+		clearTargets();
+		return StopReason::STEP;
+	}
+
+	StopReason Debugger::reverseContinue() {
+		Timeline &timeline = getTimeline();
+		uint64_t now = cpu.getCycles();
+		uint64_t end = now;
+
+		// replay the intervals between snapshots from the latest backwards,
+		// remembering the last stop in each
+		while (true) {
+			size_t index = timeline.snapshotBefore(end);
+			uint64_t start = timeline.getSnapshotCycles(index);
+			if (start >= end) {
+				break;
+			}
+
+			timeline.restore(index);
+			watchHit = false;
+
+			StopReason found = StopReason::NONE;
+			uint64_t foundCycles = 0;
+			uint16_t foundAddress = 0, foundOldValue = 0, foundValue = 0;
+
+			while (cpu.getCycles() < end && !cpu.isOnFire()) {
+				uint16_t pc = cpu.registers.pc;
+				if (breakpoints.test(pc) && conditionHolds(breakpointConditions, pc)) {
+					found = StopReason::BREAKPOINT;
+					foundCycles = cpu.getCycles();
+				}
+
+				cpu.tick();
+				timeline.tickHardware();
+
+				if (watchHit) {
+					watchHit = false;
+					if (cpu.getCycles() < now && conditionHolds(watchpointConditions, watchAddress)) {
+						found = StopReason::WATCHPOINT;
+						foundCycles = cpu.getCycles();
+						foundAddress = watchAddress;
+						foundOldValue = watchOldValue;
+						foundValue = watchValue;
+					}
+				}
+			}
+
+			if (found != StopReason::NONE) {
+				timeline.seek(foundCycles);
+				watchHit = false;
+				watchAddress = foundAddress;
+				watchOldValue = foundOldValue;
+				watchValue = foundValue;
+				clearTargets();
+				return found;
+			}
+
+			if (index == 0) {
+				break;
+			}
+			end = start;
+		}
+
+		timeline.restore(0);
+		watchHit = false;
+		clearTargets();
+		return StopReason::HISTORY_START;
+	}
+
+	StopReason Debugger::execute() {
+		while (!cpu.isOnFire()) {
+			if (isArmed()) {
+				StopReason reason = checkStop();
+				if (reason != StopReason::NONE) {
+					return reason;
+				}
+			}
+
+			cpu.tick();
+			tickHardware();
+		}
+
+		clearTargets();
+		return StopReason::ON_FIRE;
+	}
+
+	uint16_t Debugger::getWatchAddress() const {
+		return watchAddress;
+	}
+
+	uint16_t Debugger::getWatchOldValue() const {
+		return watchOldValue;
+	}
+
+	uint16_t Debugger::getWatchValue() const {
+		return watchValue;
+	}
+
+	void Debugger::watchedWrite(uint16_t address, uint16_t oldValue, uint16_t value) {
+		// report the first watched write of an instruction
+		if (!watchHit && watchpoints.test(address)) {
+			watchHit = true;
+			pending = true;
+			watchAddress = address;
+			watchOldValue = oldValue;
+			watchValue = value;
+		}
+	}
+
+	ostream &operator<<(std::ostream &stream, StopReason reason) {
+		switch (reason) {
+		case StopReason::NONE:
+			return stream << "none";
+		case StopReason::BREAKPOINT:
+			return stream << "breakpoint";
+		case StopReason::WATCHPOINT:
+			return stream << "watchpoint";
+		case StopReason::STEP:
+			return stream << "step";
+		case StopReason::CYCLE_REACHED:
+			return stream << "cycle reached";
+		case StopReason::INTERRUPTED:
+			return stream << "interrupted";
+		case StopReason::ON_FIRE:
+			return stream << "on fire";
+		case StopReason::HISTORY_START:
+			return stream << "start of recorded history";
+		}
+
+		return stream;
+	}
+
+	/*************************************************************************
+	 *
+	 * DebugConsole
+	 *
+	 *************************************************************************/
+
+	static uint64_t parseNumber(const string &value, uint64_t max) {
+		size_t end;
+		uint64_t number = stoull(value, &end, 0);
+		if (end != value.length() || number > max) {
+			throw invalid_argument(str(format("invalid number '%s'") % value));
+		}
+
+		return number;
+	}
+
+	static registers parseRegister(string name) {
+		transform(name.begin(), name.end(), name.begin(), ::toupper);
+
+		for (int i = 0; i <= static_cast<int>(registers::IA); i++) {
+			registers reg = static_cast<registers>(i);
+			if (str(format("%s") % reg) == name) {
+				return reg;
+			}
+		}
+
+		throw invalid_argument(str(format("unknown register '%s'") % name));
+	}
+
+	DebugConsole::DebugConsole(Debugger &debugger, Dcpu &cpu, ostream &out) : debugger(debugger), cpu(cpu), out(out),
+			scratch() {
+
+	}
+
+	string DebugConsole::disassemble(uint16_t address) {
+		uint8_t length = instructionLength(cpu.memory.peek(address));
+		for (int i = 0; i < length; i++) {
+			scratch.memory[(uint16_t)(address + i)] = cpu.memory.peek(address + i);
+		}
+		scratch.registers.pc = address + 1;
+
+		try {
+			return Opcode::parse(scratch, cpu.memory.peek(address))->str();
+		} catch (invalid_argument &e) {
+			return str(format("<invalid %04x>") % cpu.memory.peek(address));
+		}
+	}
+
+	void DebugConsole::printStop(StopReason reason) {
+		out << format("stopped (%s) at cycle %d") % reason % cpu.getCycles();
+		if (reason == StopReason::WATCHPOINT) {
+			out << format(": [%04x] %04x -> %04x") % debugger.getWatchAddress() % debugger.getWatchOldValue()
+					% debugger.getWatchValue();
+		}
+		out << "\n" << format("%04x: %s") % cpu.registers.pc % disassemble(cpu.registers.pc) << endl;
+	}
+
+	void DebugConsole::printRegisters() {
+		for (int i = 0; i <= static_cast<int>(registers::IA); i++) {
+			registers reg = static_cast<registers>(i);
+			out << format("%s=%04x ") % reg % cpu.registers[reg];
+		}
+		out << format("cycles=%d") % cpu.getCycles() << endl;
+	}
+
+	void DebugConsole::examine(uint16_t address, uint16_t count) {
+		for (uint32_t i = 0; i < count; i++) {
+			uint16_t current = address + i;
+			if (i % 8 == 0) {
+				out << (i ? "\n" : "") << format("%04x:") % current;
+			}
+			out << format(" %04x") % cpu.memory.peek(current);
+		}
+		out << endl;
+	}
+
+	void DebugConsole::printTimeline() {
+		Timeline *timeline = cpu.timeline;
+		if (!timeline) {
+			out << "Reverse execution is not enabled." << endl;
+			return;
+		}
+
+		out << format("%d snapshots from cycle %d, present at cycle %d, %d KiB") % timeline->getSnapshotCount()
+				% timeline->getEarliestCycles() % timeline->getPresentCycles() % (timeline->getMemoryUsage() / 1024)
+				<< endl;
+	}
+
+	void DebugConsole::stateEdited() {
+		if (cpu.timeline) {
+			cpu.timeline->stateEdited();
+		}
+	}
+
+	void DebugConsole::printHelp() {
+		out << "break|b <addr>          set a breakpoint\n"
+			<< "delete|d <addr>         remove a breakpoint\n"
+			<< "watch|w <addr>          stop after writes to the word\n"
+			<< "unwatch <addr>          remove a watchpoint\n"
+			<< "step|s [count]          execute instructions\n"
+			<< "next|n                  step over a JSR\n"
+			<< "until|u <cycle>         run until the cycle count is reached, or go back to it\n"
+			<< "continue|c              run until something stops execution\n"
+			<< "back|bs [count]         step back through recorded history\n"
+			<< "reverse|rc              go back to the previous breakpoint or watchpoint hit\n"
+			<< "timeline                show the recorded history\n"
+			<< "regs|r                  show the registers\n"
+			<< "set <reg> <value>       change a register\n"
+			<< "x <addr> [count]        show memory\n"
+			<< "poke <addr> <value>...  write memory, as devices see it, without stopping at watchpoints\n"
+			<< "quit|q                  leave the debugger\n"
+			<< "break and watch accept a condition in assembler expression syntax, for example\n"
+			<< "  b 0x20 if [SP+2] == 0x8000 && A > B" << endl;
+	}
+
+	bool DebugConsole::execute(const string &line) {
+		// break and watch take an optional "if <condition>" suffix
+		string::size_type conditionStart = line.find(" if ");
+		string condition = conditionStart == string::npos ? "" : line.substr(conditionStart + 4);
+		bool conditional = conditionStart != string::npos;
+
+		istringstream stream(line.substr(0, conditionStart));
+		string command;
+		vector<string> args;
+
+		stream >> command;
+		for (string arg; stream >> arg; ) {
+			args.push_back(arg);
+		}
+
+		try {
+			if (command.empty()) {
+				return true;
+			} else if (conditional && command != "break" && command != "b" && command != "watch" && command != "w") {
+				out << "Only break and watch take a condition." << endl;
+			} else if (command == "quit" || command == "q") {
+				return false;
+			} else if (command == "help" || command == "h") {
+				printHelp();
+			} else if ((command == "break" || command == "b") && args.size() == 1) {
+				if (conditional) {
+					debugger.addBreakpoint(parseNumber(args[0], 0xffff), Condition::compile(condition, cpu));
+				} else {
+					debugger.addBreakpoint(parseNumber(args[0], 0xffff));
+				}
+			} else if ((command == "delete" || command == "d") && args.size() == 1) {
+				debugger.removeBreakpoint(parseNumber(args[0], 0xffff));
+			} else if ((command == "watch" || command == "w") && args.size() == 1) {
+				if (conditional) {
+					debugger.addWatchpoint(parseNumber(args[0], 0xffff), Condition::compile(condition, cpu));
+				} else {
+					debugger.addWatchpoint(parseNumber(args[0], 0xffff));
+				}
+			} else if (command == "unwatch" && args.size() == 1) {
+				debugger.removeWatchpoint(parseNumber(args[0], 0xffff));
+			} else if ((command == "step" || command == "s") && args.size() <= 1) {
+				uint64_t count = args.empty() ? 1 : parseNumber(args[0], UINT64_MAX);
+				StopReason reason = StopReason::STEP;
+				for (uint64_t i = 0; i < count && reason == StopReason::STEP; i++) {
+					if (i > 0 && debugger.hasBreakpoint(cpu.registers.pc)) {
+						reason = StopReason::BREAKPOINT;
+					} else {
+						reason = debugger.step();
+					}
+				}
+				printStop(reason);
+			} else if ((command == "next" || command == "n") && args.empty()) {
+				printStop(debugger.stepOver());
+			} else if ((command == "until" || command == "u") && args.size() == 1) {
+				printStop(debugger.runToCycle(parseNumber(args[0], UINT64_MAX)));
+			} else if ((command == "continue" || command == "c") && args.empty()) {
+				printStop(debugger.run());
+			} else if ((command == "back" || command == "bs") && args.size() <= 1) {
+				uint64_t count = args.empty() ? 1 : parseNumber(args[0], UINT64_MAX);
+				StopReason reason = StopReason::STEP;
+				for (uint64_t i = 0; i < count && reason == StopReason::STEP; i++) {
+					reason = debugger.stepBack();
+				}
+				printStop(reason);
+			} else if ((command == "reverse" || command == "rc") && args.empty()) {
+				printStop(debugger.reverseContinue());
+			} else if (command == "timeline" && args.empty()) {
+				printTimeline();
+			} else if ((command == "regs" || command == "r") && args.empty()) {
+				printRegisters();
+			} else if (command == "set" && args.size() == 2) {
+				cpu.registers[parseRegister(args[0])] = parseNumber(args[1], 0xffff);
+				stateEdited();
+			} else if (command == "x" && (args.size() == 1 || args.size() == 2)) {
+				examine(parseNumber(args[0], 0xffff), args.size() == 2 ? parseNumber(args[1], 0xffff) : 8);
+			} else if (command == "poke" && args.size() >= 2) {
+				uint16_t address = parseNumber(args[0], 0xffff);
+				vector<uint16_t> values;
+				for (size_t i = 1; i < args.size(); i++) {
+					values.push_back(parseNumber(args[i], 0xffff));
+				}
+
+				// mapped devices and the journal hear of the writes, but watchpoints are for the program's own
+				MemoryWatcher *watcher = cpu.memory.watcher;
+				cpu.memory.watcher = nullptr;
+				for (uint16_t value : values) {
+					cpu.memory.write(address++, value);
+				}
+				cpu.memory.watcher = watcher;
+				stateEdited();
+			} else {
+				out << "Unknown command '" << line << "'.  Type help for a list of commands." << endl;
+			}
+		} catch (logic_error &e) {
+			// stoull throws invalid_argument and out_of_range, both logic errors
+			out << e.what() << endl;
+		}
+
+		return true;
+	}
+
+	void DebugConsole::run(istream &in) {
+		string line;
+		out << "> " << flush;
+		while (getline(in, line) && execute(line)) {
+			out << "> " << flush;
+		}
+	}
+}}
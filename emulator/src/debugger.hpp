@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstdint>
+#include <bitset>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <istream>
+#include <ostream>
+
+#include "dcpu.hpp"
+#include "condition.hpp"
+#include "timeline.hpp"
+
+namespace dcpu { namespace emulator {
+	enum class StopReason : uint8_t {
+		NONE, BREAKPOINT, WATCHPOINT, STEP, CYCLE_REACHED, INTERRUPTED, ON_FIRE, HISTORY_START
+	};
+
+	std::ostream &operator<<(std::ostream &stream, StopReason reason);
+
+	/*************************************************************************
+	 *
+	 * Debugger
+	 *
+	 * Breakpoints live in a 64K-bit bitmap indexed by PC.  Execution loops
+	 * only consult it while the debugger is armed, which is whenever a
+	 * breakpoint, watchpoint, step or run-to-cycle target is pending.
+	 * Watchpoints flag their page in DcpuMemory, so writes to every other
+	 * page stay on the fast path.
+	 *
+	 * Stepping back and reverse-continue need a Timeline attached to the
+	 * cpu.  They restore a snapshot and re-execute forward, checking the
+	 * breakpoints and watchpoints along the way.
+	 *
+	 *************************************************************************/
+	class Debugger : public MemoryWatcher {
+		Debugger(Debugger const&) = delete;
+		Debugger& operator =(Debugger const&) = delete;
+
+		Dcpu &cpu;
+		std::bitset<DcpuMemory::TOTAL_WORDS> breakpoints;
+		std::bitset<DcpuMemory::TOTAL_WORDS> watchpoints;
+		std::unordered_map<uint16_t, Condition> breakpointConditions;
+		std::unordered_map<uint16_t, Condition> watchpointConditions;
+		std::atomic<bool> armed;
+		std::atomic<bool> interruptRequested;
+		// set while anything other than a breakpoint could stop the next instruction
+		std::atomic<bool> pending;
+
+		bool steppingOver;
+		uint16_t stepOverAddress;
+		uint16_t stepOverStack;
+		bool runningToCycle;
+		uint64_t targetCycles;
+		bool resuming;
+		uint16_t resumeAddress;
+
+		bool watchHit;
+		uint16_t watchAddress;
+		uint16_t watchOldValue;
+		uint16_t watchValue;
+
+		void updateArmed();
+		void updatePending();
+		StopReason checkPendingStop();
+		void updateWatchedPage(uint16_t address);
+		static bool conditionHolds(const std::unordered_map<uint16_t, Condition> &conditions, uint16_t address);
+		void clearTargets();
+		void tickHardware();
+		Timeline &getTimeline();
+		StopReason execute();
+	public:
+		Debugger(Dcpu &cpu);
+		~Debugger();
+
+		void addBreakpoint(uint16_t address);
+		void addBreakpoint(uint16_t address, const Condition &condition);
+		void removeBreakpoint(uint16_t address);
+		bool hasBreakpoint(uint16_t address) const;
+
+		/**
+		 * Conditions on watchpoints are evaluated once the writing instruction
+		 * has completed.
+		 */
+		void addWatchpoint(uint16_t address);
+		void addWatchpoint(uint16_t address, const Condition &condition);
+		void removeWatchpoint(uint16_t address);
+		bool hasWatchpoint(uint16_t address) const;
+
+		bool isArmed() const {
+			return armed.load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * Called by execution loops before every instruction while armed.
+		 */
+		StopReason checkStop() {
+			if (!pending.load(std::memory_order_relaxed) && !breakpoints[cpu.registers.pc]) {
+				return StopReason::NONE;
+			}
+
+			return checkPendingStop();
+		}
+
+		/**
+		 * Skips a breakpoint at the current PC, so that execution can continue
+		 * from the instruction that stopped it.
+		 */
+		void prepareResume();
+
+		/**
+		 * Asks a running loop to stop before the next instruction.  Safe to call
+		 * from another thread.
+		 */
+		void requestStop();
+
+		/**
+		 * Stops once the cycle count reaches the given value.
+		 */
+		void stopAtCycle(uint64_t cycles);
+
+		/**
+		 * Stops when the JSR at the current PC returns.  Returns false, and sets
+		 * nothing, when the next instruction is not a JSR.
+		 */
+		bool stopAfterCall();
+
+		StopReason step();
+		StopReason stepOver();
+		/**
+		 * Targets behind the current cycle are reached by replaying the
+		 * timeline, without stopping at breakpoints.
+		 */
+		StopReason runToCycle(uint64_t cycles);
+		StopReason run();
+
+		StopReason stepBack();
+
+		/**
+		 * Goes back to the latest point before the current cycle at which a
+		 * breakpoint or watchpoint would have stopped execution.
+		 */
+		StopReason reverseContinue();
+
+		uint16_t getWatchAddress() const;
+		uint16_t getWatchOldValue() const;
+		uint16_t getWatchValue() const;
+
+		virtual void watchedWrite(uint16_t address, uint16_t oldValue, uint16_t value);
+	};
+
+	/*************************************************************************
+	 *
+	 * DebugConsole
+	 *
+	 * A line based command interpreter over a Debugger.
+	 *
+	 *************************************************************************/
+	class DebugConsole {
+		Debugger &debugger;
+		Dcpu &cpu;
+		std::ostream &out;
+		Dcpu scratch;
+
+		std::string disassemble(uint16_t address);
+		void printStop(StopReason reason);
+		void printRegisters();
+		void printHelp();
+		void examine(uint16_t address, uint16_t count);
+		void printTimeline();
+		void stateEdited();
+	public:
+		DebugConsole(Debugger &debugger, Dcpu &cpu, std::ostream &out);
+
+		/**
+		 * Executes one command.  Returns false once the console should exit.
+		 */
+		bool execute(const std::string &line);
+		void run(std::istream &in);
+	};
+}}
@@ -0,0 +1,72 @@
+#include <algorithm>
+
+#include "dma.hpp"
+
+using namespace std;
+
+namespace dcpu { namespace emulator {
+	DmaDevice::DmaDevice(Dcpu &cpu, uint32_t wordsPerCycle, uint32_t setupCycles)
+		: HardwareDevice(cpu, MANUFACTURER_ID, HARDWARE_ID, VERSION), wordsPerCycle(max<uint32_t>(wordsPerCycle, 1)),
+		setupCycles(setupCycles), interruptMessage(0), command(COPY), source(0), destination(0), length(0),
+		completion(0), buffer() {
+
+	}
+
+	void DmaDevice::complete() {
+		if (command == COPY) {
+			buffer.resize(length);
+			cpu.memory.readBlock(source, buffer.data(), length);
+			cpu.memory.writeBlock(destination, buffer.data(), length);
+		} else {
+			cpu.memory.fillBlock(destination, source, length);
+		}
+		length = 0;
+
+		if (interruptMessage) {
+			cpu.interrupts.send(interruptMessage);
+		}
+	}
+
+	void DmaDevice::tick() {
+		if (length && cpu.getCycles() >= completion) {
+			complete();
+		}
+	}
+
+	uint16_t DmaDevice::interrupt() {
+		switch (cpu.registers.a) {
+		case COPY:
+		case FILL:
+			if (length) {
+				cpu.registers.a = 0;
+				return 0;
+			}
+
+			command = cpu.registers.a;
+			source = cpu.registers.b;
+			destination = cpu.registers.c;
+			length = cpu.registers.x;
+			completion = cpu.getCycles() + setupCycles + (length + wordsPerCycle - 1) / wordsPerCycle;
+			cpu.registers.a = 1;
+			return setupCycles;
+		case SET_INTERRUPT:
+			interruptMessage = cpu.registers.b;
+			break;
+		case STATUS:
+			cpu.registers.b = length;
+			cpu.registers.c = length ? min<uint64_t>(completion - min(completion, cpu.getCycles()), 0xffff) : 0;
+			break;
+		}
+
+		return 0;
+	}
+
+	uint64_t DmaDevice::getNextEvent() {
+		return length ? completion : NO_EVENT;
+	}
+
+	void DmaDevice::reset() {
+		interruptMessage = 0;
+		length = 0;
+	}
+}}
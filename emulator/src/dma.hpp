@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "dcpu.hpp"
+#include "hardware.hpp"
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * DmaDevice
+	 *
+	 * Copies and fills blocks of memory in the background.  A transfer takes
+	 * a setup cost, charged to the HWI that starts it, and then a cycle for
+	 * every few words while the cpu runs on.  The host moves the whole block
+	 * at once when that time is up, then raises the interrupt if one is set.
+	 * Until then memory is as it was.
+	 *
+	 * Interrupts, with A holding the command:
+	 *   0 COPY           copies X words from B to C, as if through a buffer
+	 *                    when the blocks overlap
+	 *   1 FILL           sets X words from C to the value B
+	 *   2 SET_INTERRUPT  sends an interrupt with message B when a transfer
+	 *                    completes.  0 turns it off
+	 *   3 STATUS         sets B to the words of the transfer in progress, 0
+	 *                    when idle, and C to the cycles it has left
+	 *
+	 * COPY and FILL set A to 1 when they start, or 0 when another transfer is
+	 * still in progress.  Blocks wrap around the end of memory.  A block of
+	 * no words completes at once, without an interrupt.
+	 *
+	 *************************************************************************/
+	class DmaDevice : public HardwareDevice {
+		enum { HARDWARE_ID = 0x444d4143, MANUFACTURER_ID = 0x44435055, VERSION = 1 };
+
+		uint32_t wordsPerCycle;
+		uint32_t setupCycles;
+		uint16_t interruptMessage;
+
+		// the transfer in progress, if length is not zero
+		uint16_t command;
+		uint16_t source;
+		uint16_t destination;
+		uint16_t length;
+		uint64_t completion;
+		std::vector<uint16_t> buffer;
+
+		void complete();
+	public:
+		enum Command { COPY, FILL, SET_INTERRUPT, STATUS };
+		enum { DEFAULT_WORDS_PER_CYCLE = 4, DEFAULT_SETUP_CYCLES = 4 };
+
+		DmaDevice(Dcpu &cpu, uint32_t wordsPerCycle=DEFAULT_WORDS_PER_CYCLE,
+				uint32_t setupCycles=DEFAULT_SETUP_CYCLES);
+
+		virtual void tick();
+		virtual uint16_t interrupt();
+		virtual uint64_t getNextEvent();
+		virtual void reset();
+	};
+}}
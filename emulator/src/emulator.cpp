@@ -14,6 +14,13 @@ BEGIN_EVENT_TABLE(EmulatorFrame, wxFrame)
     EVT_MENU(ID_Open, EmulatorFrame::OnOpen)
     EVT_MENU(ID_Start, EmulatorFrame::OnStart)
     EVT_MENU(ID_Stop, EmulatorFrame::OnStop)
+    EVT_MENU(ID_Step, EmulatorFrame::OnStep)
+    EVT_MENU(ID_StepOver, EmulatorFrame::OnStepOver)
+    EVT_MENU(ID_RunToCycle, EmulatorFrame::OnRunToCycle)
+    EVT_MENU(ID_Breakpoint, EmulatorFrame::OnBreakpoint)
+    EVT_MENU(ID_Watchpoint, EmulatorFrame::OnWatchpoint)
+    EVT_MENU(ID_EditRegister, EmulatorFrame::OnEditRegister)
+    EVT_MENU(ID_EditMemory, EmulatorFrame::OnEditMemory)
     EVT_COMMAND(wxID_ANY, wxEVT_COMMAND_DCPU_STOPPED, EmulatorFrame::OnDcpuStopped)
 END_EVENT_TABLE()
 
@@ -28,7 +35,8 @@ bool EmulatorApp::OnInit() {
 }
 
 EmulatorFrame::EmulatorFrame(const wxString &title, const wxPoint &pos, const wxSize &size) 
-        : wxFrame(NULL, -1, title, pos, size), cpu(), cpuThread(cpu, this) {
+        : wxFrame(NULL, -1, title, pos, size), cpu(), debugger(cpu), console(debugger, cpu, cout),
+        cpuThread(cpu, debugger, this) {
     wxMenu *menuFile = new wxMenu;
 
     menuFile->Append(ID_Open, _("&Open"));
@@ -42,10 +50,21 @@ EmulatorFrame::EmulatorFrame(const wxString &title, const wxPoint &pos, const wx
     menuEmulator->Enable(ID_Start, false);
     menuEmulator->Enable(ID_Stop, false);
 
+    wxMenu *menuDebug = new wxMenu;
+    menuDebug->Append(ID_Step, _("Step &Into"));
+    menuDebug->Append(ID_StepOver, _("Step &Over"));
+    menuDebug->Append(ID_RunToCycle, _("Run to &Cycle..."));
+    menuDebug->AppendSeparator();
+    menuDebug->Append(ID_Breakpoint, _("Toggle &Breakpoint..."));
+    menuDebug->Append(ID_Watchpoint, _("Toggle &Watchpoint..."));
+    menuDebug->AppendSeparator();
+    menuDebug->Append(ID_EditRegister, _("Edit &Register..."));
+    menuDebug->Append(ID_EditMemory, _("Edit &Memory..."));
 
     wxMenuBar *menuBar = new wxMenuBar();
     menuBar->Append(menuFile, _("&File"));
     menuBar->Append(menuEmulator, _("&Emulator"));
+    menuBar->Append(menuDebug, _("&Debug"));
 
     SetMenuBar(menuBar);
 }
@@ -63,11 +82,20 @@ void EmulatorFrame::OnOpen(wxCommandEvent & WXUNUSED(event)) {
     }
 }
 
+void EmulatorFrame::setRunning(bool running) {
+    GetMenuBar()->Enable(ID_Start, !running);
+    GetMenuBar()->Enable(ID_Stop, running);
+
+    int debugItems[] = { ID_Step, ID_StepOver, ID_RunToCycle, ID_Breakpoint, ID_Watchpoint, ID_EditRegister,
+        ID_EditMemory };
+    for (int id : debugItems) {
+        GetMenuBar()->Enable(id, !running);
+    }
+}
+
 void EmulatorFrame::OnStart(wxCommandEvent & WXUNUSED(event)) {
     cpuThread.start();
-
-    GetMenuBar()->Enable(ID_Start, false);
-    GetMenuBar()->Enable(ID_Stop, true);
+    setRunning(true);
 }
 
 void EmulatorFrame::OnStop(wxCommandEvent & WXUNUSED(event)) {
@@ -75,9 +103,79 @@ void EmulatorFrame::OnStop(wxCommandEvent & WXUNUSED(event)) {
 }
 
 void EmulatorFrame::OnDcpuStopped(wxCommandEvent & WXUNUSED(event)) {
-    GetMenuBar()->Enable(ID_Start, true);
-    GetMenuBar()->Enable(ID_Stop, false);
+    setRunning(false);
 
     cpuThread.stop();
+    cout << "Stopped: " << cpuThread.getStopReason() << endl;
     cpu.dump(cout);
+}
+
+// Runs a console command built from the prompt text, so the menus and dcpu-run --debug share one parser
+void EmulatorFrame::debugCommand(const wxString &command, const wxString &prompt) {
+    wxString text = wxGetTextFromUser(prompt, _("Debug"), wxEmptyString, this);
+    if (!text.IsEmpty()) {
+        console.execute(string((command + wxT(" ") + text).mb_str(wxConvUTF8)));
+    }
+}
+
+void EmulatorFrame::OnStep(wxCommandEvent & WXUNUSED(event)) {
+    console.execute("step");
+}
+
+// Step over runs on the emulator thread, since the called routine may never return
+void EmulatorFrame::OnStepOver(wxCommandEvent & WXUNUSED(event)) {
+    if (debugger.stopAfterCall()) {
+        cpuThread.start();
+        setRunning(true);
+    } else {
+        console.execute("step");
+    }
+}
+
+void EmulatorFrame::OnRunToCycle(wxCommandEvent & WXUNUSED(event)) {
+    wxString text = wxGetTextFromUser(_("Stop once the cycle count reaches"), _("Debug"), wxEmptyString, this);
+    unsigned long long cycles;
+    if (text.ToULongLong(&cycles, 0)) {
+        debugger.stopAtCycle(cycles);
+        cpuThread.start();
+        setRunning(true);
+    }
+}
+
+void EmulatorFrame::OnBreakpoint(wxCommandEvent & WXUNUSED(event)) {
+    wxString text = wxGetTextFromUser(_("Breakpoint address, optionally followed by 'if <condition>'"),
+            _("Debug"), wxEmptyString, this);
+    unsigned long address;
+    if (text.Contains(wxT(" if "))) {
+        console.execute(string((wxT("break ") + text).mb_str(wxConvUTF8)));
+    } else if (text.ToULong(&address, 0) && address <= 0xffff) {
+        if (debugger.hasBreakpoint(address)) {
+            debugger.removeBreakpoint(address);
+        } else {
+            debugger.addBreakpoint(address);
+        }
+    }
+}
+
+void EmulatorFrame::OnWatchpoint(wxCommandEvent & WXUNUSED(event)) {
+    wxString text = wxGetTextFromUser(_("Watchpoint address, optionally followed by 'if <condition>'"),
+            _("Debug"), wxEmptyString, this);
+    unsigned long address;
+    if (text.Contains(wxT(" if "))) {
+        console.execute(string((wxT("watch ") + text).mb_str(wxConvUTF8)));
+    } else if (text.ToULong(&address, 0) && address <= 0xffff) {
+        if (debugger.hasWatchpoint(address)) {
+            debugger.removeWatchpoint(address);
+        } else {
+            debugger.addWatchpoint(address);
+        }
+    }
+}
+
+void EmulatorFrame::OnEditRegister(wxCommandEvent & WXUNUSED(event)) {
+    debugCommand(wxT("set"), _("Register and value, e.g. A 0x10"));
+}
+
+void EmulatorFrame::OnEditMemory(wxCommandEvent & WXUNUSED(event)) {
+    debugCommand(wxT("poke"), _("Address followed by one or more values"));
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <wx/wx.h>
 
 #include "dcpu.hpp"
+#include "debugger.hpp"
 #include "ui/dcpu_thread.hpp"
 
 class EmulatorApp : public wxApp {
@@ -9,7 +10,12 @@ class EmulatorApp : public wxApp {
 
 class EmulatorFrame : public wxFrame {
 	dcpu::emulator::Dcpu cpu;
+    dcpu::emulator::Debugger debugger;
+    dcpu::emulator::DebugConsole console;
     dcpu::emulator::DcpuThread cpuThread;
+
+    void debugCommand(const wxString &command, const wxString &prompt);
+    void setRunning(bool running);
 public:
     EmulatorFrame(const wxString &title, const wxPoint &pos, const wxSize& size);
     
@@ -17,6 +23,13 @@ public:
     void OnOpen(wxCommandEvent &event);
     void OnStart(wxCommandEvent &event);
     void OnStop(wxCommandEvent &event);
+    void OnStep(wxCommandEvent &event);
+    void OnStepOver(wxCommandEvent &event);
+    void OnRunToCycle(wxCommandEvent &event);
+    void OnBreakpoint(wxCommandEvent &event);
+    void OnWatchpoint(wxCommandEvent &event);
+    void OnEditRegister(wxCommandEvent &event);
+    void OnEditMemory(wxCommandEvent &event);
     
     void OnDcpuStopped(wxCommandEvent &event);
 
@@ -28,4 +41,11 @@ enum {
     ID_Open = 2,
     ID_Start = 3,
     ID_Stop = 4,
+    ID_Step = 5,
+    ID_StepOver = 6,
+    ID_RunToCycle = 7,
+    ID_Breakpoint = 8,
+    ID_Watchpoint = 9,
+    ID_EditRegister = 10,
+    ID_EditMemory = 11,
 };
@@ -12,6 +12,14 @@ namespace dcpu { namespace emulator {
 
 	}
 
+	uint64_t HardwareDevice::getNextEvent() {
+		return ANY_CYCLE;
+	}
+
+	void HardwareDevice::reset() {
+
+	}
+
 	uint32_t HardwareDevice::getHardwareId() {
 		return hardwareId;
 	}
@@ -11,12 +11,28 @@ namespace dcpu { namespace emulator {
 		uint32_t hardwareId;
 		uint16_t version;
 	public:
+		enum : uint64_t { ANY_CYCLE = 0, NO_EVENT = UINT64_MAX };
+
 		HardwareDevice(Dcpu &cpu, uint32_t manufacturerId, uint32_t hardwareId, uint16_t version);
 		virtual ~HardwareDevice();
 
 		virtual void tick()=0;
 		virtual uint16_t interrupt()=0;
 
+		/**
+		 * The cycle at which the device next acts on its own, or NO_EVENT
+		 * when it only acts when interrupted.  A device that gives one must
+		 * not need tick() before then, which lets idle loops be skipped up
+		 * to it.  ANY_CYCLE, the default, keeps every cycle emulated.
+		 */
+		virtual uint64_t getNextEvent();
+
+		/**
+		 * Returns the device to its power on state when the cpu is reset.
+		 * Does nothing by default.
+		 */
+		virtual void reset();
+
 		uint32_t getHardwareId();
 		uint32_t getManufacturerId();
 		uint16_t getVersion();
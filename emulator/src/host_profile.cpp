@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <boost/format.hpp>
+
+#include "host_profile.hpp"
+#include "stats.hpp"
+
+using namespace std;
+using boost::format;
+
+namespace dcpu { namespace emulator {
+	enum { MODES = ExecutionStats::OPERAND_MODES };
+
+	HostProfiler::HostProfiler() : costs(OPCODE_KEYS * MODES * MODES), overhead(~0ull), startTicks(0),
+			startTime(), nanosecondsPerTick(1) {
+
+		// the least time between two readings, which every sample includes
+		for (int i = 0; i < 1000; i++) {
+			uint64_t first = now();
+			overhead = min(overhead, now() - first);
+		}
+
+		startTime = chrono::steady_clock::now();
+		startTicks = now();
+	}
+
+	void HostProfiler::instructionExecuted(uint16_t instruction, bool skipped, uint64_t startTicks) {
+		uint64_t ticks = now() - startTicks;
+		uint8_t opcode = instruction & 0x1f;
+		uint8_t key = skipped ? static_cast<uint8_t>(SKIPPED) : opcode ? opcode : 32 + ((instruction >> 5) & 0x1f);
+		uint8_t b = (skipped || !opcode) ? 0 : ExecutionStats::operandMode((instruction >> 5) & 0x1f);
+		uint8_t a = skipped ? 0 : ExecutionStats::operandMode(instruction >> 10);
+
+		Cost &cost = costs[(key * MODES + b) * MODES + a];
+		cost.count++;
+		cost.ticks += ticks > overhead ? ticks - overhead : 0;
+	}
+
+	void HostProfiler::finish() {
+		uint64_t ticks = now() - startTicks;
+		uint64_t nanoseconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now()
+				- startTime).count();
+
+		if (ticks) {
+			nanosecondsPerTick = static_cast<double>(nanoseconds) / ticks;
+		}
+	}
+
+	vector<HostProfiler::Row> HostProfiler::getRows() const {
+		vector<Row> rows;
+		for (uint32_t i = 0; i < costs.size(); i++) {
+			if (!costs[i].count) {
+				continue;
+			}
+
+			uint32_t key = i / (MODES * MODES);
+			uint8_t b = (i / MODES) % MODES;
+			uint8_t a = i % MODES;
+
+			Row row;
+			row.skipped = key == SKIPPED;
+			row.count = costs[i].count;
+			row.nanoseconds = costs[i].ticks * nanosecondsPerTick;
+			if (row.skipped) {
+				row.opcode = row.b = row.a = nullptr;
+			} else {
+				uint16_t instruction = key < 32 ? key : (key - 32) << 5;
+				row.opcode = ExecutionStats::opcodeName(instruction);
+				row.b = key < 32 ? ExecutionStats::OPERAND_MODE_NAMES[b] : nullptr;
+				row.a = ExecutionStats::OPERAND_MODE_NAMES[a];
+			}
+			rows.push_back(row);
+		}
+
+		sort(rows.begin(), rows.end(), [] (const Row &left, const Row &right) {
+			return left.nanoseconds > right.nanoseconds;
+		});
+		return rows;
+	}
+
+	void HostProfiler::writeReport(ostream &out) const {
+		vector<Row> rows = getRows();
+
+		uint64_t total = 0;
+		uint64_t instructions = 0;
+		for (auto &row : rows) {
+			total += row.nanoseconds;
+			instructions += row.count;
+		}
+
+		out << format("%-8s %-16s %-16s %12s %14s %8s %7s\n") % "Opcode" % "b" % "a" % "Count" % "Host ns"
+				% "ns/instr" % "%";
+		for (auto &row : rows) {
+			out << format("%-8s %-16s %-16s %12d %14d %8.1f %6.2f%%\n")
+				% (row.skipped ? "skipped" : row.opcode ? row.opcode : "invalid")
+				% (row.b ? row.b : "-") % (row.a ? row.a : "-")
+				% row.count % row.nanoseconds % (static_cast<double>(row.nanoseconds) / row.count)
+				% (total ? 100.0 * row.nanoseconds / total : 0);
+		}
+		out << format("Total: %d instructions, %d host ns, the cost of reading the clock taken off\n")
+				% instructions % total;
+	}
+}}
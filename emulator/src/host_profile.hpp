@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <chrono>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * HostProfiler
+	 *
+	 * Profiles the emulator rather than the program: the host time Dcpu::tick
+	 * spends decoding and executing each instruction, attributed to its
+	 * opcode and the operand modes of a and b.  Time comes from the time
+	 * stamp counter on x86 and from the steady clock elsewhere.  The cost of
+	 * reading the clock is measured once and taken off every sample.
+	 *
+	 *************************************************************************/
+	class HostProfiler {
+	public:
+		struct Row {
+			// skipped instructions only pay for decoding and share one row
+			bool skipped;
+			// null for invalid opcodes
+			const char *opcode;
+			// null for special opcodes, which have no b, and skipped instructions
+			const char *b;
+			const char *a;
+			uint64_t count;
+			uint64_t nanoseconds;
+		};
+	private:
+		// 32 basic opcodes, 32 special ones and the skipped instructions
+		enum { SKIPPED = 64, OPCODE_KEYS = 65 };
+
+		struct Cost {
+			uint64_t count;
+			uint64_t ticks;
+		};
+
+		std::vector<Cost> costs;
+		uint64_t overhead;
+		uint64_t startTicks;
+		std::chrono::steady_clock::time_point startTime;
+		double nanosecondsPerTick;
+	public:
+		HostProfiler();
+
+		static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+#else
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+		}
+
+		void instructionExecuted(uint16_t instruction, bool skipped, uint64_t startTicks);
+
+		/**
+		 * Converts ticks to nanoseconds by the rate the clock ran at since
+		 * the profiler was made.
+		 */
+		void finish();
+
+		/**
+		 * Every opcode and operand mode combination seen, most host time
+		 * first.
+		 */
+		std::vector<Row> getRows() const;
+
+		void writeReport(std::ostream &out) const;
+	};
+}}
@@ -0,0 +1,119 @@
+#include <algorithm>
+
+#include "idle.hpp"
+#include "hardware.hpp"
+#include "opcodes.hpp"
+
+using namespace std;
+
+namespace dcpu { namespace emulator {
+	IdleDetector::IdleDetector(Dcpu &cpu) : cpu(cpu), limit(NO_LIMIT), skippedCycles(0), tracking(false),
+			expectedAddress(0), head(0), headRegisters(), headCycles(0), headWrites(0), headQueueSize(0),
+			headQueueEnabled(false), iteration() {
+
+		iteration.reserve(MAX_ITERATION);
+	}
+
+	void IdleDetector::setLimit(uint64_t cycle) {
+		limit = cycle;
+	}
+
+	uint64_t IdleDetector::getSkippedCycles() const {
+		return skippedCycles;
+	}
+
+	void IdleDetector::instructionExecuted(uint16_t address, uint16_t instruction, bool skipped) {
+		// an interrupt, the debugger or a device moved PC between instructions
+		if (address != expectedAddress) {
+			tracking = false;
+		}
+
+		uint16_t pc = cpu.registers.pc;
+		expectedAddress = pc;
+
+		if (tracking) {
+			if (iteration.size() < MAX_ITERATION) {
+				iteration.push_back(make_pair(instruction, skipped));
+			} else {
+				tracking = false;
+			}
+		}
+
+		// only a jump back, or to itself, ends an iteration
+		if (skipped || pc > address) {
+			return;
+		}
+
+		if (tracking && pc == head && isUnchanged()) {
+			skip();
+		}
+		startIteration(pc);
+	}
+
+	void IdleDetector::startIteration(uint16_t address) {
+		tracking = !cpu.skipNext;
+		head = address;
+		for (uint8_t i = 0; i < REGISTER_COUNT; i++) {
+			headRegisters[i] = cpu.registers[static_cast<registers>(i)];
+		}
+		headCycles = cpu.cycles;
+		headWrites = cpu.memory.getWriteCount();
+		headQueueSize = cpu.interrupts.queue.size();
+		headQueueEnabled = cpu.interrupts.queueEnabled;
+		iteration.clear();
+	}
+
+	bool IdleDetector::isUnchanged() {
+		if (cpu.skipNext || cpu.memory.getWriteCount() != headWrites || cpu.interrupts.queue.size() != headQueueSize
+				|| cpu.interrupts.queueEnabled != headQueueEnabled) {
+			return false;
+		}
+
+		for (uint8_t i = 0; i < REGISTER_COUNT; i++) {
+			if (headRegisters[i] != cpu.registers[static_cast<registers>(i)]) {
+				return false;
+			}
+		}
+
+		// HWI reaches a device and INT counts a dropped interrupt even when nothing else changes
+		for (auto &instruction : iteration) {
+			uint8_t special = (instruction.first >> 5) & 0x1f;
+			if ((instruction.first & 0x1f) == 0 && !instruction.second
+					&& (special == hwiOpcode::OPCODE || special == intOpcode::OPCODE)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void IdleDetector::skip() {
+		// a mapped device answers reads from its own state, and gives no next event to stop short of
+		if (cpu.memory.hasMappedPages()) {
+			return;
+		}
+
+		uint64_t cycles = cpu.cycles - headCycles;
+		uint64_t deadline = min(limit, cpu.hardwareManager.getNextEvent());
+		if (!cycles || deadline == NO_LIMIT || deadline <= cpu.cycles) {
+			return;
+		}
+
+		// the boundaries of the iterations skipped all stay short of the deadline
+		uint64_t count = (deadline - cpu.cycles - 1) / cycles;
+		if (!count) {
+			return;
+		}
+
+		cpu.cycles += count * cycles;
+		skippedCycles += count * cycles;
+		for (auto &instruction : iteration) {
+			if (instruction.second) {
+				cpu.stats.instructionSkipped(count);
+			} else {
+				cpu.stats.instructionRetired(instruction.first, count);
+			}
+		}
+		cpu.stats.setCycles(cpu.cycles);
+	}
+}}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+#include "dcpu.hpp"
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * IdleDetector
+	 *
+	 * Finds loops that wait, such as SUB PC, 1 or a poll loop, and skips
+	 * emulated time to just before the next device event or the cycle limit.
+	 * An iteration runs from a jump back to the same address to the next,
+	 * and counts as idle when it left the registers, the interrupt queue and
+	 * memory as they were, wrote nothing and made no HWI or INT.  Every later
+	 * iteration then does the same until a device acts, so whole iterations
+	 * are added to the cycles and the stats without running them.  Device
+	 * ticks are skipped with them, which is why only devices that give
+	 * their next event let anything be skipped, and nothing is while any
+	 * memory page is mapped to a device.
+	 *
+	 *************************************************************************/
+	class IdleDetector {
+		enum { MAX_ITERATION = 64, REGISTER_COUNT = 12 };
+
+		Dcpu &cpu;
+		uint64_t limit;
+		uint64_t skippedCycles;
+
+		bool tracking;
+		uint16_t expectedAddress;
+		uint16_t head;
+		uint16_t headRegisters[REGISTER_COUNT];
+		uint64_t headCycles;
+		uint64_t headWrites;
+		size_t headQueueSize;
+		bool headQueueEnabled;
+		// the instruction words of the iteration and whether each was skipped
+		std::vector<std::pair<uint16_t, bool>> iteration;
+
+		void startIteration(uint16_t address);
+		bool isUnchanged();
+		void skip();
+	public:
+		enum : uint64_t { NO_LIMIT = UINT64_MAX };
+
+		IdleDetector(Dcpu &cpu);
+
+		/**
+		 * The cycle count emulation stops at, which skipping never reaches.
+		 * Without a limit or a device event ahead, nothing is skipped.
+		 */
+		void setLimit(uint64_t cycle);
+
+		void instructionExecuted(uint16_t address, uint16_t instruction, bool skipped);
+
+		uint64_t getSkippedCycles() const;
+	};
+}}
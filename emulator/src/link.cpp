@@ -0,0 +1,228 @@
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <boost/format.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "link.hpp"
+
+using namespace std;
+using boost::format;
+using boost::str;
+
+namespace dcpu { namespace emulator {
+	static void initialize(LinkRing *ring) {
+		ring->magic = LinkRing::MAGIC;
+		ring->slots = LinkRing::SLOTS;
+		new (&ring->indexes) RingIndexes();
+	}
+
+	LinkChannel::LinkChannel(LinkRing *ring) : ring(ring) {
+
+	}
+
+	// mapped rather than allocated, which keeps the indexes on their own cache lines
+	LinkChannel::LinkChannel() : ring(static_cast<LinkRing*>(mmap(nullptr, sizeof(LinkRing),
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0))) {
+
+		if (ring == MAP_FAILED) {
+			throw runtime_error(str(format("Failed to allocate a link: %s") % strerror(errno)));
+		}
+		initialize(ring);
+	}
+
+	LinkChannel::~LinkChannel() {
+		munmap(ring, sizeof(LinkRing));
+	}
+
+	// the fd is closed either way
+	static LinkRing *mapRing(int fd, const string &path) {
+		void *mapping = mmap(nullptr, sizeof(LinkRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			throw runtime_error(str(format("Failed to map the link %s: %s") % path % strerror(errno)));
+		}
+
+		return static_cast<LinkRing*>(mapping);
+	}
+
+	// made whole under a temporary name and then linked into place, so that no other process opens it half
+	// made.  Returns nullptr when another process made it first.
+	static LinkRing *createRing(const string &path) {
+		string temporary = path + ".XXXXXX";
+		int fd = mkstemp(&temporary[0]);
+		if (fd < 0) {
+			throw runtime_error(str(format("Failed to create the link %s: %s") % path % strerror(errno)));
+		}
+
+		if (fchmod(fd, 0644) != 0 || ftruncate(fd, sizeof(LinkRing)) != 0) {
+			string error = strerror(errno);
+			close(fd);
+			unlink(temporary.c_str());
+			throw runtime_error(str(format("Failed to size the link %s: %s") % path % error));
+		}
+
+		LinkRing *ring;
+		try {
+			ring = mapRing(fd, path);
+		} catch (...) {
+			unlink(temporary.c_str());
+			throw;
+		}
+		initialize(ring);
+
+		int failure = link(temporary.c_str(), path.c_str()) == 0 ? 0 : errno;
+		unlink(temporary.c_str());
+		if (failure) {
+			munmap(ring, sizeof(LinkRing));
+			if (failure != EEXIST) {
+				throw runtime_error(str(format("Failed to create the link %s: %s") % path % strerror(failure)));
+			}
+			return nullptr;
+		}
+
+		return ring;
+	}
+
+	shared_ptr<LinkChannel> LinkChannel::map(const string &path) {
+		int fd = open(path.c_str(), O_RDWR);
+		if (fd < 0 && errno == ENOENT) {
+			if (LinkRing *ring = createRing(path)) {
+				return shared_ptr<LinkChannel>(new LinkChannel(ring));
+			}
+			fd = open(path.c_str(), O_RDWR);
+		}
+
+		if (fd < 0) {
+			throw runtime_error(str(format("Failed to open the link %s: %s") % path % strerror(errno)));
+		}
+
+		// a shorter file would fault when the ring is touched
+		struct stat info;
+		if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(LinkRing)) {
+			close(fd);
+			throw runtime_error(str(format("%s is not a link") % path));
+		}
+
+		LinkRing *ring = mapRing(fd, path);
+		if (ring->magic != LinkRing::MAGIC || ring->slots != LinkRing::SLOTS) {
+			munmap(ring, sizeof(LinkRing));
+			throw runtime_error(str(format("%s is not a link") % path));
+		}
+
+		return shared_ptr<LinkChannel>(new LinkChannel(ring));
+	}
+
+	bool LinkChannel::send(uint64_t cycle, const uint16_t *words, uint16_t length) {
+		if (!ring->indexes.getFree(LinkRing::SLOTS)) {
+			return false;
+		}
+
+		LinkMessage &message = ring->messages[ring->indexes.getHead() % LinkRing::SLOTS];
+		message.cycle = cycle;
+		message.length = min<uint16_t>(length, LinkMessage::MAX_WORDS);
+		memcpy(message.words, words, message.length * sizeof(uint16_t));
+
+		ring->indexes.publish(1);
+		return true;
+	}
+
+	size_t LinkChannel::getFreeSlots() const {
+		return ring->indexes.getFree(LinkRing::SLOTS);
+	}
+
+	const LinkMessage *LinkChannel::peek(size_t position) const {
+		if (position >= ring->indexes.getUsed()) {
+			return nullptr;
+		}
+
+		return &ring->messages[(ring->indexes.getTail() + position) % LinkRing::SLOTS];
+	}
+
+	void LinkChannel::pop() {
+		ring->indexes.consume(1);
+	}
+
+	LinkDevice::LinkDevice(Dcpu &cpu, shared_ptr<LinkChannel> outgoing, shared_ptr<LinkChannel> incoming,
+			uint64_t latency) : HardwareDevice(cpu, MANUFACTURER_ID, HARDWARE_ID, VERSION), outgoing(outgoing),
+			incoming(incoming), latency(max<uint64_t>(latency, 1)), interruptMessage(0), arrived(0) {
+
+	}
+
+	pair<shared_ptr<LinkDevice>, shared_ptr<LinkDevice>> LinkDevice::connect(Dcpu &first, Dcpu &second,
+			uint64_t latency) {
+
+		auto forward = make_shared<LinkChannel>();
+		auto backward = make_shared<LinkChannel>();
+		return make_pair(make_shared<LinkDevice>(first, forward, backward, latency),
+				make_shared<LinkDevice>(second, backward, forward, latency));
+	}
+
+	void LinkDevice::tick() {
+		const LinkMessage *message;
+		while ((message = incoming->peek(arrived)) && message->cycle <= cpu.getCycles()) {
+			arrived++;
+			if (interruptMessage) {
+				cpu.interrupts.send(interruptMessage);
+			}
+		}
+	}
+
+	uint16_t LinkDevice::interrupt() {
+		switch (cpu.registers.a) {
+		case SEND: {
+			uint16_t length = min<uint16_t>(cpu.registers.c, LinkMessage::MAX_WORDS);
+			for (uint16_t i = 0; i < length; i++) {
+				buffer[i] = cpu.memory.read(cpu.registers.b + i);
+			}
+
+			cpu.registers.c = outgoing->send(cpu.getCycles() + latency, buffer, length) ? length : 0;
+			return cpu.registers.c / WORDS_PER_CYCLE;
+		}
+		case RECEIVE: {
+			const LinkMessage *message = arrived ? incoming->peek() : nullptr;
+			if (!message) {
+				cpu.registers.c = 0;
+				return 0;
+			}
+
+			uint16_t length = min(cpu.registers.c, message->length);
+			for (uint16_t i = 0; i < length; i++) {
+				cpu.memory.write(cpu.registers.b + i, message->words[i]);
+			}
+			incoming->pop();
+			arrived--;
+
+			cpu.registers.c = length;
+			return length / WORDS_PER_CYCLE;
+		}
+		case SET_INTERRUPT:
+			interruptMessage = cpu.registers.b;
+			break;
+		case STATUS:
+			cpu.registers.b = arrived;
+			cpu.registers.c = outgoing->getFreeSlots();
+			break;
+		}
+
+		return 0;
+	}
+
+	uint64_t LinkDevice::getNextEvent() {
+		// a message not sent yet may arrive at any cycle
+		const LinkMessage *message = incoming->peek(arrived);
+		return message ? message->cycle : ANY_CYCLE;
+	}
+
+	void LinkDevice::reset() {
+		interruptMessage = 0;
+		arrived = 0;
+	}
+}}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <memory>
+#include <utility>
+
+#include "dcpu.hpp"
+#include "hardware.hpp"
+#include "ring.hpp"
+
+namespace dcpu { namespace emulator {
+	struct LinkMessage {
+		enum { MAX_WORDS = 256 };
+
+		// the cycle the message arrives at
+		uint64_t cycle;
+		uint16_t length;
+		uint16_t words[MAX_WORDS];
+	};
+
+	/*************************************************************************
+	 *
+	 * LinkRing
+	 *
+	 * A fixed ring of messages with one sender and one receiver, laid out so
+	 * that it can live in a file mapped by two processes.
+	 *
+	 *************************************************************************/
+	struct LinkRing {
+		enum : uint32_t { MAGIC = 0x4b4e494c, SLOTS = 64 };
+
+		uint32_t magic;
+		uint32_t slots;
+		RingIndexes indexes __attribute__((aligned(64)));
+		LinkMessage messages[SLOTS] __attribute__((aligned(64)));
+	};
+
+	class LinkChannel {
+		LinkChannel(LinkChannel const&) = delete;
+		LinkChannel& operator =(LinkChannel const&) = delete;
+
+		LinkRing *ring;
+
+		LinkChannel(LinkRing *ring);
+	public:
+		/**
+		 * A channel between instances in this process.
+		 */
+		LinkChannel();
+		~LinkChannel();
+
+		/**
+		 * A channel in a file, such as one under /dev/shm, that another
+		 * process maps too.  The file is created when it does not exist.
+		 */
+		static std::shared_ptr<LinkChannel> map(const std::string &path);
+
+		/**
+		 * Called by the sender only.  Returns false when the ring is full.
+		 */
+		bool send(uint64_t cycle, const uint16_t *words, uint16_t length);
+		size_t getFreeSlots() const;
+
+		/**
+		 * Called by the receiver only.  The message at the given position
+		 * after the oldest one, or nullptr when it has not been sent yet.
+		 */
+		const LinkMessage *peek(size_t position=0) const;
+		void pop();
+	};
+
+	/*************************************************************************
+	 *
+	 * LinkDevice
+	 *
+	 * One end of a point to point link.  A send copies a block of memory
+	 * into the outgoing channel, stamped with the cycle it arrives at, the
+	 * sender's cycle plus the latency.  A message arrives when the receiving
+	 * cpu reaches that cycle, which raises the interrupt if one is set, and
+	 * waits there until received.
+	 *
+	 * Arrival depends only on cycles, so runs repeat exactly as long as
+	 * messages are in the channel before the receiver reaches their cycle.
+	 * Cores of a DcpuCluster guarantee that when the latency is larger than
+	 * the quantum and the longest instruction together.  Whether a send finds
+	 * the link full depends on how far the receiver has got, and does not
+	 * repeat across threads.
+	 *
+	 * Interrupts, with A holding the command:
+	 *   0 SEND           sends C words from B, and sets C to the words sent,
+	 *                    or 0 when the link is full
+	 *   1 RECEIVE        copies the oldest arrived message to B, at most C
+	 *                    words, and sets C to the words copied, or 0 when no
+	 *                    message has arrived
+	 *   2 SET_INTERRUPT  sends an interrupt with message B for each message
+	 *                    that arrives.  0 turns them off
+	 *   3 STATUS         sets B to the messages that have arrived and C to
+	 *                    the messages that can be sent before the link is full
+	 *
+	 * SEND and RECEIVE take a cycle for every eight words copied.
+	 *
+	 *************************************************************************/
+	class LinkDevice : public HardwareDevice {
+		enum { HARDWARE_ID = 0x4c494e4b, MANUFACTURER_ID = 0x44435055, VERSION = 1, WORDS_PER_CYCLE = 8 };
+
+		std::shared_ptr<LinkChannel> outgoing;
+		std::shared_ptr<LinkChannel> incoming;
+		uint64_t latency;
+		uint16_t interruptMessage;
+		// the oldest messages in incoming that have arrived
+		size_t arrived;
+		uint16_t buffer[LinkMessage::MAX_WORDS];
+	public:
+		enum Command { SEND, RECEIVE, SET_INTERRUPT, STATUS };
+		enum : uint64_t { DEFAULT_LATENCY = 2000 };
+
+		LinkDevice(Dcpu &cpu, std::shared_ptr<LinkChannel> outgoing, std::shared_ptr<LinkChannel> incoming,
+				uint64_t latency=DEFAULT_LATENCY);
+
+		/**
+		 * Makes the two ends of a link between the cpus, still to be
+		 * registered with them.
+		 */
+		static std::pair<std::shared_ptr<LinkDevice>, std::shared_ptr<LinkDevice>> connect(Dcpu &first,
+				Dcpu &second, uint64_t latency=DEFAULT_LATENCY);
+
+		virtual void tick();
+		virtual uint16_t interrupt();
+		virtual uint64_t getNextEvent();
+		virtual void reset();
+	};
+}}
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <boost/format.hpp>
+
+#include "markers.hpp"
+
+using namespace std;
+using boost::format;
+
+namespace dcpu { namespace emulator {
+	static BenchmarkMarkers::Region emptyRegion(uint16_t index) {
+		BenchmarkMarkers::Region region = {};
+		region.name = str(format("region %d") % index);
+		region.minCycles = UINT64_MAX;
+		return region;
+	}
+
+	BenchmarkMarkers::BenchmarkMarkers(Dcpu &cpu) : HardwareDevice(cpu, MANUFACTURER_ID, HARDWARE_ID, VERSION),
+			regions() {
+
+		reset();
+	}
+
+	void BenchmarkMarkers::tick() {
+
+	}
+
+	uint16_t BenchmarkMarkers::interrupt() {
+		if (cpu.registers.b >= MAX_REGIONS) {
+			return 0;
+		}
+
+		Region &region = regions[cpu.registers.b];
+		switch (cpu.registers.a) {
+		case LABEL:
+			region.name.clear();
+			for (uint16_t i = 0; i < MAX_NAME; i++) {
+				uint16_t character = cpu.memory.read(cpu.registers.c + i);
+				if (!character) {
+					break;
+				}
+
+				// kept printable, and safe to write into JSON as it is
+				region.name += character >= 0x20 && character < 0x7f && character != '"' && character != '\\'
+						? static_cast<char>(character) : '?';
+			}
+			break;
+		case START:
+			region.running = true;
+			region.startCycles = cpu.getCycles();
+			region.startInstructions = cpu.stats.getInstructions();
+			region.startInterrupts = cpu.stats.getInterruptsDelivered();
+			break;
+		case STOP:
+			if (region.running) {
+				uint64_t cycles = cpu.getCycles() - region.startCycles;
+				region.running = false;
+				region.passes++;
+				region.cycles += cycles;
+				region.minCycles = min(region.minCycles, cycles);
+				region.maxCycles = max(region.maxCycles, cycles);
+				region.instructions += cpu.stats.getInstructions() - region.startInstructions;
+				region.interrupts += cpu.stats.getInterruptsDelivered() - region.startInterrupts;
+			}
+			break;
+		}
+
+		return 0;
+	}
+
+	uint64_t BenchmarkMarkers::getNextEvent() {
+		return NO_EVENT;
+	}
+
+	void BenchmarkMarkers::reset() {
+		regions.clear();
+		for (uint16_t i = 0; i < MAX_REGIONS; i++) {
+			regions.push_back(emptyRegion(i));
+		}
+	}
+
+	const BenchmarkMarkers::Region &BenchmarkMarkers::getRegion(uint16_t region) const {
+		return regions.at(region);
+	}
+
+	void BenchmarkMarkers::writeJson(ostream &out) const {
+		out << "[";
+		const char *separator = "\n";
+		for (uint16_t i = 0; i < MAX_REGIONS; i++) {
+			const Region &region = regions[i];
+			if (!region.passes && region.name == emptyRegion(i).name) {
+				continue;
+			}
+
+			out << separator << format("\t{\"region\": %d, \"name\": \"%s\", \"passes\": %d, \"cycles\": %d, ")
+					% i % region.name % region.passes % region.cycles;
+			out << format("\"min_cycles\": %d, \"max_cycles\": %d, \"instructions\": %d, \"interrupts\": %d}")
+					% (region.passes ? region.minCycles : 0) % region.maxCycles % region.instructions
+					% region.interrupts;
+			separator = ",\n";
+		}
+		out << "\n]\n";
+	}
+}}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "dcpu.hpp"
+#include "hardware.hpp"
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * BenchmarkMarkers
+	 *
+	 * Lets the program measure parts of itself.  HWI marks the start and the
+	 * end of numbered regions, and each completed pass through a region adds
+	 * its cycles, instructions and interrupts to the totals of the region.
+	 * A pass counts from the START HWI up to the STOP HWI, so it includes
+	 * START itself.  Regions may nest or overlap.
+	 *
+	 * Interrupts, with A holding the command and B the region, below 64:
+	 *   0 LABEL  names the region with the string at C, one character a
+	 *            word up to a zero word, at most 32 characters
+	 *   1 START  starts a pass, dropping one that was not stopped
+	 *   2 STOP   ends the pass, if one was started
+	 *
+	 *************************************************************************/
+	class BenchmarkMarkers : public HardwareDevice {
+		enum { HARDWARE_ID = 0x4d41524b, MANUFACTURER_ID = 0x44435055, VERSION = 1, MAX_NAME = 32 };
+	public:
+		enum Command { LABEL, START, STOP };
+		enum { MAX_REGIONS = 64 };
+
+		struct Region {
+			std::string name;
+			uint64_t passes;
+			uint64_t cycles;
+			uint64_t minCycles;
+			uint64_t maxCycles;
+			uint64_t instructions;
+			uint64_t interrupts;
+
+			// the pass in progress
+			bool running;
+			uint64_t startCycles;
+			uint64_t startInstructions;
+			uint64_t startInterrupts;
+		};
+	private:
+		std::vector<Region> regions;
+	public:
+		BenchmarkMarkers(Dcpu &cpu);
+
+		virtual void tick();
+		virtual uint16_t interrupt();
+		virtual uint64_t getNextEvent();
+		virtual void reset();
+
+		const Region &getRegion(uint16_t region) const;
+
+		/**
+		 * The regions that were labeled or passed through, as a JSON array.
+		 */
+		void writeJson(std::ostream &out) const;
+	};
+}}
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+
+#ifdef DCPU_MEMORY_STATS
+#include "memory_stats.hpp"
+#endif
+
+namespace dcpu { namespace emulator {
+	class MemoryAccessStats;
+
+	/*************************************************************************
+	 *
+	 * MemoryWatcher
+	 *
+	 * Notified before a write lands on a page flagged with PAGE_WATCHED.
+	 *
+	 *************************************************************************/
+	class MemoryWatcher {
+	public:
+		virtual ~MemoryWatcher() {}
+
+		virtual void watchedWrite(uint16_t address, uint16_t oldValue, uint16_t value) = 0;
+	};
+
+	/*************************************************************************
+	 *
+	 * MemoryMappedDevice
+	 *
+	 * Answers reads of the pages mapped to it, and is told of each write
+	 * before it lands, so it can act on the write at once rather than look
+	 * for changes on every tick.  The words of the page still hold what was
+	 * written.
+	 *
+	 *************************************************************************/
+	class MemoryMappedDevice {
+	public:
+		virtual ~MemoryMappedDevice() {}
+
+		/**
+		 * The value read at the address, where the page holds stored.
+		 */
+		virtual uint16_t mappedRead(uint16_t address, uint16_t stored) = 0;
+		virtual void mappedWrite(uint16_t address, uint16_t oldValue, uint16_t value) = 0;
+	};
+
+	/*************************************************************************
+	 *
+	 * MemoryImage
+	 *
+	 * The contents of all of memory, immutable once made, so that any number
+	 * of DcpuMemory instances can map one image and share its pages until
+	 * they write to them.
+	 *
+	 *************************************************************************/
+	class MemoryImage {
+	public:
+		enum { TOTAL_WORDS = 65536 };
+	private:
+		uint16_t words[TOTAL_WORDS];
+	public:
+		/**
+		 * The given words followed by zeros.
+		 */
+		MemoryImage(const uint16_t *words=nullptr, size_t count=0);
+
+		const uint16_t *getWords() const {
+			return words;
+		}
+
+		/**
+		 * Reads a program of big endian words.
+		 */
+		static std::shared_ptr<const MemoryImage> load(const std::string &filename);
+
+		/**
+		 * All zeros, shared by every memory that is cleared.
+		 */
+		static std::shared_ptr<const MemoryImage> empty();
+	};
+
+	/*************************************************************************
+	 *
+	 * DcpuMemory
+	 *
+	 * All instruction fetches, operand accesses, stack operations and device
+	 * transfers go through read(), write() and fetch().  operator[] gives raw
+	 * access for loading, dumping and tests, and is never instrumented.
+	 *
+	 * Every page carries a flag byte, and writes only leave the fast path
+	 * when the flags of the target page are set.  PAGE_CLEAN is cleared by
+	 * the first write to a page after markClean(), so dirty tracking costs
+	 * one slow write per page rather than one per store.
+	 *
+	 * Memory is a table of pages that start out pointing into a shared
+	 * MemoryImage.  A hidden shared flag sends the first write to such a page down the
+	 * same slow path, which gives the page a private copy, so an instance
+	 * costs the pages it wrote.  The non-const operator[] copies the page
+	 * too, since the caller may write through it; peek() does not.
+	 *
+	 * Pages mapped to a MemoryMappedDevice carry a hidden flag too, which
+	 * takes their writes to the device.  Reads only test whether a device
+	 * table exists, and there is none while no page is mapped, so memory
+	 * nothing maps is as fast as before.  Instruction fetches and raw access
+	 * see the words of the page.
+	 *
+	 *************************************************************************/
+	class DcpuMemory {
+	public:
+		enum { TOTAL_WORDS = 65536, PAGE_SHIFT = 8, PAGE_SIZE = 1 << PAGE_SHIFT,
+			TOTAL_PAGES = TOTAL_WORDS >> PAGE_SHIFT };
+		enum PageFlags : uint8_t { PAGE_WATCHED = 1 << 0, PAGE_CLEAN = 1 << 1, PAGE_JOURNALED = 1 << 2 };
+		typedef std::vector<std::pair<uint16_t, uint16_t>> Journal;
+	private:
+		// kept with the other flags so that the write fast path tests one byte, but hidden from callers
+		enum : uint8_t { PAGE_SHARED = 1 << 7, PAGE_MAPPED = 1 << 6, HIDDEN_FLAGS = PAGE_SHARED | PAGE_MAPPED };
+
+		// the words of each page, in the image or in privatePages
+		uint16_t *pages[TOTAL_PAGES];
+		std::unique_ptr<uint16_t[]> privatePages[TOTAL_PAGES];
+		std::shared_ptr<const MemoryImage> image;
+		uint8_t pageFlags[TOTAL_PAGES];
+		uint64_t writeCount;
+		uint16_t lastWriteAddress;
+		Journal *journal;
+		// the device of each page, only while any page is mapped
+		std::unique_ptr<MemoryMappedDevice*[]> devices;
+		uint32_t mappedPageCount;
+
+		void flaggedWrite(uint16_t address, uint16_t value);
+		uint16_t mappedRead(uint16_t address);
+		void unshare(uint16_t page);
+	public:
+		MemoryWatcher *watcher;
+#ifdef DCPU_MEMORY_STATS
+		MemoryAccessStats *stats;
+#endif
+
+		DcpuMemory();
+
+		uint16_t read(uint16_t address) {
+#ifdef DCPU_MEMORY_STATS
+			if (stats) {
+				stats->recordRead(address);
+			}
+#endif
+			if (devices && devices[address >> PAGE_SHIFT]) {
+				return mappedRead(address);
+			}
+			return pages[address >> PAGE_SHIFT][address & (PAGE_SIZE - 1)];
+		}
+
+		void write(uint16_t address, uint16_t value) {
+#ifdef DCPU_MEMORY_STATS
+			if (stats) {
+				stats->recordWrite(address);
+			}
+#endif
+			if (pageFlags[address >> PAGE_SHIFT]) {
+				flaggedWrite(address, value);
+			}
+
+			pages[address >> PAGE_SHIFT][address & (PAGE_SIZE - 1)] = value;
+			lastWriteAddress = address;
+			++writeCount;
+		}
+
+		uint16_t fetch(uint16_t address) {
+#ifdef DCPU_MEMORY_STATS
+			if (stats) {
+				stats->recordFetch(address);
+			}
+#endif
+			return pages[address >> PAGE_SHIFT][address & (PAGE_SIZE - 1)];
+		}
+
+		/**
+		 * Device transfers of whole blocks, which wrap around the end of
+		 * memory.  Pages without flags or a device are copied a page at a
+		 * time, the rest go through read() and write().
+		 */
+		void readBlock(uint16_t address, uint16_t *words, uint32_t count);
+		void writeBlock(uint16_t address, const uint16_t *words, uint32_t count);
+		void fillBlock(uint16_t address, uint16_t value, uint32_t count);
+
+		uint16_t &operator[](uint16_t address) {
+			if (pageFlags[address >> PAGE_SHIFT] & PAGE_SHARED) {
+				unshare(address >> PAGE_SHIFT);
+			}
+			return pages[address >> PAGE_SHIFT][address & (PAGE_SIZE - 1)];
+		}
+
+		const uint16_t &operator[](uint16_t address) const {
+			return pages[address >> PAGE_SHIFT][address & (PAGE_SIZE - 1)];
+		}
+
+		/**
+		 * A raw read that leaves shared pages shared.
+		 */
+		uint16_t peek(uint16_t address) const {
+			return pages[address >> PAGE_SHIFT][address & (PAGE_SIZE - 1)];
+		}
+
+		/**
+		 * The words of a page, valid until the page is written, cleared or
+		 * mapped.
+		 */
+		const uint16_t *getPage(uint16_t page) const {
+			return pages[page];
+		}
+
+		bool isPageShared(uint16_t page) const {
+			return pageFlags[page] & PAGE_SHARED;
+		}
+
+		/**
+		 * The pages written since the image was mapped or restored.
+		 */
+		uint32_t getPrivatePageCount() const;
+
+		uint64_t getWriteCount() const {
+			return writeCount;
+		}
+
+		uint16_t getLastWriteAddress() const {
+			return lastWriteAddress;
+		}
+
+		uint8_t getPageFlags(uint16_t page) const {
+			return pageFlags[page] & ~HIDDEN_FLAGS;
+		}
+
+		void setPageFlags(uint16_t page, uint8_t flags);
+		void clearPageFlags(uint16_t page, uint8_t flags);
+
+		/**
+		 * Maps the count pages from the given one to the device, in place of
+		 * any mapped before, until unmapped.  The device must outlive the
+		 * mapping, which survives loading and clearing memory.
+		 */
+		void mapDevice(uint16_t page, uint32_t count, MemoryMappedDevice *device);
+		void unmapDevice(uint16_t page, uint32_t count);
+
+		/**
+		 * The device the page is mapped to, or nullptr.
+		 */
+		MemoryMappedDevice *getMappedDevice(uint16_t page) const {
+			return devices ? devices[page] : nullptr;
+		}
+
+		bool hasMappedPages() const {
+			return devices != nullptr;
+		}
+
+		/**
+		 * Starts a new dirty tracking interval.  Raw writes through operator[]
+		 * are not tracked.
+		 */
+		void markClean();
+
+		bool isPageDirty(uint16_t page) const {
+			return !(pageFlags[page] & PAGE_CLEAN);
+		}
+
+		/**
+		 * Appends the address and value of every write to the journal until it
+		 * is reset to nullptr.
+		 */
+		void setJournal(Journal *journal);
+
+		Journal *getJournal() const {
+			return journal;
+		}
+
+		/**
+		 * Shares every page of the image, dropping private copies.  Other
+		 * page flags are kept.
+		 */
+		void map(std::shared_ptr<const MemoryImage> image);
+
+		/**
+		 * Shares the image's pages again wherever they were written, which
+		 * costs a pass over the page flags and nothing for the pages never
+		 * written.  The private copies are kept to be reused.
+		 */
+		void restore();
+
+		/**
+		 * Uses the words, which must outlive the attachment, as the memory
+		 * itself, without copying them.  Nothing is shared, and restore()
+		 * does nothing until an image is mapped again.
+		 */
+		void attach(uint16_t *words);
+
+		/**
+		 * Maps the empty image.
+		 */
+		void clear();
+	};
+}}
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cmath>
+#include <boost/format.hpp>
+
+#include "dcpu.hpp"
+#include "memory_stats.hpp"
+
+using namespace std;
+using boost::format;
+
+namespace dcpu { namespace emulator {
+	MemoryAccessStats::MemoryAccessStats(Dcpu &cpu, uint64_t windowCycles) : cpu(cpu),
+			windowCycles(windowCycles ? windowCycles : DEFAULT_WINDOW_CYCLES), firstWindowStart(0), windowEnd(0),
+			windowIndex(0), windowTouched(0), reads(DcpuMemory::TOTAL_WORDS), writes(DcpuMemory::TOTAL_WORDS),
+			fetches(DcpuMemory::TOTAL_WORDS), lastWindow(DcpuMemory::TOTAL_WORDS), workingSets() {
+		firstWindowStart = cpu.getCycles() / this->windowCycles * this->windowCycles;
+		windowEnd = firstWindowStart + this->windowCycles;
+	}
+
+	void MemoryAccessStats::touch(uint16_t address) {
+		while (cpu.getCycles() >= windowEnd) {
+			closeWindow();
+		}
+
+		// lastWindow holds the window index plus one so that zero means the word was never touched
+		if (lastWindow[address] != windowIndex + 1) {
+			lastWindow[address] = windowIndex + 1;
+			++windowTouched;
+		}
+	}
+
+	void MemoryAccessStats::closeWindow() {
+		workingSets.push_back(windowTouched);
+
+		++windowIndex;
+		windowTouched = 0;
+		windowEnd += windowCycles;
+	}
+
+	void MemoryAccessStats::recordRead(uint16_t address) {
+		++reads[address];
+		touch(address);
+	}
+
+	void MemoryAccessStats::recordWrite(uint16_t address) {
+		++writes[address];
+		touch(address);
+	}
+
+	void MemoryAccessStats::recordFetch(uint16_t address) {
+		++fetches[address];
+		touch(address);
+	}
+
+	void MemoryAccessStats::finish() {
+		while (cpu.getCycles() >= windowEnd) {
+			closeWindow();
+		}
+
+		if (windowTouched > 0) {
+			closeWindow();
+		}
+	}
+
+	uint64_t MemoryAccessStats::getReads(uint16_t address) const {
+		return reads[address];
+	}
+
+	uint64_t MemoryAccessStats::getWrites(uint16_t address) const {
+		return writes[address];
+	}
+
+	uint64_t MemoryAccessStats::getFetches(uint16_t address) const {
+		return fetches[address];
+	}
+
+	const vector<uint32_t> &MemoryAccessStats::getWorkingSets() const {
+		return workingSets;
+	}
+
+	void MemoryAccessStats::writeHeatmap(ostream &out) const {
+		// one pixel per word, one row per 256 words, with a logarithmic scale so that cold data is still visible
+		// next to the stack and the hot loop counters.
+		uint64_t hottest = 0;
+		for (size_t i = 0; i < DcpuMemory::TOTAL_WORDS; ++i) {
+			hottest = max(hottest, reads[i] + writes[i] + fetches[i]);
+		}
+
+		double scale = hottest ? 255.0 / log1p(hottest) : 0;
+
+		out << "P2\n256 256\n255\n";
+		for (size_t row = 0; row < 256; ++row) {
+			for (size_t column = 0; column < 256; ++column) {
+				size_t address = row * 256 + column;
+				uint64_t accesses = reads[address] + writes[address] + fetches[address];
+
+				out << (column ? " " : "") << (int)lround(log1p(accesses) * scale);
+			}
+			out << "\n";
+		}
+	}
+
+	void MemoryAccessStats::writeReport(ostream &out) const {
+		uint64_t totalReads = 0, totalWrites = 0, totalFetches = 0;
+		uint32_t wordsRead = 0, wordsWritten = 0, wordsFetched = 0, wordsTouched = 0;
+		vector<bool> pagesTouched(DcpuMemory::TOTAL_PAGES), pagesWritten(DcpuMemory::TOTAL_PAGES);
+
+		for (size_t i = 0; i < DcpuMemory::TOTAL_WORDS; ++i) {
+			totalReads += reads[i];
+			totalWrites += writes[i];
+			totalFetches += fetches[i];
+
+			wordsRead += reads[i] > 0;
+			wordsWritten += writes[i] > 0;
+			wordsFetched += fetches[i] > 0;
+
+			if (reads[i] || writes[i] || fetches[i]) {
+				++wordsTouched;
+				pagesTouched[i >> DcpuMemory::PAGE_SHIFT] = true;
+			}
+
+			if (writes[i]) {
+				pagesWritten[i >> DcpuMemory::PAGE_SHIFT] = true;
+			}
+		}
+
+		out << format("Accesses: %d reads, %d writes, %d fetches\n") % totalReads % totalWrites % totalFetches
+			<< format("Words touched: %d (%.2f%%), read: %d, written: %d, fetched: %d\n") % wordsTouched
+				% (100.0 * wordsTouched / DcpuMemory::TOTAL_WORDS) % wordsRead % wordsWritten % wordsFetched
+			<< format("Pages (%d words) touched: %d, written: %d of %d\n") % DcpuMemory::PAGE_SIZE
+				% count(pagesTouched.begin(), pagesTouched.end(), true)
+				% count(pagesWritten.begin(), pagesWritten.end(), true) % DcpuMemory::TOTAL_PAGES;
+
+		vector<uint32_t> hottest;
+		for (size_t i = 0; i < DcpuMemory::TOTAL_WORDS; ++i) {
+			if (reads[i] || writes[i]) {
+				hottest.push_back(i);
+			}
+		}
+
+		size_t shown = min<size_t>(hottest.size(), 16);
+		partial_sort(hottest.begin(), hottest.begin() + shown, hottest.end(), [this] (uint32_t left, uint32_t right) {
+			return reads[left] + writes[left] > reads[right] + writes[right];
+		});
+
+		out << "\nHottest data words:\n"
+			<< format("%-8s %12s %12s\n") % "Address" % "Reads" % "Writes";
+		for (size_t i = 0; i < shown; ++i) {
+			out << format("0x%04x   %12d %12d\n") % hottest[i] % reads[hottest[i]] % writes[hottest[i]];
+		}
+
+		out << format("\nWorking set per %d cycles:\n") % windowCycles
+			<< format("%-8s %14s %8s\n") % "Window" % "Start cycle" % "Words";
+		for (size_t i = 0; i < workingSets.size(); ++i) {
+			out << format("%-8d %14d %8d\n") % i % (firstWindowStart + i * windowCycles) % workingSets[i];
+		}
+	}
+}}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <ostream>
+
+namespace dcpu { namespace emulator {
+	class Dcpu;
+
+	/*************************************************************************
+	 *
+	 * MemoryAccessStats
+	 *
+	 * Counts reads, writes and instruction fetches per memory word and the
+	 * number of distinct words touched in each window of emulated cycles.
+	 * The hooks in DcpuMemory only exist when the emulator is built with
+	 * MEMORY_STATS=1; otherwise this class is only fed by its callers.
+	 *
+	 *************************************************************************/
+	class MemoryAccessStats {
+		Dcpu &cpu;
+		uint64_t windowCycles;
+		uint64_t firstWindowStart;
+		uint64_t windowEnd;
+		uint32_t windowIndex;
+		uint32_t windowTouched;
+
+		std::vector<uint64_t> reads;
+		std::vector<uint64_t> writes;
+		std::vector<uint64_t> fetches;
+		std::vector<uint32_t> lastWindow;
+		std::vector<uint32_t> workingSets;
+
+		void touch(uint16_t address);
+		void closeWindow();
+	public:
+		enum { DEFAULT_WINDOW_CYCLES = 100000 };
+
+		MemoryAccessStats(Dcpu &cpu, uint64_t windowCycles=DEFAULT_WINDOW_CYCLES);
+
+		void recordRead(uint16_t address);
+		void recordWrite(uint16_t address);
+		void recordFetch(uint16_t address);
+		void finish();
+
+		uint64_t getReads(uint16_t address) const;
+		uint64_t getWrites(uint16_t address) const;
+		uint64_t getFetches(uint16_t address) const;
+		const std::vector<uint32_t> &getWorkingSets() const;
+
+		void writeHeatmap(std::ostream &out) const;
+		void writeReport(std::ostream &out) const;
+	};
+}}
@@ -2,6 +2,8 @@
 #include <boost/format.hpp>
 
 #include "opcodes.hpp"
+#include "profiler.hpp"
+#include "timeline.hpp"
 
 using namespace std;
 using boost::format;
@@ -15,6 +17,12 @@ using boost::str;
 
 
 namespace dcpu { namespace emulator {
+    static bool isReturn(const ArgumentPtr &a, const ArgumentPtr &b) {
+        auto target = dynamic_cast<const RegisterArgument*>(b.get());
+
+        return target && target->getRegister() == registers::PC && dynamic_cast<const StackPopArgument*>(a.get());
+    }
+
     OpcodePtr Opcode::parse(Dcpu &cpu, uint16_t instruction) {
         if ((instruction & 0x1f) != 0) {
             return move(parseBasic(cpu, instruction));
@@ -126,6 +134,10 @@ namespace dcpu { namespace emulator {
     uint16_t setOpcode::execute() {
         b->set(a->get());
 
+        if (cpu.profiler && isReturn(a, b)) {
+            cpu.profiler->leaveCall(cpu.registers.sp - 1, cpu.getCycles() + calculateCycles());
+        }
+
         return calculateCycles();
     }
 
@@ -384,6 +396,10 @@ namespace dcpu { namespace emulator {
         cpu.stack.push(cpu.registers.pc);
         cpu.registers.pc = a->get();
 
+        if (cpu.profiler) {
+            cpu.profiler->enterCall(cpu.registers.pc, cpu.registers.sp, cpu.getCycles() + calculateCycles());
+        }
+
         return calculateCycles();
     }
 
@@ -416,6 +432,10 @@ namespace dcpu { namespace emulator {
         cpu.registers.a = cpu.stack.pop();
         cpu.registers.pc = cpu.stack.pop();
 
+        if (cpu.profiler) {
+            cpu.profiler->leaveInterrupt(cpu.getCycles() + calculateCycles());
+        }
+
         return calculateCycles();
     }
 
@@ -442,7 +462,15 @@ namespace dcpu { namespace emulator {
     }
 
     uint16_t hwiOpcode::execute() {
-        uint16_t extraCycles = cpu.hardwareManager.interrupt(a->get());
+        uint16_t index = a->get();
+        uint16_t extraCycles;
+
+        cpu.stats.hardwareInterrupt(index);
+        if (cpu.timeline) {
+            extraCycles = cpu.timeline->hardwareInterrupt(index);
+        } else {
+            extraCycles = cpu.hardwareManager.interrupt(index);
+        }
 
         return calculateCycles() + extraCycles;
     }
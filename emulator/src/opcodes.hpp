@@ -8,7 +8,7 @@
 
 #define DECLARE_BASIC_OPCODE(name, value, cycles, conditional) class name ## Opcode : public Opcode { \
 public: \
-	enum { OPCODE = value }; \
+	enum { OPCODE = value, CYCLES = cycles, CONDITIONAL = conditional }; \
 	name ## Opcode(Dcpu &cpu, ArgumentPtr &a, ArgumentPtr &b) \
 		: Opcode(cpu, a, b, cycles, conditional, #name) {} \
 	virtual uint16_t execute(); \
@@ -16,7 +16,7 @@ public: \
 
 #define DECLARE_SPECIAL_OPCODE(name, value, cycles) class name ## Opcode : public Opcode { \
 public: \
-	enum { OPCODE = value }; \
+	enum { OPCODE = value, CYCLES = cycles }; \
 	name ## Opcode(Dcpu &cpu, ArgumentPtr &a) : Opcode(cpu, a, cycles, false, #name) {} \
 	virtual uint16_t execute(); \
 };
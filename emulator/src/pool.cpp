@@ -0,0 +1,67 @@
+#include "pool.hpp"
+
+using namespace std;
+
+namespace dcpu { namespace emulator {
+	DcpuPool::DcpuPool(shared_ptr<const MemoryImage> image, Setup setup, size_t prepared) : image(image),
+			setup(setup), mutex(), available(), created(0) {
+
+		for (; created < prepared; created++) {
+			available.push_back(create());
+		}
+	}
+
+	unique_ptr<Dcpu> DcpuPool::create() {
+		unique_ptr<Dcpu> cpu(new Dcpu());
+		cpu->load(image);
+		if (setup) {
+			setup(*cpu);
+		}
+
+		return cpu;
+	}
+
+	unique_ptr<Dcpu> DcpuPool::acquire() {
+		{
+			lock_guard<std::mutex> lock(mutex);
+			if (!available.empty()) {
+				unique_ptr<Dcpu> cpu = move(available.back());
+				available.pop_back();
+				return cpu;
+			}
+			created++;
+		}
+
+		// the setup may be slow, so other threads are not held up
+		return create();
+	}
+
+	void DcpuPool::release(unique_ptr<Dcpu> cpu) {
+		cpu->profiler = nullptr;
+		cpu->tracer = nullptr;
+		cpu->timeline = nullptr;
+		cpu->coverage = nullptr;
+		cpu->hostProfiler = nullptr;
+		cpu->idle = nullptr;
+		cpu->hardwareManager.input = nullptr;
+		cpu->memory.watcher = nullptr;
+		cpu->memory.setJournal(nullptr);
+#ifdef DCPU_MEMORY_STATS
+		cpu->memory.stats = nullptr;
+#endif
+		cpu->reset();
+
+		lock_guard<std::mutex> lock(mutex);
+		available.push_back(move(cpu));
+	}
+
+	size_t DcpuPool::getAvailableCount() {
+		lock_guard<std::mutex> lock(mutex);
+		return available.size();
+	}
+
+	size_t DcpuPool::getCreatedCount() {
+		lock_guard<std::mutex> lock(mutex);
+		return created;
+	}
+}}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <functional>
+
+#include "dcpu.hpp"
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * DcpuPool
+	 *
+	 * Hands out instances that run one image, for workloads that run many
+	 * short jobs.  A new instance maps the image and has the setup function
+	 * register its devices once.  Released instances are reset, which
+	 * shares the written pages of the image again and resets the devices,
+	 * and are handed out again.  Safe to use from several threads; the
+	 * reset runs on the releasing thread.
+	 *
+	 *************************************************************************/
+	class DcpuPool {
+	public:
+		typedef std::function<void (Dcpu &cpu)> Setup;
+	private:
+		DcpuPool(DcpuPool const&) = delete;
+		DcpuPool& operator =(DcpuPool const&) = delete;
+
+		std::shared_ptr<const MemoryImage> image;
+		Setup setup;
+		std::mutex mutex;
+		std::vector<std::unique_ptr<Dcpu>> available;
+		size_t created;
+
+		std::unique_ptr<Dcpu> create();
+	public:
+		/**
+		 * Makes the given number of instances up front.
+		 */
+		DcpuPool(std::shared_ptr<const MemoryImage> image, Setup setup=Setup(), size_t prepared=0);
+
+		/**
+		 * An instance in the state just after the image was loaded.
+		 */
+		std::unique_ptr<Dcpu> acquire();
+
+		/**
+		 * Takes back an instance acquired from this pool.  Its hooks are
+		 * cleared.
+		 */
+		void release(std::unique_ptr<Dcpu> cpu);
+
+		size_t getAvailableCount();
+		size_t getCreatedCount();
+	};
+}}
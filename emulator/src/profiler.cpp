@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <boost/format.hpp>
+
+#include "profiler.hpp"
+
+using namespace std;
+using boost::format;
+using boost::str;
+
+namespace dcpu { namespace emulator {
+	CallProfiler::CallProfiler(Dcpu &cpu) : cpu(cpu), frames(), routines(), foldedStacks(), lastSwitch(0) {
+
+	}
+
+	uint32_t CallProfiler::routineKey(uint16_t routine, bool interrupt) {
+		return (interrupt ? 0x10000 : 0) | routine;
+	}
+
+	string CallProfiler::routineName(uint16_t routine, bool interrupt) {
+		return ::str(format(interrupt ? "irq@0x%04x" : "0x%04x") % routine);
+	}
+
+	void CallProfiler::start(uint16_t entryPoint) {
+		frames.clear();
+		routines.clear();
+		foldedStacks.clear();
+
+		lastSwitch = cpu.getCycles();
+		push(entryPoint, false, 0, lastSwitch);
+	}
+
+	void CallProfiler::charge(uint64_t cycles) {
+		if (!frames.empty()) {
+			Frame &top = frames.back();
+			uint64_t elapsed = cycles - lastSwitch;
+
+			routines[routineKey(top.routine, top.interrupt)].exclusiveCycles += elapsed;
+			foldedStacks[top.path] += elapsed;
+		}
+
+		lastSwitch = cycles;
+	}
+
+	void CallProfiler::push(uint16_t routine, bool interrupt, uint16_t returnSlot, uint64_t cycles) {
+		charge(cycles);
+
+		string name = routineName(routine, interrupt);
+		string path = frames.empty() ? name : frames.back().path + ";" + name;
+
+		RoutineStats &stats = routines[routineKey(routine, interrupt)];
+		++stats.calls;
+		++stats.active;
+
+		frames.push_back(Frame {routine, interrupt, returnSlot, cycles, path});
+	}
+
+	void CallProfiler::pop(uint64_t cycles) {
+		charge(cycles);
+
+		Frame &top = frames.back();
+		RoutineStats &stats = routines[routineKey(top.routine, top.interrupt)];
+
+		// only the outermost activation of a recursive routine counts towards its inclusive time
+		if (--stats.active == 0) {
+			stats.inclusiveCycles += cycles - top.entryCycles;
+		}
+
+		frames.pop_back();
+	}
+
+	void CallProfiler::enterCall(uint16_t routine, uint16_t returnSlot, uint64_t cycles) {
+		push(routine, false, returnSlot, cycles);
+	}
+
+	void CallProfiler::leaveCall(uint16_t returnSlot, uint64_t cycles) {
+		// a return may unwind several frames at once if the callee manipulated the stack directly, but it can
+		// never unwind past an interrupt handler or the root frame.
+		for (size_t i = frames.size(); i > 1; --i) {
+			const Frame &frame = frames[i - 1];
+			if (frame.interrupt) {
+				return;
+			}
+
+			if (frame.returnSlot == returnSlot) {
+				while (frames.size() >= i) {
+					pop(cycles);
+				}
+				return;
+			}
+		}
+	}
+
+	void CallProfiler::enterInterrupt(uint16_t handler, uint64_t cycles) {
+		push(handler, true, 0, cycles);
+	}
+
+	void CallProfiler::leaveInterrupt(uint64_t cycles) {
+		for (size_t i = frames.size(); i > 1; --i) {
+			if (frames[i - 1].interrupt) {
+				while (frames.size() >= i) {
+					pop(cycles);
+				}
+				return;
+			}
+		}
+	}
+
+	void CallProfiler::finish() {
+		uint64_t cycles = cpu.getCycles();
+		while (!frames.empty()) {
+			pop(cycles);
+		}
+	}
+
+	void CallProfiler::writeReport(ostream &out) const {
+		typedef pair<uint32_t, RoutineStats> entry;
+
+		vector<entry> sorted(routines.begin(), routines.end());
+		sort(sorted.begin(), sorted.end(), [] (const entry &left, const entry &right) {
+			return left.second.inclusiveCycles > right.second.inclusiveCycles;
+		});
+
+		uint64_t total = 0;
+		for (auto &routine : sorted) {
+			total += routine.second.exclusiveCycles;
+		}
+
+		out << format("%-12s %10s %14s %7s %14s %7s\n") % "Routine" % "Calls" % "Inclusive" % "%" % "Exclusive" % "%";
+		for (auto &routine : sorted) {
+			const RoutineStats &stats = routine.second;
+			double inclusivePercent = total ? 100.0 * stats.inclusiveCycles / total : 0;
+			double exclusivePercent = total ? 100.0 * stats.exclusiveCycles / total : 0;
+
+			out << format("%-12s %10d %14d %6.2f%% %14d %6.2f%%\n")
+				% routineName(routine.first & 0xffff, routine.first & 0x10000)
+				% stats.calls % stats.inclusiveCycles % inclusivePercent
+				% stats.exclusiveCycles % exclusivePercent;
+		}
+		out << format("Total cycles: %d\n") % total;
+	}
+
+	void CallProfiler::writeFoldedStacks(ostream &out) const {
+		for (auto &stack : foldedStacks) {
+			if (stack.second > 0) {
+				out << stack.first << " " << stack.second << "\n";
+			}
+		}
+	}
+}}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+
+#include "dcpu.hpp"
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * CallProfiler
+	 *
+	 * Maintains a shadow call stack from JSR / SET PC, POP pairs and from
+	 * interrupt entry / RFI, and attributes cycles to the routine on top of
+	 * that stack.  Cycles are only charged when the stack changes, so an
+	 * instruction that neither calls nor returns costs nothing.
+	 *
+	 *************************************************************************/
+	class CallProfiler {
+		struct Frame {
+			uint16_t routine;
+			bool interrupt;
+			uint16_t returnSlot;
+			uint64_t entryCycles;
+			std::string path;
+		};
+
+		struct RoutineStats {
+			uint64_t calls;
+			uint64_t inclusiveCycles;
+			uint64_t exclusiveCycles;
+			uint32_t active;
+		};
+
+		Dcpu &cpu;
+		std::vector<Frame> frames;
+		std::map<uint32_t, RoutineStats> routines;
+		std::map<std::string, uint64_t> foldedStacks;
+		uint64_t lastSwitch;
+
+		static uint32_t routineKey(uint16_t routine, bool interrupt);
+		static std::string routineName(uint16_t routine, bool interrupt);
+
+		void charge(uint64_t cycles);
+		void push(uint16_t routine, bool interrupt, uint16_t returnSlot, uint64_t cycles);
+		void pop(uint64_t cycles);
+	public:
+		CallProfiler(Dcpu &cpu);
+
+		void start(uint16_t entryPoint);
+		void enterCall(uint16_t routine, uint16_t returnSlot, uint64_t cycles);
+		void leaveCall(uint16_t returnSlot, uint64_t cycles);
+		void enterInterrupt(uint16_t handler, uint64_t cycles);
+		void leaveInterrupt(uint64_t cycles);
+		void finish();
+
+		void writeReport(std::ostream &out) const;
+		void writeFoldedStacks(std::ostream &out) const;
+	};
+}}
@@ -0,0 +1,399 @@
+#include <cstring>
+#include <cerrno>
+#include <iterator>
+#include <stdexcept>
+#include <boost/format.hpp>
+
+#include "replay.hpp"
+
+using namespace std;
+using boost::format;
+using boost::str;
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * InputLog
+	 *
+	 *************************************************************************/
+
+	const char InputLog::MAGIC[8] = { 'D', 'C', 'P', 'U', 'I', 'N', 'P', 'T' };
+
+	// FNV-1a over the registers, flags and memory
+	uint64_t InputLog::hashState(Dcpu &cpu) {
+		uint64_t hash = 14695981039346656037ULL;
+		auto add = [&hash](uint16_t value) {
+			hash = (hash ^ (value & 0xff)) * 1099511628211ULL;
+			hash = (hash ^ (value >> 8)) * 1099511628211ULL;
+		};
+
+		for (uint8_t i = 0; i < 12; i++) {
+			add(cpu.registers[static_cast<registers>(i)]);
+		}
+		add(cpu.isOnFire() | cpu.isSkipNext() << 1 | cpu.interrupts.isQueueEnabled() << 2);
+
+		for (uint32_t address = 0; address < DcpuMemory::TOTAL_WORDS; address++) {
+			add(cpu.memory.peek(address));
+		}
+
+		return hash;
+	}
+
+	/*************************************************************************
+	 *
+	 * InputRecorder
+	 *
+	 *************************************************************************/
+
+	InputRecorder::InputRecorder(Dcpu &cpu, const string &filename) : cpu(cpu), filename(filename),
+			out(filename, ios_base::out | ios_base::binary | ios_base::trunc), buffer(), writes(),
+			outerJournal(nullptr), lastCycles(cpu.getCycles()), recordCount(0), tickingDevices(false),
+			finished(false) {
+
+		if (!out) {
+			throw runtime_error(str(format("Failed to open file %s for write: %s") % filename % strerror(errno)));
+		}
+
+		buffer.reserve(BUFFER_SIZE + 256);
+		buffer.insert(buffer.end(), InputLog::MAGIC, InputLog::MAGIC + sizeof(InputLog::MAGIC));
+		uint32_t version = InputLog::VERSION;
+		for (int i = 0; i < 4; i++) {
+			writeByte(version >> (i * 8));
+		}
+
+		cpu.hardwareManager.input = this;
+	}
+
+	InputRecorder::~InputRecorder() {
+		if (cpu.hardwareManager.input == this) {
+			cpu.hardwareManager.input = nullptr;
+		}
+
+		try {
+			flush();
+		} catch (exception &) {
+			// destructors must not throw, and finish() reports write errors
+		}
+	}
+
+	void InputRecorder::writeByte(uint8_t value) {
+		buffer.push_back(value);
+	}
+
+	void InputRecorder::writeWord(uint16_t value) {
+		buffer.push_back(value & 0xff);
+		buffer.push_back(value >> 8);
+	}
+
+	void InputRecorder::writeVarint(uint64_t value) {
+		while (value >= 0x80) {
+			buffer.push_back((value & 0x7f) | 0x80);
+			value >>= 7;
+		}
+		buffer.push_back(value);
+	}
+
+	void InputRecorder::writeWrites(const DcpuMemory::Journal &writes) {
+		writeVarint(writes.size());
+		for (auto &write : writes) {
+			writeWord(write.first);
+			writeWord(write.second);
+		}
+	}
+
+	void InputRecorder::beginRecord(InputLog::RecordType type) {
+		if (buffer.size() >= BUFFER_SIZE) {
+			flush();
+		}
+
+		writeByte(type);
+		writeVarint(cpu.getCycles() - lastCycles);
+		lastCycles = cpu.getCycles();
+		recordCount++;
+	}
+
+	void InputRecorder::flushTickWrites() {
+		if (writes.empty()) {
+			return;
+		}
+
+		if (outerJournal) {
+			outerJournal->insert(outerJournal->end(), writes.begin(), writes.end());
+		}
+
+		beginRecord(InputLog::TICK_WRITES);
+		writeWrites(writes);
+		writes.clear();
+	}
+
+	void InputRecorder::flush() {
+		out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+		buffer.clear();
+
+		if (!out) {
+			throw runtime_error(str(format("Failed to write to %s: %s") % filename % strerror(errno)));
+		}
+	}
+
+	void InputRecorder::finish() {
+		if (finished) {
+			return;
+		}
+
+		beginRecord(InputLog::END);
+		uint64_t hash = InputLog::hashState(cpu);
+		for (int i = 0; i < 4; i++) {
+			writeWord(hash >> (i * 16));
+		}
+
+		finished = true;
+		flush();
+		out.flush();
+	}
+
+	uint64_t InputRecorder::getRecordCount() const {
+		return recordCount;
+	}
+
+	void InputRecorder::tickHardware() {
+		if (cpu.hardwareManager.getCount() == 0) {
+			return;
+		}
+
+		// writes are recorded as they happen so that they stay ordered with interrupts
+		outerJournal = cpu.memory.getJournal();
+		cpu.memory.setJournal(&writes);
+		tickingDevices = true;
+
+		try {
+			cpu.hardwareManager.tickDevices();
+		} catch (...) {
+			tickingDevices = false;
+			cpu.memory.setJournal(outerJournal);
+			throw;
+		}
+
+		tickingDevices = false;
+		cpu.memory.setJournal(outerJournal);
+		flushTickWrites();
+	}
+
+	uint16_t InputRecorder::hardwareInterrupt(uint16_t index) {
+		DcpuMemory::Journal *outer = cpu.memory.getJournal();
+		DcpuMemory::Journal interruptWrites;
+		cpu.memory.setJournal(&interruptWrites);
+
+		uint16_t extraCycles;
+		try {
+			extraCycles = cpu.hardwareManager.interruptDevice(index);
+		} catch (...) {
+			cpu.memory.setJournal(outer);
+			throw;
+		}
+
+		cpu.memory.setJournal(outer);
+		if (outer) {
+			outer->insert(outer->end(), interruptWrites.begin(), interruptWrites.end());
+		}
+
+		beginRecord(InputLog::HARDWARE_INTERRUPT);
+		writeWord(index);
+		writeWord(extraCycles);
+		for (uint8_t i = 0; i < 12; i++) {
+			writeWord(cpu.registers[static_cast<registers>(i)]);
+		}
+		writeByte((cpu.interrupts.queueEnabled ? InputLog::QUEUE_ENABLED : 0)
+				| (cpu.isOnFire() ? InputLog::ON_FIRE : 0));
+
+		queue<uint16_t> queued = cpu.interrupts.queue;
+		writeVarint(queued.size());
+		for (; !queued.empty(); queued.pop()) {
+			writeWord(queued.front());
+		}
+
+		writeWrites(interruptWrites);
+		return extraCycles;
+	}
+
+	// interrupts sent from HWI are part of the state it leaves behind
+	void InputRecorder::interruptSent(uint16_t message) {
+		if (!tickingDevices) {
+			return;
+		}
+
+		flushTickWrites();
+		beginRecord(InputLog::INTERRUPT);
+		writeWord(message);
+	}
+
+	/*************************************************************************
+	 *
+	 * InputReplayer
+	 *
+	 *************************************************************************/
+
+	InputReplayer::InputReplayer(Dcpu &cpu, const string &filename) : cpu(cpu), data(), position(0),
+			nextType(InputLog::END), nextCycles(cpu.getCycles()), finished(false), matched(false) {
+
+		ifstream in(filename, ios_base::in | ios_base::binary);
+		if (!in) {
+			throw runtime_error(str(format("Failed to open the file %s: %s") % filename % strerror(errno)));
+		}
+		data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+
+		if (data.size() < sizeof(InputLog::MAGIC) + 4 || memcmp(data.data(), InputLog::MAGIC, sizeof(InputLog::MAGIC))) {
+			throw runtime_error(str(format("%s is not an input log") % filename));
+		}
+
+		position = sizeof(InputLog::MAGIC);
+		uint32_t version = readWord();
+		version |= static_cast<uint32_t>(readWord()) << 16;
+		if (version != InputLog::VERSION) {
+			throw runtime_error(str(format("%s has unsupported input log version %d") % filename % version));
+		}
+
+		readNext();
+		cpu.hardwareManager.input = this;
+	}
+
+	InputReplayer::~InputReplayer() {
+		if (cpu.hardwareManager.input == this) {
+			cpu.hardwareManager.input = nullptr;
+		}
+	}
+
+	uint8_t InputReplayer::readByte() {
+		if (position >= data.size()) {
+			throw runtime_error("the input log is truncated");
+		}
+
+		return data[position++];
+	}
+
+	uint16_t InputReplayer::readWord() {
+		uint16_t low = readByte();
+		return low | readByte() << 8;
+	}
+
+	uint64_t InputReplayer::readVarint() {
+		uint64_t value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			uint8_t byte = readByte();
+			value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) {
+				break;
+			}
+		}
+
+		return value;
+	}
+
+	void InputReplayer::readWrites() {
+		for (uint64_t count = readVarint(); count > 0; count--) {
+			uint16_t address = readWord();
+			cpu.memory.write(address, readWord());
+		}
+	}
+
+	void InputReplayer::readNext() {
+		if (position >= data.size()) {
+			// the recording stopped without an END record, so the devices take over from here
+			finished = true;
+			return;
+		}
+
+		nextType = static_cast<InputLog::RecordType>(readByte());
+		nextCycles += readVarint();
+	}
+
+	void InputReplayer::checkNotMissed() {
+		if (nextCycles < cpu.getCycles()) {
+			throw runtime_error(str(format("the replay diverged: input logged at cycle %d was still pending at "
+					"cycle %d") % nextCycles % cpu.getCycles()));
+		}
+	}
+
+	bool InputReplayer::isFinished() const {
+		return finished;
+	}
+
+	bool InputReplayer::isMatched() const {
+		return matched;
+	}
+
+	void InputReplayer::tickHardware() {
+		if (finished) {
+			cpu.hardwareManager.tickDevices();
+			return;
+		}
+
+		checkNotMissed();
+		while (!finished && nextCycles == cpu.getCycles()) {
+			switch (nextType) {
+			case InputLog::INTERRUPT:
+				cpu.interrupts.send(readWord());
+				break;
+			case InputLog::TICK_WRITES:
+				readWrites();
+				break;
+			case InputLog::END: {
+				uint64_t hash = 0;
+				for (int i = 0; i < 4; i++) {
+					hash |= static_cast<uint64_t>(readWord()) << (i * 16);
+				}
+				matched = hash == InputLog::hashState(cpu);
+				finished = true;
+				return;
+			}
+			case InputLog::HARDWARE_INTERRUPT:
+				// executed by the instruction starting at this cycle
+				return;
+			default:
+				throw runtime_error(str(format("unknown input log record type %d") % (int)nextType));
+			}
+
+			readNext();
+		}
+	}
+
+	uint16_t InputReplayer::hardwareInterrupt(uint16_t index) {
+		if (finished) {
+			return cpu.hardwareManager.interruptDevice(index);
+		}
+
+		checkNotMissed();
+		if (nextType != InputLog::HARDWARE_INTERRUPT || nextCycles != cpu.getCycles() || readWord() != index) {
+			throw runtime_error(str(format("the replay diverged: HWI %d at cycle %d is not in the input log")
+					% index % cpu.getCycles()));
+		}
+
+		uint16_t extraCycles = readWord();
+		uint16_t values[12];
+		for (uint8_t i = 0; i < 12; i++) {
+			values[i] = readWord();
+		}
+		uint8_t flags = readByte();
+
+		queue<uint16_t> queued;
+		for (uint64_t count = readVarint(); count > 0; count--) {
+			queued.push(readWord());
+		}
+
+		readWrites();
+		for (uint8_t i = 0; i < 12; i++) {
+			cpu.registers[static_cast<registers>(i)] = values[i];
+		}
+		cpu.interrupts.queueEnabled = flags & InputLog::QUEUE_ENABLED;
+		cpu.interrupts.queue = queued;
+		if (flags & InputLog::ON_FIRE) {
+			cpu.catchFire();
+		}
+
+		readNext();
+		return extraCycles;
+	}
+
+	void InputReplayer::interruptSent(uint16_t) {
+		// replayed interrupts come from the log
+	}
+}}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "dcpu.hpp"
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * ExternalInput
+	 *
+	 * Sits between the cpu and its devices, which are the only source of
+	 * non-determinism: everything they do reaches the cpu through a tick,
+	 * a hardware interrupt or an interrupt they send.
+	 *
+	 *************************************************************************/
+	class ExternalInput {
+	public:
+		virtual ~ExternalInput() {}
+
+		virtual void tickHardware() = 0;
+		virtual uint16_t hardwareInterrupt(uint16_t index) = 0;
+		virtual void interruptSent(uint16_t message) = 0;
+	};
+
+	/*************************************************************************
+	 *
+	 * InputLog
+	 *
+	 * The file starts with an 8 byte magic and a 32-bit version, followed by
+	 * records of a type byte, the cycles since the previous record as a
+	 * LEB128 varint, and a payload:
+	 *
+	 *   INTERRUPT           message
+	 *   TICK_WRITES         count, then count address and value pairs
+	 *   HARDWARE_INTERRUPT  device index, extra cycles, the 12 registers, a
+	 *                       flags byte, the queued interrupts and the writes
+	 *   END                 a hash of the registers and memory
+	 *
+	 * Words are little endian and counts are varints.
+	 *
+	 *************************************************************************/
+	struct InputLog {
+		enum { VERSION = 1 };
+		enum RecordType : uint8_t { INTERRUPT = 1, TICK_WRITES = 2, HARDWARE_INTERRUPT = 3, END = 4 };
+		enum Flags : uint8_t { QUEUE_ENABLED = 1 << 0, ON_FIRE = 1 << 1 };
+
+		static const char MAGIC[8];
+
+		static uint64_t hashState(Dcpu &cpu);
+	};
+
+	/*************************************************************************
+	 *
+	 * InputRecorder
+	 *
+	 * Appends everything the devices do to an input log.  Records are
+	 * buffered and written in blocks.
+	 *
+	 *************************************************************************/
+	class InputRecorder : public ExternalInput {
+		InputRecorder(InputRecorder const&) = delete;
+		InputRecorder& operator =(InputRecorder const&) = delete;
+
+		enum { BUFFER_SIZE = 64 * 1024 };
+
+		Dcpu &cpu;
+		std::string filename;
+		std::ofstream out;
+		std::vector<uint8_t> buffer;
+		DcpuMemory::Journal writes;
+		DcpuMemory::Journal *outerJournal;
+		uint64_t lastCycles;
+		uint64_t recordCount;
+		bool tickingDevices;
+		bool finished;
+
+		void writeByte(uint8_t value);
+		void writeWord(uint16_t value);
+		void writeVarint(uint64_t value);
+		void writeWrites(const DcpuMemory::Journal &writes);
+		void beginRecord(InputLog::RecordType type);
+		void flushTickWrites();
+		void flush();
+	public:
+		/**
+		 * Attaches to the cpu's hardware manager until destroyed.
+		 */
+		InputRecorder(Dcpu &cpu, const std::string &filename);
+		~InputRecorder();
+
+		/**
+		 * Ends the log with a hash of the current state, which replay checks.
+		 */
+		void finish();
+		uint64_t getRecordCount() const;
+
+		virtual void tickHardware();
+		virtual uint16_t hardwareInterrupt(uint16_t index);
+		virtual void interruptSent(uint16_t message);
+	};
+
+	/*************************************************************************
+	 *
+	 * InputReplayer
+	 *
+	 * Feeds an input log back in place of the devices, which are neither
+	 * ticked nor called until the log runs out.  Throws runtime_error when
+	 * the cpu asks for input the log does not hold at that cycle.
+	 *
+	 *************************************************************************/
+	class InputReplayer : public ExternalInput {
+		InputReplayer(InputReplayer const&) = delete;
+		InputReplayer& operator =(InputReplayer const&) = delete;
+
+		Dcpu &cpu;
+		std::vector<uint8_t> data;
+		size_t position;
+		InputLog::RecordType nextType;
+		uint64_t nextCycles;
+		bool finished;
+		bool matched;
+
+		uint8_t readByte();
+		uint16_t readWord();
+		uint64_t readVarint();
+		void readWrites();
+		void readNext();
+		void checkNotMissed();
+	public:
+		InputReplayer(Dcpu &cpu, const std::string &filename);
+		~InputReplayer();
+
+		/**
+		 * True once the end of the log has been reached.
+		 */
+		bool isFinished() const;
+
+		/**
+		 * True when the log ended with a state hash and the replayed state
+		 * matched it.
+		 */
+		bool isMatched() const;
+
+		virtual void tickHardware();
+		virtual uint16_t hardwareInterrupt(uint16_t index);
+		virtual void interruptSent(uint16_t message);
+	};
+}}
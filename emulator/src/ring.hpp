@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * RingIndexes
+	 *
+	 * The two counters of a ring with one writer and one reader, on any two
+	 * threads or processes.  Each side only advances its own counter, so
+	 * neither takes a lock, and the counters sit 64 bytes apart so they never
+	 * share a cache line.  The slots are kept by the user, at the counters
+	 * taken modulo their number, and the whole may live in a mapped file.
+	 *
+	 *************************************************************************/
+	struct RingIndexes {
+		// the items written and read so far
+		std::atomic<uint64_t> head;
+		char headPadding[64 - sizeof(std::atomic<uint64_t>)];
+		std::atomic<uint64_t> tail;
+		char tailPadding[64 - sizeof(std::atomic<uint64_t>)];
+
+		RingIndexes() : head(0), headPadding(), tail(0), tailPadding() {}
+
+		/**
+		 * Called by the writer only.  Items are written to the slots from
+		 * getHead(), and handed over once published.
+		 */
+		uint64_t getHead() const {
+			return head.load(std::memory_order_relaxed);
+		}
+
+		size_t getFree(size_t slots) const {
+			return slots - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+		}
+
+		void publish(uint64_t count) {
+			head.store(head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+		}
+
+		/**
+		 * Called by the reader only.  Items are read from the slots from
+		 * getTail(), and their slots handed back once consumed.
+		 */
+		uint64_t getTail() const {
+			return tail.load(std::memory_order_relaxed);
+		}
+
+		size_t getUsed() const {
+			return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+		}
+
+		void consume(uint64_t count) {
+			tail.store(tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+		}
+	};
+}}
@@ -0,0 +1,416 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <functional>
+#include <memory>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+
+#include "dcpu.hpp"
+#include "profiler.hpp"
+#include "memory_stats.hpp"
+#include "trace.hpp"
+#include "debugger.hpp"
+#include "timeline.hpp"
+#include "replay.hpp"
+#include "coverage.hpp"
+#include "stats.hpp"
+#include "host_profile.hpp"
+#include "idle.hpp"
+#include "shared_state.hpp"
+#include "link.hpp"
+#include "dma.hpp"
+#include "coprocessor.hpp"
+#include "markers.hpp"
+#include "console.hpp"
+
+using namespace std;
+using namespace dcpu::emulator;
+
+namespace po = boost::program_options;
+
+void write_output(const string &filename, function<void (ostream&)> writer) {
+	if (filename == "-") {
+		writer(cout);
+		return;
+	}
+
+	ofstream out(filename, ios_base::out);
+	if (!out) {
+		throw runtime_error(str(boost::format("Failed to open file %s for write: %s") % filename % strerror(errno)));
+	}
+
+	writer(out);
+}
+
+void usage(const char *program_name, const po::options_description &visible_options) {
+	cout << "Usage: " << program_name << " [OPTIONS] <program>" << endl;
+	cout << "       " << program_name << " [OPTIONS] --state <file>" << endl;
+	cout << visible_options << endl;
+}
+
+int main(int argc, char **argv) {
+	uint64_t max_cycles;
+	uint64_t working_set_window;
+	uint64_t trace_records;
+	uint64_t snapshot_interval;
+	uint64_t link_latency;
+	uint32_t dma_words_per_cycle;
+	uint32_t dma_setup_cycles;
+	size_t snapshot_budget;
+	bool dump;
+	bool debug;
+	bool no_idle_skip;
+	bool dma;
+	bool coprocessor;
+	string input_file;
+	string profile_file;
+	string folded_file;
+	string memory_report_file;
+	string heatmap_file;
+	string trace_file;
+	string record_file;
+	string replay_file;
+	string coverage_file;
+	string stats_file;
+	string stats_socket;
+	string host_profile_file;
+	string state_file;
+	string link_files;
+	string markers_file;
+	string console_file;
+	string console_input_file;
+
+	po::options_description visible_options("OPTIONS");
+	visible_options.add_options()
+		("help,h", "Displays this information")
+		("max-cycles,n", po::value<uint64_t>(&max_cycles)->default_value(0),
+				"Stop after the given number of cycles.  Zero runs until the DCPU catches fire.")
+		("dump", po::bool_switch(&dump), "Dump registers and memory when execution stops")
+		("debug", po::bool_switch(&debug), "Control execution from an interactive debugger console on stdin")
+		("no-idle-skip", po::bool_switch(&no_idle_skip),
+				"Emulate every iteration of loops that wait for a device instead of skipping to its next event.")
+		("profile", po::value<string>(&profile_file),
+				"Write inclusive/exclusive cycles per routine to the file.  Use - for stdout.")
+		("folded-stacks", po::value<string>(&folded_file),
+				"Write the call profile as folded stacks for flamegraph tools.  Use - for stdout.")
+		("memory-report", po::value<string>(&memory_report_file),
+				"Write memory access counts and the working set per window to the file.  Use - for stdout.")
+		("memory-heatmap", po::value<string>(&heatmap_file),
+				"Write a 256x256 PGM image with one pixel per memory word.  Use - for stdout.")
+		("working-set-window", po::value<uint64_t>(&working_set_window)->default_value(
+				MemoryAccessStats::DEFAULT_WINDOW_CYCLES), "The number of cycles in each working set window.")
+		("trace", po::value<string>(&trace_file),
+				"Record every instruction into a memory mapped ring buffer.  Decode it with dcpu-trace.")
+		("trace-records", po::value<uint64_t>(&trace_records)->default_value(1000000),
+				"The number of instructions the trace ring buffer holds.")
+		("record", po::value<string>(&record_file),
+				"Log every interrupt, HWI result and memory write from devices to the file.")
+		("replay", po::value<string>(&replay_file),
+				"Feed a log written by --record back in place of the devices, and check that the run reproduces.")
+		("coverage", po::value<string>(&coverage_file),
+				"Write a bitmap of the words instructions started at, for the disassembler's --coverage.")
+		("host-profile", po::value<string>(&host_profile_file),
+				"Write the host time the emulator spends on each opcode and operand mode combination.  "
+				"Use - for stdout.")
+		("stats", po::value<string>(&stats_file),
+				"Write the execution counters as JSON when execution stops.  Use - for stdout.")
+		("stats-socket", po::value<string>(&stats_socket),
+				"Answer each connection to this unix domain socket with the execution counters as JSON.")
+		("state", po::value<string>(&state_file),
+				"Keep the machine state in this shared file, such as one under /dev/shm, for dcpu-state to "
+				"inspect.  If it holds a state, execution resumes from it and the program is optional.")
+		("link", po::value<string>(&link_files),
+				"Attach a link device that sends into the first file and receives from the second, given as "
+				"<outgoing>:<incoming>.  Another dcpu-run given the files the other way round is the other end.")
+		("link-latency", po::value<uint64_t>(&link_latency)->default_value(LinkDevice::DEFAULT_LATENCY),
+				"The cycles a message takes over the link.")
+		("dma", po::bool_switch(&dma), "Attach a DMA controller that copies and fills blocks of memory")
+		("dma-words-per-cycle", po::value<uint32_t>(&dma_words_per_cycle)->default_value(
+				DmaDevice::DEFAULT_WORDS_PER_CYCLE), "The words the DMA controller moves each cycle.")
+		("dma-setup-cycles", po::value<uint32_t>(&dma_setup_cycles)->default_value(
+				DmaDevice::DEFAULT_SETUP_CYCLES), "The cycles the HWI that starts a DMA transfer takes on top of its own.")
+		("coprocessor", po::bool_switch(&coprocessor),
+				"Attach a math coprocessor for vectors of 32 bit integer, fixed point and float operations")
+		("markers", po::value<string>(&markers_file),
+				"Attach a device the program marks regions to measure with, and write their cycles, instructions "
+				"and interrupts as JSON to the file when execution stops.  Use - for stdout.")
+		("console", po::value<string>(&console_file),
+				"Attach a serial console that writes what the program prints to the file.  Use - for stdout.")
+		("console-input", po::value<string>(&console_input_file),
+				"Read the console's input from the file, such as a fifo.  Use - for stdin.")
+		("snapshot-interval", po::value<uint64_t>(&snapshot_interval)->default_value(
+				Timeline::DEFAULT_INTERVAL_CYCLES), "The number of cycles between the snapshots that let the "
+				"debugger step back.  Zero disables reverse execution.")
+		("snapshot-budget", po::value<size_t>(&snapshot_budget)->default_value(
+				Timeline::DEFAULT_BUDGET_BYTES >> 20), "The MiB of memory kept for snapshots and device input.");
+
+	po::options_description hidden_options("Hidden options");
+	hidden_options.add_options()
+		("input-file", po::value<string>(&input_file), "the program to run");
+
+	po::options_description cmdline_options;
+	cmdline_options.add(visible_options).add(hidden_options);
+
+	po::positional_options_description positional_args;
+	positional_args.add("input-file", -1);
+
+	try {
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).
+				options(cmdline_options).positional(positional_args).run(), vm);
+		po::notify(vm);
+
+		if (vm.count("help")) {
+			usage(argv[0], visible_options);
+			return 0;
+		}
+
+		// the debugger's steps, and its steps back, are never published
+		if (debug && state_file.length()) {
+			throw runtime_error("--state cannot be combined with --debug");
+		}
+
+		unique_ptr<StateSegment> state;
+		if (state_file.length() && StateSegment::exists(state_file)) {
+			state = StateSegment::open(state_file);
+			if (state->get().status == MachineState::EMPTY) {
+				state.reset();
+			}
+		}
+
+		if (input_file.length() == 0 && !state) {
+			cerr << "Missing required program argument" << endl << endl;
+			usage(argv[0], visible_options);
+			return 1;
+		}
+
+		Dcpu cpu;
+		if (state) {
+			state->resume(cpu);
+		} else {
+			cpu.load(input_file.c_str());
+			if (state_file.length()) {
+				state = StateSegment::create(state_file);
+				state->attach(cpu);
+			}
+		}
+
+		if (link_files.length()) {
+			string::size_type separator = link_files.find(':');
+			if (separator == string::npos) {
+				throw runtime_error("--link takes <outgoing>:<incoming>");
+			}
+
+			cpu.hardwareManager.registerDevice(make_shared<LinkDevice>(cpu,
+					LinkChannel::map(link_files.substr(0, separator)),
+					LinkChannel::map(link_files.substr(separator + 1)), link_latency));
+		}
+
+		if (dma) {
+			cpu.hardwareManager.registerDevice(make_shared<DmaDevice>(cpu, dma_words_per_cycle, dma_setup_cycles));
+		}
+
+		if (coprocessor) {
+			cpu.hardwareManager.registerDevice(make_shared<MathCoprocessor>(cpu));
+		}
+
+		if (console_input_file.length() && !console_file.length()) {
+			throw runtime_error("--console-input needs --console");
+		}
+
+		shared_ptr<SerialConsole> console;
+		if (console_file.length()) {
+			if (debug && console_input_file == "-") {
+				throw runtime_error("the console cannot read stdin while the debugger does");
+			}
+
+			int output = console_file == "-" ? STDOUT_FILENO
+					: open(console_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			int input = console_input_file == "-" ? STDIN_FILENO
+					: console_input_file.length() ? open(console_input_file.c_str(), O_RDONLY) : -1;
+			if (output < 0 || (console_input_file.length() && input < 0)) {
+				throw runtime_error(str(boost::format("Failed to open the console: %s") % strerror(errno)));
+			}
+
+			console = make_shared<SerialConsole>(cpu, output, input);
+			cpu.hardwareManager.registerDevice(console);
+		}
+
+		shared_ptr<BenchmarkMarkers> markers;
+		if (markers_file.length()) {
+			markers = make_shared<BenchmarkMarkers>(cpu);
+			cpu.hardwareManager.registerDevice(markers);
+		}
+
+		CallProfiler profiler(cpu);
+		if (profile_file.length() || folded_file.length()) {
+			cpu.profiler = &profiler;
+			profiler.start(cpu.registers.pc);
+		}
+
+		MemoryAccessStats memoryStats(cpu, working_set_window);
+		if (memory_report_file.length() || heatmap_file.length()) {
+#ifdef DCPU_MEMORY_STATS
+			cpu.memory.stats = &memoryStats;
+#else
+			throw runtime_error("memory access statistics are not available; rebuild with MEMORY_STATS=1");
+#endif
+		}
+
+		if (record_file.length() && replay_file.length()) {
+			throw runtime_error("--record and --replay cannot be combined");
+		}
+
+		unique_ptr<InputRecorder> recorder;
+		unique_ptr<InputReplayer> replayer;
+		if (record_file.length()) {
+			recorder.reset(new InputRecorder(cpu, record_file));
+		} else if (replay_file.length()) {
+			replayer.reset(new InputReplayer(cpu, replay_file));
+		}
+
+		unique_ptr<TraceBuffer> traceBuffer;
+		unique_ptr<InstructionTracer> tracer;
+		if (trace_file.length()) {
+			traceBuffer.reset(new TraceBuffer(trace_file, trace_records));
+			tracer.reset(new InstructionTracer(cpu, *traceBuffer));
+			cpu.tracer = tracer.get();
+		}
+
+		ExecutionCoverage coverage;
+		if (coverage_file.length()) {
+			cpu.coverage = &coverage;
+		}
+
+		unique_ptr<HostProfiler> hostProfiler;
+		if (host_profile_file.length()) {
+			hostProfiler.reset(new HostProfiler());
+			cpu.hostProfiler = hostProfiler.get();
+		}
+
+		IdleDetector idle(cpu);
+
+		unique_ptr<StatsServer> statsServer;
+		if (stats_socket.length()) {
+			statsServer.reset(new StatsServer(cpu.stats, stats_socket));
+		}
+
+		try {
+			if (debug) {
+				Debugger debugger(cpu);
+				DebugConsole console(debugger, cpu, cout);
+
+				// replayed instructions would be counted twice by the profiler, tracer and memory statistics
+				bool observed = cpu.profiler || cpu.tracer || cpu.hostProfiler || memory_report_file.length()
+						|| heatmap_file.length();
+				unique_ptr<Timeline> timeline;
+				if (snapshot_interval && !observed) {
+					timeline.reset(new Timeline(cpu, snapshot_interval, snapshot_budget << 20));
+				}
+
+				if (max_cycles) {
+					debugger.stopAtCycle(max_cycles);
+				}
+				console.run(cin);
+			} else {
+				// skipped iterations would be missing from the trace and memory statistics
+				if (!no_idle_skip && !cpu.tracer && !memory_report_file.length() && !heatmap_file.length()) {
+					idle.setLimit(max_cycles ? max_cycles : IdleDetector::NO_LIMIT);
+					cpu.idle = &idle;
+				}
+
+				while (!cpu.isOnFire() && (max_cycles == 0 || cpu.getCycles() < max_cycles)
+						&& !(replayer && replayer->isFinished())) {
+					cpu.tick();
+					cpu.hardwareManager.tickAll();
+					if (state) {
+						state->publish(cpu);
+					}
+				}
+			}
+		} catch (exception &e) {
+			cerr << "Error: " << e.what() << endl;
+		}
+
+		if (state) {
+			state->finish(cpu, cpu.isOnFire() ? MachineState::ON_FIRE : MachineState::STOPPED);
+		}
+
+		if (recorder) {
+			recorder->finish();
+		}
+
+		// ahead of any report written to stdout
+		if (console) {
+			console->finish();
+		}
+
+		if (coverage_file.length()) {
+			coverage.save(coverage_file);
+		}
+
+		if (cpu.profiler) {
+			profiler.finish();
+
+			if (profile_file.length()) {
+				write_output(profile_file, bind(&CallProfiler::writeReport, &profiler, placeholders::_1));
+			}
+
+			if (folded_file.length()) {
+				write_output(folded_file, bind(&CallProfiler::writeFoldedStacks, &profiler, placeholders::_1));
+			}
+		}
+
+		if (memory_report_file.length() || heatmap_file.length()) {
+			memoryStats.finish();
+
+			if (memory_report_file.length()) {
+				write_output(memory_report_file, bind(&MemoryAccessStats::writeReport, &memoryStats,
+						placeholders::_1));
+			}
+
+			if (heatmap_file.length()) {
+				write_output(heatmap_file, bind(&MemoryAccessStats::writeHeatmap, &memoryStats, placeholders::_1));
+			}
+		}
+
+		if (hostProfiler) {
+			hostProfiler->finish();
+			write_output(host_profile_file, bind(&HostProfiler::writeReport, hostProfiler.get(), placeholders::_1));
+		}
+
+		if (markers) {
+			write_output(markers_file, bind(&BenchmarkMarkers::writeJson, markers.get(), placeholders::_1));
+		}
+
+		if (stats_file.length()) {
+			ExecutionStats::Snapshot snapshot = cpu.stats.snapshot();
+			write_output(stats_file, bind(&ExecutionStats::Snapshot::writeJson, &snapshot, placeholders::_1));
+		}
+
+		if (dump) {
+			cpu.dump(cout);
+		}
+
+		if (replayer && replayer->isFinished()) {
+			if (!replayer->isMatched()) {
+				cerr << boost::format("Replay diverged: the state at cycle %d differs from the recording")
+						% cpu.getCycles() << endl;
+				return 1;
+			}
+
+			cerr << boost::format("Replay matched the recording at cycle %d") % cpu.getCycles() << endl;
+		}
+	} catch (exception &e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
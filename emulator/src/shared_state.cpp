@@ -0,0 +1,215 @@
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <queue>
+#include <new>
+#include <stdexcept>
+#include <boost/format.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "shared_state.hpp"
+
+using namespace std;
+using boost::format;
+using boost::str;
+
+namespace dcpu { namespace emulator {
+	static uint64_t realTime() {
+		timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+	}
+
+	StateSegment::StateSegment(const string &path, bool create, bool writable) : path(path), state(nullptr),
+			writable(writable), published(0) {
+
+		int fd = ::open(path.c_str(), create ? O_RDWR | O_CREAT | O_TRUNC : writable ? O_RDWR : O_RDONLY, 0644);
+		if (fd < 0) {
+			throw runtime_error(str(format("Failed to open the state %s: %s") % path % strerror(errno)));
+		}
+
+		struct stat info;
+		if ((create && ftruncate(fd, sizeof(MachineState)) != 0) || fstat(fd, &info) != 0) {
+			string error = strerror(errno);
+			close(fd);
+			throw runtime_error(str(format("Failed to size the state %s: %s") % path % error));
+		}
+
+		if (static_cast<size_t>(info.st_size) < sizeof(MachineState)) {
+			close(fd);
+			throw runtime_error(str(format("%s is not a machine state") % path));
+		}
+
+		void *mapping = mmap(nullptr, sizeof(MachineState), PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED,
+				fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			throw runtime_error(str(format("Failed to map the state %s: %s") % path % strerror(errno)));
+		}
+		state = static_cast<MachineState*>(mapping);
+
+		if (create) {
+			// the new file reads as zeros, which leaves everything but the header in place
+			new (&state->sequence) atomic<uint32_t>(0);
+			state->magic = MachineState::MAGIC;
+			state->version = MachineState::VERSION;
+			state->status = MachineState::EMPTY;
+		} else if (state->magic != MachineState::MAGIC || state->version != MachineState::VERSION) {
+			munmap(state, sizeof(MachineState));
+			throw runtime_error(str(format("%s is not a machine state") % path));
+		}
+	}
+
+	StateSegment::~StateSegment() {
+		munmap(state, sizeof(MachineState));
+	}
+
+	unique_ptr<StateSegment> StateSegment::create(const string &path) {
+		return unique_ptr<StateSegment>(new StateSegment(path, true, true));
+	}
+
+	unique_ptr<StateSegment> StateSegment::open(const string &path, bool writable) {
+		return unique_ptr<StateSegment>(new StateSegment(path, false, writable));
+	}
+
+	bool StateSegment::exists(const string &path) {
+		return access(path.c_str(), F_OK) == 0;
+	}
+
+	void StateSegment::attach(Dcpu &cpu) {
+		for (uint32_t address = 0; address < MachineState::TOTAL_WORDS; address++) {
+			state->memory[address] = cpu.memory.peek(address);
+		}
+		cpu.memory.attach(state->memory);
+
+		state->pid = getpid();
+		state->status = MachineState::RUNNING;
+		state->heartbeat = realTime();
+		publish(cpu);
+	}
+
+	bool StateSegment::isAlive(int32_t pid) {
+		return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+	}
+
+	void StateSegment::resume(Dcpu &cpu) {
+		Snapshot snapshot = read();
+		// two workers would both write the same memory
+		if (snapshot.status == MachineState::RUNNING && isAlive(snapshot.pid)) {
+			throw runtime_error(str(format("%s is still running in process %d") % path % snapshot.pid));
+		}
+
+		cpu.cycles = snapshot.cycles;
+		cpu.onFire = snapshot.onFire;
+		cpu.skipNext = snapshot.skipNext;
+		for (uint8_t i = 0; i < MachineState::REGISTER_COUNT; i++) {
+			cpu.registers[static_cast<registers>(i)] = snapshot.registers[i];
+		}
+
+		cpu.interrupts.clear();
+		cpu.interrupts.queueEnabled = snapshot.queueEnabled;
+		for (uint16_t i = 0; i < snapshot.queueSize && i < MachineState::QUEUE_SIZE; i++) {
+			cpu.interrupts.queue.push(state->queue[i]);
+		}
+
+		cpu.stats.reset();
+		cpu.stats.setCycles(cpu.cycles);
+		cpu.hardwareManager.resetDevices();
+		cpu.memory.attach(state->memory);
+
+		state->pid = getpid();
+		state->status = MachineState::RUNNING;
+		state->heartbeat = realTime();
+	}
+
+	void StateSegment::publish(const Dcpu &cpu) {
+		uint32_t sequence = state->sequence.load(memory_order_relaxed);
+		state->sequence.store(sequence + 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+
+		const DcpuRegisters &registers = cpu.registers;
+		uint16_t *words = state->registers;
+		words[0] = registers.a;
+		words[1] = registers.b;
+		words[2] = registers.c;
+		words[3] = registers.x;
+		words[4] = registers.y;
+		words[5] = registers.z;
+		words[6] = registers.i;
+		words[7] = registers.j;
+		words[8] = registers.sp;
+		words[9] = registers.pc;
+		words[10] = registers.ex;
+		words[11] = registers.ia;
+
+		state->cycles = cpu.cycles;
+		state->onFire = cpu.onFire;
+		state->skipNext = cpu.skipNext;
+		state->queueEnabled = cpu.interrupts.queueEnabled;
+
+		// the queue is almost always empty, and only copied when it is not
+		if (!cpu.interrupts.queue.empty() || state->queueSize) {
+			queue<uint16_t> queued = cpu.interrupts.queue;
+			state->queueSize = queued.size();
+			for (uint16_t i = 0; !queued.empty(); queued.pop()) {
+				state->queue[i++] = queued.front();
+			}
+		}
+
+		if ((++published & 0xfff) == 0) {
+			state->heartbeat = realTime();
+		}
+
+		state->sequence.store(sequence + 2, memory_order_release);
+	}
+
+	void StateSegment::finish(const Dcpu &cpu, MachineState::Status status) {
+		publish(cpu);
+		state->heartbeat = realTime();
+		state->status = status;
+	}
+
+	StateSegment::Snapshot StateSegment::read() const {
+		Snapshot snapshot;
+		uint32_t before, after;
+
+		do {
+			before = state->sequence.load(memory_order_acquire);
+			snapshot.status = state->status;
+			snapshot.pid = state->pid;
+			snapshot.heartbeat = state->heartbeat;
+			snapshot.cycles = state->cycles;
+			memcpy(snapshot.registers, state->registers, sizeof(snapshot.registers));
+			snapshot.onFire = state->onFire;
+			snapshot.skipNext = state->skipNext;
+			snapshot.queueEnabled = state->queueEnabled;
+			snapshot.queueSize = state->queueSize;
+			atomic_thread_fence(memory_order_acquire);
+			after = state->sequence.load(memory_order_relaxed);
+		} while ((before & 1) || before != after);
+
+		return snapshot;
+	}
+
+	void StateSegment::checkpoint(const string &path) const {
+		unique_ptr<StateSegment> copy = create(path);
+		MachineState &target = copy->get();
+
+		Snapshot snapshot = read();
+		memcpy(target.memory, state->memory, sizeof(target.memory));
+		memcpy(target.queue, state->queue, sizeof(target.queue));
+		memcpy(target.registers, snapshot.registers, sizeof(target.registers));
+		target.cycles = snapshot.cycles;
+		target.heartbeat = snapshot.heartbeat;
+		target.onFire = snapshot.onFire;
+		target.skipNext = snapshot.skipNext;
+		target.queueEnabled = snapshot.queueEnabled;
+		target.queueSize = snapshot.queueSize;
+		target.status = snapshot.status == MachineState::ON_FIRE ? MachineState::ON_FIRE : MachineState::STOPPED;
+	}
+}}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <atomic>
+
+#include "dcpu.hpp"
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * MachineState
+	 *
+	 * The whole state of a cpu in one standard layout struct, to be mapped
+	 * from a file that several processes share.  Memory is the live memory
+	 * of the worker attached to it.  The rest is published by the worker
+	 * after every instruction under a sequence lock, so readers in other
+	 * processes copy it without locking.
+	 *
+	 *************************************************************************/
+	struct MachineState {
+		enum : uint32_t { MAGIC = 0x53555043, VERSION = 1 };
+		enum Status : uint32_t { EMPTY, RUNNING, STOPPED, ON_FIRE };
+		enum { REGISTER_COUNT = 12, QUEUE_SIZE = 256, TOTAL_WORDS = 65536 };
+
+		uint32_t magic;
+		uint32_t version;
+		// odd while the worker is publishing
+		std::atomic<uint32_t> sequence;
+		uint32_t status;
+		int32_t pid;
+		uint32_t reserved;
+		// CLOCK_REALTIME nanoseconds, refreshed every few thousand instructions
+		uint64_t heartbeat;
+		uint64_t cycles;
+		uint16_t registers[REGISTER_COUNT];
+		uint8_t onFire;
+		uint8_t skipNext;
+		uint8_t queueEnabled;
+		uint8_t reserved2;
+		uint16_t queueSize;
+		uint16_t queue[QUEUE_SIZE];
+		uint16_t memory[TOTAL_WORDS] __attribute__((aligned(64)));
+	};
+
+	static_assert(ATOMIC_INT_LOCK_FREE == 2, "the sequence lock must work across processes");
+
+	/*************************************************************************
+	 *
+	 * StateSegment
+	 *
+	 * A MachineState mapped from a file, such as one under /dev/shm.  A
+	 * worker attaches its cpu, which then reads and writes memory in the
+	 * segment, and publishes the rest after each instruction.  A worker that
+	 * crashes leaves the state as of its last instruction, and another can
+	 * resume from it.  Device state is not kept; devices are reset when a
+	 * worker resumes.
+	 *
+	 *************************************************************************/
+	class StateSegment {
+		StateSegment(StateSegment const&) = delete;
+		StateSegment& operator =(StateSegment const&) = delete;
+
+		std::string path;
+		MachineState *state;
+		bool writable;
+		uint32_t published;
+
+		StateSegment(const std::string &path, bool create, bool writable);
+	public:
+		// a consistent copy of everything but memory
+		struct Snapshot {
+			uint32_t status;
+			int32_t pid;
+			uint64_t heartbeat;
+			uint64_t cycles;
+			uint16_t registers[MachineState::REGISTER_COUNT];
+			bool onFire;
+			bool skipNext;
+			bool queueEnabled;
+			uint16_t queueSize;
+		};
+
+		~StateSegment();
+
+		/**
+		 * Creates the file, or truncates it, as an EMPTY state.
+		 */
+		static std::unique_ptr<StateSegment> create(const std::string &path);
+
+		/**
+		 * Opens an existing state.  Throws runtime_error when the file does
+		 * not hold one.
+		 */
+		static std::unique_ptr<StateSegment> open(const std::string &path, bool writable=true);
+
+		static bool exists(const std::string &path);
+
+		/**
+		 * Whether a process with the pid is running, as far as this process
+		 * can tell.
+		 */
+		static bool isAlive(int32_t pid);
+
+		MachineState &get() {
+			return *state;
+		}
+
+		/**
+		 * Moves the cpu's memory into the segment and marks the state
+		 * RUNNING by this process.  The segment must outlive the attachment.
+		 */
+		void attach(Dcpu &cpu);
+
+		/**
+		 * Restores the cpu from the segment and attaches it, resetting its
+		 * devices.  Throws runtime_error when the state is still RUNNING in
+		 * a live process.
+		 */
+		void resume(Dcpu &cpu);
+
+		void publish(const Dcpu &cpu);
+
+		/**
+		 * Publishes a final state with the given status.
+		 */
+		void finish(const Dcpu &cpu, MachineState::Status status);
+
+		Snapshot read() const;
+
+		/**
+		 * Copies the state to a new segment, which another worker can
+		 * resume.  Memory is copied as it is at the time, so the copy of a
+		 * state that is still RUNNING may mix instructions.
+		 */
+		void checkpoint(const std::string &path) const;
+	};
+}}
@@ -0,0 +1,239 @@
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#include <stdexcept>
+#include <boost/format.hpp>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "stats.hpp"
+#include "opcodes.hpp"
+
+using namespace std;
+using boost::format;
+using boost::str;
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * ExecutionStats
+	 *
+	 *************************************************************************/
+
+	const char *ExecutionStats::OPERAND_MODE_NAMES[OPERAND_MODES] = {
+		"register", "[register]", "[register+next]", "push/pop", "peek", "pick", "sp", "pc", "ex",
+		"[next]", "next", "literal"
+	};
+
+	// indexed by opcode, taken from the opcode declarations.  Null marks an invalid opcode.
+	struct NameTable {
+		const char *basic[32];
+		const char *special[32];
+
+		NameTable() : basic(), special() {
+#define BASIC_NAME(name) basic[name ## Opcode::OPCODE] = #name
+#define SPECIAL_NAME(name) special[name ## Opcode::OPCODE] = #name
+			BASIC_NAME(set); BASIC_NAME(add); BASIC_NAME(sub); BASIC_NAME(mul); BASIC_NAME(mli);
+			BASIC_NAME(div); BASIC_NAME(dvi); BASIC_NAME(mod); BASIC_NAME(mdi); BASIC_NAME(and);
+			BASIC_NAME(bor); BASIC_NAME(xor); BASIC_NAME(shr); BASIC_NAME(asr); BASIC_NAME(shl);
+			BASIC_NAME(ifb); BASIC_NAME(ifc); BASIC_NAME(ife); BASIC_NAME(ifn); BASIC_NAME(ifg);
+			BASIC_NAME(ifa); BASIC_NAME(ifl); BASIC_NAME(ifu); BASIC_NAME(adx); BASIC_NAME(sbx);
+			BASIC_NAME(sti); BASIC_NAME(std);
+
+			SPECIAL_NAME(jsr); SPECIAL_NAME(hcf); SPECIAL_NAME(int); SPECIAL_NAME(iag); SPECIAL_NAME(ias);
+			SPECIAL_NAME(rfi); SPECIAL_NAME(iaq); SPECIAL_NAME(hwn); SPECIAL_NAME(hwq); SPECIAL_NAME(hwi);
+#undef BASIC_NAME
+#undef SPECIAL_NAME
+		}
+	};
+
+	static const NameTable NAMES;
+
+	ExecutionStats::ExecutionStats() {
+		reset();
+	}
+
+	void ExecutionStats::reset() {
+		for (Counter *counter : { &instructions, &cycles, &skipped, &interruptsDelivered, &interruptsQueued,
+				&interruptsDropped }) {
+			counter->store(0, memory_order_relaxed);
+		}
+
+		for (auto &counter : basicOpcodes) counter.store(0, memory_order_relaxed);
+		for (auto &counter : specialOpcodes) counter.store(0, memory_order_relaxed);
+		for (auto &counter : aOperands) counter.store(0, memory_order_relaxed);
+		for (auto &counter : bOperands) counter.store(0, memory_order_relaxed);
+		for (auto &counter : hardwareInterrupts) counter.store(0, memory_order_relaxed);
+	}
+
+	uint8_t ExecutionStats::operandMode(uint8_t code) {
+		if (code < 0x18) {
+			return code >> 3;
+		} else if (code < 0x20) {
+			return code - 0x18 + 3;
+		}
+
+		return 11;
+	}
+
+	const char *ExecutionStats::opcodeName(uint16_t instruction) {
+		uint8_t opcode = instruction & 0x1f;
+		return opcode ? NAMES.basic[opcode] : NAMES.special[(instruction >> 5) & 0x1f];
+	}
+
+	ExecutionStats::Snapshot ExecutionStats::snapshot() const {
+		Snapshot result = {};
+		result.instructions = instructions.load(memory_order_relaxed);
+		result.cycles = cycles.load(memory_order_relaxed);
+		result.skipped = skipped.load(memory_order_relaxed);
+		result.interruptsDelivered = interruptsDelivered.load(memory_order_relaxed);
+		result.interruptsQueued = interruptsQueued.load(memory_order_relaxed);
+		result.interruptsDropped = interruptsDropped.load(memory_order_relaxed);
+
+		for (int i = 0; i < 32; i++) {
+			result.basicOpcodes[i] = basicOpcodes[i].load(memory_order_relaxed);
+			result.specialOpcodes[i] = specialOpcodes[i].load(memory_order_relaxed);
+			result.bModes[operandMode(i)] += bOperands[i].load(memory_order_relaxed);
+		}
+
+		for (int i = 0; i < 64; i++) {
+			result.aModes[operandMode(i)] += aOperands[i].load(memory_order_relaxed);
+		}
+
+		for (int i = 0; i <= MAX_DEVICES; i++) {
+			result.hardwareInterrupts[i] = hardwareInterrupts[i].load(memory_order_relaxed);
+		}
+
+		return result;
+	}
+
+	static void writeOpcodes(ostream &out, const char *const names[32], const uint64_t counts[32]) {
+		uint64_t invalid = 0;
+		for (int i = 0; i < 32; i++) {
+			if (names[i]) {
+				out << format("\"%s\": %d, ") % names[i] % counts[i];
+			} else {
+				invalid += counts[i];
+			}
+		}
+		out << format("\"invalid\": %d}") % invalid;
+	}
+
+	static void writeModes(ostream &out, const uint64_t counts[ExecutionStats::OPERAND_MODES]) {
+		for (int i = 0; i < ExecutionStats::OPERAND_MODES; i++) {
+			out << format("%s\"%s\": %d") % (i ? ", " : "") % ExecutionStats::OPERAND_MODE_NAMES[i] % counts[i];
+		}
+		out << "}";
+	}
+
+	void ExecutionStats::Snapshot::writeJson(ostream &out) const {
+		out << format("{\n\t\"instructions\": %d,\n\t\"cycles\": %d,\n\t\"skipped\": %d,\n") % instructions % cycles
+				% skipped;
+		out << format("\t\"interrupts\": {\"delivered\": %d, \"queued\": %d, \"dropped\": %d},\n")
+				% interruptsDelivered % interruptsQueued % interruptsDropped;
+
+		// only the devices interrupted, keyed by index
+		out << "\t\"hwi\": {";
+		const char *separator = "";
+		for (int i = 0; i < MAX_DEVICES; i++) {
+			if (hardwareInterrupts[i]) {
+				out << format("%s\"%d\": %d") % separator % i % hardwareInterrupts[i];
+				separator = ", ";
+			}
+		}
+		if (hardwareInterrupts[MAX_DEVICES]) {
+			out << format("%s\"other\": %d") % separator % hardwareInterrupts[MAX_DEVICES];
+		}
+		out << "},\n";
+
+		out << "\t\"opcodes\": {\n\t\t\"basic\": {";
+		writeOpcodes(out, NAMES.basic, basicOpcodes);
+		out << ",\n\t\t\"special\": {";
+		writeOpcodes(out, NAMES.special, specialOpcodes);
+		out << "\n\t},\n";
+
+		out << "\t\"operands\": {\n\t\t\"a\": {";
+		writeModes(out, aModes);
+		out << ",\n\t\t\"b\": {";
+		writeModes(out, bModes);
+		out << "\n\t}\n}\n";
+	}
+
+	/*************************************************************************
+	 *
+	 * StatsServer
+	 *
+	 *************************************************************************/
+
+	StatsServer::StatsServer(const ExecutionStats &stats, const string &path) : stats(stats), path(path),
+			listener(-1), stopping(false), thread() {
+
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (path.length() >= sizeof(address.sun_path)) {
+			throw runtime_error(str(format("The socket path %s is too long") % path));
+		}
+		strcpy(address.sun_path, path.c_str());
+
+		// a socket left by an earlier run, but never any other kind of file
+		struct stat existing;
+		if (lstat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+			unlink(path.c_str());
+		}
+
+		listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+				|| listen(listener, 4) < 0) {
+			string error = strerror(errno);
+			if (listener >= 0) {
+				close(listener);
+			}
+			throw runtime_error(str(format("Failed to listen on %s: %s") % path % error));
+		}
+
+		thread = std::thread(&StatsServer::serve, this);
+	}
+
+	StatsServer::~StatsServer() {
+		stopping = true;
+		thread.join();
+		close(listener);
+		unlink(path.c_str());
+	}
+
+	void StatsServer::serve() {
+		pollfd waiting = { listener, POLLIN, 0 };
+
+		while (!stopping) {
+			// wakes up now and then to see whether it should stop
+			if (poll(&waiting, 1, 100) <= 0) {
+				continue;
+			}
+
+			int client = accept(listener, nullptr, nullptr);
+			if (client < 0) {
+				continue;
+			}
+
+			ostringstream json;
+			stats.snapshot().writeJson(json);
+			string data = json.str();
+
+			size_t sent = 0;
+			while (sent < data.length()) {
+				ssize_t written = send(client, data.data() + sent, data.length() - sent, MSG_NOSIGNAL);
+				if (written <= 0) {
+					break;
+				}
+				sent += written;
+			}
+
+			close(client);
+		}
+	}
+}}
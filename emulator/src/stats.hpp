@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <ostream>
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * ExecutionStats
+	 *
+	 * Counters that are always on: instructions retired and skipped, cycles,
+	 * interrupts, HWI per device and the mix of opcodes and operand modes.
+	 * Only the cpu thread writes them, so each update is a relaxed load and
+	 * store rather than a locked increment, and any thread may take a
+	 * snapshot without locking.  Execution the debugger repeats when it steps
+	 * back is counted again.
+	 *
+	 *************************************************************************/
+	class ExecutionStats {
+	public:
+		enum { MAX_DEVICES = 64, OPERAND_MODES = 12 };
+
+		struct Snapshot {
+			uint64_t instructions;
+			uint64_t cycles;
+			uint64_t skipped;
+			uint64_t interruptsDelivered;
+			uint64_t interruptsQueued;
+			uint64_t interruptsDropped;
+			uint64_t basicOpcodes[32];
+			uint64_t specialOpcodes[32];
+			uint64_t aModes[OPERAND_MODES];
+			uint64_t bModes[OPERAND_MODES];
+			// HWI to device indexes past MAX_DEVICES are counted in the last entry
+			uint64_t hardwareInterrupts[MAX_DEVICES + 1];
+
+			void writeJson(std::ostream &out) const;
+		};
+
+		static const char *OPERAND_MODE_NAMES[OPERAND_MODES];
+	private:
+		typedef std::atomic<uint64_t> Counter;
+
+		Counter instructions;
+		Counter cycles;
+		Counter skipped;
+		Counter interruptsDelivered;
+		Counter interruptsQueued;
+		Counter interruptsDropped;
+		Counter basicOpcodes[32];
+		Counter specialOpcodes[32];
+		// by operand code, folded into modes when read
+		Counter aOperands[64];
+		Counter bOperands[32];
+		Counter hardwareInterrupts[MAX_DEVICES + 1];
+
+		static void increment(Counter &counter, uint64_t amount=1) {
+			counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+		}
+	public:
+		ExecutionStats();
+
+		void instructionRetired(uint16_t instruction, uint64_t count=1) {
+			uint8_t opcode = instruction & 0x1f;
+			uint8_t b = (instruction >> 5) & 0x1f;
+
+			increment(instructions, count);
+			increment(aOperands[instruction >> 10], count);
+			if (opcode) {
+				increment(basicOpcodes[opcode], count);
+				increment(bOperands[b], count);
+			} else {
+				increment(specialOpcodes[b], count);
+			}
+		}
+
+		void instructionSkipped(uint64_t count=1) {
+			increment(skipped, count);
+		}
+
+		void setCycles(uint64_t value) {
+			cycles.store(value, std::memory_order_relaxed);
+		}
+
+		void interruptDelivered() {
+			increment(interruptsDelivered);
+		}
+
+		void interruptQueued() {
+			increment(interruptsQueued);
+		}
+
+		void interruptDropped() {
+			increment(interruptsDropped);
+		}
+
+		void hardwareInterrupt(uint16_t index) {
+			increment(hardwareInterrupts[index < MAX_DEVICES ? index : MAX_DEVICES]);
+		}
+
+		uint64_t getInstructions() const {
+			return instructions.load(std::memory_order_relaxed);
+		}
+
+		uint64_t getInterruptsDelivered() const {
+			return interruptsDelivered.load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * Only from the cpu thread.
+		 */
+		void reset();
+
+		/**
+		 * Safe from any thread.  The counters are read one at a time, so a
+		 * snapshot taken while the cpu runs may be a few instructions apart
+		 * between counters.
+		 */
+		Snapshot snapshot() const;
+
+		/**
+		 * The operand mode of an argument code, indexing OPERAND_MODE_NAMES.
+		 */
+		static uint8_t operandMode(uint8_t code);
+
+		/**
+		 * The mnemonic of the instruction word's opcode, or null when the
+		 * opcode is invalid.
+		 */
+		static const char *opcodeName(uint16_t instruction);
+	};
+
+	/*************************************************************************
+	 *
+	 * StatsServer
+	 *
+	 * Answers each connection to a unix domain socket with a JSON snapshot
+	 * of the stats, from a thread of its own, until destroyed.
+	 *
+	 *************************************************************************/
+	class StatsServer {
+		StatsServer(StatsServer const&) = delete;
+		StatsServer& operator =(StatsServer const&) = delete;
+
+		const ExecutionStats &stats;
+		std::string path;
+		int listener;
+		std::atomic<bool> stopping;
+		std::thread thread;
+
+		void serve();
+	public:
+		StatsServer(const ExecutionStats &stats, const std::string &path);
+		~StatsServer();
+	};
+}}
@@ -0,0 +1,379 @@
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/format.hpp>
+
+#include "timeline.hpp"
+
+using namespace std;
+using boost::format;
+using boost::str;
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * Timeline::Page
+	 *
+	 *************************************************************************/
+
+	Timeline::Page::Page(const uint16_t *source, size_t &usage) : usage(usage) {
+		memcpy(words, source, sizeof(words));
+		usage += sizeof(words);
+	}
+
+	Timeline::Page::~Page() {
+		usage -= sizeof(words);
+	}
+
+	/*************************************************************************
+	 *
+	 * Timeline
+	 *
+	 *************************************************************************/
+
+	Timeline::Timeline(Dcpu &cpu, uint64_t intervalCycles, size_t budgetBytes) : cpu(cpu),
+			intervalCycles(max<uint64_t>(intervalCycles, 1)), budgetBytes(budgetBytes), pageBytes(0),
+			eventBytes(0), snapshots(), events(), nextEvent(0), presentCycles(cpu.cycles), devicesTicked(false),
+			devicesTickedAt(0), nextSnapshotCycles(cpu.cycles + this->intervalCycles), tickingDevices(false) {
+
+		cpu.timeline = this;
+		takeSnapshot(true);
+	}
+
+	Timeline::~Timeline() {
+		cpu.timeline = nullptr;
+
+		for (uint16_t page = 0; page < DcpuMemory::TOTAL_PAGES; page++) {
+			cpu.memory.clearPageFlags(page, DcpuMemory::PAGE_CLEAN);
+		}
+
+		// the pages report to pageBytes, so they have to go first
+		snapshots.clear();
+		for (auto &page : current) {
+			page.reset();
+		}
+	}
+
+	Timeline::CpuState Timeline::capture() const {
+		CpuState state;
+
+		for (uint8_t i = 0; i < 12; i++) {
+			state.registers[i] = cpu.registers[static_cast<registers>(i)];
+		}
+
+		state.cycles = cpu.cycles;
+		state.skipNext = cpu.skipNext;
+		state.onFire = cpu.onFire;
+		state.queueEnabled = cpu.interrupts.queueEnabled;
+		state.queue = cpu.interrupts.queue;
+
+		return state;
+	}
+
+	void Timeline::apply(const CpuState &state) {
+		for (uint8_t i = 0; i < 12; i++) {
+			cpu.registers[static_cast<registers>(i)] = state.registers[i];
+		}
+
+		cpu.cycles = state.cycles;
+		cpu.skipNext = state.skipNext;
+		cpu.onFire = state.onFire;
+		cpu.interrupts.queueEnabled = state.queueEnabled;
+		cpu.interrupts.queue = state.queue;
+	}
+
+	void Timeline::takeSnapshot(bool compareAll) {
+		Snapshot snapshot;
+		snapshot.state = capture();
+		snapshot.eventIndex = events.size();
+
+		for (uint16_t page = 0; page < DcpuMemory::TOTAL_PAGES; page++) {
+			const uint16_t *words = cpu.memory.getPage(page);
+			bool changed = !current[page] || (compareAll
+					? memcmp(current[page]->words, words, sizeof(Page::words)) != 0
+					: cpu.memory.isPageDirty(page));
+
+			if (changed) {
+				current[page] = make_shared<Page>(words, pageBytes);
+			}
+
+			snapshot.pages[page] = current[page];
+		}
+
+		cpu.memory.markClean();
+
+		if (!snapshots.empty() && snapshots.back().state.cycles == snapshot.state.cycles) {
+			snapshots.back() = move(snapshot);
+		} else {
+			snapshots.push_back(move(snapshot));
+		}
+
+		thin();
+	}
+
+	/**
+	 * Drops the snapshot whose neighbours are closest together relative to its
+	 * age, so the spacing between the kept snapshots grows with their age.  The
+	 * latest snapshot is always kept.
+	 */
+	void Timeline::thin() {
+		while (getMemoryUsage() > budgetBytes && snapshots.size() > 1) {
+			size_t victim = 0;
+			double best = 0;
+
+			for (size_t i = 1; i + 1 < snapshots.size(); i++) {
+				double gap = snapshots[i + 1].state.cycles - snapshots[i - 1].state.cycles;
+				double age = presentCycles - snapshots[i].state.cycles + 1;
+
+				if (victim == 0 || gap / age < best) {
+					victim = i;
+					best = gap / age;
+				}
+			}
+
+			removeSnapshot(victim);
+		}
+	}
+
+	void Timeline::removeSnapshot(size_t index) {
+		snapshots.erase(snapshots.begin() + index);
+
+		if (index != 0) {
+			return;
+		}
+
+		// nothing can replay the inputs logged before the earliest snapshot
+		size_t dropped = snapshots.front().eventIndex;
+		for (size_t i = 0; i < dropped; i++) {
+			eventBytes -= eventSize(events[i]);
+		}
+
+		events.erase(events.begin(), events.begin() + dropped);
+		for (auto &snapshot : snapshots) {
+			snapshot.eventIndex -= dropped;
+		}
+		nextEvent = nextEvent > dropped ? nextEvent - dropped : 0;
+	}
+
+	size_t Timeline::eventSize(const InputEvent &event) {
+		return sizeof(InputEvent) + (event.state ? sizeof(CpuState) : 0)
+				+ event.writes.size() * sizeof(DcpuMemory::Journal::value_type);
+	}
+
+	void Timeline::addEvent(InputEvent &&event) {
+		eventBytes += eventSize(event);
+		events.push_back(move(event));
+	}
+
+	void Timeline::flushTickWrites() {
+		if (tickWrites.empty()) {
+			return;
+		}
+
+		InputEvent event;
+		event.type = InputEvent::TICK_WRITES;
+		event.value = 0;
+		event.cycles = cpu.cycles;
+		event.writes.swap(tickWrites);
+		addEvent(move(event));
+	}
+
+	// interrupts that were triggered rewrite the words they pushed when the
+	// writes that follow them are replayed, which leaves the same values
+	void Timeline::injectDeviceInput() {
+		while (nextEvent < events.size() && events[nextEvent].type != InputEvent::HARDWARE_INTERRUPT
+				&& events[nextEvent].cycles == cpu.cycles) {
+			InputEvent &event = events[nextEvent++];
+
+			if (event.type == InputEvent::INTERRUPT) {
+				cpu.interrupts.send(event.value);
+			} else {
+				for (auto &write : event.writes) {
+					cpu.memory.write(write.first, write.second);
+				}
+			}
+		}
+	}
+
+	Timeline::InputEvent &Timeline::nextInput(InputEvent::Type type) {
+		if (nextEvent >= events.size() || events[nextEvent].type != type || events[nextEvent].cycles != cpu.cycles) {
+			throw logic_error(str(format("the replay diverged from the recording at cycle %d") % cpu.cycles));
+		}
+
+		return events[nextEvent++];
+	}
+
+	void Timeline::instructionExecuted() {
+		if (cpu.cycles <= presentCycles) {
+			return;
+		}
+
+		presentCycles = cpu.cycles;
+		if (presentCycles >= nextSnapshotCycles) {
+			takeSnapshot(false);
+			nextSnapshotCycles = presentCycles + intervalCycles;
+		}
+	}
+
+	void Timeline::tickHardware() {
+		if (devicesTicked && cpu.cycles <= devicesTickedAt) {
+			injectDeviceInput();
+			return;
+		}
+
+		// journaling costs two passes over the page flags, so skip it when nothing could write
+		bool journaled = cpu.hardwareManager.getCount() || cpu.hardwareManager.input;
+		if (journaled) {
+			cpu.memory.setJournal(&tickWrites);
+		}
+		tickingDevices = true;
+
+		try {
+			cpu.hardwareManager.tickAll();
+		} catch (...) {
+			tickingDevices = false;
+			if (journaled) {
+				cpu.memory.setJournal(nullptr);
+			}
+			throw;
+		}
+
+		tickingDevices = false;
+		if (journaled) {
+			cpu.memory.setJournal(nullptr);
+			flushTickWrites();
+		}
+
+		devicesTicked = true;
+		devicesTickedAt = cpu.cycles;
+		nextEvent = events.size();
+	}
+
+	uint16_t Timeline::hardwareInterrupt(uint16_t index) {
+		if (cpu.cycles < presentCycles) {
+			InputEvent &event = nextInput(InputEvent::HARDWARE_INTERRUPT);
+
+			for (auto &write : event.writes) {
+				cpu.memory.write(write.first, write.second);
+			}
+			apply(*event.state);
+
+			return event.value;
+		}
+
+		InputEvent event;
+		event.type = InputEvent::HARDWARE_INTERRUPT;
+		event.cycles = cpu.cycles;
+
+		cpu.memory.setJournal(&event.writes);
+		try {
+			event.value = cpu.hardwareManager.interrupt(index);
+		} catch (...) {
+			cpu.memory.setJournal(nullptr);
+			throw;
+		}
+		cpu.memory.setJournal(nullptr);
+
+		event.state.reset(new CpuState(capture()));
+		addEvent(move(event));
+		nextEvent = events.size();
+
+		return events.back().value;
+	}
+
+	void Timeline::interruptSent(uint16_t message) {
+		if (!tickingDevices) {
+			return;
+		}
+
+		flushTickWrites();
+
+		InputEvent event;
+		event.type = InputEvent::INTERRUPT;
+		event.value = message;
+		event.cycles = cpu.cycles;
+		addEvent(move(event));
+	}
+
+	void Timeline::stateEdited() {
+		uint64_t now = cpu.cycles;
+
+		while (snapshots.size() > 1 && snapshots.back().state.cycles > now) {
+			snapshots.pop_back();
+		}
+
+		for (size_t i = nextEvent; i < events.size(); i++) {
+			eventBytes -= eventSize(events[i]);
+		}
+		events.erase(events.begin() + nextEvent, events.end());
+
+		presentCycles = now;
+		devicesTickedAt = min(devicesTickedAt, now);
+		nextSnapshotCycles = now + intervalCycles;
+
+		takeSnapshot(true);
+	}
+
+	bool Timeline::isReplaying() const {
+		return cpu.cycles < presentCycles;
+	}
+
+	size_t Timeline::snapshotBefore(uint64_t cycles) const {
+		auto after = lower_bound(snapshots.begin(), snapshots.end(), cycles,
+				[](const Snapshot &snapshot, uint64_t cycles) { return snapshot.state.cycles < cycles; });
+
+		return after == snapshots.begin() ? 0 : after - snapshots.begin() - 1;
+	}
+
+	void Timeline::restore(size_t index) {
+		const Snapshot &snapshot = snapshots.at(index);
+		apply(snapshot.state);
+
+		for (uint16_t page = 0; page < DcpuMemory::TOTAL_PAGES; page++) {
+			if (current[page] != snapshot.pages[page] || cpu.memory.isPageDirty(page)) {
+				memcpy(&cpu.memory[page << DcpuMemory::PAGE_SHIFT], snapshot.pages[page]->words,
+						sizeof(Page::words));
+				current[page] = snapshot.pages[page];
+			}
+		}
+
+		cpu.memory.markClean();
+		nextEvent = snapshot.eventIndex;
+		injectDeviceInput();
+	}
+
+	void Timeline::seek(uint64_t cycles) {
+		cycles = min(cycles, presentCycles);
+		size_t index = snapshotBefore(cycles + 1);
+
+		// replay forward from where we are when no snapshot lies in between
+		if (cpu.cycles > cycles || cpu.cycles < snapshots[index].state.cycles) {
+			restore(index);
+		}
+
+		while (cpu.cycles < cycles && !cpu.onFire) {
+			cpu.tick();
+			tickHardware();
+		}
+	}
+
+	size_t Timeline::getSnapshotCount() const {
+		return snapshots.size();
+	}
+
+	uint64_t Timeline::getSnapshotCycles(size_t index) const {
+		return snapshots.at(index).state.cycles;
+	}
+
+	uint64_t Timeline::getEarliestCycles() const {
+		return snapshots.front().state.cycles;
+	}
+
+	uint64_t Timeline::getPresentCycles() const {
+		return presentCycles;
+	}
+
+	size_t Timeline::getMemoryUsage() const {
+		return pageBytes + eventBytes + snapshots.size() * sizeof(Snapshot);
+	}
+}}
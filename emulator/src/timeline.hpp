@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#include "dcpu.hpp"
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * Timeline
+	 *
+	 * Records enough of an execution to travel back through it.  Every
+	 * interval a snapshot of the CPU is taken; memory pages are shared with
+	 * the previous snapshot unless DcpuMemory saw them dirtied, so each
+	 * snapshot only copies the pages written since the one before it.
+	 *
+	 * Instructions are deterministic, so the only inputs that have to be
+	 * logged are those from devices: the interrupts sent and memory written
+	 * while the devices tick, and the registers and memory writes left
+	 * behind by HWI.  Going back
+	 * restores the nearest earlier snapshot and re-executes forward, feeding
+	 * the logged inputs back in place of the devices, which are not ticked
+	 * until execution passes the recorded present again.
+	 *
+	 * When snapshots and the input log outgrow the memory budget, snapshots
+	 * are thinned so that older history is kept more sparsely than recent
+	 * history.
+	 *
+	 *************************************************************************/
+	class Timeline {
+		Timeline(Timeline const&) = delete;
+		Timeline& operator =(Timeline const&) = delete;
+	public:
+		enum { DEFAULT_INTERVAL_CYCLES = 100000 };
+		static const size_t DEFAULT_BUDGET_BYTES = 64 << 20;
+	private:
+		struct Page {
+			uint16_t words[DcpuMemory::PAGE_SIZE];
+			size_t &usage;
+
+			Page(const uint16_t *source, size_t &usage);
+			~Page();
+		};
+
+		typedef std::shared_ptr<const Page> PagePtr;
+
+		struct CpuState {
+			uint16_t registers[12];
+			uint64_t cycles;
+			bool skipNext;
+			bool onFire;
+			bool queueEnabled;
+			std::queue<uint16_t> queue;
+		};
+
+		struct Snapshot {
+			CpuState state;
+			size_t eventIndex;
+			PagePtr pages[DcpuMemory::TOTAL_PAGES];
+		};
+
+		struct InputEvent {
+			enum Type : uint8_t { INTERRUPT, TICK_WRITES, HARDWARE_INTERRUPT };
+
+			Type type;
+			uint16_t value;
+			uint64_t cycles;
+			// the effects of HWI, which are replayed instead of calling the device
+			std::unique_ptr<CpuState> state;
+			// also the memory written by ticking devices
+			DcpuMemory::Journal writes;
+		};
+
+		Dcpu &cpu;
+		uint64_t intervalCycles;
+		size_t budgetBytes;
+		size_t pageBytes;
+		size_t eventBytes;
+		std::vector<Snapshot> snapshots;
+		std::vector<InputEvent> events;
+		PagePtr current[DcpuMemory::TOTAL_PAGES];
+		DcpuMemory::Journal tickWrites;
+		size_t nextEvent;
+		uint64_t presentCycles;
+		bool devicesTicked;
+		uint64_t devicesTickedAt;
+		uint64_t nextSnapshotCycles;
+		bool tickingDevices;
+
+		CpuState capture() const;
+		void apply(const CpuState &state);
+		void takeSnapshot(bool compareAll);
+		void thin();
+		void removeSnapshot(size_t index);
+		static size_t eventSize(const InputEvent &event);
+		void addEvent(InputEvent &&event);
+		void flushTickWrites();
+		void injectDeviceInput();
+		InputEvent &nextInput(InputEvent::Type type);
+	public:
+		/**
+		 * Takes the first snapshot from the current state of the cpu, and
+		 * attaches to it until destroyed.
+		 */
+		Timeline(Dcpu &cpu, uint64_t intervalCycles=DEFAULT_INTERVAL_CYCLES,
+				size_t budgetBytes=DEFAULT_BUDGET_BYTES);
+		~Timeline();
+
+		/**
+		 * Called by Dcpu::tick() after every instruction.
+		 */
+		void instructionExecuted();
+
+		/**
+		 * Ticks the devices and logs what they send, or replays the logged
+		 * interrupts while behind the recorded present.  Execution loops call
+		 * this in place of DcpuHardwareManager::tickAll().
+		 */
+		void tickHardware();
+
+		/**
+		 * Called by HWI in place of DcpuHardwareManager::interrupt().
+		 */
+		uint16_t hardwareInterrupt(uint16_t index);
+
+		/**
+		 * Called by DcpuInterrupts::send().
+		 */
+		void interruptSent(uint16_t message);
+
+		/**
+		 * Must be called after registers or memory are edited by hand.  The
+		 * history after the current cycle is discarded, since it can no longer
+		 * be replayed, and a full snapshot is taken.
+		 */
+		void stateEdited();
+
+		bool isReplaying() const;
+
+		/**
+		 * The index of the latest snapshot taken before the given cycle, or 0
+		 * when there is none.
+		 */
+		size_t snapshotBefore(uint64_t cycles) const;
+		void restore(size_t index);
+
+		/**
+		 * Moves to the first instruction boundary at or after the given cycle,
+		 * replaying from the nearest snapshot.  Targets beyond the recorded
+		 * present stop at the present.
+		 */
+		void seek(uint64_t cycles);
+
+		size_t getSnapshotCount() const;
+		uint64_t getSnapshotCycles(size_t index) const;
+		uint64_t getEarliestCycles() const;
+		uint64_t getPresentCycles() const;
+		size_t getMemoryUsage() const;
+	};
+}}
@@ -0,0 +1,190 @@
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/format.hpp>
+
+#include "trace.hpp"
+#include "cfg.hpp"
+
+using namespace std;
+using boost::format;
+using boost::str;
+
+static const char TRACE_MAGIC[8] = {'D', 'C', 'P', 'U', 'T', 'R', 'C', '\0'};
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * TraceBuffer
+	 *
+	 *************************************************************************/
+
+	TraceBuffer::TraceBuffer(const string &filename, uint64_t capacity) : fd(-1), mappingSize(0), mapping(nullptr),
+			header(nullptr), records(nullptr) {
+		if (capacity == 0) {
+			throw invalid_argument("the trace buffer must hold at least one record");
+		}
+
+		fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd == -1) {
+			throw runtime_error(str(format("Failed to open the file %s: %s") % filename % strerror(errno)));
+		}
+
+		mappingSize = sizeof(TraceHeader) + capacity * sizeof(TraceRecord);
+		if (ftruncate(fd, mappingSize) != 0) {
+			close(fd);
+			throw runtime_error(str(format("Failed to size the trace file %s: %s") % filename % strerror(errno)));
+		}
+
+		map(filename, true);
+
+		memcpy(header->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+		header->version = TraceHeader::VERSION;
+		header->recordSize = sizeof(TraceRecord);
+		header->capacity = capacity;
+		header->written = 0;
+		header->endCycles = 0;
+	}
+
+	TraceBuffer::TraceBuffer(const string &filename) : fd(-1), mappingSize(0), mapping(nullptr), header(nullptr),
+			records(nullptr) {
+		fd = open(filename.c_str(), O_RDONLY);
+		if (fd == -1) {
+			throw runtime_error(str(format("Failed to open the file %s: %s") % filename % strerror(errno)));
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) != 0) {
+			close(fd);
+			throw runtime_error(str(format("Failed to stat the file %s: %s") % filename % strerror(errno)));
+		}
+
+		mappingSize = info.st_size;
+		if (mappingSize < sizeof(TraceHeader)) {
+			close(fd);
+			throw runtime_error(str(format("%s is not a trace file") % filename));
+		}
+
+		map(filename, false);
+
+		if (memcmp(header->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 || header->version != TraceHeader::VERSION
+				|| header->recordSize != sizeof(TraceRecord) || header->capacity == 0
+				|| mappingSize < sizeof(TraceHeader) + header->capacity * sizeof(TraceRecord)) {
+			release();
+			throw runtime_error(str(format("%s is not a version %d trace file") % filename % TraceHeader::VERSION));
+		}
+	}
+
+	TraceBuffer::~TraceBuffer() {
+		release();
+	}
+
+	void TraceBuffer::release() {
+		if (mapping) {
+			munmap(mapping, mappingSize);
+			mapping = nullptr;
+		}
+
+		if (fd != -1) {
+			close(fd);
+			fd = -1;
+		}
+	}
+
+	void TraceBuffer::map(const string &filename, bool writable) {
+		mapping = mmap(nullptr, mappingSize, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+		if (mapping == MAP_FAILED) {
+			mapping = nullptr;
+			close(fd);
+			throw runtime_error(str(format("Failed to map the file %s: %s") % filename % strerror(errno)));
+		}
+
+		header = static_cast<TraceHeader*>(mapping);
+		records = reinterpret_cast<TraceRecord*>(header + 1);
+	}
+
+	uint64_t TraceBuffer::size() const {
+		return header->written < header->capacity ? header->written : header->capacity;
+	}
+
+	uint64_t TraceBuffer::getWritten() const {
+		return header->written;
+	}
+
+	uint64_t TraceBuffer::getEndCycles() const {
+		return header->endCycles;
+	}
+
+	const TraceRecord &TraceBuffer::operator[](uint64_t index) const {
+		uint64_t oldest = header->written - size();
+		return records[(oldest + index) % header->capacity];
+	}
+
+	/*************************************************************************
+	 *
+	 * InstructionTracer
+	 *
+	 *************************************************************************/
+
+	InstructionTracer::InstructionTracer(Dcpu &cpu, TraceBuffer &buffer) : cpu(cpu), buffer(buffer), record(),
+			lastCycles(cpu.getCycles()), writesBefore(0) {
+
+	}
+
+	void InstructionTracer::beginInstruction() {
+		uint16_t pc = cpu.registers.pc;
+
+		record.pc = pc;
+		record.flags = cpu.isSkipNext() ? TraceRecord::SKIPPED : 0;
+		record.wordCount = instructionLength(cpu.memory.peek(pc));
+		for (int i = 0; i < 3; i++) {
+			record.words[i] = i < record.wordCount ? cpu.memory.peek(pc + i) : 0;
+		}
+
+		for (int i = 0; i < TOTAL_REGISTERS; i++) {
+			registersBefore[i] = cpu.registers[static_cast<registers>(i)];
+		}
+
+		writesBefore = cpu.memory.getWriteCount();
+	}
+
+	void InstructionTracer::endInstruction() {
+		record.changedRegisters = 0;
+		record.changedRegister = TraceRecord::NO_REGISTER;
+		record.registerValue = 0;
+
+		// PC changes on every instruction, so it is left to the pc of the following record
+		for (int i = 0; i < TOTAL_REGISTERS; i++) {
+			registers reg = static_cast<registers>(i);
+			if (reg == registers::PC || registersBefore[i] == cpu.registers[reg]) {
+				continue;
+			}
+
+			record.changedRegisters |= 1 << i;
+			if (record.changedRegister == TraceRecord::NO_REGISTER) {
+				record.changedRegister = i;
+				record.registerValue = cpu.registers[reg];
+			}
+		}
+
+		uint64_t writes = cpu.memory.getWriteCount() - writesBefore;
+		if (writes > 0) {
+			record.flags |= TraceRecord::MEMORY_WRITE | (writes > 1 ? TraceRecord::MULTIPLE_WRITES : 0);
+			record.writeAddress = cpu.memory.getLastWriteAddress();
+			record.writeValue = cpu.memory.peek(record.writeAddress);
+		} else {
+			record.writeAddress = 0;
+			record.writeValue = 0;
+		}
+
+		uint64_t cycles = cpu.getCycles();
+		record.cycleDelta = cycles - lastCycles;
+		lastCycles = cycles;
+
+		buffer.append(record, cycles);
+	}
+
+}}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "dcpu.hpp"
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * TraceRecord
+	 *
+	 * One fixed-size record per executed (or skipped) instruction.
+	 *
+	 *************************************************************************/
+	struct TraceRecord {
+		enum { NO_REGISTER = 0xff };
+		enum Flags : uint8_t { SKIPPED = 1 << 0, MEMORY_WRITE = 1 << 1, MULTIPLE_WRITES = 1 << 2 };
+
+		uint32_t cycleDelta;
+		uint16_t pc;
+		uint16_t words[3];
+		uint16_t changedRegisters;
+		uint16_t registerValue;
+		uint16_t writeAddress;
+		uint16_t writeValue;
+		uint8_t wordCount;
+		uint8_t changedRegister;
+		uint8_t flags;
+		uint8_t reserved;
+	};
+
+	static_assert(sizeof(TraceRecord) == 24, "trace records must stay 24 bytes");
+
+	/*************************************************************************
+	 *
+	 * TraceHeader
+	 *
+	 *************************************************************************/
+	struct TraceHeader {
+		enum { VERSION = 1 };
+
+		char magic[8];
+		uint32_t version;
+		uint32_t recordSize;
+		uint64_t capacity;
+		uint64_t written;
+		uint64_t endCycles;
+	};
+
+	/*************************************************************************
+	 *
+	 * TraceBuffer
+	 *
+	 * A ring of TraceRecords in a memory mapped file.  The header is updated
+	 * after every record, so the file holds the most recent instructions even
+	 * if the emulator dies without shutting down.
+	 *
+	 *************************************************************************/
+	class TraceBuffer {
+		TraceBuffer(TraceBuffer const&) = delete;
+		TraceBuffer& operator =(TraceBuffer const&) = delete;
+
+		int fd;
+		size_t mappingSize;
+		void *mapping;
+		TraceHeader *header;
+		TraceRecord *records;
+
+		void map(const std::string &filename, bool writable);
+		void release();
+	public:
+		TraceBuffer(const std::string &filename, uint64_t capacity);
+		TraceBuffer(const std::string &filename);
+		~TraceBuffer();
+
+		void append(const TraceRecord &record, uint64_t endCycles) {
+			records[header->written % header->capacity] = record;
+			header->endCycles = endCycles;
+			++header->written;
+		}
+
+		uint64_t size() const;
+		uint64_t getWritten() const;
+		uint64_t getEndCycles() const;
+		const TraceRecord &operator[](uint64_t index) const;
+	};
+
+	/*************************************************************************
+	 *
+	 * InstructionTracer
+	 *
+	 *************************************************************************/
+	class InstructionTracer {
+		enum { TOTAL_REGISTERS = 12 };
+
+		Dcpu &cpu;
+		TraceBuffer &buffer;
+		TraceRecord record;
+		uint64_t lastCycles;
+		uint64_t writesBefore;
+		uint16_t registersBefore[TOTAL_REGISTERS];
+	public:
+		InstructionTracer(Dcpu &cpu, TraceBuffer &buffer);
+
+		void beginInstruction();
+		void endInstruction();
+	};
+}}
@@ -15,16 +15,23 @@ static const int64_t CYCLE_IN_NANOSECONDS = SECOND_IN_NS / dcpu::emulator::Dcpu:
 namespace dcpu { namespace emulator {
 	DEFINE_EVENT_TYPE(wxEVT_COMMAND_DCPU_STOPPED);
 	
-	DcpuThread::DcpuThread(Dcpu &cpu, wxEvtHandler* eventHandler) : cpu(cpu), eventHandler(eventHandler),
-		stopExecution(false), cyclesSlept(-1) {
+	DcpuThread::DcpuThread(Dcpu &cpu, Debugger &debugger, wxEvtHandler* eventHandler) : cpu(cpu),
+		debugger(debugger), eventHandler(eventHandler), stopExecution(false), cyclesSlept(-1),
+		stopReason(StopReason::NONE) {
 	}
 
 	void DcpuThread::run() {
+		stopReason = StopReason::NONE;
+
 		try {
 			while (!stopExecution && !cpu.isOnFire()) {
 				sleepUntilNextCycle();
 
 				if (cyclesSlept >= cpu.getCycles()) {
+					if (debugger.isArmed() && (stopReason = debugger.checkStop()) != StopReason::NONE) {
+						break;
+					}
+
 					cpu.tick();
 				}
 
@@ -39,6 +46,8 @@ namespace dcpu { namespace emulator {
 
 	void DcpuThread::start() {
 		stopExecution = false;
+		cyclesSlept = cpu.getCycles() - 1;
+		debugger.prepareResume();
 		thread = std::thread(&DcpuThread::run, this);
 	}
 
@@ -49,6 +58,10 @@ namespace dcpu { namespace emulator {
         }
 	}
 
+	StopReason DcpuThread::getStopReason() {
+		return stopReason;
+	}
+
 	void DcpuThread::sleepUntilNextCycle() {
 		uint64_t currentTime = getCurrentTime();
 
@@ -6,6 +6,7 @@
 #include <memory>
 
 #include "../dcpu.hpp"
+#include "../debugger.hpp"
 
 namespace dcpu { namespace emulator {
 	DECLARE_EVENT_TYPE(wxEVT_COMMAND_DCPU_STOPPED, wxID_ANY);
@@ -15,20 +16,23 @@ namespace dcpu { namespace emulator {
     	DcpuThread& operator =(DcpuThread const&) = delete;
 
 		Dcpu &cpu;
+		Debugger &debugger;
 		wxEvtHandler* eventHandler;
 		std::atomic<bool> stopExecution;
 		uint64_t cyclesSlept;
 		std::thread thread;
+		StopReason stopReason;
         
         void sleepUntilNextCycle();
         void notifyStopped();
         uint64_t getCurrentTime();
         void sleep(uint64_t time);
 	public:
-		DcpuThread(Dcpu &cpu, wxEvtHandler* eventHandler);
+		DcpuThread(Dcpu &cpu, Debugger &debugger, wxEvtHandler* eventHandler);
 
 		void run();
 		void start();
 		void stop();
+		StopReason getStopReason();
 	};
 }}
@@ -0,0 +1,399 @@
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/format.hpp>
+
+#include "wcet.hpp"
+#include "opcodes.hpp"
+
+using namespace std;
+using boost::format;
+using boost::str;
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * Estimate
+	 *
+	 *************************************************************************/
+
+	CycleEstimator::Estimate::Estimate(uint64_t best, uint64_t worst) : best(best), worst(worst), bounded(true),
+			reason() {}
+
+	static void unbound(CycleEstimator::Estimate &estimate, const string &reason) {
+		if (estimate.bounded) {
+			estimate.bounded = false;
+			estimate.reason = reason;
+		}
+	}
+
+	static CycleEstimator::Estimate sequence(const CycleEstimator::Estimate &first,
+			const CycleEstimator::Estimate &second) {
+
+		CycleEstimator::Estimate result(first.best + second.best, first.worst + second.worst);
+		if (!first.bounded) {
+			unbound(result, first.reason);
+		} else if (!second.bounded) {
+			unbound(result, second.reason);
+		}
+
+		return result;
+	}
+
+	// adds another path to the same place
+	static void merge(map<int32_t, CycleEstimator::Estimate> &estimates, int32_t key,
+			const CycleEstimator::Estimate &path) {
+
+		auto existing = estimates.find(key);
+		if (existing == estimates.end()) {
+			estimates.insert(make_pair(key, path));
+			return;
+		}
+
+		CycleEstimator::Estimate &estimate = existing->second;
+		estimate.best = min(estimate.best, path.best);
+		estimate.worst = max(estimate.worst, path.worst);
+		if (!path.bounded) {
+			unbound(estimate, path.reason);
+		}
+	}
+
+	/*************************************************************************
+	 *
+	 * Strongly connected components
+	 *
+	 *************************************************************************/
+
+	// Tarjan's algorithm, which finds each component after every component reachable from it
+	struct ComponentFinder {
+		const vector<vector<uint32_t>> &edges;
+		vector<int32_t> index;
+		vector<uint32_t> lowLink;
+		vector<bool> onStack;
+		vector<uint32_t> stack;
+		vector<vector<uint32_t>> components;
+		uint32_t nextIndex;
+
+		ComponentFinder(const vector<vector<uint32_t>> &edges) : edges(edges), index(edges.size(), -1),
+				lowLink(edges.size()), onStack(edges.size()), stack(), components(), nextIndex(0) {
+
+			for (uint32_t node = 0; node < edges.size(); node++) {
+				if (index[node] < 0) {
+					visit(node);
+				}
+			}
+		}
+
+		void visit(uint32_t node) {
+			index[node] = lowLink[node] = nextIndex++;
+			stack.push_back(node);
+			onStack[node] = true;
+
+			for (auto next : edges[node]) {
+				if (index[next] < 0) {
+					visit(next);
+					lowLink[node] = min(lowLink[node], lowLink[next]);
+				} else if (onStack[next]) {
+					lowLink[node] = min<uint32_t>(lowLink[node], index[next]);
+				}
+			}
+
+			if (lowLink[node] == static_cast<uint32_t>(index[node])) {
+				vector<uint32_t> component;
+				uint32_t member;
+				do {
+					member = stack.back();
+					stack.pop_back();
+					onStack[member] = false;
+					component.push_back(member);
+				} while (member != node);
+
+				components.push_back(move(component));
+			}
+		}
+	};
+
+	/*************************************************************************
+	 *
+	 * CycleEstimator
+	 *
+	 *************************************************************************/
+
+	CycleEstimator::CycleEstimator(const uint16_t *memory, const ControlFlowGraph &cfg, const LoopBounds &bounds,
+			uint16_t hwiCycles) : memory(memory), cfg(cfg), bounds(bounds), hwiCycles(hwiCycles), routines(),
+			active() {}
+
+	int32_t CycleEstimator::blockIndex(uint16_t address) const {
+		const Block *block = cfg.findBlock(address);
+		if (!block || block->start != address) {
+			return EXIT;
+		}
+
+		return block - cfg.getBlocks().data();
+	}
+
+	CycleEstimator::Estimate CycleEstimator::blockCost(uint32_t index) {
+		const Block &block = cfg.getBlocks()[index];
+		uint32_t hardwareInterrupts = 0;
+
+		uint16_t address = block.start;
+		for (uint32_t i = 0; i < block.instructions; i++) {
+			DecodedInstruction decoded = decodeInstruction(memory, address);
+			hardwareInterrupts += decoded.isSpecial(hwiOpcode::OPCODE);
+			address += decoded.length;
+		}
+
+		Estimate cost(block.cycles, block.cycles + static_cast<uint64_t>(hardwareInterrupts) * hwiCycles);
+		if (block.exit != Block::CALL) {
+			return cost;
+		}
+
+		for (auto &edge : block.successors) {
+			if (edge.kind == ControlFlowGraph::Edge::CALL) {
+				return sequence(cost, estimate(edge.target));
+			}
+		}
+
+		unbound(cost, str(format("JSR through a register at the end of block 0x%04x") % block.start));
+		return cost;
+	}
+
+	/**
+	 * The cycles from the start of the header to each place the region is
+	 * left through, as if the edges back to the header left it too.
+	 */
+	CycleEstimator::Exits CycleEstimator::analyzeRegion(const vector<uint32_t> &nodes, uint32_t header) {
+		auto &blocks = cfg.getBlocks();
+		map<uint32_t, uint32_t> local;
+		for (uint32_t i = 0; i < nodes.size(); i++) {
+			local[nodes[i]] = i;
+		}
+
+		vector<vector<uint32_t>> edges(nodes.size());
+		for (uint32_t i = 0; i < nodes.size(); i++) {
+			for (auto &edge : blocks[nodes[i]].successors) {
+				auto target = local.find(blockIndex(edge.target));
+				if (edge.kind != ControlFlowGraph::Edge::CALL && target != local.end() && target->first != header) {
+					edges[i].push_back(target->second);
+				}
+			}
+		}
+
+		Exits exits;
+		Exits arrivals;
+		auto reach = [&](int32_t target, const Estimate &cost) {
+			if (target == static_cast<int32_t>(header)) {
+				merge(exits, BACK, cost);
+			} else if (target != EXIT && local.count(target)) {
+				merge(arrivals, local[target], cost);
+			} else {
+				merge(exits, target, cost);
+			}
+		};
+
+		arrivals[local[header]] = Estimate();
+		ComponentFinder finder(edges);
+
+		for (auto component = finder.components.rbegin(); component != finder.components.rend(); ++component) {
+			vector<uint32_t> entered;
+			for (auto node : *component) {
+				if (arrivals.count(node)) {
+					entered.push_back(node);
+				}
+			}
+
+			if (entered.empty()) {
+				continue;
+			}
+
+			for (size_t i = 1; i < entered.size(); i++) {
+				merge(arrivals, entered[0], arrivals[entered[i]]);
+			}
+			Estimate arrival = arrivals[entered[0]];
+
+			uint32_t node = (*component)[0];
+			bool loop = component->size() > 1 || find(edges[node].begin(), edges[node].end(), node) != edges[node].end();
+
+			if (!loop) {
+				const Block &block = blocks[nodes[node]];
+				Estimate cost = sequence(arrival, blockCost(nodes[node]));
+
+				bool leaves = false;
+				for (auto &edge : block.successors) {
+					if (edge.kind == ControlFlowGraph::Edge::CALL) {
+						continue;
+					}
+
+					reach(blockIndex(edge.target), sequence(cost, Estimate(edge.skipped, edge.skipped)));
+					leaves = true;
+				}
+
+				if (!leaves) {
+					if (block.exit == Block::INDIRECT) {
+						unbound(cost, str(format("computed jump at the end of block 0x%04x") % block.start));
+					}
+					merge(exits, EXIT, cost);
+				}
+				continue;
+			}
+
+			if (entered.size() > 1) {
+				unbound(arrival, str(format("the loop at 0x%04x is entered at more than one place")
+						% blocks[nodes[entered[0]]].start));
+			}
+
+			vector<uint32_t> members;
+			for (auto member : *component) {
+				members.push_back(nodes[member]);
+			}
+
+			for (auto &exit : analyzeLoop(members, nodes[entered[0]])) {
+				reach(exit.first, sequence(arrival, exit.second));
+			}
+		}
+
+		return exits;
+	}
+
+	CycleEstimator::Exits CycleEstimator::analyzeLoop(const vector<uint32_t> &nodes, uint32_t header) {
+		Exits exits = analyzeRegion(nodes, header);
+		auto back = exits.find(BACK);
+		if (back == exits.end()) {
+			return exits;
+		}
+
+		Estimate iteration = back->second;
+		exits.erase(back);
+
+		uint16_t start = cfg.getBlocks()[header].start;
+		auto bound = bounds.find(start);
+		for (auto &exit : exits) {
+			if (bound == bounds.end()) {
+				unbound(exit.second, str(format("the loop at 0x%04x has no .BOUND") % start));
+				continue;
+			}
+
+			uint64_t repeats = bound->second > 0 ? bound->second - 1 : 0;
+			exit.second.worst += repeats * iteration.worst;
+			if (!iteration.bounded) {
+				unbound(exit.second, iteration.reason);
+			}
+		}
+
+		return exits;
+	}
+
+	CycleEstimator::Estimate CycleEstimator::estimate(uint16_t entry) {
+		auto known = routines.find(entry);
+		if (known != routines.end()) {
+			return known->second;
+		}
+
+		Estimate result;
+		if (active.count(entry)) {
+			unbound(result, str(format("the routine at 0x%04x calls itself") % entry));
+			return result;
+		}
+
+		int32_t start = blockIndex(entry);
+		if (start == EXIT) {
+			throw invalid_argument(str(format("no code starts at 0x%04x") % entry));
+		}
+
+		// the blocks reached without calling
+		auto &blocks = cfg.getBlocks();
+		vector<uint32_t> nodes;
+		vector<bool> seen(blocks.size());
+		vector<uint32_t> pending = { static_cast<uint32_t>(start) };
+		seen[start] = true;
+
+		while (!pending.empty()) {
+			uint32_t node = pending.back();
+			pending.pop_back();
+			nodes.push_back(node);
+
+			for (auto &edge : blocks[node].successors) {
+				int32_t target = blockIndex(edge.target);
+				if (edge.kind != ControlFlowGraph::Edge::CALL && target != EXIT && !seen[target]) {
+					seen[target] = true;
+					pending.push_back(target);
+				}
+			}
+		}
+
+		active.insert(entry);
+		Exits exits;
+		try {
+			exits = analyzeLoop(nodes, start);
+		} catch (...) {
+			active.erase(entry);
+			throw;
+		}
+		active.erase(entry);
+
+		auto exit = exits.find(EXIT);
+		if (exit == exits.end()) {
+			unbound(result, str(format("the routine at 0x%04x never returns") % entry));
+		} else {
+			result = exit->second;
+		}
+
+		routines[entry] = result;
+		return result;
+	}
+
+	vector<uint16_t> CycleEstimator::getRoutines() const {
+		set<uint16_t> entries;
+		for (auto &block : cfg.getBlocks()) {
+			if (cfg.isEntry(block.start)) {
+				entries.insert(block.start);
+			}
+
+			for (auto &edge : block.successors) {
+				if (edge.kind == ControlFlowGraph::Edge::CALL) {
+					entries.insert(edge.target);
+				}
+			}
+		}
+
+		return vector<uint16_t>(entries.begin(), entries.end());
+	}
+
+	CycleEstimator::LoopBounds CycleEstimator::loadBounds(const string &filename) {
+		ifstream in(filename);
+		if (!in) {
+			throw runtime_error(str(format("Failed to open the file %s: %s") % filename % strerror(errno)));
+		}
+
+		LoopBounds bounds;
+		string line;
+		for (int number = 1; getline(in, line); number++) {
+			istringstream fields(line);
+			string address;
+			uint32_t count;
+
+			if (!(fields >> address) || address[0] == ';') {
+				continue;
+			}
+
+			size_t end;
+			unsigned long value = 0;
+			try {
+				value = stoul(address, &end, 0);
+			} catch (logic_error &) {
+				end = 0;
+			}
+
+			if (end != address.length() || value > 0xffff || !(fields >> count)) {
+				throw runtime_error(str(format("%s:%d: expected an address and a loop bound") % filename % number));
+			}
+
+			bounds[value] = count;
+		}
+
+		return bounds;
+	}
+}}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+#include "cfg.hpp"
+
+namespace dcpu { namespace emulator {
+	/*************************************************************************
+	 *
+	 * CycleEstimator
+	 *
+	 * Best and worst case cycles of routines, from the block costs of a
+	 * control flow graph.  A routine starts at an entry point, an IAS
+	 * handler or a JSR target and ends where it returns, halts or stops on
+	 * an invalid word.  Calls add the cost of the routine called, skips the
+	 * cycle each skipped instruction takes, and HWI the extra cycles given
+	 * for the worst case.
+	 *
+	 * Loops are the strongly connected parts of the graph.  Each needs a
+	 * bound on the times its header runs per entry, as the assembler's
+	 * .BOUND directive gives, or the worst case is unbounded.  The best case
+	 * assumes loops exit on their first pass.
+	 *
+	 *************************************************************************/
+	class CycleEstimator {
+	public:
+		typedef std::map<uint16_t, uint32_t> LoopBounds;
+
+		struct Estimate {
+			uint64_t best;
+			uint64_t worst;
+			bool bounded;
+			// why the worst case is unbounded
+			std::string reason;
+
+			Estimate(uint64_t best=0, uint64_t worst=0);
+		};
+	private:
+		typedef ControlFlowGraph::Block Block;
+		// keyed by the index of the block reached, or one of these
+		typedef std::map<int32_t, Estimate> Exits;
+		enum : int32_t { EXIT = -1, BACK = -2 };
+
+		const uint16_t *memory;
+		const ControlFlowGraph &cfg;
+		LoopBounds bounds;
+		uint16_t hwiCycles;
+		std::map<uint16_t, Estimate> routines;
+		std::set<uint16_t> active;
+
+		int32_t blockIndex(uint16_t address) const;
+		Estimate blockCost(uint32_t index);
+		Exits analyzeRegion(const std::vector<uint32_t> &nodes, uint32_t header);
+		Exits analyzeLoop(const std::vector<uint32_t> &nodes, uint32_t header);
+	public:
+		/**
+		 * The memory and graph must outlive the estimator.  hwiCycles is the
+		 * most extra cycles any device takes to handle an HWI.
+		 */
+		CycleEstimator(const uint16_t *memory, const ControlFlowGraph &cfg, const LoopBounds &bounds,
+				uint16_t hwiCycles=0);
+
+		/**
+		 * The cycles from entering the routine at the address until it
+		 * returns.  Throws invalid_argument when no block starts there.
+		 */
+		Estimate estimate(uint16_t entry);
+
+		/**
+		 * The graph's entry points and handlers and every JSR target, in
+		 * address order.
+		 */
+		std::vector<uint16_t> getRoutines() const;
+
+		/**
+		 * Reads the address and count pairs written by the assembler's
+		 * --bounds option.
+		 */
+		static LoopBounds loadBounds(const std::string &filename);
+	};
+}}
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <dcpu.hpp>
+#include <cfg.hpp>
+#include "utils/test_program.hpp"
+
+using namespace std;
+using namespace dcpu::emulator;
+
+typedef ControlFlowGraph::Block Block;
+typedef ControlFlowGraph::Edge Edge;
+
+// 0000: SET A, 5
+// 0001: JSR 0x0010
+// 0003: IFE A, 0
+// 0004: SET PC, 0x0020
+// 0006: SUB PC, 4
+// 0010: SUB A, 1
+// 0011: SET PC, POP
+// 0020: HCF 0
+static void loadExample(vector<uint16_t> &memory) {
+	memory.assign(ControlFlowGraph::TOTAL_WORDS, 0);
+	loadProgram(memory, { 0x9801, 0x7c20, 0x0010, 0x8412, 0x7f81, 0x0020, 0x9783 });
+	loadProgram(memory, { 0x8803, 0x6381 }, 0x10);
+	memory[0x20] = 0x84e0;
+}
+
+static void expectEdge(const Block &block, size_t index, uint16_t target, Edge::Kind kind) {
+	ASSERT_LT(index, block.successors.size());
+	EXPECT_EQ(target, block.successors[index].target);
+	EXPECT_EQ(kind, block.successors[index].kind);
+}
+
+TEST(ControlFlowGraphTest, SplitsBlocks) {
+	vector<uint16_t> memory;
+	loadExample(memory);
+	ControlFlowGraph cfg(memory.data(), { 0 });
+
+	auto &blocks = cfg.getBlocks();
+	ASSERT_EQ(6, blocks.size());
+
+	EXPECT_EQ(0x0000, blocks[0].start);
+	EXPECT_EQ(3, blocks[0].words);
+	EXPECT_EQ(2, blocks[0].instructions);
+	EXPECT_EQ(5, blocks[0].cycles);
+	EXPECT_EQ(Block::CALL, blocks[0].exit);
+	expectEdge(blocks[0], 0, 0x0010, Edge::CALL);
+	expectEdge(blocks[0], 1, 0x0003, Edge::FALLTHROUGH);
+
+	EXPECT_EQ(0x0003, blocks[1].start);
+	EXPECT_EQ(2, blocks[1].cycles);
+	EXPECT_EQ(Block::CONDITIONAL, blocks[1].exit);
+	expectEdge(blocks[1], 0, 0x0004, Edge::FALLTHROUGH);
+	expectEdge(blocks[1], 1, 0x0006, Edge::SKIP);
+	EXPECT_EQ(1, blocks[1].successors[1].skipped);
+
+	EXPECT_EQ(0x0004, blocks[2].start);
+	EXPECT_EQ(2, blocks[2].words);
+	EXPECT_EQ(2, blocks[2].cycles);
+	expectEdge(blocks[2], 0, 0x0020, Edge::JUMP);
+
+	EXPECT_EQ(0x0006, blocks[3].start);
+	expectEdge(blocks[3], 0, 0x0003, Edge::JUMP);
+
+	EXPECT_EQ(0x0010, blocks[4].start);
+	EXPECT_EQ(3, blocks[4].cycles);
+	EXPECT_EQ(Block::RETURN, blocks[4].exit);
+	EXPECT_TRUE(blocks[4].successors.empty());
+
+	EXPECT_EQ(0x0020, blocks[5].start);
+	EXPECT_EQ(Block::HALT, blocks[5].exit);
+
+	EXPECT_EQ(&blocks[2], cfg.findBlock(0x0005));
+	EXPECT_EQ(nullptr, cfg.findBlock(0x0007));
+	EXPECT_TRUE(cfg.isInstruction(0x0004));
+	EXPECT_FALSE(cfg.isInstruction(0x0005));
+}
+
+TEST(ControlFlowGraphTest, SkipsConditionalChains) {
+	// 0000: IFE A, 0
+	// 0001: IFN B, 1
+	// 0002: SET [0x1000], 1
+	// 0004: IAS 0x0030
+	// 0006: SET PC, 6
+	vector<uint16_t> memory(ControlFlowGraph::TOTAL_WORDS, 0);
+	loadProgram(memory, { 0x8412, 0x8833, 0x8bc1, 0x1000, 0x7d40, 0x0030, 0x9f81 });
+	memory[0x30] = 0x8560;
+
+	ControlFlowGraph cfg(memory.data(), { 0 });
+
+	const Block *block = cfg.findBlock(0);
+	ASSERT_NE(nullptr, block);
+	expectEdge(*block, 1, 0x0004, Edge::SKIP);
+	EXPECT_EQ(2, block->successors[1].skipped);
+
+	// the handler is followed as an entry point
+	EXPECT_TRUE(cfg.isEntry(0x0030));
+	ASSERT_NE(nullptr, cfg.findBlock(0x0030));
+	EXPECT_EQ(Block::RETURN, cfg.findBlock(0x0030)->exit);
+	EXPECT_EQ(Block::JUMP, cfg.findBlock(0x0006)->exit);
+}
+
+TEST(ControlFlowGraphTest, CyclesMatchEmulator) {
+	srand(36);
+	vector<uint16_t> memory(ControlFlowGraph::TOTAL_WORDS, 0);
+
+	for (int i = 0; i < 5000; i++) {
+		Dcpu cpu;
+		for (uint16_t address = 0; address < 3; address++) {
+			memory[address] = cpu.memory[address] = rand() & 0xffff;
+		}
+
+		// HWI adds whatever the device takes
+		if ((memory[0] & 0x3ff) == (0x12 << 5)) {
+			continue;
+		}
+
+		uint16_t expected = ControlFlowGraph::instructionCycles(memory.data(), 0);
+		try {
+			cpu.tick();
+		} catch (invalid_argument &e) {
+			EXPECT_EQ(0, expected) << "for " << hex << memory[0];
+			continue;
+		} catch (exception &e) {
+			continue;
+		}
+
+		EXPECT_EQ(expected, cpu.getCycles()) << "for " << hex << memory[0];
+	}
+}
+
+TEST(ControlFlowGraphTest, ExportsGraph) {
+	vector<uint16_t> memory;
+	loadExample(memory);
+	ControlFlowGraph cfg(memory.data(), { 0 });
+
+	ostringstream dot;
+	cfg.writeDot(dot);
+	EXPECT_NE(string::npos, dot.str().find("b0000 [label=\"0000-0002\\n2 instructions, 5 cycles\\ncall\", peripheries=2];"));
+	EXPECT_NE(string::npos, dot.str().find("b0003 -> b0006 [style=dashed, label=\"skip 1\"];"));
+	EXPECT_NE(string::npos, dot.str().find("b0000 -> b0010 [style=dotted, label=\"call\"];"));
+
+	ostringstream json;
+	cfg.writeJson(json);
+	EXPECT_NE(string::npos, json.str().find("\"entries\": [0]"));
+	EXPECT_NE(string::npos, json.str().find("{\"start\": 3, \"words\": 1, \"instructions\": 1, \"cycles\": 2, "
+			"\"exit\": \"conditional\", \"successors\": [{\"target\": 4, \"kind\": \"fallthrough\"}, "
+			"{\"target\": 6, \"kind\": \"skip\", \"skipped\": 1}]}"));
+}
+
+TEST(ControlFlowGraphTest, DecodesInstructions) {
+	vector<uint16_t> memory(ControlFlowGraph::TOTAL_WORDS, 0);
+	// SET [0xfffe], 0x1234 at the end of memory, its next words wrapping around
+	memory[0xffff] = 0x7fc1;
+	memory[0x0000] = 0x1234;
+	memory[0x0001] = 0xfffe;
+
+	DecodedInstruction decoded = decodeInstruction(memory.data(), 0xffff);
+	EXPECT_TRUE(decoded.isValid());
+	EXPECT_EQ(3, decoded.length);
+	EXPECT_EQ(0x1234, decoded.nextA);
+	EXPECT_EQ(0xfffe, decoded.nextB);
+	EXPECT_EQ(instructionLength(0x7fc1), decoded.length);
+
+	// an invalid opcode is a single word, though its operands would take more
+	memory[0x10] = 0x7fd8;
+	decoded = decodeInstruction(memory.data(), 0x10);
+	EXPECT_FALSE(decoded.isValid());
+	EXPECT_EQ(1, decoded.length);
+	EXPECT_EQ(3, instructionLength(0x7fd8));
+}
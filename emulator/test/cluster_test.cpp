@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+#include <utility>
+
+#include <dcpu.hpp>
+#include <cluster.hpp>
+
+using namespace std;
+using namespace dcpu::emulator;
+
+class OrderDevice : public SharedDevice {
+public:
+	vector<pair<uint64_t, size_t>> calls;
+	uint32_t ticks;
+
+	OrderDevice(DcpuCluster &cluster) : SharedDevice(cluster, 0x12345678, 0x1, 1), calls(), ticks(0) {}
+
+	virtual uint16_t interrupt(size_t core) {
+		Dcpu &cpu = cluster.getCore(core);
+		calls.push_back(make_pair(cpu.getCycles(), core));
+		cpu.registers.b = calls.size();
+		return 0;
+	}
+
+	virtual void tick() {
+		ticks++;
+	}
+};
+
+// 0000: HWI 0
+// 0001: SET X, X   (repeated core times)
+// ....: SET PC, 0
+static void loadLoop(Dcpu &cpu, size_t core) {
+	uint16_t address = 0;
+	cpu.memory[address++] = 0x8640;
+	for (size_t i = 0; i < core; i++) {
+		cpu.memory[address++] = 0x0c61;
+	}
+	cpu.memory[address++] = 0x8781;
+}
+
+static vector<pair<uint64_t, size_t>> runLoops(size_t cores, uint64_t quantum) {
+	DcpuCluster cluster(cores, quantum);
+	auto device = make_shared<OrderDevice>(cluster);
+	cluster.addSharedDevice(device);
+	for (size_t i = 0; i < cores; i++) {
+		loadLoop(cluster.getCore(i), i);
+	}
+
+	cluster.run(10000);
+	EXPECT_EQ(10000, cluster.getCycles());
+	EXPECT_EQ(10000 / quantum, device->ticks);
+	for (size_t i = 0; i < cores; i++) {
+		EXPECT_GE(cluster.getCore(i).getCycles(), 10000);
+	}
+
+	return device->calls;
+}
+
+TEST(DcpuClusterTest, SharedDeviceCallsAreOrderedByCycle) {
+	vector<pair<uint64_t, size_t>> calls = runLoops(4, 100);
+	ASSERT_GT(calls.size(), 1000);
+	for (size_t i = 1; i < calls.size(); i++) {
+		EXPECT_LT(calls[i - 1], calls[i]);
+	}
+
+	// the same order however the threads are scheduled, and whatever the quantum
+	EXPECT_EQ(calls, runLoops(4, 100));
+	EXPECT_EQ(calls, runLoops(4, 1000));
+}
+
+class BroadcastDevice : public SharedDevice {
+public:
+	BroadcastDevice(DcpuCluster &cluster) : SharedDevice(cluster, 0, 0x2, 1) {}
+
+	virtual uint16_t interrupt(size_t core) {
+		return 0;
+	}
+
+	virtual void tick() {
+		if (cluster.getCycles() == 500) {
+			for (size_t i = 0; i < cluster.getCoreCount(); i++) {
+				cluster.getCore(i).interrupts.send(0x42 + i);
+			}
+		}
+	}
+};
+
+TEST(DcpuClusterTest, SharedDevicesReachEveryCoreAtTheBarrier) {
+	DcpuCluster cluster(3, 100);
+	cluster.addSharedDevice(make_shared<BroadcastDevice>(cluster));
+
+	for (size_t i = 0; i < 3; i++) {
+		Dcpu &cpu = cluster.getCore(i);
+		// 0000: IAS 4
+		// 0001: SUB PC, 1
+		// 0004: HCF 0
+		cpu.memory[0] = 0x9540;
+		cpu.memory[1] = 0x8b83;
+		cpu.memory[4] = 0x84e0;
+	}
+
+	cluster.run();
+	EXPECT_EQ(600, cluster.getCycles());
+	for (size_t i = 0; i < 3; i++) {
+		Dcpu &cpu = cluster.getCore(i);
+		EXPECT_TRUE(cpu.isOnFire());
+		EXPECT_EQ(0x42 + i, cpu.registers.a);
+		EXPECT_EQ(1, cpu.hardwareManager.getCount());
+	}
+}
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+#include <dcpu.hpp>
+#include <condition.hpp>
+
+using namespace std;
+using namespace dcpu::emulator;
+
+TEST(ConditionTest, ReadsRegistersAndMemory) {
+	Dcpu cpu;
+	Condition condition = Condition::compile("[SP+2] == 0x8000 && A > B", cpu);
+
+	cpu.registers.sp = 0xfff0;
+	cpu.memory[0xfff2] = 0x8000;
+	cpu.registers.a = 2;
+	cpu.registers.b = 1;
+	EXPECT_TRUE(condition.evaluate());
+
+	cpu.registers.b = 3;
+	EXPECT_FALSE(condition.evaluate());
+
+	cpu.registers.b = 1;
+	cpu.memory[0xfff2] = 0x7fff;
+	EXPECT_FALSE(condition.evaluate());
+}
+
+TEST(ConditionTest, Operators) {
+	Dcpu cpu;
+	cpu.registers.a = 10;
+	cpu.registers.x = 0xffff;
+
+	EXPECT_TRUE(Condition::compile("A * 2 + 1 == 21", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("A / 3 == 3 && A % 3 == 1", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("(A << 4 | 1) >> 4 == A", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("X == 0xffff && X > A", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("A < 11 && A <= 10 && A >= 10 && !(A != 10)", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("-A == ~A + 1", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("A / 0 == 0", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("[SP] == 0 || [0x10] == 1", cpu).evaluate());
+	EXPECT_FALSE(Condition::compile("B || C", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("B || A", cpu).evaluate());
+	EXPECT_FALSE(Condition::compile("A && B", cpu).evaluate());
+}
+
+TEST(ConditionTest, ArithmeticWraps) {
+	Dcpu cpu;
+	cpu.registers.x = 0xffff;
+
+	// 32-bit two's complement, with the signed operators reading the wrapped values
+	EXPECT_TRUE(Condition::compile("X * X * X == 0x2ffff", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("X << 31 < 0 && X << 32 == 0", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("-(1 << 31) == 1 << 31", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("(1 << 31) / -1 == 1 << 31 && (1 << 31) % -1 == 0", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("(1 << 31) >> 31 == -1 && -7 / 2 == -3", cpu).evaluate());
+}
+
+TEST(ConditionTest, ShortCircuitValue) {
+	Dcpu cpu;
+	cpu.registers.a = 5;
+
+	// && and || yield 0 or 1, like the assembler
+	EXPECT_TRUE(Condition::compile("(A || 0) == 1", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("(A && 7) == 1", cpu).evaluate());
+	EXPECT_TRUE(Condition::compile("(0 && A) == 0", cpu).evaluate());
+}
+
+TEST(ConditionTest, RejectsInvalidConditions) {
+	Dcpu cpu;
+
+	EXPECT_THROW(Condition::compile("A ==", cpu), invalid_argument);
+	EXPECT_THROW(Condition::compile("A == 1 )", cpu), invalid_argument);
+	EXPECT_THROW(Condition::compile("[A", cpu), invalid_argument);
+	EXPECT_THROW(Condition::compile("label == 1", cpu), invalid_argument);
+	EXPECT_THROW(Condition::compile("[SP++] == 1", cpu), invalid_argument);
+}
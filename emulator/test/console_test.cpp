@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <chrono>
+
+#include <unistd.h>
+
+#include <dcpu.hpp>
+#include <console.hpp>
+
+using namespace std;
+using namespace dcpu::emulator;
+
+static void command(Dcpu &cpu, SerialConsole &console, uint16_t a, uint16_t b=0, uint16_t c=0) {
+	cpu.registers.a = a;
+	cpu.registers.b = b;
+	cpu.registers.c = c;
+	console.interrupt();
+}
+
+static void store(Dcpu &cpu, uint16_t address, const string &text) {
+	for (size_t i = 0; i < text.length(); i++) {
+		cpu.memory[address + i] = text[i];
+	}
+}
+
+TEST(ConsoleRingTest, WrapsAroundAndFills) {
+	ConsoleRing ring(8);
+	char data[8];
+
+	EXPECT_EQ(6, ring.write("abcdef", 6));
+	EXPECT_EQ(4, ring.read(data, 4));
+	EXPECT_EQ(6, ring.getFree());
+	EXPECT_EQ(6, ring.write("ghijklmn", 8));
+	EXPECT_EQ(0, ring.getFree());
+	EXPECT_EQ(0, ring.write("o", 1));
+
+	ASSERT_EQ(8, ring.read(data, 8));
+	EXPECT_EQ("efghijkl", string(data, 8));
+	EXPECT_EQ(0, ring.getUsed());
+}
+
+TEST(SerialConsoleTest, WritesWithBackPressure) {
+	int output[2];
+	ASSERT_EQ(0, pipe(output));
+	Dcpu cpu;
+	SerialConsole console(cpu, output[1], -1, 16);
+	string text = "The quick brown fox jumps over the lazy dog";
+	store(cpu, 0x1000, text);
+
+	// the host drains the ring as it likes, but never more than 16 go in at once
+	uint16_t written = 0;
+	while (written < text.length()) {
+		command(cpu, console, SerialConsole::WRITE, 0x1000 + written, text.length() - written);
+		EXPECT_LE(cpu.registers.c, 16);
+		written += cpu.registers.c;
+	}
+	console.finish();
+	close(output[1]);
+
+	char data[64];
+	ssize_t length = read(output[0], data, sizeof(data));
+	close(output[0]);
+	EXPECT_EQ(text, string(data, length));
+}
+
+TEST(SerialConsoleTest, ReadsInputAndInterrupts) {
+	int input[2];
+	ASSERT_EQ(0, pipe(input));
+	Dcpu cpu;
+	SerialConsole console(cpu, STDOUT_FILENO, input[0]);
+	command(cpu, console, SerialConsole::SET_INTERRUPT, 0x33);
+	cpu.registers.ia = 0x200;
+	cpu.memory[0] = 0x8b83;
+	EXPECT_EQ(HardwareDevice::ANY_CYCLE, console.getNextEvent());
+
+	ASSERT_EQ(3, write(input[1], "abc", 3));
+	for (int i = 0; i < 1000 && cpu.registers.pc != 0x200; i++) {
+		this_thread::sleep_for(chrono::milliseconds(1));
+		cpu.tick();
+		console.tick();
+	}
+	EXPECT_EQ(0x200, cpu.registers.pc);
+	EXPECT_EQ(0x33, cpu.registers.a);
+
+	command(cpu, console, SerialConsole::STATUS);
+	EXPECT_EQ(3, cpu.registers.c);
+	command(cpu, console, SerialConsole::READ, 0x300, 2);
+	EXPECT_EQ(2, cpu.registers.c);
+	command(cpu, console, SerialConsole::READ, 0x302, 8);
+	EXPECT_EQ(1, cpu.registers.c);
+	EXPECT_EQ('a', cpu.memory[0x300]);
+	EXPECT_EQ('c', cpu.memory[0x302]);
+
+	console.finish();
+	close(input[0]);
+	close(input[1]);
+}
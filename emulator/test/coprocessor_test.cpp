@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+#include <dcpu.hpp>
+#include <coprocessor.hpp>
+
+using namespace std;
+using namespace dcpu::emulator;
+
+static void store(Dcpu &cpu, uint16_t address, const vector<uint32_t> &values) {
+	for (size_t i = 0; i < values.size(); i++) {
+		cpu.memory[address + i * 2] = values[i] & 0xffff;
+		cpu.memory[address + i * 2 + 1] = values[i] >> 16;
+	}
+}
+
+static uint32_t load(Dcpu &cpu, uint16_t address) {
+	return cpu.memory[address] | (static_cast<uint32_t>(cpu.memory[address + 1]) << 16);
+}
+
+static uint16_t run(Dcpu &cpu, MathCoprocessor &coprocessor, uint16_t operation, uint16_t count) {
+	uint16_t descriptor[] = { operation, count, 0x1000, 0x2000, 0x3000 };
+	for (uint16_t i = 0; i < 5; i++) {
+		cpu.memory[0x100 + i] = descriptor[i];
+	}
+
+	cpu.registers.a = 0;
+	cpu.registers.b = 0x100;
+	return coprocessor.interrupt();
+}
+
+static uint32_t fixed(double value) {
+	return static_cast<uint32_t>(static_cast<int32_t>(value * 65536));
+}
+
+static uint32_t bits(float value) {
+	uint32_t result;
+	memcpy(&result, &value, sizeof(result));
+	return result;
+}
+
+TEST(MathCoprocessorTest, IntegerVectors) {
+	Dcpu cpu;
+	MathCoprocessor coprocessor(cpu);
+	store(cpu, 0x1000, { 100000, 0xffffffff, 7, static_cast<uint32_t>(-9) });
+	store(cpu, 0x2000, { 3, 2, 0, 2 });
+
+	EXPECT_EQ(2 + 4 * 2, run(cpu, coprocessor, MathCoprocessor::MUL, 4));
+	EXPECT_EQ(0, cpu.registers.a);
+	EXPECT_EQ(300000, load(cpu, 0x3000));
+	EXPECT_EQ(0xfffffffe, load(cpu, 0x3002));
+	EXPECT_EQ(0, load(cpu, 0x3004));
+
+	run(cpu, coprocessor, MathCoprocessor::DIV, 4);
+	EXPECT_EQ(33333, load(cpu, 0x3000));
+	EXPECT_EQ(0, load(cpu, 0x3004));
+
+	run(cpu, coprocessor, MathCoprocessor::DVI, 4);
+	EXPECT_EQ(static_cast<uint32_t>(-4), load(cpu, 0x3006));
+
+	run(cpu, coprocessor, MathCoprocessor::ADD, 4);
+	EXPECT_EQ(1, load(cpu, 0x3002));
+}
+
+TEST(MathCoprocessorTest, FixedPointAndFloats) {
+	Dcpu cpu;
+	MathCoprocessor coprocessor(cpu);
+	store(cpu, 0x1000, { fixed(1.5), fixed(-2.25) });
+	store(cpu, 0x2000, { fixed(2.5), fixed(0.5) });
+
+	run(cpu, coprocessor, MathCoprocessor::MULX, 2);
+	EXPECT_EQ(fixed(3.75), load(cpu, 0x3000));
+	EXPECT_EQ(fixed(-1.125), load(cpu, 0x3002));
+
+	run(cpu, coprocessor, MathCoprocessor::DIVX, 2);
+	EXPECT_EQ(fixed(0.6), load(cpu, 0x3000));
+	EXPECT_EQ(fixed(-4.5), load(cpu, 0x3002));
+
+	cpu.memory[0x3002] = 0x1234;
+	run(cpu, coprocessor, MathCoprocessor::DOTX, 2);
+	EXPECT_EQ(fixed(2.625), load(cpu, 0x3000));
+	EXPECT_EQ(0x1234, cpu.memory[0x3002]);
+
+	store(cpu, 0x1000, { bits(1.5f) });
+	store(cpu, 0x2000, { bits(0.25f) });
+	EXPECT_EQ(2 + 4, run(cpu, coprocessor, MathCoprocessor::FDIV, 1));
+	EXPECT_EQ(bits(6.0f), load(cpu, 0x3000));
+}
+
+TEST(MathCoprocessorTest, DotProductWraps) {
+	Dcpu cpu;
+	MathCoprocessor coprocessor(cpu);
+	// four products of 2^62 add up to 2^64, past what the sum holds
+	store(cpu, 0x1000, { 0x80000000, 0x80000000, 0x80000000, 0x80000000, fixed(1.5) });
+	store(cpu, 0x2000, { 0x80000000, 0x80000000, 0x80000000, 0x80000000, fixed(-0.5) });
+
+	run(cpu, coprocessor, MathCoprocessor::DOTX, 5);
+	EXPECT_EQ(fixed(-0.75), load(cpu, 0x3000));
+}
+
+TEST(MathCoprocessorTest, RejectsUnknownOperations) {
+	Dcpu cpu;
+	MathCoprocessor coprocessor(cpu);
+
+	EXPECT_EQ(0, run(cpu, coprocessor, 13, 1));
+	EXPECT_EQ(1, cpu.registers.a);
+	EXPECT_EQ(0, run(cpu, coprocessor, MathCoprocessor::ADD, 8193));
+	EXPECT_EQ(1, cpu.registers.a);
+}
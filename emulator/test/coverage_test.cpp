@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <stdexcept>
+#include <unistd.h>
+
+#include <dcpu.hpp>
+#include <coverage.hpp>
+
+using namespace std;
+using namespace dcpu::emulator;
+
+class CoverageTest : public ::testing::Test {
+public:
+	void SetUp() {
+		char path[] = "/tmp/dcpu-coverage-XXXXXX";
+		int fd = mkstemp(path);
+		close(fd);
+		filename = path;
+	}
+
+	void TearDown() {
+		remove(filename.c_str());
+	}
+protected:
+	string filename;
+};
+
+TEST_F(CoverageTest, MarksInstructionStarts) {
+	Dcpu cpu;
+	// 0000: IFE A, 1
+	// 0001: SET [0x1000], A    (skipped)
+	// 0003: SET A, 1
+	cpu.memory[0] = 0x8812;
+	cpu.memory[1] = 0x03c1;
+	cpu.memory[2] = 0x1000;
+	cpu.memory[3] = 0x8801;
+
+	ExecutionCoverage coverage;
+	cpu.coverage = &coverage;
+	cpu.tick();
+	cpu.tick();
+	cpu.tick();
+
+	EXPECT_TRUE(coverage.isMarked(0));
+	EXPECT_TRUE(coverage.isMarked(1));
+	EXPECT_FALSE(coverage.isMarked(2));
+	EXPECT_TRUE(coverage.isMarked(3));
+	EXPECT_EQ(3, coverage.count());
+}
+
+TEST_F(CoverageTest, SaveAndMerge) {
+	ExecutionCoverage first;
+	first.mark(0);
+	first.mark(0xffff);
+	first.save(filename);
+
+	ExecutionCoverage second;
+	second.mark(0x1234);
+	second.load(filename);
+
+	EXPECT_TRUE(second.isMarked(0));
+	EXPECT_TRUE(second.isMarked(0x1234));
+	EXPECT_TRUE(second.isMarked(0xffff));
+	EXPECT_EQ(3, second.count());
+}
+
+TEST_F(CoverageTest, RejectsOtherFiles) {
+	FILE *file = fopen(filename.c_str(), "wb");
+	fputs("not a coverage file", file);
+	fclose(file);
+
+	ExecutionCoverage coverage;
+	EXPECT_THROW(coverage.load(filename), runtime_error);
+}
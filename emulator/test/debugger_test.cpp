@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include <sstream>
+
+#include <dcpu.hpp>
+#include <debugger.hpp>
+
+using namespace std;
+using namespace dcpu::emulator;
+
+// 0000: SET A, 1
+// 0001: JSR 0x0005
+// 0003: SET [0x1000], A
+// 0005: ADD A, 2       (subroutine)
+// 0006: SET PC, POP
+static void loadProgram(Dcpu &cpu) {
+	cpu.memory[0] = 0x8801;
+	cpu.memory[1] = 0x7c20;
+	cpu.memory[2] = 0x0005;
+	cpu.memory[3] = 0x03c1;
+	cpu.memory[4] = 0x1000;
+	cpu.memory[5] = 0x8c02;
+	cpu.memory[6] = 0x6381;
+}
+
+TEST(DebuggerTest, NotArmedByDefault) {
+	Dcpu cpu;
+	Debugger debugger(cpu);
+
+	EXPECT_FALSE(debugger.isArmed());
+	debugger.addBreakpoint(3);
+	EXPECT_TRUE(debugger.isArmed());
+	debugger.removeBreakpoint(3);
+	EXPECT_FALSE(debugger.isArmed());
+}
+
+TEST(DebuggerTest, BreakpointAndResume) {
+	Dcpu cpu;
+	loadProgram(cpu);
+	Debugger debugger(cpu);
+
+	debugger.addBreakpoint(5);
+	EXPECT_EQ(StopReason::BREAKPOINT, debugger.run());
+	EXPECT_EQ(5, cpu.registers.pc);
+
+	// resuming must not stop on the breakpoint it stopped at
+	debugger.addBreakpoint(3);
+	EXPECT_EQ(StopReason::BREAKPOINT, debugger.run());
+	EXPECT_EQ(3, cpu.registers.pc);
+	EXPECT_EQ(3, cpu.registers.a);
+}
+
+TEST(DebuggerTest, StepOverJsr) {
+	Dcpu cpu;
+	loadProgram(cpu);
+	Debugger debugger(cpu);
+
+	EXPECT_EQ(StopReason::STEP, debugger.stepOver());
+	EXPECT_EQ(1, cpu.registers.pc);
+
+	EXPECT_EQ(StopReason::STEP, debugger.stepOver());
+	EXPECT_EQ(3, cpu.registers.pc);
+	EXPECT_EQ(3, cpu.registers.a);
+	EXPECT_FALSE(debugger.isArmed());
+}
+
+TEST(DebuggerTest, Watchpoint) {
+	Dcpu cpu;
+	loadProgram(cpu);
+	Debugger debugger(cpu);
+
+	debugger.addWatchpoint(0x1000);
+	EXPECT_EQ(DcpuMemory::PAGE_WATCHED, cpu.memory.getPageFlags(0x10));
+	EXPECT_EQ(0, cpu.memory.getPageFlags(0x11));
+
+	EXPECT_EQ(StopReason::WATCHPOINT, debugger.run());
+	EXPECT_EQ(5, cpu.registers.pc);
+	EXPECT_EQ(0x1000, debugger.getWatchAddress());
+	EXPECT_EQ(0, debugger.getWatchOldValue());
+	EXPECT_EQ(3, debugger.getWatchValue());
+
+	debugger.removeWatchpoint(0x1000);
+	EXPECT_EQ(0, cpu.memory.getPageFlags(0x10));
+}
+
+TEST(DebuggerTest, RunToCycle) {
+	Dcpu cpu;
+	loadProgram(cpu);
+	Debugger debugger(cpu);
+
+	// stops at the first instruction boundary at or past the target
+	EXPECT_EQ(StopReason::CYCLE_REACHED, debugger.runToCycle(4));
+	EXPECT_EQ(5, cpu.registers.pc);
+	EXPECT_EQ(5, cpu.getCycles());
+}
+
+TEST(DebuggerTest, ConsoleEditsState) {
+	Dcpu cpu;
+	Debugger debugger(cpu);
+	ostringstream out;
+	DebugConsole console(debugger, cpu, out);
+
+	EXPECT_TRUE(console.execute("set x 0x1234"));
+	EXPECT_EQ(0x1234, cpu.registers.x);
+
+	EXPECT_TRUE(console.execute("poke 0x100 1 2 3"));
+	EXPECT_EQ(1, cpu.memory[0x100]);
+	EXPECT_EQ(3, cpu.memory[0x102]);
+
+	EXPECT_TRUE(console.execute("break 0x20"));
+	EXPECT_TRUE(debugger.hasBreakpoint(0x20));
+
+	EXPECT_TRUE(console.execute("set q 1"));
+	EXPECT_NE(string::npos, out.str().find("unknown register"));
+
+	EXPECT_FALSE(console.execute("quit"));
+}
+
+class WriteRecorder : public MemoryMappedDevice {
+public:
+	DcpuMemory::Journal writes;
+
+	virtual uint16_t mappedRead(uint16_t, uint16_t stored) {
+		return stored;
+	}
+
+	virtual void mappedWrite(uint16_t address, uint16_t, uint16_t value) {
+		writes.push_back(make_pair(address, value));
+	}
+};
+
+TEST(DebuggerTest, PokeWritesThroughDevices) {
+	Dcpu cpu;
+	loadProgram(cpu);
+	Debugger debugger(cpu);
+	ostringstream out;
+	DebugConsole console(debugger, cpu, out);
+	WriteRecorder device;
+	cpu.memory.mapDevice(0x80, 1, &device);
+	debugger.addWatchpoint(0x1000);
+
+	EXPECT_TRUE(console.execute("poke 0x8000 7"));
+	ASSERT_EQ(1, device.writes.size());
+	EXPECT_EQ(0x8000, device.writes[0].first);
+	EXPECT_EQ(7, device.writes[0].second);
+
+	// the program's own write still stops, the poke does not
+	EXPECT_TRUE(console.execute("poke 0x1000 9"));
+	EXPECT_EQ(9, cpu.memory.peek(0x1000));
+	EXPECT_EQ(StopReason::WATCHPOINT, debugger.run());
+	EXPECT_EQ(9, debugger.getWatchOldValue());
+	cpu.memory.unmapDevice(0x80, 1);
+}
+
+TEST(DebuggerTest, ConditionalBreakpoint) {
+	Dcpu cpu;
+	// 0000: ADD A, 1
+	// 0001: SET PC, 0
+	cpu.memory[0] = 0x8802;
+	cpu.memory[1] = 0x8781;
+	Debugger debugger(cpu);
+
+	debugger.addBreakpoint(1, Condition::compile("A == 5", cpu));
+	EXPECT_EQ(StopReason::BREAKPOINT, debugger.run());
+	EXPECT_EQ(1, cpu.registers.pc);
+	EXPECT_EQ(5, cpu.registers.a);
+
+	ostringstream out;
+	DebugConsole console(debugger, cpu, out);
+	console.execute("watch 0x100 if [0x100] > 2");
+	EXPECT_TRUE(debugger.hasWatchpoint(0x100));
+
+	console.execute("break 1 if A ==");
+	EXPECT_NE(string::npos, out.str().find("error"));
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+#include <cstring>
+
+#include <dcpu.hpp>
+#include <dma.hpp>
+
+using namespace std;
+using namespace dcpu::emulator;
+
+static void command(Dcpu &cpu, DmaDevice &dma, uint16_t a, uint16_t b=0, uint16_t c=0, uint16_t x=0) {
+	cpu.registers.a = a;
+	cpu.registers.b = b;
+	cpu.registers.c = c;
+	cpu.registers.x = x;
+	dma.interrupt();
+}
+
+// runs SUB PC, 1 at 0x0000, two cycles at a time
+static void runUntil(Dcpu &cpu, DmaDevice &dma, uint64_t cycles) {
+	cpu.memory[0] = 0x8b83;
+	while (cpu.getCycles() < cycles) {
+		cpu.tick();
+		dma.tick();
+	}
+}
+
+TEST(DmaDeviceTest, CopiesOverlappingBlocksWhenDone) {
+	Dcpu cpu;
+	DmaDevice dma(cpu);
+	vector<uint16_t> expected(0x300);
+	for (uint16_t i = 0; i < 0x100; i++) {
+		cpu.memory[0x100 + i] = i + 1;
+		expected[0x100 + i] = i + 1;
+	}
+	memmove(&expected[0x180], &expected[0x100], 0x100 * sizeof(uint16_t));
+
+	command(cpu, dma, DmaDevice::COPY, 0x100, 0x180, 0x100);
+	EXPECT_EQ(1, cpu.registers.a);
+
+	// 4 cycles of setup, then 4 words a cycle
+	runUntil(cpu, dma, 66);
+	EXPECT_EQ(0, cpu.memory[0x200]);
+	command(cpu, dma, DmaDevice::STATUS);
+	EXPECT_EQ(0x100, cpu.registers.b);
+	EXPECT_EQ(2, cpu.registers.c);
+
+	runUntil(cpu, dma, 68);
+	for (uint16_t i = 0x100; i < 0x300; i++) {
+		EXPECT_EQ(expected[i], cpu.memory[i]);
+	}
+	command(cpu, dma, DmaDevice::STATUS);
+	EXPECT_EQ(0, cpu.registers.b);
+}
+
+TEST(DmaDeviceTest, FillsThroughTrackedPages) {
+	Dcpu cpu;
+	DmaDevice dma(cpu, 1, 0);
+	DcpuMemory::Journal journal;
+
+	command(cpu, dma, DmaDevice::FILL, 0xabcd, 0xfff0, 0x20);
+	cpu.memory.setJournal(&journal);
+	runUntil(cpu, dma, 0x20);
+	cpu.memory.setJournal(nullptr);
+
+	ASSERT_EQ(0x20, journal.size());
+	EXPECT_EQ(0xfff0, journal[0].first);
+	EXPECT_EQ(0x000f, journal[0x1f].first);
+	EXPECT_EQ(0xabcd, cpu.memory[0xffff]);
+	EXPECT_EQ(0xabcd, cpu.memory[0x0000 + 0xf]);
+	EXPECT_EQ(0, cpu.memory[0x0010]);
+}
+
+TEST(DmaDeviceTest, OneTransferAtATime) {
+	Dcpu cpu;
+	DmaDevice dma(cpu);
+	command(cpu, dma, DmaDevice::SET_INTERRUPT, 0x55);
+	cpu.registers.ia = 0x200;
+
+	command(cpu, dma, DmaDevice::FILL, 7, 0x1000, 0x40);
+	EXPECT_EQ(1, cpu.registers.a);
+	EXPECT_EQ(20, dma.getNextEvent());
+	command(cpu, dma, DmaDevice::FILL, 8, 0x2000, 0x40);
+	EXPECT_EQ(0, cpu.registers.a);
+
+	runUntil(cpu, dma, 20);
+	EXPECT_EQ(0x200, cpu.registers.pc);
+	EXPECT_EQ(0x55, cpu.registers.a);
+	EXPECT_EQ(7, cpu.memory[0x103f]);
+	EXPECT_EQ(0, cpu.memory[0x2000]);
+	EXPECT_EQ(HardwareDevice::NO_EVENT, dma.getNextEvent());
+}
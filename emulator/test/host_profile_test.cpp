@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <sstream>
+
+#include <dcpu.hpp>
+#include <host_profile.hpp>
+#include "utils/test_program.hpp"
+
+using namespace std;
+using namespace dcpu::emulator;
+
+// 0000: SET A, 1
+// 0001: IFE A, 2
+// 0002: SET B, [0x1000]    (skipped)
+// 0004: JSR 0x0010
+// 0010: SET PUSH, A
+TEST(HostProfilerTest, AttributesInstructions) {
+	Dcpu cpu;
+	loadProgram(cpu, { 0x8801, 0x8c12, 0x7821, 0x1000, 0x7c20, 0x0010 });
+	cpu.memory[0x10] = 0x0301;
+
+	HostProfiler profiler;
+	cpu.hostProfiler = &profiler;
+	for (int i = 0; i < 5; i++) {
+		cpu.tick();
+	}
+	profiler.finish();
+
+	vector<HostProfiler::Row> rows = profiler.getRows();
+	ASSERT_EQ(5, rows.size());
+
+	uint64_t count = 0;
+	for (size_t i = 0; i < rows.size(); i++) {
+		count += rows[i].count;
+		if (i) {
+			EXPECT_GE(rows[i - 1].nanoseconds, rows[i].nanoseconds);
+		}
+	}
+	EXPECT_EQ(5, count);
+
+	auto find = [&] (const char *opcode, const char *b, const char *a) {
+		for (auto &row : rows) {
+			if (!row.skipped && !strcmp(row.opcode, opcode) && (b ? row.b && !strcmp(row.b, b) : !row.b)
+					&& !strcmp(row.a, a)) {
+				return true;
+			}
+		}
+		return false;
+	};
+	EXPECT_TRUE(find("set", "register", "literal"));
+	EXPECT_TRUE(find("ife", "register", "literal"));
+	EXPECT_TRUE(find("jsr", nullptr, "next"));
+	EXPECT_TRUE(find("set", "push/pop", "register"));
+
+	ostringstream out;
+	profiler.writeReport(out);
+	EXPECT_NE(string::npos, out.str().find("skipped "));
+	EXPECT_NE(string::npos, out.str().find("Total: 5 instructions"));
+}
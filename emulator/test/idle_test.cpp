@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+#include <memory>
+
+#include <dcpu.hpp>
+#include <hardware.hpp>
+#include <idle.hpp>
+#include "utils/test_hardware.hpp"
+#include "utils/test_program.hpp"
+
+using namespace std;
+using namespace dcpu::emulator;
+
+// sends an interrupt once the cycle count reaches its deadline
+class TimerDevice : public HardwareDevice {
+public:
+	uint64_t deadline;
+	uint64_t ticks;
+
+	TimerDevice(Dcpu &cpu, uint64_t deadline) : HardwareDevice(cpu, 0, 0, 0), deadline(deadline), ticks(0) {}
+
+	virtual void tick() {
+		ticks++;
+		if (cpu.getCycles() >= deadline) {
+			deadline = NO_EVENT;
+			cpu.interrupts.send(1);
+		}
+	}
+
+	virtual uint16_t interrupt() {
+		return 0;
+	}
+
+	virtual uint64_t getNextEvent() {
+		return deadline;
+	}
+};
+
+// 0000: IAS 0x0010
+// 0002: IFE B, 0
+// 0003: SUB PC, 2      (waits for the interrupt)
+// 0004: HCF 0
+// 0010: SET B, 1
+// 0011: RFI 0
+static void loadPollLoop(Dcpu &cpu) {
+	loadProgram(cpu, { 0x7d40, 0x0010, 0x8432, 0x8f83, 0x84e0 });
+	loadProgram(cpu, { 0x8821, 0x8560 }, 0x10);
+}
+
+// reads as 1 from the given cycle on, and as 0 before
+class ReadyRegister : public MemoryMappedDevice {
+public:
+	Dcpu &cpu;
+	uint64_t ready;
+
+	ReadyRegister(Dcpu &cpu, uint64_t ready) : cpu(cpu), ready(ready) {}
+
+	virtual uint16_t mappedRead(uint16_t, uint16_t) {
+		return cpu.getCycles() >= ready;
+	}
+
+	virtual void mappedWrite(uint16_t, uint16_t, uint16_t) {}
+};
+
+static uint64_t run(Dcpu &cpu, uint64_t maxCycles) {
+	uint64_t ticks = 0;
+	while (!cpu.isOnFire() && cpu.getCycles() < maxCycles) {
+		cpu.tick();
+		cpu.hardwareManager.tickAll();
+		ticks++;
+	}
+	return ticks;
+}
+
+static void expectSameState(Dcpu &expected, Dcpu &actual) {
+	EXPECT_EQ(expected.getCycles(), actual.getCycles());
+	EXPECT_EQ(expected.isOnFire(), actual.isOnFire());
+	for (uint8_t i = 0; i < 12; i++) {
+		EXPECT_EQ(expected.registers[static_cast<registers>(i)], actual.registers[static_cast<registers>(i)]);
+	}
+
+	ExecutionStats::Snapshot expectedStats = expected.stats.snapshot();
+	ExecutionStats::Snapshot actualStats = actual.stats.snapshot();
+	EXPECT_EQ(expectedStats.instructions, actualStats.instructions);
+	EXPECT_EQ(expectedStats.skipped, actualStats.skipped);
+	EXPECT_EQ(expectedStats.cycles, actualStats.cycles);
+	EXPECT_EQ(expectedStats.interruptsDelivered, actualStats.interruptsDelivered);
+	for (int i = 0; i < 32; i++) {
+		EXPECT_EQ(expectedStats.basicOpcodes[i], actualStats.basicOpcodes[i]);
+	}
+}
+
+TEST(IdleDetectorTest, SpinSkipsToLimit) {
+	// 0000: SUB PC, 1
+	Dcpu expected, actual;
+	expected.memory[0] = actual.memory[0] = 0x8b83;
+
+	IdleDetector idle(actual);
+	idle.setLimit(100001);
+	actual.idle = &idle;
+
+	run(expected, 100001);
+	uint64_t ticks = run(actual, 100001);
+
+	expectSameState(expected, actual);
+	EXPECT_LT(ticks, 10);
+	EXPECT_GT(idle.getSkippedCycles(), 99900);
+}
+
+TEST(IdleDetectorTest, PollLoopSkipsToDeviceEvent) {
+	Dcpu expected, actual;
+	loadPollLoop(expected);
+	loadPollLoop(actual);
+	auto expectedTimer = make_shared<TimerDevice>(expected, 50000);
+	auto actualTimer = make_shared<TimerDevice>(actual, 50000);
+	expected.hardwareManager.registerDevice(expectedTimer);
+	actual.hardwareManager.registerDevice(actualTimer);
+
+	IdleDetector idle(actual);
+	actual.idle = &idle;
+
+	run(expected, IdleDetector::NO_LIMIT);
+	run(actual, IdleDetector::NO_LIMIT);
+
+	expectSameState(expected, actual);
+	EXPECT_EQ(1, actual.registers.b);
+	EXPECT_LT(actualTimer->ticks, 20);
+	EXPECT_GT(expectedTimer->ticks, 10000);
+}
+
+TEST(IdleDetectorTest, DevicesWithoutEventsKeepEveryCycle) {
+	Dcpu cpu;
+	loadPollLoop(cpu);
+	cpu.hardwareManager.registerDevice(make_shared<TestHardware>(cpu));
+
+	IdleDetector idle(cpu);
+	idle.setLimit(1000);
+	cpu.idle = &idle;
+	run(cpu, 1000);
+
+	EXPECT_EQ(0, idle.getSkippedCycles());
+	EXPECT_EQ(1000, cpu.getCycles());
+}
+
+TEST(IdleDetectorTest, BusyLoopIsNotSkipped) {
+	// 0000: ADD I, 1
+	// 0001: SUB PC, 2
+	Dcpu cpu;
+	cpu.memory[0] = 0x88c2;
+	cpu.memory[1] = 0x8f83;
+
+	IdleDetector idle(cpu);
+	idle.setLimit(10000);
+	cpu.idle = &idle;
+	run(cpu, 10000);
+
+	EXPECT_EQ(0, idle.getSkippedCycles());
+	EXPECT_EQ(2500, cpu.registers.i);
+}
+
+TEST(IdleDetectorTest, MappedPagesKeepEveryCycle) {
+	// 0000: IFE [0x8000], 0
+	// 0002: SUB PC, 3
+	// 0003: HCF 0
+	Dcpu cpu;
+	loadProgram(cpu, { 0x87d2, 0x8000, 0x9383, 0x84e0 });
+	ReadyRegister status(cpu, 5000);
+	cpu.memory.mapDevice(0x80, 1, &status);
+
+	IdleDetector idle(cpu);
+	idle.setLimit(100000);
+	cpu.idle = &idle;
+	run(cpu, 100000);
+
+	EXPECT_TRUE(cpu.isOnFire());
+	EXPECT_EQ(0, idle.getSkippedCycles());
+	EXPECT_LT(cpu.getCycles(), 5010);
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include <dcpu.hpp>
+#include <link.hpp>
+#include <cluster.hpp>
+
+using namespace std;
+using namespace dcpu::emulator;
+
+static uint16_t command(Dcpu &cpu, LinkDevice &device, uint16_t a, uint16_t b=0, uint16_t c=0) {
+	cpu.registers.a = a;
+	cpu.registers.b = b;
+	cpu.registers.c = c;
+	device.interrupt();
+	return cpu.registers.c;
+}
+
+TEST(LinkDeviceTest, MessagesArriveAfterTheLatency) {
+	Dcpu sender, receiver;
+	auto link = LinkDevice::connect(sender, receiver, 10);
+	LinkDevice &out = *link.first;
+	LinkDevice &in = *link.second;
+
+	sender.memory[0x100] = 1;
+	sender.memory[0x101] = 2;
+	sender.memory[0x102] = 3;
+	EXPECT_EQ(3, command(sender, out, LinkDevice::SEND, 0x100, 3));
+
+	command(receiver, in, LinkDevice::SET_INTERRUPT, 0x77);
+	receiver.memory[0] = 0x8b83;
+	receiver.registers.ia = 0x200;
+	receiver.registers.sp = 0;
+	for (int i = 0; i < 5; i++) {
+		// SUB PC, 1 takes two cycles
+		in.tick();
+		EXPECT_EQ(0, receiver.registers.pc);
+		receiver.tick();
+	}
+
+	EXPECT_EQ(10, receiver.getCycles());
+	in.tick();
+	EXPECT_EQ(0x200, receiver.registers.pc);
+	EXPECT_EQ(0x77, receiver.registers.a);
+
+	command(receiver, in, LinkDevice::STATUS);
+	EXPECT_EQ(1, receiver.registers.b);
+	EXPECT_EQ(2, command(receiver, in, LinkDevice::RECEIVE, 0x300, 2));
+	EXPECT_EQ(1, receiver.memory[0x300]);
+	EXPECT_EQ(2, receiver.memory[0x301]);
+	EXPECT_EQ(0, receiver.memory[0x302]);
+	EXPECT_EQ(0, command(receiver, in, LinkDevice::RECEIVE, 0x300, 2));
+}
+
+TEST(LinkDeviceTest, FullLinkRefusesSends) {
+	Dcpu sender, receiver;
+	auto link = LinkDevice::connect(sender, receiver);
+
+	for (uint32_t i = 0; i < LinkRing::SLOTS; i++) {
+		EXPECT_EQ(1, command(sender, *link.first, LinkDevice::SEND, 0, 1));
+	}
+	EXPECT_EQ(0, command(sender, *link.first, LinkDevice::SEND, 0, 1));
+	command(sender, *link.first, LinkDevice::STATUS);
+	EXPECT_EQ(0, sender.registers.c);
+}
+
+// sender:
+// 0000: ADD X, 1
+// 0001: SET [0x100], X
+// 0003: SET A, 0          (SEND)
+// 0004: SET B, 0x100
+// 0006: SET C, 1
+// 0007: HWI 0
+// 0008: IFN X, 20
+// 0009: SET PC, 0
+// 000a: HCF 0
+static const uint16_t senderProgram[] = { 0x8862, 0x0fc1, 0x0100, 0x8401, 0x7c21, 0x0100, 0x8841, 0x8640, 0xd473,
+	0x8781, 0x84e0 };
+
+// receiver:
+// 0000: SET A, 3          (STATUS)
+// 0001: HWI 0
+// 0002: IFE B, 0
+// 0003: SET PC, 0
+// 0004: SET A, 1          (RECEIVE)
+// 0005: SET B, 0x1000
+// 0007: ADD B, Y
+// 0008: SET C, 1
+// 0009: HWI 0
+// 000a: ADD Y, 1
+// 000b: SET PC, 0
+static const uint16_t receiverProgram[] = { 0x9001, 0x8640, 0x8432, 0x8781, 0x8801, 0x7c21, 0x1000, 0x1022, 0x8841,
+	0x8640, 0x8882, 0x8781 };
+
+static vector<uint16_t> runLink(uint64_t quantum) {
+	DcpuCluster cluster(2, quantum);
+	Dcpu &sender = cluster.getCore(0);
+	Dcpu &receiver = cluster.getCore(1);
+	auto link = LinkDevice::connect(sender, receiver, 500);
+	sender.hardwareManager.registerDevice(link.first);
+	receiver.hardwareManager.registerDevice(link.second);
+
+	for (uint16_t i = 0; i < sizeof(senderProgram) / sizeof(senderProgram[0]); i++) {
+		sender.memory[i] = senderProgram[i];
+	}
+	for (uint16_t i = 0; i < sizeof(receiverProgram) / sizeof(receiverProgram[0]); i++) {
+		receiver.memory[i] = receiverProgram[i];
+	}
+
+	cluster.run(5000);
+	EXPECT_TRUE(sender.isOnFire());
+
+	vector<uint16_t> received;
+	for (uint16_t i = 0; i < receiver.registers.y; i++) {
+		received.push_back(receiver.memory[0x1000 + i]);
+	}
+	// where the receiver was when each message arrived
+	received.push_back(receiver.registers.pc);
+	received.push_back(receiver.getCycles());
+	return received;
+}
+
+TEST(LinkDeviceTest, ClusterRunsRepeat) {
+	vector<uint16_t> received = runLink(100);
+	ASSERT_EQ(22, received.size());
+	for (uint16_t i = 0; i < 20; i++) {
+		EXPECT_EQ(i + 1, received[i]);
+	}
+
+	EXPECT_EQ(received, runLink(100));
+	EXPECT_EQ(received, runLink(400));
+}
+
+TEST(LinkChannelTest, FilesAreMadeOnce) {
+	string path = "/tmp/dcpu-link-test-" + to_string(getpid());
+	uint16_t words[] = { 4, 5 };
+
+	shared_ptr<LinkChannel> sender = LinkChannel::map(path);
+	EXPECT_TRUE(sender->send(10, words, 2));
+
+	// a second mapping finds the message rather than a new ring
+	shared_ptr<LinkChannel> receiver = LinkChannel::map(path);
+	ASSERT_NE(nullptr, receiver->peek());
+	EXPECT_EQ(5, receiver->peek()->words[1]);
+	remove(path.c_str());
+
+	FILE *out = fopen(path.c_str(), "w");
+	fputs("not a link", out);
+	fclose(out);
+	EXPECT_THROW(LinkChannel::map(path), runtime_error);
+	remove(path.c_str());
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <sstream>
+
+#include <dcpu.hpp>
+#include <markers.hpp>
+#include "utils/test_program.hpp"
+
+using namespace std;
+using namespace dcpu::emulator;
+
+// 0000: SET A, 1          (START)
+// 0001: SET B, 3
+// 0002: HWI 0
+// 0003: SET X, X
+// 0004: SET X, X
+// 0005: SET X, X
+// 0006: SET A, 2          (STOP)
+// 0007: HWI 0
+// 0008: SUB I, 1
+// 0009: IFN I, 0
+// 000a: SET PC, 0
+// 000b: HCF 0
+static void loadExample(Dcpu &cpu) {
+	loadProgram(cpu, { 0x8801, 0x9021, 0x8640, 0x0c61, 0x0c61, 0x0c61, 0x8c01, 0x8640, 0x88c3, 0x84d3, 0x8781,
+		0x84e0 });
+}
+
+TEST(BenchmarkMarkersTest, MeasuresEachPass) {
+	Dcpu cpu;
+	auto markers = make_shared<BenchmarkMarkers>(cpu);
+	cpu.hardwareManager.registerDevice(markers);
+	loadExample(cpu);
+	cpu.registers.i = 2;
+
+	// LABEL 3, with a quote that is replaced
+	const char *name = "co\"py";
+	for (uint16_t i = 0; name[i]; i++) {
+		cpu.memory[0x100 + i] = name[i];
+	}
+	cpu.registers.a = BenchmarkMarkers::LABEL;
+	cpu.registers.b = 3;
+	cpu.registers.c = 0x100;
+	markers->interrupt();
+	cpu.registers.a = 0;
+	cpu.registers.b = 0;
+	cpu.registers.c = 0;
+
+	while (!cpu.isOnFire()) {
+		cpu.tick();
+	}
+
+	// each pass is the START HWI, three SETs and the SET before STOP
+	const BenchmarkMarkers::Region &region = markers->getRegion(3);
+	EXPECT_EQ("co?py", region.name);
+	EXPECT_EQ(2, region.passes);
+	EXPECT_EQ(16, region.cycles);
+	EXPECT_EQ(8, region.minCycles);
+	EXPECT_EQ(8, region.maxCycles);
+	EXPECT_EQ(10, region.instructions);
+	EXPECT_FALSE(region.running);
+
+	ostringstream json;
+	markers->writeJson(json);
+	EXPECT_EQ("[\n\t{\"region\": 3, \"name\": \"co?py\", \"passes\": 2, \"cycles\": 16, \"min_cycles\": 8, "
+			"\"max_cycles\": 8, \"instructions\": 10, \"interrupts\": 0}\n]\n", json.str());
+
+	markers->reset();
+	EXPECT_EQ(0, markers->getRegion(3).passes);
+}
+
+TEST(BenchmarkMarkersTest, StopWithoutStartIsIgnored) {
+	Dcpu cpu;
+	BenchmarkMarkers markers(cpu);
+	cpu.registers.a = BenchmarkMarkers::STOP;
+	cpu.registers.b = 1;
+	markers.interrupt();
+
+	EXPECT_EQ(0, markers.getRegion(1).passes);
+	ostringstream json;
+	markers.writeJson(json);
+	EXPECT_EQ("[\n]\n", json.str());
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <sstream>
+
+#include <dcpu.hpp>
+#include <memory_stats.hpp>
+#include <opcodes.hpp>
+
+using namespace std;
+using namespace dcpu::emulator;
+
+TEST(MemoryAccessStatsTest, CountsPerWord) {
+	Dcpu cpu;
+	MemoryAccessStats stats(cpu);
+
+	stats.recordRead(0x1000);
+	stats.recordRead(0x1000);
+	stats.recordWrite(0x1000);
+	stats.recordFetch(0x0000);
+
+	EXPECT_EQ(2, stats.getReads(0x1000));
+	EXPECT_EQ(1, stats.getWrites(0x1000));
+	EXPECT_EQ(1, stats.getFetches(0x0000));
+	EXPECT_EQ(0, stats.getReads(0x1001));
+}
+
+TEST(MemoryAccessStatsTest, WorkingSetPerWindow) {
+	Dcpu cpu;
+	MemoryAccessStats stats(cpu, 4);
+
+	// SET A, 1 takes one cycle, so each instruction advances the window clock by one.
+	for (int i = 0; i < 10; i++) {
+		cpu.memory[i] = 0x8801;
+	}
+
+	for (int i = 0; i < 10; i++) {
+		stats.recordRead(0x2000);
+		stats.recordWrite(0x3000 + i);
+		cpu.tick();
+	}
+	stats.finish();
+
+	// windows: cycles 0-3, 4-7 and 8-9 each touch 0x2000 plus one fresh word per cycle
+	ASSERT_EQ(3, stats.getWorkingSets().size());
+	EXPECT_EQ(5, stats.getWorkingSets()[0]);
+	EXPECT_EQ(5, stats.getWorkingSets()[1]);
+	EXPECT_EQ(3, stats.getWorkingSets()[2]);
+}
+
+TEST(MemoryAccessStatsTest, Heatmap) {
+	Dcpu cpu;
+	MemoryAccessStats stats(cpu);
+
+	stats.recordWrite(0x0101);
+
+	stringstream heatmap;
+	stats.writeHeatmap(heatmap);
+
+	string header;
+	getline(heatmap, header);
+	EXPECT_EQ("P2", header);
+	getline(heatmap, header);
+	EXPECT_EQ("256 256", header);
+	getline(heatmap, header);
+
+	string row;
+	getline(heatmap, row);
+	EXPECT_EQ(string::npos, row.find("255"));
+	getline(heatmap, row);
+	EXPECT_EQ(0, row.find("0 255 0"));
+}
+
+#ifdef DCPU_MEMORY_STATS
+TEST(MemoryAccessStatsTest, OperandAndStackHooks) {
+	Dcpu cpu;
+	MemoryAccessStats stats(cpu);
+	cpu.memory.stats = &stats;
+
+	// SET [0x1000], POP
+	cpu.memory[0] = 0x63c1;
+	cpu.memory[1] = 0x1000;
+	cpu.registers.sp = 0xfffe;
+	cpu.tick();
+
+	EXPECT_EQ(1, stats.getFetches(0));
+	EXPECT_EQ(1, stats.getFetches(1));
+	EXPECT_EQ(1, stats.getReads(0xfffe));
+	EXPECT_EQ(1, stats.getWrites(0x1000));
+}
+#endif
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include <dcpu.hpp>
+
+using namespace std;
+using namespace dcpu::emulator;
+
+static shared_ptr<const MemoryImage> makeImage() {
+	vector<uint16_t> words(0x300);
+	for (uint16_t i = 0; i < words.size(); i++) {
+		words[i] = i * 3;
+	}
+	return make_shared<MemoryImage>(words.data(), words.size());
+}
+
+TEST(DcpuMemoryTest, PagesStaySharedUntilWritten) {
+	shared_ptr<const MemoryImage> image = makeImage();
+	Dcpu first, second;
+	first.load(image);
+	second.load(image);
+
+	EXPECT_EQ(0, first.memory.getPrivatePageCount());
+	EXPECT_EQ(image->getWords(), first.memory.getPage(0));
+	EXPECT_EQ(first.memory.getPage(1), second.memory.getPage(1));
+	EXPECT_EQ(0x201 * 3, first.memory.read(0x201));
+	EXPECT_EQ(0, first.memory.read(0x300));
+
+	first.memory.write(0x0105, 7);
+	EXPECT_EQ(1, first.memory.getPrivatePageCount());
+	EXPECT_FALSE(first.memory.isPageShared(0x01));
+	EXPECT_TRUE(first.memory.isPageShared(0x02));
+	EXPECT_EQ(7, first.memory.read(0x0105));
+	EXPECT_EQ(0x0104 * 3, first.memory.read(0x0104));
+	EXPECT_EQ(0x0105 * 3, second.memory.read(0x0105));
+	EXPECT_EQ(0x0105 * 3, image->getWords()[0x0105]);
+
+	// raw reads leave the page shared, raw access copies it
+	EXPECT_EQ(0x0205 * 3, first.memory.peek(0x0205));
+	EXPECT_TRUE(first.memory.isPageShared(0x02));
+	first.memory[0x0205] = 9;
+	EXPECT_EQ(2, first.memory.getPrivatePageCount());
+	EXPECT_EQ(0x0205 * 3, second.memory.peek(0x0205));
+
+	// loading again resets to the image
+	first.load(image);
+	EXPECT_EQ(0, first.memory.getPrivatePageCount());
+	EXPECT_EQ(0x0105 * 3, first.memory.read(0x0105));
+}
+
+TEST(DcpuMemoryTest, SharingIsHiddenFromPageFlags) {
+	Dcpu cpu;
+	cpu.load(makeImage());
+
+	EXPECT_EQ(0, cpu.memory.getPageFlags(0x01));
+	cpu.memory.setPageFlags(0x01, 0xff);
+	cpu.memory.clearPageFlags(0x01, 0xff);
+	EXPECT_EQ(0, cpu.memory.getPageFlags(0x01));
+	EXPECT_TRUE(cpu.memory.isPageShared(0x01));
+
+	cpu.memory.markClean();
+	cpu.memory.write(0x0100, 1);
+	EXPECT_TRUE(cpu.memory.isPageDirty(0x01));
+	EXPECT_FALSE(cpu.memory.isPageDirty(0x02));
+	EXPECT_FALSE(cpu.memory.isPageShared(0x01));
+}
+
+TEST(DcpuMemoryTest, ClearSharesTheEmptyImage) {
+	Dcpu cpu;
+	cpu.memory.write(0x8000, 1);
+	cpu.clear();
+
+	EXPECT_EQ(0, cpu.memory.getPrivatePageCount());
+	EXPECT_EQ(MemoryImage::empty()->getWords(), cpu.memory.getPage(0));
+	EXPECT_EQ(0, cpu.memory.read(0x8000));
+}
+
+class StatusRegister : public MemoryMappedDevice {
+public:
+	DcpuMemory::Journal writes;
+
+	virtual uint16_t mappedRead(uint16_t address, uint16_t stored) {
+		return address == 0x8000 ? 0x1234 : stored;
+	}
+
+	virtual void mappedWrite(uint16_t address, uint16_t, uint16_t value) {
+		writes.push_back(make_pair(address, value));
+	}
+};
+
+TEST(DcpuMemoryTest, MappedPagesGoToTheDevice) {
+	Dcpu cpu;
+	StatusRegister device;
+	cpu.memory.mapDevice(0x80, 1, &device);
+	EXPECT_EQ(&device, cpu.memory.getMappedDevice(0x80));
+	EXPECT_EQ(0, cpu.memory.getPageFlags(0x80));
+
+	// SET A, [0x8000]
+	// SET [0x8001], A
+	cpu.memory[0] = 0x7801;
+	cpu.memory[1] = 0x8000;
+	cpu.memory[2] = 0x03c1;
+	cpu.memory[3] = 0x8001;
+	cpu.tick();
+	cpu.tick();
+	EXPECT_EQ(0x1234, cpu.registers.a);
+	ASSERT_EQ(1, device.writes.size());
+	EXPECT_EQ(0x8001, device.writes[0].first);
+	EXPECT_EQ(0x1234, device.writes[0].second);
+	EXPECT_EQ(0x1234, cpu.memory.read(0x8001));
+	EXPECT_EQ(0, cpu.memory.peek(0x8000));
+
+	cpu.memory.write(0x8100, 1);
+	uint16_t words[3] = { 1, 2, 3 };
+	cpu.memory.writeBlock(0x80fe, words, 3);
+	EXPECT_EQ(3, device.writes.size());
+	cpu.memory.readBlock(0x7fff, words, 3);
+	EXPECT_EQ(0x1234, words[1]);
+
+	cpu.memory.unmapDevice(0x80, 1);
+	EXPECT_EQ(nullptr, cpu.memory.getMappedDevice(0x80));
+	cpu.memory.write(0x8000, 5);
+	EXPECT_EQ(5, cpu.memory.read(0x8000));
+	EXPECT_EQ(3, device.writes.size());
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+#include <thread>
+
+#include <dcpu.hpp>
+#include <hardware.hpp>
+#include <pool.hpp>
+
+using namespace std;
+using namespace dcpu::emulator;
+
+class CountingDevice : public HardwareDevice {
+public:
+	uint32_t interrupts;
+	uint32_t resets;
+
+	CountingDevice(Dcpu &cpu) : HardwareDevice(cpu, 0, 0, 0), interrupts(0), resets(0) {}
+
+	virtual void tick() {}
+
+	virtual uint16_t interrupt() {
+		interrupts++;
+		return 0;
+	}
+
+	virtual void reset() {
+		interrupts = 0;
+		resets++;
+	}
+};
+
+// 0000: SET [0x1000], 3
+// 0002: SET A, 2
+// 0003: HWI 0
+// 0004: HCF 0
+static shared_ptr<const MemoryImage> makeImage() {
+	const vector<uint16_t> program = { 0x9001 | (0x1e << 5), 0x1000, 0x8c01, 0x8640, 0x84e0 };
+	return make_shared<MemoryImage>(program.data(), program.size());
+}
+
+static void run(Dcpu &cpu) {
+	while (!cpu.isOnFire()) {
+		cpu.tick();
+	}
+}
+
+TEST(DcpuPoolTest, ReleasedInstancesComeBackPristine) {
+	shared_ptr<const MemoryImage> image = makeImage();
+	vector<CountingDevice*> devices;
+	DcpuPool pool(image, [&devices] (Dcpu &cpu) {
+		auto device = make_shared<CountingDevice>(cpu);
+		devices.push_back(device.get());
+		cpu.hardwareManager.registerDevice(device);
+	});
+
+	unique_ptr<Dcpu> cpu = pool.acquire();
+	Dcpu *first = cpu.get();
+	run(*cpu);
+	EXPECT_EQ(3, cpu->memory.read(0x1000));
+	EXPECT_EQ(2, cpu->registers.a);
+	EXPECT_EQ(1, devices[0]->interrupts);
+	EXPECT_EQ(1, cpu->memory.getPrivatePageCount());
+
+	pool.release(move(cpu));
+	EXPECT_EQ(1, pool.getAvailableCount());
+
+	cpu = pool.acquire();
+	EXPECT_EQ(first, cpu.get());
+	EXPECT_EQ(1, pool.getCreatedCount());
+	EXPECT_EQ(0, cpu->memory.getPrivatePageCount());
+	EXPECT_EQ(0, cpu->memory.read(0x1000));
+	EXPECT_EQ(0, cpu->registers.a);
+	EXPECT_EQ(0, cpu->registers.pc);
+	EXPECT_EQ(0, cpu->getCycles());
+	EXPECT_FALSE(cpu->isOnFire());
+	EXPECT_EQ(0, cpu->stats.snapshot().instructions);
+	EXPECT_EQ(0, devices[0]->interrupts);
+	EXPECT_EQ(1, devices[0]->resets);
+	EXPECT_EQ(1, devices.size());
+
+	run(*cpu);
+	uint64_t cycles = cpu->getCycles();
+	pool.release(move(cpu));
+
+	// a new instance runs the job the same as a reused one
+	cpu = pool.acquire();
+	unique_ptr<Dcpu> second = pool.acquire();
+	EXPECT_EQ(2, pool.getCreatedCount());
+	run(*second);
+	EXPECT_EQ(cycles, second->getCycles());
+	EXPECT_EQ(image->getWords() + 0x1000, cpu->memory.getPage(0x10));
+}
+
+TEST(DcpuPoolTest, SharedAcrossThreads) {
+	DcpuPool pool(makeImage(), DcpuPool::Setup(), 4);
+	EXPECT_EQ(4, pool.getAvailableCount());
+
+	vector<thread> threads;
+	for (int t = 0; t < 4; t++) {
+		threads.push_back(thread([&pool] {
+			for (int i = 0; i < 100; i++) {
+				unique_ptr<Dcpu> cpu = pool.acquire();
+				EXPECT_EQ(0, cpu->memory.read(0x1000));
+				run(*cpu);
+				pool.release(move(cpu));
+			}
+		}));
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	EXPECT_EQ(pool.getCreatedCount(), pool.getAvailableCount());
+	EXPECT_LE(pool.getCreatedCount(), 8);
+}
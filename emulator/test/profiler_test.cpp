@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <initializer_list>
+
+#include <dcpu.hpp>
+#include <profiler.hpp>
+
+using namespace std;
+using namespace dcpu::emulator;
+
+static void loadProgram(Dcpu &cpu, uint16_t address, initializer_list<uint16_t> words) {
+	for (auto word : words) {
+		cpu.memory[address++] = word;
+	}
+}
+
+static void run(Dcpu &cpu) {
+	while (!cpu.isOnFire()) {
+		cpu.tick();
+	}
+}
+
+class CallProfilerTest : public ::testing::Test {
+public:
+	void SetUp() {
+		// 0x00: JSR 0x10
+		// 0x02: HCF 0
+		loadProgram(cpu, 0x00, {0x7c20, 0x0010, 0x84e0});
+		// 0x10: SET A, 1
+		// 0x11: JSR 0x20
+		// 0x13: SET PC, POP
+		loadProgram(cpu, 0x10, {0x8801, 0x7c20, 0x0020, 0x6381});
+		// 0x20: SET B, 1
+		// 0x21: SET PC, POP
+		loadProgram(cpu, 0x20, {0x8821, 0x6381});
+	}
+protected:
+	Dcpu cpu;
+};
+
+TEST_F(CallProfilerTest, InclusiveAndExclusiveCycles) {
+	CallProfiler profiler(cpu);
+	cpu.profiler = &profiler;
+	profiler.start(cpu.registers.pc);
+
+	run(cpu);
+	profiler.finish();
+
+	stringstream report;
+	profiler.writeReport(report);
+
+	EXPECT_NE(string::npos, report.str().find("0x0010                1              8"));
+	EXPECT_NE(string::npos, report.str().find("0x0020                1              2"));
+	EXPECT_NE(string::npos, report.str().find("Total cycles: 13"));
+}
+
+TEST_F(CallProfilerTest, FoldedStacks) {
+	CallProfiler profiler(cpu);
+	cpu.profiler = &profiler;
+	profiler.start(cpu.registers.pc);
+
+	run(cpu);
+	profiler.finish();
+
+	stringstream folded;
+	profiler.writeFoldedStacks(folded);
+
+	EXPECT_EQ("0x0000 5\n0x0000;0x0010 6\n0x0000;0x0010;0x0020 2\n", folded.str());
+}
+
+TEST_F(CallProfilerTest, InterruptFrames) {
+	// 0x00: IAS 0x30
+	// 0x02: INT 1
+	// 0x03: HCF 0
+	loadProgram(cpu, 0x00, {0x7d40, 0x0030, 0x8900, 0x84e0});
+	// 0x30: SET A, 1
+	// 0x31: RFI 0
+	loadProgram(cpu, 0x30, {0x8801, 0x8560});
+
+	CallProfiler profiler(cpu);
+	cpu.profiler = &profiler;
+	profiler.start(cpu.registers.pc);
+
+	run(cpu);
+	profiler.finish();
+
+	stringstream folded;
+	profiler.writeFoldedStacks(folded);
+
+	// the handler is entered once INT has taken its 4 cycles, and SET and RFI take 4 more
+	EXPECT_NE(string::npos, folded.str().find("0x0000;irq@0x0030 4\n"));
+	EXPECT_EQ(0, cpu.registers.sp);
+}
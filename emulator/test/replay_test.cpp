@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <unistd.h>
+
+#include <dcpu.hpp>
+#include <hardware.hpp>
+#include <replay.hpp>
+#include <debugger.hpp>
+#include <timeline.hpp>
+#include "utils/test_program.hpp"
+
+using namespace std;
+using namespace dcpu::emulator;
+
+// A device driven by a pseudo random generator, standing in for keyboards,
+// clocks and host files.
+class NoisyHardware : public HardwareDevice {
+	uint32_t state;
+
+	uint16_t next() {
+		state = state * 1103515245 + 12345;
+		return state >> 16;
+	}
+public:
+	uint64_t ticks;
+	uint64_t calls;
+
+	NoisyHardware(Dcpu &cpu, uint32_t seed) : HardwareDevice(cpu, 0, 0, 0), state(seed), ticks(0), calls(0) {}
+
+	virtual void tick() {
+		uint16_t value = next();
+		if (++ticks % 29 == 0) {
+			cpu.memory.write(0x3000, value);
+		}
+		if (ticks % 41 == 0) {
+			cpu.interrupts.send(value);
+		}
+	}
+
+	virtual uint16_t interrupt() {
+		cpu.registers.b = next();
+		cpu.memory.write(0x2000 + (calls & 0xf), cpu.registers.b);
+		return calls++ % 3;
+	}
+};
+
+// 0000: IAS 0x0010
+// 0002: HWI 0
+// 0003: ADD [0x1000], B
+// 0005: SET A, [0x3000]
+// 0007: ADD [0x1001], A
+// 0009: ADD I, 1
+// 000a: SET PC, 2
+// 0010: ADD J, A       (interrupt handler)
+// 0011: RFI 0
+static shared_ptr<NoisyHardware> loadExample(Dcpu &cpu, uint32_t seed) {
+	loadProgram(cpu, { 0x7d40, 0x0010, 0x8640, 0x07c2, 0x1000, 0x7801, 0x3000, 0x03c2, 0x1001, 0x88c2, 0x8b81 });
+	loadProgram(cpu, { 0x00e2, 0x8560 }, 0x10);
+
+	auto device = make_shared<NoisyHardware>(cpu, seed);
+	cpu.hardwareManager.registerDevice(device);
+	return device;
+}
+
+static void run(Dcpu &cpu, uint64_t cycles) {
+	while (cpu.getCycles() < cycles) {
+		cpu.tick();
+		cpu.hardwareManager.tickAll();
+	}
+}
+
+class ReplayTest : public ::testing::Test {
+public:
+	void SetUp() {
+		char path[] = "/tmp/dcpu-input-XXXXXX";
+		int fd = mkstemp(path);
+		close(fd);
+		filename = path;
+	}
+
+	void TearDown() {
+		remove(filename.c_str());
+	}
+protected:
+	string filename;
+
+	uint64_t record(uint64_t cycles, bool finish=true) {
+		Dcpu cpu;
+		loadExample(cpu, 1);
+		InputRecorder recorder(cpu, filename);
+		run(cpu, cycles);
+		if (finish) {
+			recorder.finish();
+		}
+
+		EXPECT_GT(recorder.getRecordCount(), 100);
+		EXPECT_GT(cpu.registers.j, 0);
+		return InputLog::hashState(cpu);
+	}
+};
+
+TEST_F(ReplayTest, ReproducesRun) {
+	uint64_t hash = record(20000);
+
+	Dcpu cpu;
+	auto device = loadExample(cpu, 99);
+	InputReplayer replayer(cpu, filename);
+	while (!replayer.isFinished()) {
+		cpu.tick();
+		cpu.hardwareManager.tickAll();
+	}
+
+	EXPECT_TRUE(replayer.isMatched());
+	EXPECT_EQ(hash, InputLog::hashState(cpu));
+	EXPECT_EQ(0, device->ticks);
+	EXPECT_EQ(0, device->calls);
+
+	// past the end of the log the devices take over
+	cpu.tick();
+	cpu.hardwareManager.tickAll();
+	EXPECT_EQ(1, device->ticks);
+}
+
+TEST_F(ReplayTest, DetectsChangedState) {
+	record(20000);
+
+	Dcpu cpu;
+	loadExample(cpu, 1);
+	cpu.memory[0x1001] = 1;
+	InputReplayer replayer(cpu, filename);
+	while (!replayer.isFinished()) {
+		cpu.tick();
+		cpu.hardwareManager.tickAll();
+	}
+
+	EXPECT_FALSE(replayer.isMatched());
+}
+
+TEST_F(ReplayTest, DetectsChangedTiming) {
+	record(20000);
+
+	Dcpu cpu;
+	loadExample(cpu, 1);
+	cpu.memory[0x09] = 0x88c1; // SET I, 1 takes a cycle less than ADD I, 1
+	InputReplayer replayer(cpu, filename);
+
+	EXPECT_THROW(run(cpu, 20000), runtime_error);
+}
+
+TEST_F(ReplayTest, UnfinishedLogHandsOverToDevices) {
+	record(5000, false);
+
+	Dcpu cpu;
+	auto device = loadExample(cpu, 1);
+	InputReplayer replayer(cpu, filename);
+	run(cpu, 10000);
+
+	EXPECT_TRUE(replayer.isFinished());
+	EXPECT_FALSE(replayer.isMatched());
+	EXPECT_GT(device->ticks, 0);
+	EXPECT_LT(device->ticks, 10000);
+}
+
+TEST_F(ReplayTest, StepBackThroughReplay) {
+	record(3000);
+
+	Dcpu cpu;
+	loadExample(cpu, 7);
+	InputReplayer replayer(cpu, filename);
+	Debugger debugger(cpu);
+	Timeline timeline(cpu, 100);
+
+	EXPECT_EQ(StopReason::CYCLE_REACHED, debugger.runToCycle(2000));
+	uint64_t hash = InputLog::hashState(cpu);
+	uint64_t cycles = cpu.getCycles();
+
+	for (int i = 0; i < 50; i++) {
+		ASSERT_EQ(StopReason::STEP, debugger.stepBack());
+	}
+	for (int i = 0; i < 50; i++) {
+		ASSERT_EQ(StopReason::STEP, debugger.step());
+	}
+
+	EXPECT_EQ(cycles, cpu.getCycles());
+	EXPECT_EQ(hash, InputLog::hashState(cpu));
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <cstdio>
+
+#include <unistd.h>
+
+#include <dcpu.hpp>
+#include <shared_state.hpp>
+#include "utils/test_program.hpp"
+
+using namespace std;
+using namespace dcpu::emulator;
+
+class StateFile {
+public:
+	string path;
+
+	StateFile() : path("/tmp/dcpu-state-test-" + to_string(getpid())) {}
+
+	~StateFile() {
+		remove(path.c_str());
+	}
+};
+
+// 0000: SET A, 5
+// 0001: SET [0x1000], A
+// 0003: ADD A, 1
+// 0004: HCF 0
+static void loadExample(Dcpu &cpu) {
+	loadProgram(cpu, { 0x9801, 0x03c1, 0x1000, 0x8802, 0x84e0 });
+}
+
+TEST(StateSegmentTest, PublishesToOtherMappings) {
+	StateFile file;
+	Dcpu cpu;
+	loadExample(cpu);
+
+	unique_ptr<StateSegment> segment = StateSegment::create(file.path);
+	segment->attach(cpu);
+
+	unique_ptr<StateSegment> observer = StateSegment::open(file.path, false);
+	EXPECT_EQ(MachineState::RUNNING, observer->read().status);
+	EXPECT_EQ(getpid(), observer->read().pid);
+	EXPECT_EQ(0x9801, observer->get().memory[0]);
+
+	cpu.tick();
+	cpu.tick();
+	segment->publish(cpu);
+
+	// memory is shared as it is written, registers once published
+	EXPECT_EQ(5, observer->get().memory[0x1000]);
+	StateSegment::Snapshot snapshot = observer->read();
+	EXPECT_EQ(5, snapshot.registers[0]);
+	EXPECT_EQ(3, snapshot.registers[9]);
+	EXPECT_EQ(cpu.getCycles(), snapshot.cycles);
+
+	while (!cpu.isOnFire()) {
+		cpu.tick();
+	}
+	segment->finish(cpu, MachineState::ON_FIRE);
+	EXPECT_EQ(MachineState::ON_FIRE, observer->read().status);
+	EXPECT_EQ(6, observer->read().registers[0]);
+}
+
+TEST(StateSegmentTest, ResumesInAnotherCpu) {
+	StateFile file;
+	uint64_t cycles;
+	{
+		Dcpu cpu;
+		loadExample(cpu);
+
+		unique_ptr<StateSegment> segment = StateSegment::create(file.path);
+		segment->attach(cpu);
+		cpu.tick();
+		cpu.tick();
+		segment->publish(cpu);
+		cycles = cpu.getCycles();
+
+		// this process still runs it
+		Dcpu other;
+		EXPECT_THROW(StateSegment::open(file.path)->resume(other), runtime_error);
+		segment->finish(cpu, MachineState::STOPPED);
+	}
+
+	Dcpu cpu;
+	unique_ptr<StateSegment> segment = StateSegment::open(file.path);
+	segment->resume(cpu);
+	EXPECT_EQ(5, cpu.registers.a);
+	EXPECT_EQ(3, cpu.registers.pc);
+	EXPECT_EQ(cycles, cpu.getCycles());
+	EXPECT_EQ(5, cpu.memory.read(0x1000));
+
+	cpu.tick();
+	EXPECT_EQ(6, cpu.registers.a);
+
+	StateFile copy;
+	copy.path += "-copy";
+	segment->publish(cpu);
+	segment->checkpoint(copy.path);
+
+	unique_ptr<StateSegment> checkpoint = StateSegment::open(copy.path);
+	EXPECT_EQ(MachineState::STOPPED, checkpoint->read().status);
+	Dcpu migrated;
+	checkpoint->resume(migrated);
+	EXPECT_EQ(6, migrated.registers.a);
+	EXPECT_EQ(4, migrated.registers.pc);
+	EXPECT_EQ(5, migrated.memory.read(0x1000));
+}
+
+TEST(StateSegmentTest, RejectsOtherFiles) {
+	StateFile file;
+	FILE *out = fopen(file.path.c_str(), "w");
+	fputs("not a state", out);
+	fclose(out);
+
+	EXPECT_THROW(StateSegment::open(file.path), runtime_error);
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <sstream>
+#include <memory>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <dcpu.hpp>
+#include <stats.hpp>
+#include "utils/test_hardware.hpp"
+#include "utils/test_program.hpp"
+
+using namespace std;
+using namespace dcpu::emulator;
+
+// 0000: SET A, 1
+// 0001: IFE A, 2
+// 0002: SET B, [0x1000]    (skipped)
+// 0004: HWI 0
+// 0005: SET PUSH, A
+static void runProgram(Dcpu &cpu) {
+	loadProgram(cpu, { 0x8801, 0x8c12, 0x7821, 0x1000, 0x8640, 0x0301 });
+
+	cpu.hardwareManager.registerDevice(make_shared<TestHardware>(cpu));
+	while (cpu.registers.pc < 6) {
+		cpu.tick();
+	}
+}
+
+TEST(ExecutionStatsTest, CountsInstructions) {
+	Dcpu cpu;
+	runProgram(cpu);
+
+	ExecutionStats::Snapshot stats = cpu.stats.snapshot();
+	EXPECT_EQ(4, stats.instructions);
+	EXPECT_EQ(1, stats.skipped);
+	EXPECT_EQ(cpu.getCycles(), stats.cycles);
+
+	EXPECT_EQ(2, stats.basicOpcodes[0x01]);
+	EXPECT_EQ(1, stats.basicOpcodes[0x12]);
+	EXPECT_EQ(1, stats.specialOpcodes[0x12]);
+	EXPECT_EQ(1, stats.hardwareInterrupts[0]);
+
+	EXPECT_EQ(3, stats.aModes[ExecutionStats::operandMode(0x21)]);
+	EXPECT_EQ(1, stats.aModes[ExecutionStats::operandMode(0x00)]);
+	EXPECT_EQ(2, stats.bModes[ExecutionStats::operandMode(0x00)]);
+	EXPECT_EQ(1, stats.bModes[ExecutionStats::operandMode(0x18)]);
+
+	cpu.clear();
+	EXPECT_EQ(0, cpu.stats.snapshot().instructions);
+}
+
+TEST(ExecutionStatsTest, OperandModes) {
+	EXPECT_STREQ("register", ExecutionStats::OPERAND_MODE_NAMES[ExecutionStats::operandMode(0x07)]);
+	EXPECT_STREQ("[register]", ExecutionStats::OPERAND_MODE_NAMES[ExecutionStats::operandMode(0x08)]);
+	EXPECT_STREQ("[register+next]", ExecutionStats::OPERAND_MODE_NAMES[ExecutionStats::operandMode(0x17)]);
+	EXPECT_STREQ("pick", ExecutionStats::OPERAND_MODE_NAMES[ExecutionStats::operandMode(0x1a)]);
+	EXPECT_STREQ("pc", ExecutionStats::OPERAND_MODE_NAMES[ExecutionStats::operandMode(0x1c)]);
+	EXPECT_STREQ("next", ExecutionStats::OPERAND_MODE_NAMES[ExecutionStats::operandMode(0x1f)]);
+	EXPECT_STREQ("literal", ExecutionStats::OPERAND_MODE_NAMES[ExecutionStats::operandMode(0x3f)]);
+}
+
+TEST(ExecutionStatsTest, CountsInterrupts) {
+	Dcpu cpu;
+
+	cpu.interrupts.send(1);
+	cpu.registers.ia = 0x100;
+	cpu.interrupts.send(2);
+	cpu.interrupts.send(3);
+
+	ExecutionStats::Snapshot stats = cpu.stats.snapshot();
+	EXPECT_EQ(1, stats.interruptsDropped);
+	EXPECT_EQ(1, stats.interruptsDelivered);
+	EXPECT_EQ(1, stats.interruptsQueued);
+}
+
+TEST(ExecutionStatsTest, WritesJson) {
+	Dcpu cpu;
+	runProgram(cpu);
+
+	ostringstream out;
+	cpu.stats.snapshot().writeJson(out);
+	string json = out.str();
+
+	EXPECT_NE(string::npos, json.find("\"instructions\": 4,"));
+	EXPECT_NE(string::npos, json.find("\"hwi\": {\"0\": 1}"));
+	EXPECT_NE(string::npos, json.find("\"set\": 2"));
+	EXPECT_NE(string::npos, json.find("\"hwi\": 1"));
+	EXPECT_NE(string::npos, json.find("\"push/pop\": 1"));
+}
+
+TEST(ExecutionStatsTest, ServesJsonOnSocket) {
+	Dcpu cpu;
+	runProgram(cpu);
+
+	string path = "/tmp/dcpu-stats-" + to_string(getpid());
+	StatsServer server(cpu.stats, path);
+
+	int client = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path.c_str());
+	ASSERT_EQ(0, connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+
+	string json;
+	char buffer[256];
+	ssize_t received;
+	while ((received = read(client, buffer, sizeof(buffer))) > 0) {
+		json.append(buffer, received);
+	}
+	close(client);
+
+	ostringstream expected;
+	cpu.stats.snapshot().writeJson(expected);
+	EXPECT_EQ(expected.str(), json);
+}
@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include <dcpu.hpp>
+#include <hardware.hpp>
+#include <debugger.hpp>
+#include <timeline.hpp>
+#include "utils/test_program.hpp"
+
+using namespace std;
+using namespace dcpu::emulator;
+
+// A device whose answers depend on how often it has been called, so a replay
+// that called it again would diverge.
+class CountingHardware : public HardwareDevice {
+public:
+	uint16_t ticks;
+	uint16_t calls;
+
+	CountingHardware(Dcpu &cpu) : HardwareDevice(cpu, 0, 0, 0), ticks(0), calls(0) {}
+
+	virtual void tick() {
+		if (++ticks % 37 == 0) {
+			cpu.interrupts.send(ticks);
+		}
+	}
+
+	virtual uint16_t interrupt() {
+		calls++;
+		cpu.registers.b = calls * 3;
+		cpu.memory.write(0x2000, calls);
+		return 0;
+	}
+};
+
+struct State {
+	uint64_t cycles;
+	uint16_t a, b, i, j, pc, sp;
+	uint16_t total, lastCall;
+
+	State(Dcpu &cpu) : cycles(cpu.getCycles()), a(cpu.registers.a), b(cpu.registers.b), i(cpu.registers.i),
+			j(cpu.registers.j), pc(cpu.registers.pc), sp(cpu.registers.sp), total(cpu.memory[0x1000]),
+			lastCall(cpu.memory[0x2000]) {}
+
+	bool operator==(const State &other) const {
+		return cycles == other.cycles && a == other.a && b == other.b && i == other.i && j == other.j
+				&& pc == other.pc && sp == other.sp && total == other.total && lastCall == other.lastCall;
+	}
+};
+
+// 0000: IAS 0x0010
+// 0002: HWI 0
+// 0003: ADD [0x1000], B
+// 0005: ADD I, 1
+// 0006: SET PC, 2
+// 0010: ADD J, 1       (interrupt handler)
+// 0011: RFI 0
+static shared_ptr<CountingHardware> loadExample(Dcpu &cpu) {
+	loadProgram(cpu, { 0x7d40, 0x0010, 0x8640, 0x07c2, 0x1000, 0x88c2, 0x8b81 });
+	loadProgram(cpu, { 0x88e2, 0x8560 }, 0x10);
+
+	auto device = make_shared<CountingHardware>(cpu);
+	cpu.hardwareManager.registerDevice(device);
+	return device;
+}
+
+static vector<State> record(Debugger &debugger, Dcpu &cpu, int steps) {
+	vector<State> states;
+	states.push_back(State(cpu));
+	for (int i = 0; i < steps; i++) {
+		debugger.step();
+		states.push_back(State(cpu));
+	}
+	return states;
+}
+
+TEST(TimelineTest, DirtyPages) {
+	DcpuMemory memory;
+
+	memory.markClean();
+	EXPECT_FALSE(memory.isPageDirty(0x10));
+	memory.write(0x1000, 1);
+	EXPECT_TRUE(memory.isPageDirty(0x10));
+	EXPECT_FALSE(memory.isPageDirty(0x11));
+
+	DcpuMemory::Journal journal;
+	memory.setJournal(&journal);
+	memory.write(0x1234, 5);
+	memory.setJournal(nullptr);
+	memory.write(0x1235, 6);
+
+	ASSERT_EQ(1, journal.size());
+	EXPECT_EQ(0x1234, journal[0].first);
+	EXPECT_EQ(5, journal[0].second);
+}
+
+TEST(TimelineTest, StepBackReplaysDeviceInput) {
+	Dcpu cpu;
+	auto device = loadExample(cpu);
+	Debugger debugger(cpu);
+	Timeline timeline(cpu, 50);
+
+	vector<State> states = record(debugger, cpu, 400);
+	ASSERT_GT(cpu.registers.j, 0);
+	uint16_t calls = device->calls;
+	uint16_t ticks = device->ticks;
+
+	for (size_t i = states.size() - 1; i > 0; i--) {
+		ASSERT_EQ(StopReason::STEP, debugger.stepBack());
+		ASSERT_TRUE(states[i - 1] == State(cpu)) << "after stepping back to cycle " << states[i - 1].cycles;
+	}
+	EXPECT_EQ(StopReason::HISTORY_START, debugger.stepBack());
+
+	// forward again from the log, without asking the device
+	for (size_t i = 1; i < states.size(); i++) {
+		debugger.step();
+		ASSERT_TRUE(states[i] == State(cpu)) << "after stepping forward to cycle " << states[i].cycles;
+	}
+	EXPECT_EQ(calls, device->calls);
+	EXPECT_EQ(ticks, device->ticks);
+	EXPECT_FALSE(timeline.isReplaying());
+
+	// and past the present the device takes over again
+	debugger.step();
+	EXPECT_EQ(ticks + 1, device->ticks);
+}
+
+TEST(TimelineTest, ReverseContinueToWatchpoint) {
+	Dcpu cpu;
+	loadExample(cpu);
+	Debugger debugger(cpu);
+	Timeline timeline(cpu, 64);
+
+	vector<State> states = record(debugger, cpu, 300);
+	debugger.addWatchpoint(0x1000);
+
+	for (size_t i = states.size() - 1; i > 0; i--) {
+		if (states[i].total != states[i - 1].total && states[i].cycles < cpu.getCycles()) {
+			ASSERT_EQ(StopReason::WATCHPOINT, debugger.reverseContinue());
+			ASSERT_TRUE(states[i] == State(cpu)) << "expected the write at cycle " << states[i].cycles;
+			EXPECT_EQ(0x1000, debugger.getWatchAddress());
+			EXPECT_EQ(states[i - 1].total, debugger.getWatchOldValue());
+			EXPECT_EQ(states[i].total, debugger.getWatchValue());
+		}
+	}
+
+	EXPECT_EQ(StopReason::HISTORY_START, debugger.reverseContinue());
+	EXPECT_EQ(0, cpu.getCycles());
+}
+
+TEST(TimelineTest, ReverseContinueToConditionalBreakpoint) {
+	Dcpu cpu;
+	loadExample(cpu);
+	Debugger debugger(cpu);
+	Timeline timeline(cpu, 64);
+
+	vector<State> states = record(debugger, cpu, 300);
+	debugger.addBreakpoint(5, Condition::compile("I == 10", cpu));
+
+	EXPECT_EQ(StopReason::BREAKPOINT, debugger.reverseContinue());
+	EXPECT_EQ(5, cpu.registers.pc);
+	EXPECT_EQ(10, cpu.registers.i);
+
+	// execution continues forward from the point reached
+	debugger.addWatchpoint(0x1000);
+	EXPECT_EQ(StopReason::WATCHPOINT, debugger.run());
+	EXPECT_EQ(11, cpu.registers.i);
+}
+
+TEST(TimelineTest, BudgetThinsSnapshots) {
+	Dcpu cpu;
+	loadExample(cpu);
+	Debugger debugger(cpu);
+	size_t budget = 256 * 1024;
+	Timeline timeline(cpu, 10, budget);
+
+	vector<State> states = record(debugger, cpu, 2000);
+
+	EXPECT_LE(timeline.getMemoryUsage(), budget);
+	EXPECT_GT(timeline.getSnapshotCount(), 1);
+	EXPECT_LT(timeline.getSnapshotCount(), 2000 / 10);
+
+	for (int i = 0; i < 20; i++) {
+		ASSERT_EQ(StopReason::STEP, debugger.stepBack());
+		ASSERT_TRUE(states[states.size() - 2 - i] == State(cpu));
+	}
+
+	uint64_t target = states[100].cycles;
+	if (target >= timeline.getEarliestCycles()) {
+		EXPECT_EQ(StopReason::CYCLE_REACHED, debugger.runToCycle(target));
+		EXPECT_TRUE(states[100] == State(cpu));
+	}
+}
+
+TEST(TimelineTest, EditDiscardsFuture) {
+	Dcpu cpu;
+	loadExample(cpu);
+	Debugger debugger(cpu);
+	Timeline timeline(cpu, 20);
+
+	vector<State> states = record(debugger, cpu, 100);
+	EXPECT_EQ(StopReason::CYCLE_REACHED, debugger.runToCycle(states[50].cycles));
+	EXPECT_TRUE(timeline.isReplaying());
+
+	cpu.memory[0x1000] = 0x4000;
+	timeline.stateEdited();
+	EXPECT_FALSE(timeline.isReplaying());
+	EXPECT_EQ(states[50].cycles, timeline.getPresentCycles());
+
+	debugger.step();
+	debugger.step();
+	ASSERT_EQ(StopReason::STEP, debugger.stepBack());
+	ASSERT_EQ(StopReason::STEP, debugger.stepBack());
+	EXPECT_EQ(states[50].cycles, cpu.getCycles());
+	EXPECT_EQ(0x4000, cpu.memory[0x1000]);
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <memory>
+#include <unistd.h>
+
+#include <dcpu.hpp>
+#include <trace.hpp>
+#include <cfg.hpp>
+
+using namespace std;
+using namespace dcpu::emulator;
+
+class TraceTest : public ::testing::Test {
+public:
+	void SetUp() {
+		char path[] = "/tmp/dcpu-trace-XXXXXX";
+		int fd = mkstemp(path);
+		close(fd);
+		filename = path;
+	}
+
+	void TearDown() {
+		remove(filename.c_str());
+	}
+protected:
+	string filename;
+};
+
+TEST_F(TraceTest, InstructionLength) {
+	EXPECT_EQ(1, instructionLength(0x8801)); // SET A, 1
+	EXPECT_EQ(2, instructionLength(0x7c20)); // JSR next word
+	EXPECT_EQ(3, instructionLength(0x7fc1)); // SET [next word], next word
+	EXPECT_EQ(2, instructionLength(0x8a01)); // SET [A + next word], 1
+}
+
+TEST_F(TraceTest, RecordsInstructions) {
+	Dcpu cpu;
+	// SET A, 1
+	// SET [0x1000], A
+	cpu.memory[0] = 0x8801;
+	cpu.memory[1] = 0x03c1;
+	cpu.memory[2] = 0x1000;
+
+	{
+		TraceBuffer buffer(filename, 16);
+		InstructionTracer tracer(cpu, buffer);
+		cpu.tracer = &tracer;
+
+		cpu.tick();
+		cpu.tick();
+		cpu.tracer = nullptr;
+	}
+
+	TraceBuffer buffer(filename);
+	ASSERT_EQ(2, buffer.size());
+	EXPECT_EQ(3, buffer.getEndCycles());
+
+	EXPECT_EQ(0, buffer[0].pc);
+	EXPECT_EQ(1, buffer[0].cycleDelta);
+	EXPECT_EQ(1, buffer[0].wordCount);
+	EXPECT_EQ(static_cast<uint8_t>(registers::A), buffer[0].changedRegister);
+	EXPECT_EQ(1, buffer[0].registerValue);
+	EXPECT_FALSE(buffer[0].flags & TraceRecord::MEMORY_WRITE);
+
+	EXPECT_EQ(1, buffer[1].pc);
+	EXPECT_EQ(2, buffer[1].cycleDelta);
+	EXPECT_EQ(2, buffer[1].wordCount);
+	EXPECT_EQ(0x1000, buffer[1].words[1]);
+	EXPECT_EQ(TraceRecord::NO_REGISTER, buffer[1].changedRegister);
+	EXPECT_TRUE(buffer[1].flags & TraceRecord::MEMORY_WRITE);
+	EXPECT_EQ(0x1000, buffer[1].writeAddress);
+	EXPECT_EQ(1, buffer[1].writeValue);
+}
+
+TEST_F(TraceTest, RingKeepsMostRecent) {
+	Dcpu cpu;
+	for (int i = 0; i < 10; i++) {
+		cpu.memory[i] = 0x8801;
+	}
+
+	TraceBuffer buffer(filename, 4);
+	InstructionTracer tracer(cpu, buffer);
+	cpu.tracer = &tracer;
+
+	for (int i = 0; i < 10; i++) {
+		cpu.tick();
+	}
+
+	EXPECT_EQ(10, buffer.getWritten());
+	ASSERT_EQ(4, buffer.size());
+	EXPECT_EQ(6, buffer[0].pc);
+	EXPECT_EQ(9, buffer[3].pc);
+}
+
+TEST_F(TraceTest, RejectsOtherFiles) {
+	FILE *file = fopen(filename.c_str(), "w");
+	fputs("not a trace file, but long enough to hold a header", file);
+	fclose(file);
+
+	EXPECT_THROW(TraceBuffer buffer(filename), runtime_error);
+}
+
+TEST_F(TraceTest, LeavesCodePagesShared) {
+	// SET A, 1
+	// HCF 0
+	uint16_t program[] = { 0x8801, 0x84e0 };
+	Dcpu cpu;
+	cpu.load(make_shared<MemoryImage>(program, 2));
+
+	TraceBuffer buffer(filename, 4);
+	InstructionTracer tracer(cpu, buffer);
+	cpu.tracer = &tracer;
+	cpu.tick();
+	cpu.tick();
+
+	EXPECT_EQ(2, buffer.size());
+	EXPECT_TRUE(cpu.memory.isPageShared(0));
+}
@@ -0,0 +1,13 @@
+#include "test_program.hpp"
+
+void loadProgram(dcpu::emulator::Dcpu &cpu, std::initializer_list<uint16_t> program, uint16_t at) {
+	for (uint16_t word : program) {
+		cpu.memory[at++] = word;
+	}
+}
+
+void loadProgram(std::vector<uint16_t> &memory, std::initializer_list<uint16_t> program, uint16_t at) {
+	for (uint16_t word : program) {
+		memory[at++] = word;
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <initializer_list>
+
+#include "dcpu.hpp"
+
+/**
+ * Writes the words into memory from the address on, the way tests lay out
+ * their programs.
+ */
+void loadProgram(dcpu::emulator::Dcpu &cpu, std::initializer_list<uint16_t> program, uint16_t at = 0);
+void loadProgram(std::vector<uint16_t> &memory, std::initializer_list<uint16_t> program, uint16_t at = 0);
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <unistd.h>
+
+#include <dcpu.hpp>
+#include <cfg.hpp>
+#include <wcet.hpp>
+#include "utils/test_program.hpp"
+
+using namespace std;
+using namespace dcpu::emulator;
+
+// 0000: SET I, 0
+// 0001: JSR 0x0010
+// 0003: ADD I, 1       (runs ten times)
+// 0004: IFN I, 10
+// 0005: SET PC, 3
+// 0006: HCF 0
+// 0010: SUB A, 1
+// 0011: SET PC, POP
+static void loadExample(Dcpu &cpu) {
+	loadProgram(cpu, { 0x84c1, 0x7c20, 0x0010, 0x88c2, 0xacd3, 0x9381, 0x84e0 });
+	loadProgram(cpu, { 0x8803, 0x6381 }, 0x10);
+}
+
+static vector<uint16_t> copyMemory(const Dcpu &cpu) {
+	vector<uint16_t> memory(ControlFlowGraph::TOTAL_WORDS);
+	for (uint32_t address = 0; address < memory.size(); address++) {
+		memory[address] = cpu.memory.peek(address);
+	}
+	return memory;
+}
+
+TEST(CycleEstimatorTest, BoundedLoopMatchesEmulator) {
+	Dcpu cpu;
+	loadExample(cpu);
+	vector<uint16_t> memory = copyMemory(cpu);
+	ControlFlowGraph cfg(memory.data(), { 0 });
+	CycleEstimator estimator(memory.data(), cfg, { { 0x0003, 10 } });
+
+	EXPECT_EQ(vector<uint16_t>({ 0x0000, 0x0010 }), estimator.getRoutines());
+
+	CycleEstimator::Estimate routine = estimator.estimate(0x0010);
+	EXPECT_TRUE(routine.bounded);
+	EXPECT_EQ(3, routine.best);
+	EXPECT_EQ(3, routine.worst);
+
+	CycleEstimator::Estimate program = estimator.estimate(0x0000);
+	ASSERT_TRUE(program.bounded) << program.reason;
+	EXPECT_EQ(14, program.best);
+	EXPECT_EQ(59, program.worst);
+
+	while (!cpu.isOnFire()) {
+		cpu.tick();
+	}
+	EXPECT_EQ(program.worst, cpu.getCycles());
+}
+
+TEST(CycleEstimatorTest, LoopWithoutBound) {
+	Dcpu cpu;
+	loadExample(cpu);
+	vector<uint16_t> memory = copyMemory(cpu);
+	ControlFlowGraph cfg(memory.data(), { 0 });
+	CycleEstimator estimator(memory.data(), cfg, {});
+
+	CycleEstimator::Estimate program = estimator.estimate(0x0000);
+	EXPECT_FALSE(program.bounded);
+	EXPECT_EQ("the loop at 0x0003 has no .BOUND", program.reason);
+	EXPECT_EQ(14, program.best);
+}
+
+TEST(CycleEstimatorTest, RecursionAndHandlers) {
+	// 0000: IAS 0x0020
+	// 0002: JSR 0x0010
+	// 0004: HCF 0
+	// 0010: JSR 0x0010
+	// 0012: SET PC, POP
+	// 0020: HWI 0
+	// 0021: RFI 0
+	vector<uint16_t> memory(ControlFlowGraph::TOTAL_WORDS, 0);
+	loadProgram(memory, { 0x7d40, 0x0020, 0x7c20, 0x0010, 0x84e0 });
+	loadProgram(memory, { 0x7c20, 0x0010, 0x6381 }, 0x10);
+	loadProgram(memory, { 0x8640, 0x8560 }, 0x20);
+
+	ControlFlowGraph cfg(memory.data(), { 0 });
+	CycleEstimator estimator(memory.data(), cfg, {}, 7);
+
+	EXPECT_EQ(vector<uint16_t>({ 0x0000, 0x0010, 0x0020 }), estimator.getRoutines());
+	EXPECT_TRUE(cfg.isHandler(0x0020));
+	EXPECT_FALSE(cfg.isHandler(0x0010));
+
+	CycleEstimator::Estimate handler = estimator.estimate(0x0020);
+	ASSERT_TRUE(handler.bounded);
+	EXPECT_EQ(7, handler.best);
+	EXPECT_EQ(14, handler.worst);
+
+	CycleEstimator::Estimate recursive = estimator.estimate(0x0010);
+	EXPECT_FALSE(recursive.bounded);
+	EXPECT_EQ("the routine at 0x0010 calls itself", recursive.reason);
+	EXPECT_FALSE(estimator.estimate(0x0000).bounded);
+
+	EXPECT_THROW(estimator.estimate(0x0011), invalid_argument);
+}
+
+TEST(CycleEstimatorTest, LoadBounds) {
+	char path[] = "/tmp/dcpu-bounds-XXXXXX";
+	int fd = mkstemp(path);
+	close(fd);
+
+	{
+		ofstream out(path);
+		out << "; written by the assembler\n0x0003 10\n\n0x1000 4\n";
+	}
+	CycleEstimator::LoopBounds bounds = CycleEstimator::loadBounds(path);
+	EXPECT_EQ(2, bounds.size());
+	EXPECT_EQ(10, bounds[0x0003]);
+	EXPECT_EQ(4, bounds[0x1000]);
+
+	{
+		ofstream out(path);
+		out << "0x0003\n";
+	}
+	EXPECT_THROW(CycleEstimator::loadBounds(path), runtime_error);
+
+	remove(path);
+}